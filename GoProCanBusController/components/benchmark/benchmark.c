@@ -0,0 +1,602 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cameraCommand.h"
+#include "cameraInfo.h"
+#include "cameraState.h"
+#include "remoteProtocol.h"
+#include "stationTable.h"
+#include "shutterTrace.h"
+#include "persist.h"
+#include "configStore.h"
+#include "udpServer.h"
+#include "canSignals.h"
+#include "canBus.h"
+#include "ble_gopro.h"
+#include "goproAdv.h"
+#include "benchmark.h"
+
+static const char *TAG = "benchmark";
+
+// Calls per sample of the CPU-bound benchmarks, enough to dwarf the
+// microsecond resolution of the timer
+#define BENCHMARK_BATCH 1000
+
+#define JOIN_TIMEOUT_MS 30000
+#define ACK_TIMEOUT_MS  2000
+
+// Frame rate setting written by the round trip benchmarks, any valid one does
+#define FPS_ARG 8
+
+// Datagrams per sample of the receive throughput benchmark, well inside the
+// socket's receive buffer so none are lost before the server drains them
+#define UDP_BLAST_FRAMES 64
+
+// Marks the benchmark's datagrams in the reserved header bytes, followed by
+// a sequence number, so camera replies in between are told apart
+static const uint8_t udp_rx_tag[4] = {'b', 'n', 'c', 'h'};
+#define UDP_RX_SEQ_OFFSET 4
+
+// Status reply of a HERO legacy camera, trimmed to the usual size
+static const char status_json[] =
+    "{\"status\":{\"1\":1,\"2\":2,\"3\":0,\"4\":0,\"6\":0,\"8\":0,\"9\":0,\"10\":0,\"11\":0,"
+    "\"13\":0,\"14\":0,\"15\":0,\"16\":0,\"17\":1,\"19\":0,\"20\":0,\"21\":0,\"22\":0,\"23\":0,"
+    "\"24\":0,\"26\":0,\"27\":0,\"28\":0,\"30\":\"GP12345678\",\"31\":0,\"32\":0,\"33\":0,"
+    "\"34\":0,\"35\":0,\"36\":0,\"37\":0,\"38\":0,\"39\":0,\"40\":\"%12%0A%13%0A%0B%2D\","
+    "\"41\":0,\"42\":0,\"43\":0,\"44\":0,\"45\":0,\"54\":31287232,\"55\":1,\"56\":0,\"57\":0,"
+    "\"58\":0,\"59\":0,\"60\":500,\"61\":2,\"62\":0,\"63\":0,\"64\":4383,\"69\":1,\"70\":87,"
+    "\"71\":12,\"72\":0,\"73\":20,\"74\":0,\"75\":0,\"76\":1,\"77\":0,\"78\":1},"
+    "\"settings\":{\"2\":1,\"3\":8,\"4\":0,\"5\":0,\"6\":1,\"7\":0,\"8\":0,\"9\":0,\"10\":0,"
+    "\"11\":0,\"12\":0,\"13\":0,\"14\":0,\"15\":4,\"16\":0,\"17\":0,\"18\":1,\"19\":0,\"20\":0}}";
+
+// Engine speed as a vehicle bus sends it, a big endian signal with a scale
+static const can_signal_t rpm_signal = {
+    .name = "engine_rpm",
+    .id = 0x0C0,
+    .start = 7,
+    .length = 16,
+    .byte_order = CAN_BYTE_ORDER_MOTOROLA,
+    .factor = 0.25f,
+};
+
+typedef struct {
+    const char *name;
+    const char *unit;           // "ns" per call or frame, or "us" per round trip
+    bool (*setup)(void);        // Optional, false skips the benchmark
+    bool (*sample)(uint32_t *value);
+    void (*teardown)(void);
+} bench_t;
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    int samples;
+    int failed;
+    uint32_t min, p50, p90, p99, max, mean;
+} bench_result_t;
+
+// Keeps the compiler from dropping the work being timed
+static volatile uint32_t sink;
+
+static uint32_t values[CONFIG_BENCHMARK_SAMPLES];
+static int camera_count;
+static esp_http_client_handle_t http_client;
+static persist_id_t persist_id = -1;
+static uint32_t persist_counter;
+
+static uint32_t batch_ns(int64_t start_us)
+{
+    return (uint32_t)((esp_timer_get_time() - start_us) * 1000 / BENCHMARK_BATCH);
+}
+
+static bool bench_command_encode_ble(uint32_t *value)
+{
+    const camera_command_t *cmd = camera_command_find("set_fps");
+    uint8_t packet[CAMERA_BLE_PACKET_MAX];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        size_t len = camera_command_encode_ble(cmd, i & 0x0f, packet);
+        sink += packet[len - 1];
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+static bool bench_remote_frame_build(uint32_t *value)
+{
+    uint8_t frame[REMOTE_FRAME_MAX_LEN];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        uint8_t arg = i & 1 ? REMOTE_SHUTTER_START : REMOTE_SHUTTER_STOP;
+        sink += remote_frame_build(frame, sizeof(frame), REMOTE_CMD_SHUTTER, &arg, 1);
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+static bool bench_remote_frame_parse(uint32_t *value)
+{
+    // Status reply of a recording camera
+    uint8_t reply[REMOTE_HEADER_LEN + 2] = {0};
+    memcpy(&reply[REMOTE_OPCODE_OFFSET], "st", 2);
+    reply[REMOTE_HEADER_LEN + REMOTE_ST_RECORDING] = 1;
+
+    remote_frame_t frame;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        if (remote_frame_parse(reply, sizeof(reply), &frame)) {
+            sink += frame.command;
+        }
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+static bool bench_can_signal_decode(uint32_t *value)
+{
+    uint8_t data[8] = {0x2e, 0xe0, 0, 0, 0, 0, 0, 0};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        data[1] = i;
+        sink += (uint32_t)can_signal_decode(&rpm_signal, data);
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+// A record frame with the bit clear, which leaves the state machine idle
+static bool bench_can_ingest(uint32_t *value)
+{
+    const uint8_t data[8] = {0};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        can_bus_ingest(CONFIG_CAN_RECORD_ID, data, sizeof(data), 0);
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+// What a HERO camera puts in its advertisement: flags, the GoPro service
+// and its name, then manufacturer data
+static const uint8_t gopro_adv[] = {
+    0x02, 0x01, 0x06,
+    0x03, 0x03, 0xa6, 0xfe,
+    0x0b, 0x09, 'G', 'o', 'P', 'r', 'o', ' ', '1', '2', '3', '4',
+    0x0b, 0xff, 0xf2, 0x02, 0x02, 0x01, 0x38, 0x33, 0x00, 0x00, 0x00, 0x00,
+};
+
+static bool bench_gopro_adv_parse(uint32_t *value)
+{
+    gopro_adv_t adv;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        sink += gopro_adv_parse(gopro_adv, sizeof(gopro_adv), &adv);
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+static bool bench_status_json_parse(uint32_t *value)
+{
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_BATCH; i++) {
+        camera_info_apply_status(0, status_json);
+    }
+    *value = batch_ns(start);
+    return true;
+}
+
+static void persist_snapshot(void *buf, void *ctx)
+{
+    memcpy(buf, &persist_counter, sizeof(persist_counter));
+}
+
+static const persist_record_t persist_record = {
+    .key = "bench",
+    .version = 1,
+    .size = sizeof(uint32_t),
+    .snapshot = persist_snapshot,
+};
+
+static bool persist_setup(void)
+{
+    if (persist_id < 0) {
+        persist_id = persist_register(&persist_record);
+    }
+    return persist_id >= 0;
+}
+
+// A changed record, so every sample really writes and commits
+static bool bench_persist_commit(uint32_t *value)
+{
+    persist_counter++;
+    int64_t start = esp_timer_get_time();
+    persist_mark_dirty(persist_id);
+    persist_flush();
+    *value = esp_timer_get_time() - start;
+    return true;
+}
+
+static bool http_setup(void)
+{
+    http_client = camera_command_http_client(0);
+    return http_client != NULL;
+}
+
+static void http_teardown(void)
+{
+    esp_http_client_cleanup(http_client);
+    http_client = NULL;
+}
+
+// Keep-alive, as a series of commands to one camera goes
+static bool bench_http_roundtrip(uint32_t *value)
+{
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = camera_command_send_http(http_client, camera_command_find("set_fps"), 0, FPS_ARG);
+    *value = esp_timer_get_time() - start;
+    return err == ESP_OK;
+}
+
+// The simulated link adds no delay, so this is the controller's own share
+static bool ble_setup(void)
+{
+    for (int waited = 0; connected_camera.command_handle == 0; waited += 100) {
+        if (waited >= JOIN_TIMEOUT_MS) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    ble_sim_set_link(&(ble_sim_link_t){0});
+    return true;
+}
+
+static void ble_teardown(void)
+{
+    ble_sim_set_link(&(ble_sim_link_t){
+        .latency_us = CONFIG_BLE_SIM_LATENCY_MS * 1000,
+        .jitter_us = CONFIG_BLE_SIM_JITTER_MS * 1000,
+        .loss_permille = CONFIG_BLE_SIM_LOSS_PERMILLE,
+    });
+}
+
+static bool bench_ble_roundtrip(uint32_t *value)
+{
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = camera_command_send_ble(camera_command_find("set_fps"), 0, FPS_ARG);
+    *value = esp_timer_get_time() - start;
+    return err == ESP_OK;
+}
+
+static bool fanout_setup(void)
+{
+    return camera_count >= 2;
+}
+
+// One Smart Remote shutter to every camera, traced the way a REST call is.
+// Gives the first and the last ack after the send.
+static bool fanout(uint32_t *first, uint32_t *last)
+{
+    static bool recording;
+    recording = !recording;
+    const camera_command_t *cmd = camera_command_find(recording ? "shutter_start" : "shutter_stop");
+
+    trace_id_t id = trace_begin(TRACE_SOURCE_HTTP, recording, 0);
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        trace_bind(id, camera);
+    }
+    uint32_t targets = camera_command_send_remote_all(cmd, cmd->fixed_arg);
+    if (targets == 0) {
+        return false;
+    }
+
+    int64_t deadline = esp_timer_get_time() + ACK_TIMEOUT_MS * 1000;
+    uint32_t acked = 0;
+    *first = UINT32_MAX;
+    *last = 0;
+    while (acked != targets && esp_timer_get_time() < deadline) {
+        vTaskDelay(1);
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            uint32_t offset;
+            if ((targets & ~acked & (1u << camera)) &&
+                trace_stage_offset(id, camera, TRACE_STAGE_ACKED, &offset)) {
+                acked |= 1u << camera;
+                *first = offset < *first ? offset : *first;
+                *last = offset > *last ? offset : *last;
+            }
+        }
+    }
+    return acked == targets;
+}
+
+static bool bench_fanout_last_ack(uint32_t *value)
+{
+    uint32_t first;
+    return fanout(&first, value);
+}
+
+// Spread between the first and the last camera to take the shutter
+static bool bench_fanout_skew(uint32_t *value)
+{
+    uint32_t first, last;
+    if (!fanout(&first, &last)) {
+        return false;
+    }
+    *value = last - first;
+    return true;
+}
+
+// One socket per joined camera, bound to its address, so every datagram is
+// demultiplexed to its camera as a reply would be
+static int udp_rx_socks[MAX_CAMERAS];
+static int udp_rx_sock_count;
+static struct sockaddr_in udp_rx_dest;
+static uint32_t udp_rx_seq;
+static uint32_t udp_rx_sent;
+
+// Written by the server task through the receive hook
+static uint32_t udp_rx_seen;
+static uint32_t udp_rx_last_seq;
+static int64_t udp_rx_last_us;
+
+// Frames and time of all throughput samples, for the rate in the log
+static uint64_t udp_rx_total_frames;
+static int64_t udp_rx_total_us;
+
+static void udp_rx_hook(int camera, const uint8_t *data, size_t len, void *ctx)
+{
+    uint32_t seq;
+    if (len < UDP_RX_SEQ_OFFSET + sizeof(seq) || memcmp(data, udp_rx_tag, sizeof(udp_rx_tag)) != 0) {
+        return;
+    }
+    memcpy(&seq, &data[UDP_RX_SEQ_OFFSET], sizeof(seq));
+    __atomic_store_n(&udp_rx_last_us, esp_timer_get_time(), __ATOMIC_RELAXED);
+    __atomic_store_n(&udp_rx_last_seq, seq, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&udp_rx_seen, 1, __ATOMIC_RELEASE);
+}
+
+static void udp_rx_teardown(void)
+{
+    udp_server_set_rx_hook(NULL, NULL);
+    for (int i = 0; i < udp_rx_sock_count; i++) {
+        close(udp_rx_socks[i]);
+    }
+    udp_rx_sock_count = 0;
+    if (udp_rx_total_us > 0) {
+        ESP_LOGI(TAG, "udp_rx_throughput: %lu frames/s",
+                 (unsigned long)(udp_rx_total_frames * 1000000 / udp_rx_total_us));
+    }
+}
+
+static bool udp_rx_setup(void)
+{
+    const runtime_config_t *config = config_store_acquire();
+    udp_rx_dest = (struct sockaddr_in){
+        .sin_family = AF_INET,
+        .sin_port = htons(config->listen_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    config_store_release(config);
+
+    udp_rx_sock_count = 0;
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        struct sockaddr_in source = {.sin_family = AF_INET};
+        if (!station_table_camera_ip(camera, &source.sin_addr.s_addr)) {
+            continue;
+        }
+        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock < 0) {
+            break;
+        }
+        udp_rx_socks[udp_rx_sock_count++] = sock;
+        if (bind(sock, (struct sockaddr *)&source, sizeof(source)) < 0) {
+            ESP_LOGE(TAG, "Cannot send as camera %d: errno %d", camera, errno);
+            udp_rx_teardown();
+            return false;
+        }
+    }
+    if (udp_rx_sock_count == 0) {
+        return false;
+    }
+    udp_rx_total_frames = 0;
+    udp_rx_total_us = 0;
+    udp_server_set_rx_hook(udp_rx_hook, NULL);
+    return true;
+}
+
+// A status reply without a payload, which leaves the camera's state alone
+static bool udp_rx_send(void)
+{
+    uint8_t frame[REMOTE_HEADER_LEN] = {0};
+    memcpy(frame, udp_rx_tag, sizeof(udp_rx_tag));
+    uint32_t seq = ++udp_rx_seq;
+    memcpy(&frame[UDP_RX_SEQ_OFFSET], &seq, sizeof(seq));
+    memcpy(&frame[REMOTE_OPCODE_OFFSET], "st", 2);
+    int sock = udp_rx_socks[udp_rx_sent++ % udp_rx_sock_count];
+    return sendto(sock, frame, sizeof(frame), 0, (struct sockaddr *)&udp_rx_dest, sizeof(udp_rx_dest)) ==
+           sizeof(frame);
+}
+
+// Until the server dispatched count frames since seen was read
+static bool udp_rx_wait(uint32_t seen, uint32_t count)
+{
+    int64_t deadline = esp_timer_get_time() + ACK_TIMEOUT_MS * 1000;
+    while (__atomic_load_n(&udp_rx_seen, __ATOMIC_ACQUIRE) - seen < count) {
+        if (esp_timer_get_time() >= deadline) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// From the send to the engine having taken the datagram, through select,
+// the batched drain and the lookup of the camera
+static bool bench_udp_rx_dispatch(uint32_t *value)
+{
+    uint32_t seen = __atomic_load_n(&udp_rx_seen, __ATOMIC_ACQUIRE);
+    int64_t start = esp_timer_get_time();
+    if (!udp_rx_send() || !udp_rx_wait(seen, 1) ||
+        __atomic_load_n(&udp_rx_last_seq, __ATOMIC_RELAXED) != udp_rx_seq) {
+        return false;
+    }
+    *value = __atomic_load_n(&udp_rx_last_us, __ATOMIC_RELAXED) - start;
+    return true;
+}
+
+// A burst spread over every camera's socket, as ns per frame so a slower
+// run compares as a larger number; the teardown logs the rate
+static bool bench_udp_rx_throughput(uint32_t *value)
+{
+    uint32_t seen = __atomic_load_n(&udp_rx_seen, __ATOMIC_ACQUIRE);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < UDP_BLAST_FRAMES; i++) {
+        if (!udp_rx_send()) {
+            return false;
+        }
+    }
+    if (!udp_rx_wait(seen, UDP_BLAST_FRAMES)) {
+        return false;
+    }
+    int64_t elapsed = __atomic_load_n(&udp_rx_last_us, __ATOMIC_RELAXED) - start;
+    udp_rx_total_frames += UDP_BLAST_FRAMES;
+    udp_rx_total_us += elapsed;
+    *value = (uint32_t)(elapsed * 1000 / UDP_BLAST_FRAMES);
+    return true;
+}
+
+static const bench_t benches[] = {
+    {"command_encode_ble", "ns", NULL, bench_command_encode_ble, NULL},
+    {"remote_frame_build", "ns", NULL, bench_remote_frame_build, NULL},
+    {"remote_frame_parse", "ns", NULL, bench_remote_frame_parse, NULL},
+    {"can_signal_decode", "ns", NULL, bench_can_signal_decode, NULL},
+    {"can_ingest", "ns", NULL, bench_can_ingest, NULL},
+    {"status_json_parse", "ns", NULL, bench_status_json_parse, NULL},
+    {"gopro_adv_parse", "ns", NULL, bench_gopro_adv_parse, NULL},
+    {"persist_commit", "us", persist_setup, bench_persist_commit, NULL},
+    {"http_roundtrip", "us", http_setup, bench_http_roundtrip, http_teardown},
+    {"ble_roundtrip", "us", ble_setup, bench_ble_roundtrip, ble_teardown},
+    {"fanout_last_ack", "us", fanout_setup, bench_fanout_last_ack, NULL},
+    {"fanout_skew", "us", fanout_setup, bench_fanout_skew, NULL},
+    {"udp_rx_dispatch", "us", udp_rx_setup, bench_udp_rx_dispatch, udp_rx_teardown},
+    {"udp_rx_throughput", "ns", udp_rx_setup, bench_udp_rx_throughput, udp_rx_teardown},
+};
+
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+static bench_result_t results[BENCH_COUNT];
+
+static int compare_values(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(int count, int p)
+{
+    return values[(count - 1) * p / 100];
+}
+
+static void run(const bench_t *bench, bench_result_t *result)
+{
+    *result = (bench_result_t){.name = bench->name, .unit = bench->unit};
+    if (bench->setup != NULL && !bench->setup()) {
+        ESP_LOGE(TAG, "%s: setup failed, skipped", bench->name);
+        result->failed = CONFIG_BENCHMARK_SAMPLES;
+        return;
+    }
+
+    uint64_t sum = 0;
+    for (int i = 0; i < CONFIG_BENCHMARK_SAMPLES; i++) {
+        uint32_t value;
+        if (bench->sample(&value)) {
+            values[result->samples++] = value;
+            sum += value;
+        } else {
+            result->failed++;
+        }
+    }
+    if (bench->teardown != NULL) {
+        bench->teardown();
+    }
+
+    int n = result->samples;
+    if (n > 0) {
+        qsort(values, n, sizeof(values[0]), compare_values);
+        result->min = values[0];
+        result->p50 = percentile(n, 50);
+        result->p90 = percentile(n, 90);
+        result->p99 = percentile(n, 99);
+        result->max = values[n - 1];
+        result->mean = sum / n;
+    }
+    ESP_LOGI(TAG, "%s: p50 %lu %s, p99 %lu %s, %d failed", bench->name, (unsigned long)result->p50,
+             bench->unit, (unsigned long)result->p99, bench->unit, result->failed);
+}
+
+static void write_results(FILE *out)
+{
+    fprintf(out, "{\"version\":1,\"samples\":%d,\"batch\":%d,\"cameras\":%d,\"benchmarks\":[",
+            CONFIG_BENCHMARK_SAMPLES, BENCHMARK_BATCH, camera_count);
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out, "%s\n{\"name\":\"%s\",\"unit\":\"%s\",\"samples\":%d,\"failed\":%d,"
+                "\"min\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu,\"mean\":%lu}",
+                i ? "," : "", r->name, r->unit, r->samples, r->failed, (unsigned long)r->min,
+                (unsigned long)r->p50, (unsigned long)r->p90, (unsigned long)r->p99,
+                (unsigned long)r->max, (unsigned long)r->mean);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+// Cameras with a DHCP lease, once all the simulated ones joined or the wait ran out
+static int wait_for_cameras(void)
+{
+    int count = 0;
+    for (int waited = 0; waited < JOIN_TIMEOUT_MS; waited += 100) {
+        count = 0;
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            uint32_t ip;
+            count += station_table_camera_ip(camera, &ip);
+        }
+        if (count >= CONFIG_WIFI_SIM_CAMERAS) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return count;
+}
+
+static void benchmark_task(void *arg)
+{
+    camera_count = wait_for_cameras();
+    ESP_LOGI(TAG, "%d cameras joined, %d samples per benchmark", camera_count, CONFIG_BENCHMARK_SAMPLES);
+
+    bool failed = false;
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        run(&benches[i], &results[i]);
+        failed |= results[i].failed > 0;
+    }
+
+    FILE *out = fopen(CONFIG_BENCHMARK_OUTPUT, "w");
+    if (out == NULL) {
+        ESP_LOGE(TAG, "Cannot write %s", CONFIG_BENCHMARK_OUTPUT);
+        failed = true;
+    } else {
+        write_results(out);
+        fclose(out);
+    }
+    write_results(stdout);
+    fflush(stdout);
+    exit(failed ? 1 : 0);
+}
+
+void benchmark_start(void)
+{
+    // Below the CAN and link tasks, whose work several benchmarks wait on
+    xTaskCreate(benchmark_task, "benchmark", 8192, NULL, 2, NULL);
+}
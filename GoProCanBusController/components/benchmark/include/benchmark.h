@@ -0,0 +1,18 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Benchmarks of the host build. The hot paths run against the in-process
+// simulators and the camera servers of tools/gopro_sim.py, and the results
+// go to CONFIG_BENCHMARK_OUTPUT as JSON:
+//
+//   {"version": 1, "samples": N, "cameras": N,
+//    "benchmarks": [{"name": ..., "unit": "ns" | "us", "samples": N, "failed": N,
+//                    "min": ..., "p50": ..., "p90": ..., "p99": ..., "max": ..., "mean": ...}]}
+//
+// CPU-bound paths are timed in batches and reported per call in ns, network
+// and flash paths per round trip in us.
+
+// Starts the benchmark task, which exits the process when it is done
+void benchmark_start(void);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,173 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_cpu.h"
+#endif
+#include "esp_timer.h"
+#include "binLog.h"
+
+#define RING_SIZE CONFIG_BINLOG_RECORDS_PER_CORE
+#define RING_MASK (RING_SIZE - 1)
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "CONFIG_BINLOG_RECORDS_PER_CORE must be a power of two");
+
+// Longest line the drain task prints, longer ones are cut
+#define DRAIN_LINE_MAX 160
+
+// Records sent per chunk by the HTTP handler
+#define HTTP_BATCH 16
+
+typedef struct {
+    uint32_t head;              // Slots reserved so far, only ever grows
+    uint32_t tail;              // Next slot the drain task prints
+    binlog_record_t slots[RING_SIZE];
+} binlog_ring_t;
+
+static binlog_ring_t rings[portNUM_PROCESSORS];
+static uint32_t dropped;
+
+// Lock-free on purpose: writers on the same core may preempt each other, and
+// ISRs log too. A slot is claimed with one atomic add, and its seq is cleared
+// while it is filled, so a reader can tell a torn copy from a whole one.
+void IRAM_ATTR binlog_write(esp_log_level_t level, const char *tag, const char *fmt, int argc, ...)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+#if CONFIG_IDF_TARGET_LINUX
+    int core = 0;
+#else
+    int core = esp_cpu_get_core_id();
+#endif
+    binlog_ring_t *ring = &rings[core];
+    uint32_t n = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    binlog_record_t *record = &ring->slots[n & RING_MASK];
+
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->time_us = now;
+    record->tag = (uint32_t)(uintptr_t)tag;
+    record->fmt = (uint32_t)(uintptr_t)fmt;
+    record->level = level;
+    record->argc = argc;
+    record->core = core;
+
+    va_list args;
+    va_start(args, argc);
+    for (int i = 0; i < argc; i++) {
+        record->args[i] = va_arg(args, uint32_t);
+    }
+    va_end(args);
+    __atomic_store_n(&record->seq, n + 1, __ATOMIC_RELEASE);
+}
+
+// Copies slot n if it is complete and was not overwritten during the copy
+static bool ring_read(binlog_ring_t *ring, uint32_t n, binlog_record_t *out)
+{
+    binlog_record_t *record = &ring->slots[n & RING_MASK];
+    if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != n + 1) {
+        return false;
+    }
+    memcpy(out, record, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&record->seq, __ATOMIC_RELAXED) == n + 1;
+}
+
+int32_t binlog_dropped(void)
+{
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+#if CONFIG_BINLOG_UART
+// Formatted here, where it costs nothing: every argument is one word on this
+// target, so passing all of them satisfies any format that uses fewer
+static void print_record(const binlog_record_t *record)
+{
+    static const char letters[] = "NEWIDV";
+    const uint32_t *a = record->args;
+    char line[DRAIN_LINE_MAX];
+    snprintf(line, sizeof(line), (const char *)(uintptr_t)record->fmt, a[0], a[1], a[2], a[3], a[4]);
+    printf("%c (%lu) %s: %s\n", record->level < sizeof(letters) - 1 ? letters[record->level] : '?',
+           (unsigned long)(record->time_us / 1000), (const char *)(uintptr_t)record->tag, line);
+}
+
+static void drain_ring(binlog_ring_t *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head - ring->tail > RING_SIZE) {
+        __atomic_fetch_add(&dropped, head - ring->tail - RING_SIZE, __ATOMIC_RELAXED);
+        ring->tail = head - RING_SIZE;
+    }
+
+    while (ring->tail != head) {
+        binlog_record_t record;
+        if (ring_read(ring, ring->tail, &record)) {
+            print_record(&record);
+        } else if (head - ring->tail < RING_SIZE) {
+            // Claimed but still being written, pick it up next time
+            return;
+        } else {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        }
+        ring->tail++;
+    }
+}
+
+static void binlog_drain_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_BINLOG_DRAIN_INTERVAL_MS));
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            drain_ring(&rings[core]);
+        }
+    }
+}
+#endif
+
+void binlog_init(void)
+{
+#if CONFIG_BINLOG_UART
+    // Just above idle, printing never holds up real work
+    xTaskCreate(binlog_drain_task, "binlog_drain", 3072, NULL, tskIDLE_PRIORITY + 1, NULL);
+#endif
+}
+
+esp_err_t binlog_http_handler(httpd_req_t *req)
+{
+    uint32_t heads[portNUM_PROCESSORS];
+    binlog_header_t header = {
+        .magic = BINLOG_MAGIC,
+        .version = BINLOG_VERSION,
+        .record_size = sizeof(binlog_record_t),
+        .now_us = (uint32_t)esp_timer_get_time(),
+        .dropped = binlog_dropped(),
+    };
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        heads[core] = __atomic_load_n(&rings[core].head, __ATOMIC_ACQUIRE);
+        header.count += heads[core] < RING_SIZE ? heads[core] : RING_SIZE;
+    }
+
+    // The rings keep running while this sends, slots overwritten or still
+    // being written by then go out zeroed and the decoder skips them
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t err = httpd_resp_send_chunk(req, (const char *)&header, sizeof(header));
+    binlog_record_t batch[HTTP_BATCH];
+    for (int core = 0; core < portNUM_PROCESSORS && err == ESP_OK; core++) {
+        uint32_t n = heads[core] < RING_SIZE ? 0 : heads[core] - RING_SIZE;
+        while (n != heads[core] && err == ESP_OK) {
+            int len = 0;
+            for (; len < HTTP_BATCH && n != heads[core]; len++, n++) {
+                if (!ring_read(&rings[core], n, &batch[len])) {
+                    memset(&batch[len], 0, sizeof(batch[len]));
+                }
+            }
+            err = httpd_resp_send_chunk(req, (const char *)batch, len * sizeof(binlog_record_t));
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
@@ -0,0 +1,82 @@
+#ifndef BIN_LOG_H
+#define BIN_LOG_H
+
+// Deferred-format logging. A record keeps the address of its format string
+// and up to BINLOG_MAX_ARGS raw argument words, so logging from a hot path is
+// a slot reservation and a few stores: nothing is formatted and nothing
+// waits for the UART. Each core writes its own lock-free ring.
+//
+// Records are printed as text by a low-priority drain task, or fetched raw
+// from GET /logs and turned back into text on the host by
+// tools/binlog_decode.py, which reads the format strings out of the ELF.
+//
+// Arguments must be integers of 32 bits or less, or pointers to strings that
+// live for the whole run (literals, tables in flash): the pointer is what is
+// kept, not the text.
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_http_server.h>
+
+#define BINLOG_MAX_ARGS 5
+#define BINLOG_MAGIC    "BLOG"
+#define BINLOG_VERSION  1
+
+typedef struct {
+    uint32_t seq;               // Slot number + 1 once the record is complete
+    uint32_t time_us;           // esp_timer time, low 32 bits
+    uint32_t tag;               // Addresses of the tag and format strings
+    uint32_t fmt;
+    uint8_t level;              // esp_log_level_t
+    uint8_t argc;
+    uint8_t core;
+    uint8_t reserved;
+    uint32_t args[BINLOG_MAX_ARGS];
+} binlog_record_t;
+
+// Start of the GET /logs body, followed by count records oldest first per core
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t now_us;            // esp_timer time of the snapshot, low 32 bits
+    uint32_t dropped;           // Overwritten before the drain reached them
+    uint32_t count;
+} binlog_header_t;
+
+// Starts the drain task, records written before it are kept
+void binlog_init(void);
+
+void binlog_write(esp_log_level_t level, const char *tag, const char *fmt, int argc, ...);
+
+// Records overwritten before the console drain printed them
+int32_t binlog_dropped(void);
+
+// GET returns the records still in the rings, see binlog_header_t
+esp_err_t binlog_http_handler(httpd_req_t *req);
+
+// Never called, lets the compiler check arguments against the format
+static inline __attribute__((format(printf, 1, 2))) void binlog_check(const char *fmt, ...)
+{
+}
+
+#define BINLOG_ARGC(...) BINLOG_ARGC_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define BINLOG_ARGC_(_0, _1, _2, _3, _4, _5, n, ...) n
+
+#define BINLOG_LEVEL(level, tag, fmt, ...) do {                                       \
+        _Static_assert(BINLOG_ARGC(__VA_ARGS__) <= BINLOG_MAX_ARGS, "too many arguments"); \
+        if (0) {                                                                      \
+            binlog_check(fmt, ##__VA_ARGS__);                                         \
+        }                                                                             \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                             \
+            binlog_write(level, tag, fmt, BINLOG_ARGC(__VA_ARGS__), ##__VA_ARGS__);   \
+        }                                                                             \
+    } while (0)
+
+#define BINLOGE(tag, fmt, ...) BINLOG_LEVEL(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define BINLOGW(tag, fmt, ...) BINLOG_LEVEL(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define BINLOGI(tag, fmt, ...) BINLOG_LEVEL(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define BINLOGD(tag, fmt, ...) BINLOG_LEVEL(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+#endif // BIN_LOG_H
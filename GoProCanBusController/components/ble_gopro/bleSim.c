@@ -0,0 +1,121 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "ble_gopro.h"
+
+static const char *TAG = "BLE_SIM";
+
+// Handles the simulated camera reports, as GATT discovery would find them
+#define SIM_CONNECTION_HANDLE   1
+#define SIM_COMMAND_HANDLE      0x0030
+#define SIM_SETTINGS_HANDLE     0x0034
+
+// GoPro command id of the shutter, whose argument is 1 to record
+#define GOPRO_CMD_SHUTTER       0x01
+
+gopro_camera_t connected_camera;
+
+char discoveredDevices[MAX_DEVICES][32];
+ble_addr_t discoveredDevicesAddr[MAX_DEVICES];
+int numDevices = 0;
+
+static const ble_addr_t sim_address = {.type = 0, .val = {0x47, 0x50, 0x53, 0x49, 0x4d, 0x01}};
+
+static portMUX_TYPE sim_lock = portMUX_INITIALIZER_UNLOCKED;
+static ble_sim_link_t sim_link = {
+    .latency_us = CONFIG_BLE_SIM_LATENCY_MS * 1000,
+    .jitter_us = CONFIG_BLE_SIM_JITTER_MS * 1000,
+    .loss_permille = CONFIG_BLE_SIM_LOSS_PERMILLE,
+};
+static ble_sim_write_cb_t write_cb;
+static void *write_ctx;
+static bool recording;
+
+void ble_sim_set_link(const ble_sim_link_t *link)
+{
+    taskENTER_CRITICAL(&sim_lock);
+    sim_link = *link;
+    taskEXIT_CRITICAL(&sim_lock);
+}
+
+void ble_sim_set_write_cb(ble_sim_write_cb_t cb, void *ctx)
+{
+    taskENTER_CRITICAL(&sim_lock);
+    write_cb = cb;
+    write_ctx = ctx;
+    taskEXIT_CRITICAL(&sim_lock);
+}
+
+void ble_sim_set_connected(bool connected)
+{
+    connected_camera.connection_handle = connected ? SIM_CONNECTION_HANDLE : 0;
+    connected_camera.command_handle = connected ? SIM_COMMAND_HANDLE : 0;
+    connected_camera.settings_handle = connected ? SIM_SETTINGS_HANDLE : 0;
+    connected_camera.camera_address = sim_address;
+    ESP_LOGI(TAG, "Simulated camera %s", connected ? "connected" : "disconnected");
+}
+
+bool ble_sim_recording(void)
+{
+    return __atomic_load_n(&recording, __ATOMIC_RELAXED);
+}
+
+// One link delay, then the camera takes the write or it is lost
+static int sim_write(uint16_t handle, const uint8_t *data, uint16_t len)
+{
+    if (handle == 0 || connected_camera.connection_handle == 0) {
+        return BLE_SIM_ETIMEOUT;
+    }
+    taskENTER_CRITICAL(&sim_lock);
+    ble_sim_link_t link = sim_link;
+    ble_sim_write_cb_t cb = write_cb;
+    void *ctx = write_ctx;
+    taskEXIT_CRITICAL(&sim_lock);
+
+    int64_t delay_us = link.latency_us;
+    if (link.jitter_us > 0) {
+        delay_us += (int64_t)(esp_random() % (2 * link.jitter_us + 1)) - link.jitter_us;
+    }
+    if (delay_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS((delay_us + 999) / 1000));
+    }
+    if (esp_random() % 1000 < link.loss_permille) {
+        return BLE_SIM_ETIMEOUT;
+    }
+
+    // Type-length-value, see camera_command_send_ble
+    if (handle == SIM_COMMAND_HANDLE && len >= 4 && data[1] == GOPRO_CMD_SHUTTER) {
+        __atomic_store_n(&recording, data[3] != 0, __ATOMIC_RELAXED);
+    }
+    if (cb != NULL) {
+        cb(handle, data, len, ctx);
+    }
+    return 0;
+}
+
+int gopro_write_command(const uint8_t *data, uint16_t data_len)
+{
+    return sim_write(connected_camera.command_handle, data, data_len);
+}
+
+int gopro_write_setting(const uint8_t *data, uint16_t data_len)
+{
+    return sim_write(connected_camera.settings_handle, data, data_len);
+}
+
+// The simulated camera is the only device in range
+void ble_gopro_scan(void)
+{
+    strlcpy(discoveredDevices[0], "GoPro Sim", sizeof(discoveredDevices[0]));
+    discoveredDevicesAddr[0] = sim_address;
+    numDevices = 1;
+    ESP_LOGI(TAG, "Scan found the simulated camera");
+}
+
+void ble_gopro_init(void)
+{
+    ESP_LOGI(TAG, "Initializing simulated BLE...");
+    ble_sim_set_connected(true);
+}
@@ -1,10 +1,18 @@
 #include "ble_gopro.h"
+#include "cameraState.h"
+#include "metrics.h"
+#include "binLog.h"
+#include "goproAdv.h"
 #include <stdio.h>
+#include <inttypes.h>
 #include <string.h>
 #include <assert.h>
 
 static const char *TAG = "BLE_GOPRO_GAP";
 
+// Set once a camera has dropped, so the next connection counts as a reconnect
+static bool had_disconnect = false;
+
 /*
  * If not already defined elsewhere, define a helper to convert a BLE address to a string.
  */
@@ -22,6 +30,20 @@ static inline char *ble_addr_to_str(const ble_addr_t *addr, char *str)
 }
 #endif
 
+/**
+ * Maps an RSSI reading onto a 0-100 link quality, -50 dBm or better is perfect.
+ */
+static uint8_t rssi_to_link_quality(int8_t rssi)
+{
+    if (rssi >= -50) {
+        return 100;
+    }
+    if (rssi <= -100) {
+        return 0;
+    }
+    return (uint8_t)(2 * (rssi + 100));
+}
+
 /**
  * Called when service discovery for a peer has completed.
  */
@@ -87,78 +109,29 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg)
 {
     struct ble_gap_conn_desc desc;
     int rc;
-    char addr_str_buf[18];
 
     switch (event->type) {
         case BLE_GAP_EVENT_DISC: {
             struct ble_gap_disc_desc *disc = &event->disc;
-            ESP_LOGI(TAG, "Discovered device: %s", ble_addr_to_str(&disc->addr, addr_str_buf));
-
-            bool is_gopro = false;
-            const uint8_t *adv_data = disc->data;
-            uint8_t adv_length = disc->length_data;
-
-            int pos = 0;
-            while (pos < adv_length) {
-                uint8_t field_len = adv_data[pos];
-                if (field_len == 0)
-                    break;
-                uint8_t field_type = adv_data[pos + 1];
-
-                // Check for 16-bit Service UUIDs (0x02 = Incomplete, 0x03 = Complete)
-                if (field_type == 0x02 || field_type == 0x03) {
-                    for (int i = 2; i < field_len + 1; i += 2) {
-                        uint16_t svc_uuid = adv_data[pos + i] | (adv_data[pos + i + 1] << 8);
-                        if (svc_uuid == 0xFEA6) {
-                            is_gopro = true;
-                        }
-                    }
-                }
-                pos += field_len + 1;
-            }
-
-            if (is_gopro) {
-                ESP_LOGI(TAG, "GoPro Discovered: %s (RSSI: %d dBm)",
-                         ble_addr_to_str(&disc->addr, addr_str_buf), disc->rssi);
-                ESP_LOGI(TAG, "Raw Advertisement Data (%d bytes):", adv_length);
-                for (int i = 0; i < adv_length; i++) {
-                    printf("%02X ", adv_data[i]);
+            // Every advertisement lands here, the address goes out as two raw halves
+            BINLOGI(TAG, "Discovered device: %06" PRIX32 "%06" PRIX32,
+                    (uint32_t)(disc->addr.val[0] << 16 | disc->addr.val[1] << 8 | disc->addr.val[2]),
+                    (uint32_t)(disc->addr.val[3] << 16 | disc->addr.val[4] << 8 | disc->addr.val[5]));
+
+            gopro_adv_t adv;
+            if (gopro_adv_parse(disc->data, disc->length_data, &adv)) {
+                BINLOGI(TAG, "GoPro discovered: %06" PRIX32 "%06" PRIX32 " (RSSI: %d dBm)",
+                        (uint32_t)(disc->addr.val[0] << 16 | disc->addr.val[1] << 8 | disc->addr.val[2]),
+                        (uint32_t)(disc->addr.val[3] << 16 | disc->addr.val[4] << 8 | disc->addr.val[5]),
+                        disc->rssi);
+                camera_state_set_rssi(0, disc->rssi);
+                // The raw advertisement is only worth its console time when debugging
+                ESP_LOG_BUFFER_HEX_LEVEL(TAG, disc->data, disc->length_data, ESP_LOG_DEBUG);
+                if (adv.complete_name[0] != '\0') {
+                    ESP_LOGI(TAG, "Complete Local Name: %s", adv.complete_name);
                 }
-                printf("\n");
-
-                // Process local names if available
-                char complete_local_name[31] = {0};
-                char shortened_local_name[31] = {0};
-
-                pos = 0;
-                while (pos < adv_length) {
-                    uint8_t field_len = adv_data[pos];
-                    if (field_len == 0)
-                        break;
-                    uint8_t field_type = adv_data[pos + 1];
-                    ESP_LOGI(TAG, "Field Type: 0x%02X, Length: %d", field_type, field_len);
-                    if (field_type == 0x09) { // Complete Local Name
-                        int name_len = field_len - 1;
-                        if (name_len > 30) name_len = 30;
-                        memcpy(complete_local_name, &adv_data[pos + 2], name_len);
-                        complete_local_name[name_len] = '\0';
-                        ESP_LOGI(TAG, "Complete Local Name: %s", complete_local_name);
-                    }
-                    if (field_type == 0x08) { // Shortened Local Name
-                        int name_len = field_len - 1;
-                        if (name_len > 30) name_len = 30;
-                        memcpy(shortened_local_name, &adv_data[pos + 2], name_len);
-                        shortened_local_name[name_len] = '\0';
-                        ESP_LOGI(TAG, "Shortened Local Name: %s", shortened_local_name);
-                    }
-                    if (field_type == 0x02 || field_type == 0x03 || field_type == 0x16) {
-                        ESP_LOGI(TAG, "Service UUID Data:");
-                        for (int i = 2; i < field_len + 1; i += 2) {
-                            uint16_t svc_uuid = adv_data[pos + i] | (adv_data[pos + i + 1] << 8);
-                            ESP_LOGI(TAG, "  UUID: 0x%04X", svc_uuid);
-                        }
-                    }
-                    pos += field_len + 1;
+                if (adv.short_name[0] != '\0') {
+                    ESP_LOGI(TAG, "Shortened Local Name: %s", adv.short_name);
                 }
                 ble_connect(disc);
             }
@@ -166,14 +139,14 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg)
         }
 
         case BLE_GAP_EVENT_EXT_DISC: {
-            ESP_LOGI(TAG, "GAP: BLE_GAP_EVENT_EXT_DISC");
+            BINLOGI(TAG, "GAP: BLE_GAP_EVENT_EXT_DISC");
             // Process extended discovery if needed.
             return 0;
         }
 
         // Adjust the event type macro as necessary.
         case BLE_GAP_EVENT_PERIODIC_REPORT: {
-            ESP_LOGI(TAG, "GAP: BLE_GAP_EVENT_PERIODIC_ADV_REPORT");
+            BINLOGI(TAG, "GAP: BLE_GAP_EVENT_PERIODIC_ADV_REPORT");
             return 0;
         }
 
@@ -181,6 +154,7 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg)
             ESP_LOGI(TAG, "GAP: BLE_GAP_EVENT_LINK_ESTAB");
             if (event->connect.status == 0) {
                 MODLOG_DFLT(INFO, "Connection established ");
+                metrics_inc(had_disconnect ? METRIC_BLE_RECONNECTS : METRIC_BLE_CONNECTS);
                 // Assign the connection handle to your global camera structure.
                 connected_camera.connection_handle = event->connect.conn_handle;
                 MODLOG_DFLT(INFO, "Assigned camera connection_handle: %d\n", connected_camera.connection_handle);
@@ -188,6 +162,11 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg)
                 assert(rc == 0);
                 print_conn_desc(&desc);
                 MODLOG_DFLT(INFO, "\n");
+                int8_t rssi;
+                if (ble_gap_conn_rssi(event->connect.conn_handle, &rssi) == 0) {
+                    camera_state_set_rssi(0, rssi);
+                    camera_state_set_link_quality(0, rssi_to_link_quality(rssi));
+                }
                 rc = peer_add(event->connect.conn_handle);
                 if (rc != 0) {
                     MODLOG_DFLT(ERROR, "Failed to add peer; rc=%d\n", rc);
@@ -210,9 +189,14 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg)
 
         case BLE_GAP_EVENT_DISCONNECT: {
             MODLOG_DFLT(INFO, "disconnect; reason=%d ", event->disconnect.reason);
+            metrics_inc(METRIC_BLE_DISCONNECTS);
+            had_disconnect = true;
             print_conn_desc(&event->disconnect.conn);
             MODLOG_DFLT(INFO, "\n");
             peer_delete(event->disconnect.conn.conn_handle);
+            connected_camera.command_handle = 0;
+            connected_camera.settings_handle = 0;
+            camera_state_set_link_quality(0, 0);
             return 0;
         }
 
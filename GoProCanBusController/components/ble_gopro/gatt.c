@@ -155,20 +155,27 @@ void assign_command_handle(const struct peer *peer)
         SLIST_FOREACH(chr, &svc->chrs, next)
         {
             chr_UUID = (ble_uuid_t *)&chr->chr.uuid;
-            // Compare the characteristic UUID with the GoPro command UUID.
+            // Compare the characteristic UUID with the GoPro command and settings UUIDs.
             if (ble_uuid_cmp(chr_UUID, gopro_command_uuid) == 0)
             {
                 connected_camera.command_handle = chr->chr.val_handle;
                 MODLOG_DFLT(INFO, "Assigned command handle: %d\n", connected_camera.command_handle);
-                return; // Exit once the correct handle is assigned.
+            }
+            else if (ble_uuid_cmp(chr_UUID, gopro_settings_uuid) == 0)
+            {
+                connected_camera.settings_handle = chr->chr.val_handle;
+                MODLOG_DFLT(INFO, "Assigned settings handle: %d\n", connected_camera.settings_handle);
             }
         }
     }
-    MODLOG_DFLT(ERROR, "Command characteristic not found!\n");
+    if (connected_camera.command_handle == 0)
+    {
+        MODLOG_DFLT(ERROR, "Command characteristic not found!\n");
+    }
 }
 
 
-void gopro_write_command(const uint8_t *data, uint16_t data_len) {
+int gopro_write_command(const uint8_t *data, uint16_t data_len) {
     ESP_LOGI(TAG, "Writing command to camera");
     ESP_LOGI(TAG, "Connected camera connection_handle: %d", connected_camera.connection_handle);
     ESP_LOGI(TAG, "Command handle: %d", connected_camera.command_handle);
@@ -193,4 +200,23 @@ void gopro_write_command(const uint8_t *data, uint16_t data_len) {
     if (rc != 0) {
         MODLOG_DFLT(ERROR, "Failed to write command; rc=%d\n", rc);
     }
+    return rc;
+}
+
+int gopro_write_setting(const uint8_t *data, uint16_t data_len) {
+    if (connected_camera.settings_handle == 0) {
+        ESP_LOGE(TAG, "Settings characteristic not discovered");
+        return BLE_HS_ENOENT;
+    }
+    int rc = ble_gattc_write_no_rsp_flat(
+        connected_camera.connection_handle,
+        connected_camera.settings_handle,
+        data,
+        data_len
+    );
+
+    if (rc != 0) {
+        MODLOG_DFLT(ERROR, "Failed to write setting; rc=%d\n", rc);
+    }
+    return rc;
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include <string.h>
+#include "goproAdv.h"
+
+// Advertising data types, Bluetooth Core Supplement part A section 1
+#define AD_UUID16_INCOMPLETE    0x02
+#define AD_UUID16_COMPLETE      0x03
+#define AD_NAME_SHORT           0x08
+#define AD_NAME_COMPLETE        0x09
+
+static void copy_name(char *name, const uint8_t *value, uint8_t len)
+{
+    if (len > GOPRO_ADV_NAME_MAX) {
+        len = GOPRO_ADV_NAME_MAX;
+    }
+    memcpy(name, value, len);
+    name[len] = '\0';
+}
+
+bool gopro_adv_parse(const uint8_t *data, uint8_t len, gopro_adv_t *adv)
+{
+    memset(adv, 0, sizeof(*adv));
+    // Each field is a length, a type and length - 1 bytes of value
+    for (int pos = 0; pos + 1 < len && data[pos] != 0 && pos + 1 + data[pos] <= len; pos += data[pos] + 1) {
+        uint8_t type = data[pos + 1];
+        const uint8_t *value = &data[pos + 2];
+        uint8_t value_len = data[pos] - 1;
+        switch (type) {
+        case AD_UUID16_INCOMPLETE:
+        case AD_UUID16_COMPLETE:
+            for (int i = 0; i + 1 < value_len; i += 2) {
+                if ((value[i] | value[i + 1] << 8) == GOPRO_SERVICE_UUID) {
+                    adv->is_gopro = true;
+                }
+            }
+            break;
+        case AD_NAME_SHORT:
+            copy_name(adv->short_name, value, value_len);
+            break;
+        case AD_NAME_COMPLETE:
+            copy_name(adv->complete_name, value, value_len);
+            break;
+        default:
+            break;
+        }
+    }
+    return adv->is_gopro;
+}
@@ -0,0 +1,40 @@
+#ifndef BLE_SIM_H
+#define BLE_SIM_H
+
+// Stand-in for NimBLE on the linux target. One simulated camera is connected
+// as soon as BLE starts, and it takes the command and setting writes the
+// controller makes. Each write waits one link delay, latency plus up to the
+// jitter either way, and a share of them is lost the way a write is lost
+// when the link drops.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Address as NimBLE keeps it
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+// Returned by a lost write, NimBLE's BLE_HS_ETIMEOUT
+#define BLE_SIM_ETIMEOUT 13
+
+typedef struct {
+    uint32_t latency_us;
+    uint32_t jitter_us;
+    uint16_t loss_permille;
+} ble_sim_link_t;
+
+// Sees every write the camera took, on the writing task
+typedef void (*ble_sim_write_cb_t)(uint16_t handle, const uint8_t *data, uint16_t len, void *ctx);
+
+void ble_sim_set_link(const ble_sim_link_t *link);
+void ble_sim_set_write_cb(ble_sim_write_cb_t cb, void *ctx);
+
+// The camera drops off or comes back, writes fail while it is away
+void ble_sim_set_connected(bool connected);
+
+// Recording state the camera was last told to be in
+bool ble_sim_recording(void);
+
+#endif // BLE_SIM_H
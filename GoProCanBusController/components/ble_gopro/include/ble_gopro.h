@@ -2,6 +2,11 @@
 #define BLE_GOPRO_H
 
 #include "esp_log.h"
+
+// The linux target has no BLE controller, a simulated camera stands in
+#if CONFIG_IDF_TARGET_LINUX
+#include "bleSim.h"
+#else
 #include "nvs_flash.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
@@ -18,6 +23,7 @@
 // Other module includes
 #include "peer.h"
 #include "misc.h"
+#endif
 
 #define BLEGOPRO_QUERY_UUID     0xFEA6
 #define GOPRO_SERVICE_UUID      0xFEA6
@@ -30,6 +36,7 @@
 extern "C" {
 #endif
 
+#if !CONFIG_IDF_TARGET_LINUX
 static const ble_uuid_t *gopro_command_uuid = BLE_UUID128_DECLARE(
     0x1b, 0xc5, 0xd5, 0xa5,
     0x02, 0x00, 0x46, 0x90,
@@ -37,10 +44,19 @@ static const ble_uuid_t *gopro_command_uuid = BLE_UUID128_DECLARE(
     0x72, 0x00, 0xf9, 0xb5
 );
 
+static const ble_uuid_t *gopro_settings_uuid = BLE_UUID128_DECLARE(
+    0x1b, 0xc5, 0xd5, 0xa5,
+    0x02, 0x00, 0x46, 0x90,
+    0xe3, 0x11, 0x8d, 0xaa,
+    0x74, 0x00, 0xf9, 0xb5
+);
+#endif
+
 // Camera structure
 typedef struct {
     uint16_t connection_handle;    // Connection handler
     uint16_t command_handle;       // Handle for the shutter command characteristic
+    uint16_t settings_handle;      // Handle for the settings characteristic
     ble_addr_t camera_address;     // The camera's unique Bluetooth Device Address
 } gopro_camera_t;
 
@@ -54,6 +70,8 @@ extern int numDevices;
 // Public API function prototypes
 void ble_gopro_init(void);
 void ble_gopro_scan(void);
+
+#if !CONFIG_IDF_TARGET_LINUX
 void ble_host_task(void *param);
 
 // GAP event handler used by the scan; defined in ble_gopro_gap.c
@@ -62,7 +80,10 @@ int blecent_gap_event(struct ble_gap_event *event, void *arg);
 // GATT functions
 void subscribe_to_characteristics(const struct peer *peer);
 void assign_command_handle(const struct peer *peer);
-void gopro_write_command(const uint8_t *data, uint16_t data_len);
+#endif
+
+int gopro_write_command(const uint8_t *data, uint16_t data_len);
+int gopro_write_setting(const uint8_t *data, uint16_t data_len);
 
 #ifdef __cplusplus
 }
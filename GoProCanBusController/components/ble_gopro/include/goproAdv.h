@@ -0,0 +1,27 @@
+#ifndef GOPRO_ADV_H
+#define GOPRO_ADV_H
+
+// Reads what discovery needs out of a BLE advertisement: whether it carries
+// the GoPro service UUID and the camera's local names. Plain C so the host
+// build can time it.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 16-bit service UUID every GoPro advertises
+#define GOPRO_SERVICE_UUID      0xFEA6
+
+// Longest name an advertisement can carry, without the terminator
+#define GOPRO_ADV_NAME_MAX      30
+
+typedef struct {
+    bool is_gopro;
+    char complete_name[GOPRO_ADV_NAME_MAX + 1];    // Empty if not advertised
+    char short_name[GOPRO_ADV_NAME_MAX + 1];
+} gopro_adv_t;
+
+// Walks the advertising fields of data, stopping at the first one that is
+// empty or runs past len. False if the advertisement is not a GoPro's.
+bool gopro_adv_parse(const uint8_t *data, uint8_t len, gopro_adv_t *adv);
+
+#endif // GOPRO_ADV_H
@@ -1,15 +1,20 @@
 #include <esp_log.h>
 #include "ble_gopro.h"
+#include "cameraCommand.h"
+#include "binLog.h"
+#include "shutterTrace.h"
 
 static const char *TAG = "BLE_GOPRO_SHUTTER";
 
 void start_recording_ble()
 {
-    ESP_LOGI(TAG, "Shutter requested!");
+    BINLOGI(TAG, "Shutter requested!");
 
-        // Create a two-byte command array:
-        uint8_t shutter_command[4] = { 3, 1, 1, 1 };
+        // The web UI button, traced from the moment the request came in
+        trace_id_t trace = trace_begin(TRACE_SOURCE_BUTTON, true, 0);
+        trace_dispatched(trace);
+        trace_bind(trace, 0);
 
-        // Send the command with the updated two-byte length.
-        gopro_write_command(shutter_command, sizeof(shutter_command));
+        // Shutter on: command 0x01 with the one byte argument 1
+        camera_command_send_ble(camera_command_find("shutter_start"), 0, 0);
 }
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "cameraBatch.h"
+#include "cameraCommand.h"
+#include "cameraState.h"
+#include "binLog.h"
+#include "shutterTrace.h"
+
+static const char *TAG = "camera_batch";
+
+#define BATCH_MAX_BODY   2048
+#define BATCH_MAX_ITEMS  64     // After expanding camera selectors
+#define BATCH_RESULT_LEN 96     // JSON bytes per result
+
+// One command for one camera, in request order
+typedef struct {
+    const camera_command_t *cmd;
+    camera_transport_t transport;
+    int camera;
+    int arg;
+    int request_index;          // Position of the item in the request array
+    bool all_cameras;           // Expanded from the "all" selector
+    bool unreachable;           // "auto" found no link to the camera
+    esp_err_t result;
+} batch_item_t;
+
+typedef struct {
+    batch_item_t *items;
+    int count;
+    int camera;
+    SemaphoreHandle_t done;
+} batch_worker_t;
+
+// Runs every item of one camera in order, reusing one HTTP connection
+static void batch_run_camera(batch_worker_t *worker)
+{
+    esp_http_client_handle_t client = NULL;
+
+    for (int i = 0; i < worker->count; i++) {
+        batch_item_t *item = &worker->items[i];
+        if (item->camera != worker->camera) {
+            continue;
+        }
+        if (item->unreachable) {
+            item->result = ESP_ERR_INVALID_STATE;
+            continue;
+        }
+        if (item->transport == CAMERA_TRANSPORT_BLE) {
+            item->result = camera_command_send_ble(item->cmd, item->camera, item->arg);
+            continue;
+        }
+        if (item->transport == CAMERA_TRANSPORT_REMOTE) {
+            item->result = camera_command_send_remote(item->cmd, item->camera, item->arg);
+            continue;
+        }
+        if (client == NULL) {
+            client = camera_command_http_client(worker->camera);
+        }
+        if (client == NULL) {
+            item->result = camera_base_url(worker->camera, NULL, 0) ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_STATE;
+            continue;
+        }
+        item->result = camera_command_send_http(client, item->cmd, item->camera, item->arg);
+    }
+    if (client != NULL) {
+        esp_http_client_cleanup(client);
+    }
+}
+
+static void batch_worker_task(void *arg)
+{
+    batch_worker_t *worker = arg;
+    batch_run_camera(worker);
+    xSemaphoreGive(worker->done);
+    vTaskDelete(NULL);
+}
+
+// Appends one item per selected camera, returns an error message or NULL
+static const char *batch_expand(const cJSON *selector, const batch_item_t *proto,
+                                batch_item_t *items, int *count)
+{
+    int cameras[MAX_CAMERAS];
+    int selected = 0;
+    bool all = false;
+
+    if (cJSON_IsString(selector) && strcmp(selector->valuestring, "all") == 0) {
+        all = true;
+        for (int i = 0; i < MAX_CAMERAS; i++) {
+            cameras[selected++] = i;
+        }
+    } else if (cJSON_IsNumber(selector)) {
+        cameras[selected++] = selector->valueint;
+    } else if (cJSON_IsArray(selector) && cJSON_GetArraySize(selector) <= MAX_CAMERAS) {
+        const cJSON *entry;
+        cJSON_ArrayForEach(entry, selector) {
+            if (!cJSON_IsNumber(entry)) {
+                return "camera list must hold numbers";
+            }
+            cameras[selected++] = entry->valueint;
+        }
+    } else {
+        return "camera must be a number, a list or \"all\"";
+    }
+
+    for (int i = 0; i < selected; i++) {
+        if (cameras[i] < 0 || cameras[i] >= MAX_CAMERAS) {
+            return "camera out of range";
+        }
+        if (*count >= BATCH_MAX_ITEMS) {
+            return "too many commands";
+        }
+        items[*count] = *proto;
+        items[*count].camera = cameras[i];
+        items[*count].all_cameras = all;
+        if (proto->transport == CAMERA_TRANSPORT_AUTO) {
+            items[*count].unreachable = !camera_transport_pick(proto->cmd, cameras[i], &items[*count].transport);
+        }
+        (*count)++;
+    }
+    return NULL;
+}
+
+// Validates the whole request up front so nothing runs if any item is bad
+static const char *batch_parse(const cJSON *root, batch_item_t *items, int *count, int *bad_index)
+{
+    if (!cJSON_IsArray(root)) {
+        *bad_index = -1;
+        return "body must be a JSON array";
+    }
+
+    int index = 0;
+    const cJSON *entry;
+    cJSON_ArrayForEach(entry, root) {
+        *bad_index = index;
+        batch_item_t proto = {.transport = CAMERA_TRANSPORT_WIFI, .request_index = index};
+
+        const cJSON *command = cJSON_GetObjectItem(entry, "command");
+        if (!cJSON_IsString(command) || (proto.cmd = camera_command_find(command->valuestring)) == NULL) {
+            return "unknown command";
+        }
+        const cJSON *arg = cJSON_GetObjectItem(entry, "arg");
+        if (proto.cmd->needs_arg) {
+            if (!cJSON_IsNumber(arg)) {
+                return "command needs a numeric arg";
+            }
+            proto.arg = arg->valueint;
+        }
+        const cJSON *transport = cJSON_GetObjectItem(entry, "transport");
+        if (transport != NULL &&
+            (!cJSON_IsString(transport) || !camera_transport_from_name(transport->valuestring, &proto.transport))) {
+            return "transport must be \"wifi\", \"ble\", \"remote\" or \"auto\"";
+        }
+        if (!camera_command_supports(proto.cmd, proto.transport)) {
+            return "command not available on this transport";
+        }
+        const char *err = batch_expand(cJSON_GetObjectItem(entry, "camera"), &proto, items, count);
+        if (err != NULL) {
+            return err;
+        }
+        index++;
+    }
+    return NULL;
+}
+
+// Traces a batch that starts or stops recording, from when the request came in
+static void batch_trace(const batch_item_t *items, int count, int64_t trigger_us)
+{
+    const camera_command_t *shutter = NULL;
+    for (int i = 0; i < count && shutter == NULL; i++) {
+        if (items[i].cmd->recording >= 0) {
+            shutter = items[i].cmd;
+        }
+    }
+    if (shutter == NULL) {
+        return;
+    }
+    trace_id_t trace = trace_begin(TRACE_SOURCE_HTTP, shutter->recording > 0, trigger_us);
+    trace_dispatched(trace);
+    for (int i = 0; i < count; i++) {
+        trace_bind(trace, items[i].camera);
+    }
+}
+
+// A batch of one remote command for "all" cameras goes out as a single frame
+static bool batch_run_broadcast(batch_item_t *items, int count)
+{
+    if (count == 0 || items[0].transport != CAMERA_TRANSPORT_REMOTE || !items[0].all_cameras ||
+        items[count - 1].request_index != 0) {
+        return false;
+    }
+    uint32_t targets = camera_command_send_remote_all(items[0].cmd, items[0].arg);
+    for (int i = 0; i < count; i++) {
+        items[i].result = (targets & (1u << items[i].camera)) ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+    return true;
+}
+
+static esp_err_t batch_send_error(httpd_req_t *req, const char *message, int index)
+{
+    char body[128];
+    snprintf(body, sizeof(body), "{\"error\":\"%s\",\"index\":%d}", message, index);
+    httpd_resp_set_status(req, "400 Bad Request");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t batch_send_results(httpd_req_t *req, const batch_item_t *items, int count)
+{
+    size_t size = 16 + count * BATCH_RESULT_LEN;
+    char *body = malloc(size);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    size_t len = snprintf(body, size, "{\"results\":[");
+    for (int i = 0; i < count && len < size; i++) {
+        len += snprintf(body + len, size - len,
+                        "%s{\"index\":%d,\"camera\":%d,\"command\":\"%s\",\"ok\":%s,\"error\":\"%s\"}",
+                        i ? "," : "", items[i].request_index, items[i].camera, items[i].cmd->name,
+                        items[i].result == ESP_OK ? "true" : "false",
+                        items[i].result == ESP_OK ? "" : esp_err_to_name(items[i].result));
+    }
+    if (len < size) {
+        len += snprintf(body + len, size - len, "]}");
+    }
+    esp_err_t ret = httpd_resp_send(req, body, len < size ? len : size - 1);
+    free(body);
+    return ret;
+}
+
+esp_err_t camera_batch_handler(httpd_req_t *req)
+{
+    int64_t trigger_us = esp_timer_get_time();
+    if (req->content_len == 0 || req->content_len > BATCH_MAX_BODY) {
+        return batch_send_error(req, "body missing or too large", -1);
+    }
+
+    char *body = malloc(req->content_len + 1);
+    batch_item_t *items = calloc(BATCH_MAX_ITEMS, sizeof(batch_item_t));
+    if (body == NULL || items == NULL) {
+        free(body);
+        free(items);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            free(body);
+            free(items);
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    free(body);
+    int count = 0;
+    int bad_index = -1;
+    const char *err = root == NULL ? "invalid JSON" : batch_parse(root, items, &count, &bad_index);
+    cJSON_Delete(root);
+    if (err != NULL) {
+        free(items);
+        return batch_send_error(req, err, bad_index);
+    }
+    batch_trace(items, count, trigger_us);
+
+    if (batch_run_broadcast(items, count)) {
+        BINLOGI(TAG, "Broadcast %s to all cameras", items[0].cmd->name);
+        esp_err_t ret = batch_send_results(req, items, count);
+        free(items);
+        return ret;
+    }
+
+    // One worker per camera: cameras run concurrently, each camera in request order
+    batch_worker_t workers[MAX_CAMERAS];
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(MAX_CAMERAS, 0);
+    int started = 0;
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        bool used = false;
+        for (int i = 0; i < count && !used; i++) {
+            used = items[i].camera == camera;
+        }
+        if (!used) {
+            continue;
+        }
+        batch_worker_t *worker = &workers[camera];
+        *worker = (batch_worker_t){.items = items, .count = count, .camera = camera, .done = done};
+        if (done != NULL && xTaskCreate(batch_worker_task, "batch_worker", 4096, worker, 5, NULL) == pdPASS) {
+            started++;
+        } else {
+            batch_run_camera(worker);
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    if (done != NULL) {
+        vSemaphoreDelete(done);
+    }
+
+    BINLOGI(TAG, "Batch of %d commands finished", count);
+    esp_err_t ret = batch_send_results(req, items, count);
+    free(items);
+    return ret;
+}
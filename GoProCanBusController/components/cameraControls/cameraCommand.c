@@ -0,0 +1,280 @@
+#include <string.h>
+#include "cameraCommand.h"
+#include "cameraState.h"
+#include "ble_gopro.h"
+#include "udpServer.h"
+#include "stationTable.h"
+#include "metrics.h"
+#include "linkMonitor.h"
+#include "binLog.h"
+#include "shutterTrace.h"
+#include "esp_timer.h"
+
+static const char *TAG = "camera_command";
+
+// Video, photo and multishot modes map onto the Open GoPro preset groups 1000-1002
+static const camera_command_t commands[] = {
+    {"hilight", false, 0, -1, "/gp/gpControl/command/storage/tag_moment", BLE_TARGET_COMMAND, 0x18, 0, 0,
+     REMOTE_CMD_UNKNOWN, -1},
+    {"set_fps", true, 0, -1, "/gp/gpControl/setting/3/%d", BLE_TARGET_SETTING, 3, 1, 0,
+     REMOTE_CMD_UNKNOWN, -1},
+    {"set_mode", true, 0, -1, "/gp/gpControl/command/mode?p=%d", BLE_TARGET_COMMAND, 0x3E, 2, 1000,
+     REMOTE_CMD_MODE, -1},
+    {"set_resolution", true, 0, -1, "/gp/gpControl/setting/2/%d", BLE_TARGET_SETTING, 2, 1, 0,
+     REMOTE_CMD_UNKNOWN, -1},
+    {"shutter_start", false, 1, 1, "/gp/gpControl/command/shutter?p=%d", BLE_TARGET_COMMAND, 0x01, 1, 0,
+     REMOTE_CMD_SHUTTER, REMOTE_SHUTTER_START},
+    {"shutter_stop", false, 0, 0, "/gp/gpControl/command/shutter?p=%d", BLE_TARGET_COMMAND, 0x01, 1, 0,
+     REMOTE_CMD_SHUTTER, REMOTE_SHUTTER_STOP},
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+const camera_command_t *camera_command_find(const char *name)
+{
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        if (strcmp(commands[i].name, name) == 0) {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+bool camera_command_supports(const camera_command_t *cmd, camera_transport_t transport)
+{
+    if (transport == CAMERA_TRANSPORT_AUTO) {
+        return cmd->http_path != NULL || cmd->ble_target != BLE_TARGET_NONE ||
+               cmd->remote_cmd != REMOTE_CMD_UNKNOWN;
+    }
+    if (transport == CAMERA_TRANSPORT_BLE) {
+        return cmd->ble_target != BLE_TARGET_NONE;
+    }
+    if (transport == CAMERA_TRANSPORT_REMOTE) {
+        return cmd->remote_cmd != REMOTE_CMD_UNKNOWN;
+    }
+    return cmd->http_path != NULL;
+}
+
+bool camera_transport_from_name(const char *name, camera_transport_t *transport)
+{
+    if (strcmp(name, "wifi") == 0) {
+        *transport = CAMERA_TRANSPORT_WIFI;
+        return true;
+    }
+    if (strcmp(name, "ble") == 0) {
+        *transport = CAMERA_TRANSPORT_BLE;
+        return true;
+    }
+    if (strcmp(name, "remote") == 0) {
+        *transport = CAMERA_TRANSPORT_REMOTE;
+        return true;
+    }
+    if (strcmp(name, "auto") == 0) {
+        *transport = CAMERA_TRANSPORT_AUTO;
+        return true;
+    }
+    return false;
+}
+
+bool camera_transport_pick(const camera_command_t *cmd, int camera, camera_transport_t *transport)
+{
+    static const struct {
+        camera_transport_t transport;
+        link_transport_t link;
+        link_state_t state;
+    } preference[] = {
+        {CAMERA_TRANSPORT_REMOTE, LINK_TRANSPORT_REMOTE, LINK_STATE_UP},
+        {CAMERA_TRANSPORT_WIFI, LINK_TRANSPORT_WIFI, LINK_STATE_UP},
+        {CAMERA_TRANSPORT_REMOTE, LINK_TRANSPORT_REMOTE, LINK_STATE_DEGRADED},
+        {CAMERA_TRANSPORT_WIFI, LINK_TRANSPORT_WIFI, LINK_STATE_DEGRADED},
+    };
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        if (camera_command_supports(cmd, preference[i].transport) &&
+            link_monitor_state(camera, preference[i].link) == preference[i].state) {
+            *transport = preference[i].transport;
+            return true;
+        }
+    }
+    // Not probed yet, e.g. right after joining: HTTP has its own timeout
+    if (cmd->http_path != NULL && link_monitor_state(camera, LINK_TRANSPORT_WIFI) == LINK_STATE_UNKNOWN &&
+        camera_base_url(camera, NULL, 0)) {
+        *transport = CAMERA_TRANSPORT_WIFI;
+        return true;
+    }
+    // The link monitor cannot see BLE, so it is tried rather than ruled out
+    if (camera_command_supports(cmd, CAMERA_TRANSPORT_BLE)) {
+        *transport = CAMERA_TRANSPORT_BLE;
+        return true;
+    }
+    return false;
+}
+
+bool camera_base_url(int camera, char *url, size_t size)
+{
+    uint32_t ip;
+    if (!station_table_camera_ip(camera, &ip)) {
+        return false;
+    }
+    const uint8_t *octet = (const uint8_t *)&ip;
+    snprintf(url, size, "http://%u.%u.%u.%u", octet[0], octet[1], octet[2], octet[3]);
+    return true;
+}
+
+esp_http_client_handle_t camera_command_http_client(int camera)
+{
+    char url[32];
+    if (!camera_base_url(camera, url, sizeof(url))) {
+        ESP_LOGE(TAG, "Camera %d has no address yet", camera);
+        return NULL;
+    }
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = CAMERA_HTTP_TIMEOUT_MS,
+        .keep_alive_enable = true,
+    };
+    return esp_http_client_init(&config);
+}
+
+static void update_recording(const camera_command_t *cmd, int camera)
+{
+    if (cmd->recording >= 0) {
+        camera_state_set_recording(camera, cmd->recording);
+    }
+}
+
+esp_err_t camera_command_send_http(esp_http_client_handle_t client, const camera_command_t *cmd,
+                                   int camera, int arg)
+{
+    char url[96];
+    int len;
+    if (!camera_base_url(camera, url, sizeof(url))) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    len = strlen(url);
+    snprintf(url + len, sizeof(url) - len, cmd->http_path, cmd->needs_arg ? arg : cmd->fixed_arg);
+
+    int64_t start = esp_timer_get_time();
+    trace_camera_stage(camera, TRACE_STAGE_SENT);
+    esp_http_client_set_url(client, url);
+    esp_err_t err = esp_http_client_perform(client);
+    metrics_inc(METRIC_HTTP_CLIENT_REQUESTS);
+    if (err != ESP_OK) {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
+        BINLOGE(TAG, "%s on camera %d failed: %s", cmd->name, camera, esp_err_to_name(err));
+        return err;
+    }
+    int status = esp_http_client_get_status_code(client);
+    if (status != 200) {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
+        BINLOGE(TAG, "%s on camera %d returned HTTP %d", cmd->name, camera, status);
+        return ESP_FAIL;
+    }
+    trace_camera_stage(camera, TRACE_STAGE_ACKED);
+    if (cmd->recording >= 0) {
+        metrics_observe(METRIC_SHUTTER_LATENCY_WIFI, esp_timer_get_time() - start);
+    }
+    update_recording(cmd, camera);
+    return ESP_OK;
+}
+
+size_t camera_command_encode_ble(const camera_command_t *cmd, int arg, uint8_t packet[CAMERA_BLE_PACKET_MAX])
+{
+    // Commands without an argument are just their length and id
+    if (cmd->ble_arg_len == 0) {
+        packet[0] = 1;
+        packet[1] = cmd->ble_id;
+        return 2;
+    }
+    // Type-length-value: total length, id, argument length, big endian argument
+    uint32_t value = (uint32_t)((cmd->needs_arg ? arg : cmd->fixed_arg) + cmd->ble_arg_base);
+    packet[0] = 2 + cmd->ble_arg_len;
+    packet[1] = cmd->ble_id;
+    packet[2] = cmd->ble_arg_len;
+    for (int i = 0; i < cmd->ble_arg_len; i++) {
+        packet[3 + i] = value >> (8 * (cmd->ble_arg_len - 1 - i));
+    }
+    return 3 + cmd->ble_arg_len;
+}
+
+esp_err_t camera_command_send_ble(const camera_command_t *cmd, int camera, int arg)
+{
+    // Only one camera is connected over BLE, and it is always camera 0
+    if (camera != 0 || connected_camera.command_handle == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t packet[CAMERA_BLE_PACKET_MAX];
+    size_t len = camera_command_encode_ble(cmd, arg, packet);
+
+    int64_t start = esp_timer_get_time();
+    trace_camera_stage(camera, TRACE_STAGE_SENT);
+    int rc;
+    if (cmd->ble_target == BLE_TARGET_SETTING) {
+        rc = gopro_write_setting(packet, len);
+    } else {
+        rc = gopro_write_command(packet, len);
+    }
+    if (rc != 0) {
+        return ESP_FAIL;
+    }
+    trace_camera_stage(camera, TRACE_STAGE_ACKED);
+    if (cmd->recording >= 0) {
+        metrics_observe(METRIC_SHUTTER_LATENCY_BLE, esp_timer_get_time() - start);
+    }
+    update_recording(cmd, camera);
+    return ESP_OK;
+}
+
+static uint8_t remote_value(const camera_command_t *cmd, int arg)
+{
+    return cmd->remote_arg >= 0 ? cmd->remote_arg : (cmd->needs_arg ? arg : cmd->fixed_arg);
+}
+
+esp_err_t camera_command_send_remote(const camera_command_t *cmd, int camera, int arg)
+{
+    uint8_t value = remote_value(cmd, arg);
+    if (!udp_remote_send(camera, cmd->remote_cmd, &value, 1)) {
+        ESP_LOGE(TAG, "%s on camera %d: camera not joined", cmd->name, camera);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Acked when the camera's reply comes in on the UDP server
+    trace_camera_stage(camera, TRACE_STAGE_SENT);
+    return ESP_OK;
+}
+
+uint32_t camera_command_send_remote_all(const camera_command_t *cmd, int arg)
+{
+    uint8_t value = remote_value(cmd, arg);
+    uint32_t targets = udp_remote_send_all(cmd->remote_cmd, &value, 1);
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        if (targets & (1u << camera)) {
+            trace_camera_stage(camera, TRACE_STAGE_SENT);
+        }
+    }
+    return targets;
+}
+
+esp_err_t camera_command_send(const camera_command_t *cmd, int camera, int arg, camera_transport_t transport)
+{
+    if (transport == CAMERA_TRANSPORT_AUTO && !camera_transport_pick(cmd, camera, &transport)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!camera_command_supports(cmd, transport)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (transport == CAMERA_TRANSPORT_BLE) {
+        return camera_command_send_ble(cmd, camera, arg);
+    }
+    if (transport == CAMERA_TRANSPORT_REMOTE) {
+        return camera_command_send_remote(cmd, camera, arg);
+    }
+    esp_http_client_handle_t client = camera_command_http_client(camera);
+    if (client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = camera_command_send_http(client, cmd, camera, arg);
+    esp_http_client_cleanup(client);
+    return err;
+}
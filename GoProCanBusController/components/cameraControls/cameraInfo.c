@@ -1,21 +1,61 @@
-#include "camerainfo.h"
+#include "cameraInfo.h"
 #include "softAP.h"
+#include "cameraState.h"
+#include "cameraCommand.h"
+#include "cJSON.h"
+#include "metrics.h"
 
 static const char *TAG = "camera_info";
 
+// Status ids reported under "status" by /gp/gpControl/status
+#define STATUS_ENCODING      "10"
+#define STATUS_SD_REMAINING  "54"
+#define STATUS_BATTERY       "70"
+
+void camera_info_apply_status(int camera, const char *json)
+{
+    cJSON *root = cJSON_Parse(json);
+    if (root == NULL) {
+        ESP_LOGE(TAG, "Camera status is not valid JSON");
+        return;
+    }
+    cJSON *status = cJSON_GetObjectItem(root, "status");
+    cJSON *item = cJSON_GetObjectItem(status, STATUS_ENCODING);
+    if (cJSON_IsNumber(item)) {
+        camera_state_set_recording(camera, item->valueint != 0);
+    }
+    item = cJSON_GetObjectItem(status, STATUS_SD_REMAINING);
+    if (cJSON_IsNumber(item)) {
+        camera_state_set_sd_remaining(camera, item->valueint);
+    }
+    item = cJSON_GetObjectItem(status, STATUS_BATTERY);
+    if (cJSON_IsNumber(item)) {
+        camera_state_set_battery(camera, item->valueint);
+    }
+    cJSON_Delete(root);
+}
+
 void get_camera_info(httpd_req_t *req) {
     esp_err_t err;
     char buffer[1024];  // Adjust size depending on expected JSON length
     int content_length;
+    char url[64];
+
+    if (!camera_base_url(0, url, sizeof(url))) {
+        httpd_resp_send(req, "Camera not connected", HTTPD_RESP_USE_STRLEN);
+        return;
+    }
+    strlcat(url, "/gp/gpControl/status", sizeof(url));
 
     esp_http_client_config_t config = {
-        .url = "http://10.71.79.2/gp/gpControl/status",
+        .url = url,
         .method = HTTP_METHOD_GET,
         .timeout_ms = 5000,
     };
 
     esp_http_client_handle_t client = esp_http_client_init(&config);
     err = esp_http_client_perform(client);
+    metrics_inc(METRIC_HTTP_CLIENT_REQUESTS);
 
     if (err == ESP_OK) {
         content_length = esp_http_client_get_content_length(client);
@@ -26,8 +66,10 @@ void get_camera_info(httpd_req_t *req) {
         buffer[content_length] = '\0';  // Null-terminate the string
 
         ESP_LOGI(TAG, "Camera Info JSON: %s", buffer);
+        camera_info_apply_status(0, buffer);
         httpd_resp_send(req, buffer, HTTPD_RESP_USE_STRLEN);  // Optional: send JSON back to web client
     } else {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
         ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
         httpd_resp_send(req, "Failed to fetch camera info", HTTPD_RESP_USE_STRLEN);
     }
@@ -0,0 +1,10 @@
+#ifndef CAMERABATCH_H
+#define CAMERABATCH_H
+
+#include <esp_http_server.h>
+
+// POST /api/batch: runs a JSON array of {"camera", "command", "arg", "transport"}
+// items, every camera in parallel, and answers with one result per item
+esp_err_t camera_batch_handler(httpd_req_t *req);
+
+#endif
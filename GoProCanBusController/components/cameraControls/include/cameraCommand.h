@@ -0,0 +1,83 @@
+#ifndef CAMERACOMMAND_H
+#define CAMERACOMMAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_client.h>
+#include "remoteProtocol.h"
+
+#define CAMERA_HTTP_TIMEOUT_MS 5000
+
+// Longest BLE packet a command encodes to: length, id, argument length, 4 bytes
+#define CAMERA_BLE_PACKET_MAX  7
+
+typedef enum {
+    CAMERA_TRANSPORT_WIFI,
+    CAMERA_TRANSPORT_BLE,
+    CAMERA_TRANSPORT_REMOTE,    // Smart Remote UDP protocol over the softAP
+    CAMERA_TRANSPORT_AUTO,      // Picked per camera by camera_transport_pick()
+} camera_transport_t;
+
+// Characteristic a command is written to over BLE
+typedef enum {
+    BLE_TARGET_NONE,        // Not available over BLE
+    BLE_TARGET_COMMAND,
+    BLE_TARGET_SETTING,
+} ble_target_t;
+
+// One entry of the command catalog, shared by every transport
+typedef struct {
+    const char *name;           // Name used by the REST API
+    bool needs_arg;             // False when fixed_arg is always used
+    int fixed_arg;
+    int8_t recording;           // Recording state after success, -1 if unchanged
+    const char *http_path;      // gpControl path, %d is replaced by the argument
+    ble_target_t ble_target;
+    uint8_t ble_id;             // Command or setting id
+    uint8_t ble_arg_len;        // Bytes of the big endian BLE argument
+    uint16_t ble_arg_base;      // Added to the argument before BLE encoding
+    remote_command_id_t remote_cmd; // REMOTE_CMD_UNKNOWN if not available
+    int16_t remote_arg;         // Fixed Smart Remote argument, -1 to pass the argument on
+} camera_command_t;
+
+const camera_command_t *camera_command_find(const char *name);
+bool camera_command_supports(const camera_command_t *cmd, camera_transport_t transport);
+
+bool camera_transport_from_name(const char *name, camera_transport_t *transport);
+
+// Healthiest transport that carries the command to the camera, from the link
+// monitor: a link that is up beats a degraded one, and Smart Remote beats
+// HTTP on equal health. BLE is the fallback. False if no link can reach the
+// camera, so the command can fail at once instead of timing out.
+bool camera_transport_pick(const camera_command_t *cmd, int camera, camera_transport_t *transport);
+
+// "http://<ip>" of a camera from the station table, false until its DHCP lease is acked
+bool camera_base_url(int camera, char *url, size_t size);
+
+// HTTP client for one camera, keep-alive so a series of commands shares the connection.
+// NULL if the camera has no address yet.
+esp_http_client_handle_t camera_command_http_client(int camera);
+
+// Runs a Wi-Fi command on a client from camera_command_http_client()
+esp_err_t camera_command_send_http(esp_http_client_handle_t client, const camera_command_t *cmd,
+                                   int camera, int arg);
+
+// Packet a command is written as over BLE, returns its length
+size_t camera_command_encode_ble(const camera_command_t *cmd, int arg, uint8_t packet[CAMERA_BLE_PACKET_MAX]);
+
+// Writes a command to the camera connected over BLE
+esp_err_t camera_command_send_ble(const camera_command_t *cmd, int camera, int arg);
+
+// Sends a command with the Smart Remote protocol, recording state follows the camera's reply
+esp_err_t camera_command_send_remote(const camera_command_t *cmd, int camera, int arg);
+
+// Sends a command to every joined camera at once, returns a bit per camera that got it
+uint32_t camera_command_send_remote_all(const camera_command_t *cmd, int arg);
+
+// Sends one command over any transport, "auto" included. Wi-Fi opens a
+// connection for just this command, series of commands should share one.
+esp_err_t camera_command_send(const camera_command_t *cmd, int camera, int arg, camera_transport_t transport);
+
+#endif // CAMERACOMMAND_H
@@ -8,4 +8,7 @@
 
 void get_camera_info(httpd_req_t *req);
 
+// Pulls the fields shown in the web UI out of the camera status JSON
+void camera_info_apply_status(int camera, const char *json);
+
 #endif
\ No newline at end of file
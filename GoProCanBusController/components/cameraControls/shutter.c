@@ -1,47 +1,36 @@
 #include "shutter.h"
 #include "softAP.h"
+#include "cameraCommand.h"
+#include "shutterTrace.h"
 
 static const char *TAG = "shutter";
 
-void start_recording(httpd_req_t *req) {
-  esp_err_t err;
-  esp_http_client_config_t config = {
-    .url = "http://10.71.79.2/gp/gpControl/command/shutter?p=1",
-    .method = HTTP_METHOD_GET,
-    .timeout_ms = 5000,
-  };
-  esp_http_client_handle_t client = esp_http_client_init(&config);
-  err = esp_http_client_perform(client);
+static void send_shutter(httpd_req_t *req, const char *command, const char *done, const char *failed) {
+  const camera_command_t *cmd = camera_command_find(command);
+  trace_id_t trace = trace_begin(TRACE_SOURCE_HTTP, cmd->recording > 0, 0);
+  esp_err_t err = ESP_ERR_NO_MEM;
+  esp_http_client_handle_t client = camera_command_http_client(0);
+  if (client != NULL) {
+    trace_dispatched(trace);
+    trace_bind(trace, 0);
+    err = camera_command_send_http(client, cmd, 0, 0);
+    esp_http_client_cleanup(client);
+  }
 
   if (err == ESP_OK) {
     ESP_LOGI(TAG, "HTTP GET request sent!");
-    httpd_resp_send(req, "Recording started!", HTTPD_RESP_USE_STRLEN);
+    httpd_resp_send(req, done, HTTPD_RESP_USE_STRLEN);
   }
   else {
     ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
-    httpd_resp_send(req, "Recording failed to start!", HTTPD_RESP_USE_STRLEN);
+    httpd_resp_send(req, failed, HTTPD_RESP_USE_STRLEN);
   }
-esp_http_client_cleanup(client);
 }
 
-void stop_recording(httpd_req_t *req) {
-  esp_err_t err;
-  esp_http_client_config_t config = {
-    .url = "http://10.71.79.2/gp/gpControl/command/shutter?p=0",
-    .method = HTTP_METHOD_GET,
-    .timeout_ms = 5000,
-  };
-  esp_http_client_handle_t client = esp_http_client_init(&config);
-  err = esp_http_client_perform(client);
-
-  if (err == ESP_OK) {
-    ESP_LOGI(TAG, "HTTP GET request sent!");
-    httpd_resp_send(req, "Recording stopped!", HTTPD_RESP_USE_STRLEN);
-  }
-  else {
-    ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
-    httpd_resp_send(req, "Recording failed to stop!", HTTPD_RESP_USE_STRLEN);
-  }
-esp_http_client_cleanup(client);
+void start_recording(httpd_req_t *req) {
+  send_shutter(req, "shutter_start", "Recording started!", "Recording failed to start!");
 }
 
+void stop_recording(httpd_req_t *req) {
+  send_shutter(req, "shutter_stop", "Recording stopped!", "Recording failed to stop!");
+}
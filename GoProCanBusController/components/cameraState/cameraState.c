@@ -0,0 +1,154 @@
+#include <string.h>
+#include "freertos/semphr.h"
+#include "cameraState.h"
+
+static camera_state_t cameras[MAX_CAMERAS];
+static uint8_t dirty[MAX_CAMERAS];
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t changed = NULL;
+static uint32_t sequence = 0;
+
+void camera_state_init(void)
+{
+    for (int i = 0; i < MAX_CAMERAS; i++) {
+        cameras[i].recording = false;
+        cameras[i].battery = CAMERA_BATTERY_UNKNOWN;
+        cameras[i].sd_remaining = CAMERA_SD_UNKNOWN;
+        cameras[i].rssi = CAMERA_RSSI_UNKNOWN;
+        cameras[i].link_quality = 0;
+        dirty[i] = 0;
+    }
+    changed = xSemaphoreCreateBinary();
+}
+
+// Marks a field dirty, must be called with state_lock held.
+// Returns true on the first change after a collect so the waiter is woken only once.
+static bool mark_dirty(int camera, uint8_t field)
+{
+    bool was_clean = true;
+    for (int i = 0; i < MAX_CAMERAS; i++) {
+        if (dirty[i]) {
+            was_clean = false;
+            break;
+        }
+    }
+    dirty[camera] |= field;
+    return was_clean;
+}
+
+static void wake_waiter(bool wake)
+{
+    if (wake && changed != NULL) {
+        xSemaphoreGive(changed);
+    }
+}
+
+void camera_state_set_recording(int camera, bool recording)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    bool wake = false;
+    taskENTER_CRITICAL(&state_lock);
+    if (cameras[camera].recording != recording) {
+        cameras[camera].recording = recording;
+        wake = mark_dirty(camera, CAMERA_FIELD_RECORDING);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    wake_waiter(wake);
+}
+
+void camera_state_set_battery(int camera, int8_t percent)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    bool wake = false;
+    taskENTER_CRITICAL(&state_lock);
+    if (cameras[camera].battery != percent) {
+        cameras[camera].battery = percent;
+        wake = mark_dirty(camera, CAMERA_FIELD_BATTERY);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    wake_waiter(wake);
+}
+
+void camera_state_set_sd_remaining(int camera, int32_t kb)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    bool wake = false;
+    taskENTER_CRITICAL(&state_lock);
+    if (cameras[camera].sd_remaining != kb) {
+        cameras[camera].sd_remaining = kb;
+        wake = mark_dirty(camera, CAMERA_FIELD_SD_REMAINING);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    wake_waiter(wake);
+}
+
+void camera_state_set_rssi(int camera, int8_t rssi)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    bool wake = false;
+    taskENTER_CRITICAL(&state_lock);
+    if (cameras[camera].rssi != rssi) {
+        cameras[camera].rssi = rssi;
+        wake = mark_dirty(camera, CAMERA_FIELD_RSSI);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    wake_waiter(wake);
+}
+
+void camera_state_set_link_quality(int camera, uint8_t quality)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    bool wake = false;
+    taskENTER_CRITICAL(&state_lock);
+    if (cameras[camera].link_quality != quality) {
+        cameras[camera].link_quality = quality;
+        wake = mark_dirty(camera, CAMERA_FIELD_LINK_QUALITY);
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    wake_waiter(wake);
+}
+
+bool camera_state_wait(TickType_t timeout)
+{
+    if (changed == NULL) {
+        return false;
+    }
+    return xSemaphoreTake(changed, timeout) == pdTRUE;
+}
+
+uint32_t camera_state_collect(camera_state_t *out, uint8_t *changed_fields)
+{
+    bool any = false;
+    uint32_t seq = 0;
+    taskENTER_CRITICAL(&state_lock);
+    memcpy(out, cameras, sizeof(cameras));
+    for (int i = 0; i < MAX_CAMERAS; i++) {
+        changed_fields[i] = dirty[i];
+        any = any || dirty[i] != 0;
+        dirty[i] = 0;
+    }
+    if (any) {
+        seq = ++sequence;
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    return seq;
+}
+
+uint32_t camera_state_snapshot(camera_state_t *out)
+{
+    taskENTER_CRITICAL(&state_lock);
+    memcpy(out, cameras, sizeof(cameras));
+    uint32_t seq = sequence;
+    taskEXIT_CRITICAL(&state_lock);
+    return seq;
+}
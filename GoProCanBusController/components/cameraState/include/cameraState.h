@@ -0,0 +1,55 @@
+#ifndef CAMERASTATE_H
+#define CAMERASTATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "softAP.h"
+
+// One slot per camera that can join the access point
+#define MAX_CAMERAS             MAX_STA_CONN
+
+// Unknown values reported before the camera has told us anything
+#define CAMERA_BATTERY_UNKNOWN  (-1)
+#define CAMERA_SD_UNKNOWN       (-1)
+#define CAMERA_RSSI_UNKNOWN     0
+
+// Bits of the per-camera dirty mask, one per field
+#define CAMERA_FIELD_RECORDING      (1u << 0)
+#define CAMERA_FIELD_BATTERY        (1u << 1)
+#define CAMERA_FIELD_SD_REMAINING   (1u << 2)
+#define CAMERA_FIELD_RSSI           (1u << 3)
+#define CAMERA_FIELD_LINK_QUALITY   (1u << 4)
+#define CAMERA_FIELD_ALL            0x1f
+
+// Live state of one camera as shown to the web UI
+typedef struct {
+    bool recording;
+    int8_t battery;         // Battery level in percent
+    int32_t sd_remaining;   // Remaining SD card space in kB
+    int8_t rssi;            // BLE RSSI in dBm
+    uint8_t link_quality;   // 0 (lost) to 100 (perfect)
+} camera_state_t;
+
+void camera_state_init(void);
+
+// Setters only mark a field dirty when its value actually changes
+void camera_state_set_recording(int camera, bool recording);
+void camera_state_set_battery(int camera, int8_t percent);
+void camera_state_set_sd_remaining(int camera, int32_t kb);
+void camera_state_set_rssi(int camera, int8_t rssi);
+void camera_state_set_link_quality(int camera, uint8_t quality);
+
+// Blocks until at least one field has changed since the last collect
+bool camera_state_wait(TickType_t timeout);
+
+// Copies every camera and the fields changed since the last collect, then
+// clears the dirty masks. Returns the sequence number of this update, or 0
+// when nothing changed.
+uint32_t camera_state_collect(camera_state_t *out, uint8_t *changed_fields);
+
+// Copies every camera without touching the dirty masks. Returns the sequence
+// number of the last collect, every later update carries a higher one.
+uint32_t camera_state_snapshot(camera_state_t *out);
+
+#endif // CAMERASTATE_H
@@ -0,0 +1,302 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cameraCommand.h"
+#include "cameraState.h"
+#include "shutterTrace.h"
+#include "metrics.h"
+#include "binLog.h"
+#include "canSignals.h"
+#include "canRecord.h"
+#include "canPort.h"
+#include "canStatus.h"
+#include "canIsoTp.h"
+#include "canTime.h"
+#include "timeSync.h"
+#include "canBus.h"
+
+static const char *TAG = "can_bus";
+
+// Record changes waiting for the dispatch task; more than a few means the
+// cameras cannot keep up and the oldest intent no longer matters anyway
+#define DISPATCH_QUEUE_LEN 4
+
+// Frames waiting per priority, a round of status frames fits in the low one
+#define TX_QUEUE_LEN (MAX_CAMERAS + 2)
+
+// Longest the transmit task waits for room in the controller, a bus that
+// takes nothing for this long is off or unterminated
+#define TX_TIMEOUT_MS 100
+
+typedef struct {
+    trace_id_t trace;
+    bool recording;
+    int64_t rx_us;
+} can_dispatch_t;
+
+// Handles one decoded signal of a frame received at rx_us
+typedef void (*can_signal_handler_t)(float value, int64_t rx_us);
+
+typedef struct {
+    const can_signal_t *signal;
+    can_signal_handler_t handler;
+} can_rx_entry_t;
+
+static const can_signal_t record_signal = {
+    .name = "record",
+    .id = CONFIG_CAN_RECORD_ID,
+    .start = CONFIG_CAN_RECORD_START_BIT,
+    .length = 1,
+    .byte_order = CAN_BYTE_ORDER_INTEL,
+    .factor = 1,
+};
+
+#if CONFIG_CAN_MARKER_ENABLED
+static const can_signal_t marker_signal = {
+    .name = "marker",
+    .id = CONFIG_CAN_MARKER_ID,
+    .start = CONFIG_CAN_MARKER_START_BIT,
+    .length = 1,
+    .byte_order = CAN_BYTE_ORDER_INTEL,
+    .factor = 1,
+};
+
+// Last value of the marker signal, -1 before the first frame
+static int8_t marker_level = -1;
+#endif
+
+static can_record_t record_state;
+static QueueHandle_t dispatch_queue;
+static QueueHandle_t tx_queues[CAN_TX_PRIORITY_COUNT];
+static TaskHandle_t tx_task;
+static portMUX_TYPE hook_lock = portMUX_INITIALIZER_UNLOCKED;
+static can_record_hook_t record_hook;
+static void *record_ctx;
+
+static void record_received(float value, int64_t rx_us)
+{
+    can_record_action_t action = can_record_update(&record_state, value != 0);
+    if (action == CAN_RECORD_NONE) {
+        return;
+    }
+    taskENTER_CRITICAL(&hook_lock);
+    can_record_hook_t hook = record_hook;
+    void *ctx = record_ctx;
+    taskEXIT_CRITICAL(&hook_lock);
+    if (hook != NULL) {
+        hook(action == CAN_RECORD_START, rx_us, ctx);
+    }
+
+    can_dispatch_t dispatch = {
+        .recording = action == CAN_RECORD_START,
+        .trace = trace_begin(TRACE_SOURCE_CAN, action == CAN_RECORD_START, rx_us),
+        .rx_us = rx_us,
+    };
+    if (dispatch_queue == NULL || xQueueSend(dispatch_queue, &dispatch, 0) != pdTRUE) {
+        metrics_inc(METRIC_CAN_TRIGGERS_DROPPED);
+        BINLOGW(TAG, "Dispatch queue full, record %d dropped", dispatch.recording);
+    }
+}
+
+#if CONFIG_CAN_MARKER_ENABLED
+// A marker is the signal going from 0 to 1, it repeats in every frame
+static void marker_received(float value, int64_t rx_us)
+{
+    int8_t level = value != 0;
+    if (marker_level == 0 && level == 1) {
+        time_sync_marker(TIME_MARKER_CAN, rx_us, time_sync_recording_cameras());
+    }
+    marker_level = level;
+}
+#endif
+
+static const can_rx_entry_t rx_table[] = {
+    {&record_signal, record_received},
+#if CONFIG_CAN_MARKER_ENABLED
+    {&marker_signal, marker_received},
+#endif
+};
+
+#define RX_TABLE_COUNT (sizeof(rx_table) / sizeof(rx_table[0]))
+
+void can_bus_ingest(uint32_t id, const uint8_t *data, uint8_t len, int64_t rx_us)
+{
+    // Short frames read as zero past their end, like a DBC decoder does
+    uint8_t payload[8] = {0};
+    memcpy(payload, data, len < sizeof(payload) ? len : sizeof(payload));
+
+    for (size_t i = 0; i < RX_TABLE_COUNT; i++) {
+        if (rx_table[i].signal->id == id) {
+            rx_table[i].handler(can_signal_decode(rx_table[i].signal, payload), rx_us);
+        }
+    }
+}
+
+void can_bus_set_record_hook(can_record_hook_t hook, void *ctx)
+{
+    taskENTER_CRITICAL(&hook_lock);
+    record_hook = hook;
+    record_ctx = ctx;
+    taskEXIT_CRITICAL(&hook_lock);
+}
+
+bool can_bus_transmit(const can_frame_t *frame, can_tx_priority_t priority, TickType_t wait)
+{
+    if (priority >= CAN_TX_PRIORITY_COUNT || tx_task == NULL ||
+        xQueueSend(tx_queues[priority], frame, wait) != pdTRUE) {
+        metrics_inc(METRIC_CAN_TX_DROPPED);
+        return false;
+    }
+    xTaskNotifyGive(tx_task);
+    return true;
+}
+
+// Highest priority frame waiting, false once every queue is empty
+static bool next_tx_frame(can_frame_t *frame)
+{
+    for (int priority = 0; priority < CAN_TX_PRIORITY_COUNT; priority++) {
+        if (xQueueReceive(tx_queues[priority], frame, 0) == pdTRUE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hands frames to the controller one at a time, so a high priority frame
+// queued meanwhile goes next instead of behind a backlog of low ones
+static void can_tx_task(void *arg)
+{
+    can_frame_t frame;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (next_tx_frame(&frame)) {
+            esp_err_t err = can_port_transmit(&frame, pdMS_TO_TICKS(TX_TIMEOUT_MS));
+            if (err == ESP_OK) {
+                metrics_inc(METRIC_CAN_FRAMES_SENT);
+            } else {
+                metrics_inc(METRIC_CAN_TX_DROPPED);
+                BINLOGW(TAG, "Frame 0x%03lx not sent: %s", (unsigned long)frame.id, esp_err_to_name(err));
+            }
+        }
+    }
+}
+
+// Sends the shutter to each camera on its best transport, one after another
+static void can_dispatch_task(void *arg)
+{
+    can_dispatch_t dispatch;
+    while (1) {
+        xQueueReceive(dispatch_queue, &dispatch, portMAX_DELAY);
+        const camera_command_t *cmd = camera_command_find(dispatch.recording ? "shutter_start" : "shutter_stop");
+        trace_dispatched(dispatch.trace);
+        uint32_t started = 0;
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            camera_transport_t transport;
+            if (!camera_transport_pick(cmd, camera, &transport)) {
+                continue;
+            }
+            trace_bind(dispatch.trace, camera);
+            esp_err_t err = camera_command_send(cmd, camera, 0, transport);
+            if (err == ESP_OK) {
+                started |= 1u << camera;
+            } else {
+                BINLOGW(TAG, "%s on camera %d failed: %s", cmd->name, camera, esp_err_to_name(err));
+            }
+        }
+        // The start is the first marker of a recording, on the cameras it
+        // went to whether or not they have acked it yet
+        if (dispatch.recording) {
+            time_sync_marker(TIME_MARKER_RECORD, dispatch.rx_us, started);
+        }
+    }
+}
+
+#if CONFIG_CAN_TIME_ENABLED
+static bool time_frame(const can_frame_t *frame, int64_t *utc_us)
+{
+#if CONFIG_CAN_TIME_FORMAT_UNIX_US
+    return can_time_decode_unix(frame, CONFIG_CAN_TIME_ID, utc_us);
+#else
+    return can_time_decode_nmea2000(frame, utc_us);
+#endif
+}
+#endif
+
+static void can_rx_task(void *arg)
+{
+    can_frame_t frame;
+    while (1) {
+        if (can_port_receive(&frame, portMAX_DELAY) != ESP_OK) {
+            continue;
+        }
+        int64_t rx_us = esp_timer_get_time();
+        metrics_inc(METRIC_CAN_FRAMES_RECEIVED);
+#if CONFIG_CAN_TIME_ENABLED
+        // Before the filter below, the NMEA 2000 time comes on an extended identifier
+        int64_t utc_us;
+        if (time_frame(&frame, &utc_us)) {
+            time_sync_reference(TIME_SOURCE_CAN, utc_us + CONFIG_CAN_TIME_LATENCY_US, rx_us);
+            continue;
+        }
+#endif
+        if (frame.extd || frame.rtr) {
+            continue;
+        }
+#if CONFIG_CAN_ISOTP_ENABLED
+        if (frame.id == CONFIG_CAN_ISOTP_RX_ID) {
+            can_isotp_receive(&frame, rx_us);
+            continue;
+        }
+#endif
+        can_bus_ingest(frame.id, frame.data, frame.len, rx_us);
+    }
+}
+
+esp_err_t can_bus_init(void)
+{
+#if CONFIG_CAN_BUS_ENABLED
+    can_record_init(&record_state, CONFIG_CAN_RECORD_CONFIRM_FRAMES);
+    dispatch_queue = xQueueCreate(DISPATCH_QUEUE_LEN, sizeof(can_dispatch_t));
+    if (dispatch_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = can_port_start();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the bus: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Receive above the dispatch task: frames are stamped as they arrive even
+    // while a slow HTTP command is out
+    TaskHandle_t task;
+    if (xTaskCreate(can_rx_task, "can_rx", 3072, NULL, 8, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+    if (xTaskCreate(can_dispatch_task, "can_dispatch", 4096, NULL, 6, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+
+    for (int priority = 0; priority < CAN_TX_PRIORITY_COUNT; priority++) {
+        tx_queues[priority] = xQueueCreate(TX_QUEUE_LEN, sizeof(can_frame_t));
+        if (tx_queues[priority] == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    // Below reception, which must never wait on a full bus
+    if (xTaskCreate(can_tx_task, "can_tx", 3072, NULL, 7, &tx_task) == pdPASS) {
+        metrics_register_task(tx_task);
+    }
+#if CONFIG_CAN_STATUS_ENABLED
+    can_status_start();
+#endif
+#if CONFIG_CAN_ISOTP_ENABLED
+    can_isotp_start();
+#endif
+    ESP_LOGI(TAG, "Listening for record frames on 0x%03x", CONFIG_CAN_RECORD_ID);
+#endif
+    return ESP_OK;
+}
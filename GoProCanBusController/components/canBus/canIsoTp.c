@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "metrics.h"
+#include "binLog.h"
+#include "isoTp.h"
+#include "canBus.h"
+#include "canIsoTp.h"
+
+static const char *TAG = "can_isotp";
+
+// Frames and send requests waiting for the link task, a whole block fits
+#define EVENT_QUEUE_LEN (CAN_PORT_RX_QUEUE_LEN + 4)
+
+// Longest the link task waits for room in the transmit queue before it
+// offers the frame again on the next poll
+#define TX_ROOM_WAIT_MS 20
+
+#define API_BASE_URL    "http://127.0.0.1"
+#define API_TIMEOUT_MS  5000
+#define API_URL_MAX     128
+
+typedef enum {
+    EVENT_FRAME,                // A frame off the bus
+    EVENT_SEND,                 // The API task has a response ready
+} event_type_t;
+
+typedef struct {
+    event_type_t type;
+    int64_t rx_us;
+    can_frame_t frame;
+} link_event_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} api_request_t;
+
+static uint8_t rx_memory[CONFIG_CAN_ISOTP_BUFFERS][CONFIG_CAN_ISOTP_MAX_LEN];
+static isotp_buffer_t rx_pool[CONFIG_CAN_ISOTP_BUFFERS];
+static uint8_t response[CONFIG_CAN_ISOTP_MAX_LEN];
+static size_t response_len;
+
+static isotp_link_t iso_link;
+static QueueHandle_t event_queue;
+static QueueHandle_t request_queue;
+static TaskHandle_t api_task_handle;
+
+// Flow control jumps the queue, the peer's next block waits on it
+static bool link_send(void *ctx, const uint8_t *data, uint8_t len)
+{
+    can_frame_t frame = {.id = CONFIG_CAN_ISOTP_TX_ID, .len = len};
+    memcpy(frame.data, data, len);
+    can_tx_priority_t priority = (data[0] >> 4) == ISOTP_PCI_FLOW_CONTROL ? CAN_TX_PRIORITY_HIGH : CAN_TX_PRIORITY_LOW;
+    return can_bus_transmit(&frame, priority, pdMS_TO_TICKS(TX_ROOM_WAIT_MS));
+}
+
+// Runs on the link task; the buffer goes to the API task as it is
+static void link_received(void *ctx, uint8_t *message, size_t len)
+{
+    api_request_t request = {.data = message, .len = len};
+    if (xQueueSend(request_queue, &request, 0) != pdTRUE) {
+        isotp_release(&iso_link, message);
+    }
+}
+
+static void link_sent(void *ctx, bool ok)
+{
+    if (!ok) {
+        BINLOGW(TAG, "Response of %u bytes not delivered", (unsigned)response_len);
+    }
+    xTaskNotifyGive(api_task_handle);
+}
+
+static void link_task(void *arg)
+{
+    link_event_t event;
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        int64_t next = isotp_next_poll_us(&iso_link);
+        if (next != INT64_MAX) {
+            int64_t delay_us = next - esp_timer_get_time();
+            wait = delay_us > 0 ? pdMS_TO_TICKS((delay_us + 999) / 1000) : 0;
+            // A wait under a tick rounds to none and this task would spin
+            // until the deadline, starving the dispatch task below it
+            if (delay_us > 0 && wait == 0) {
+                wait = 1;
+            }
+        }
+        if (xQueueReceive(event_queue, &event, wait) == pdTRUE) {
+            if (event.type == EVENT_FRAME) {
+                isotp_receive(&iso_link, event.frame.data, event.frame.len, event.rx_us);
+            } else if (!isotp_send(&iso_link, response, response_len, esp_timer_get_time())) {
+                xTaskNotifyGive(api_task_handle);
+            }
+        }
+        isotp_poll(&iso_link, esp_timer_get_time());
+    }
+}
+
+void can_isotp_receive(const can_frame_t *frame, int64_t rx_us)
+{
+    link_event_t event = {.type = EVENT_FRAME, .rx_us = rx_us, .frame = *frame};
+    if (event_queue == NULL || xQueueSend(event_queue, &event, 0) != pdTRUE) {
+        metrics_inc(METRIC_CAN_ISOTP_DROPPED);
+    }
+}
+
+static int respond(int status, const char *body)
+{
+    return snprintf((char *)response, sizeof(response), "%d\n%s", status, body);
+}
+
+static bool method_from_name(const char *name, size_t len, esp_http_client_method_t *method)
+{
+    static const struct {
+        const char *name;
+        esp_http_client_method_t method;
+    } methods[] = {
+        {"GET", HTTP_METHOD_GET},
+        {"POST", HTTP_METHOD_POST},
+        {"PUT", HTTP_METHOD_PUT},
+        {"DELETE", HTTP_METHOD_DELETE},
+    };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strlen(methods[i].name) == len && memcmp(methods[i].name, name, len) == 0) {
+            *method = methods[i].method;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Serves one request through the web server, leaving the answer in response
+static size_t serve(const uint8_t *request, size_t len)
+{
+    const char *text = (const char *)request;
+    const char *line_end = memchr(text, '\n', len);
+    size_t line_len = line_end != NULL ? (size_t)(line_end - text) : len;
+    const char *body = line_end != NULL ? line_end + 1 : text + len;
+    size_t body_len = text + len - body;
+
+    const char *space = memchr(text, ' ', line_len);
+    esp_http_client_method_t method;
+    if (space == NULL || space + 1 >= text + line_len || !method_from_name(text, space - text, &method) ||
+        space[1] != '/') {
+        return respond(400, "Expected \"<method> <path>\" on the first line");
+    }
+    char url[API_URL_MAX];
+    size_t path_len = text + line_len - (space + 1);
+    if (line_len > 0 && text[line_len - 1] == '\r') {
+        path_len--;
+    }
+    if (path_len >= sizeof(url) - strlen(API_BASE_URL)) {
+        return respond(414, "Path too long");
+    }
+    snprintf(url, sizeof(url), "%s%.*s", API_BASE_URL, (int)path_len, space + 1);
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = method,
+        .timeout_ms = API_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return respond(500, "No memory for the request");
+    }
+    if (body_len > 0) {
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+    }
+
+    size_t out = 0;
+    esp_err_t err = esp_http_client_open(client, body_len);
+    if (err == ESP_OK && body_len > 0 && esp_http_client_write(client, body, body_len) != (int)body_len) {
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK && esp_http_client_fetch_headers(client) < 0) {
+        err = ESP_FAIL;
+    }
+    if (err == ESP_OK) {
+        // The status line goes in front of the body, as wide as any status is
+        out = snprintf((char *)response, sizeof(response), "%03d\n", esp_http_client_get_status_code(client));
+        int read = esp_http_client_read_response(client, (char *)response + out, sizeof(response) - out);
+        if (read < 0) {
+            err = ESP_FAIL;
+        } else if (!esp_http_client_is_complete_data_received(client)) {
+            out = respond(500, "Response does not fit in one ISO-TP message");
+        } else {
+            out += read;
+        }
+    }
+    esp_http_client_cleanup(client);
+    if (err != ESP_OK) {
+        return respond(502, "Web server did not answer");
+    }
+    return out;
+}
+
+static void api_task(void *arg)
+{
+    api_request_t request;
+    while (1) {
+        xQueueReceive(request_queue, &request, portMAX_DELAY);
+        response_len = serve(request.data, request.len);
+        isotp_release(&iso_link, request.data);
+
+        link_event_t event = {.type = EVENT_SEND};
+        xQueueSend(event_queue, &event, portMAX_DELAY);
+        // The response buffer is the link's until it has gone out
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void can_isotp_start(void)
+{
+    for (int i = 0; i < CONFIG_CAN_ISOTP_BUFFERS; i++) {
+        rx_pool[i] = (isotp_buffer_t){.data = rx_memory[i], .size = CONFIG_CAN_ISOTP_MAX_LEN};
+    }
+    isotp_config_t config = {
+        .block_size = CONFIG_CAN_ISOTP_BLOCK_SIZE,
+        .st_min = isotp_st_min_from_us(CONFIG_CAN_ISOTP_STMIN_US),
+        .timeout_us = CONFIG_CAN_ISOTP_TIMEOUT_MS * 1000,
+        .padding = 0xcc,
+    };
+    isotp_callbacks_t callbacks = {
+        .send = link_send,
+        .received = link_received,
+        .sent = link_sent,
+    };
+    isotp_init(&iso_link, &config, &callbacks, rx_pool, CONFIG_CAN_ISOTP_BUFFERS);
+
+    event_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(link_event_t));
+    request_queue = xQueueCreate(CONFIG_CAN_ISOTP_BUFFERS, sizeof(api_request_t));
+    if (event_queue == NULL || request_queue == NULL) {
+        ESP_LOGE(TAG, "No memory for the ISO-TP queues");
+        return;
+    }
+    TaskHandle_t task;
+    // Next to the transmit task, consecutive frames keep their pace
+    if (xTaskCreate(link_task, "can_isotp", 3072, NULL, 7, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+    // Requests wait on the web server, which runs at a low priority anyway
+    if (xTaskCreate(api_task, "can_api", 4096, NULL, 4, &api_task_handle) == pdPASS) {
+        metrics_register_task(api_task_handle);
+    }
+    ESP_LOGI(TAG, "REST API on 0x%03x, answers on 0x%03x", CONFIG_CAN_ISOTP_RX_ID, CONFIG_CAN_ISOTP_TX_ID);
+}
@@ -0,0 +1,55 @@
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "canSim.h"
+
+static const char *TAG = "can_sim";
+
+static QueueHandle_t rx_queue;
+static portMUX_TYPE hook_lock = portMUX_INITIALIZER_UNLOCKED;
+static can_sim_tx_hook_t tx_hook;
+static void *tx_ctx;
+
+esp_err_t can_port_start(void)
+{
+    rx_queue = xQueueCreate(CAN_PORT_RX_QUEUE_LEN, sizeof(can_frame_t));
+    if (rx_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Simulated CAN bus up");
+    return ESP_OK;
+}
+
+esp_err_t can_port_receive(can_frame_t *frame, TickType_t wait)
+{
+    if (rx_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return xQueueReceive(rx_queue, frame, wait) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t can_port_transmit(const can_frame_t *frame, TickType_t wait)
+{
+    taskENTER_CRITICAL(&hook_lock);
+    can_sim_tx_hook_t hook = tx_hook;
+    void *ctx = tx_ctx;
+    taskEXIT_CRITICAL(&hook_lock);
+
+    // Nothing else is on the bus, every frame is acked at once
+    if (hook != NULL) {
+        hook(frame, ctx);
+    }
+    return ESP_OK;
+}
+
+bool can_sim_inject(const can_frame_t *frame)
+{
+    return rx_queue != NULL && xQueueSend(rx_queue, frame, 0) == pdTRUE;
+}
+
+void can_sim_set_tx_hook(can_sim_tx_hook_t hook, void *ctx)
+{
+    taskENTER_CRITICAL(&hook_lock);
+    tx_hook = hook;
+    tx_ctx = ctx;
+    taskEXIT_CRITICAL(&hook_lock);
+}
@@ -0,0 +1,53 @@
+#include <string.h>
+#include "driver/twai.h"
+#include "canPort.h"
+
+esp_err_t can_port_start(void)
+{
+    twai_general_config_t general = TWAI_GENERAL_CONFIG_DEFAULT(CONFIG_CAN_TX_GPIO, CONFIG_CAN_RX_GPIO,
+                                                                TWAI_MODE_NORMAL);
+    general.rx_queue_len = CAN_PORT_RX_QUEUE_LEN;
+#if CONFIG_CAN_BITRATE_125K
+    twai_timing_config_t timing = TWAI_TIMING_CONFIG_125KBITS();
+#elif CONFIG_CAN_BITRATE_250K
+    twai_timing_config_t timing = TWAI_TIMING_CONFIG_250KBITS();
+#elif CONFIG_CAN_BITRATE_1M
+    twai_timing_config_t timing = TWAI_TIMING_CONFIG_1MBITS();
+#else
+    twai_timing_config_t timing = TWAI_TIMING_CONFIG_500KBITS();
+#endif
+    twai_filter_config_t filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+    esp_err_t err = twai_driver_install(&general, &timing, &filter);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return twai_start();
+}
+
+esp_err_t can_port_receive(can_frame_t *frame, TickType_t wait)
+{
+    twai_message_t message;
+    esp_err_t err = twai_receive(&message, wait);
+    if (err != ESP_OK) {
+        return err;
+    }
+    frame->id = message.identifier;
+    frame->extd = message.extd;
+    frame->rtr = message.rtr;
+    frame->len = message.data_length_code < 8 ? message.data_length_code : 8;
+    memcpy(frame->data, message.data, sizeof(frame->data));
+    return ESP_OK;
+}
+
+esp_err_t can_port_transmit(const can_frame_t *frame, TickType_t wait)
+{
+    twai_message_t message = {
+        .identifier = frame->id,
+        .extd = frame->extd,
+        .rtr = frame->rtr,
+        .data_length_code = frame->len,
+    };
+    memcpy(message.data, frame->data, sizeof(message.data));
+    return twai_transmit(&message, wait);
+}
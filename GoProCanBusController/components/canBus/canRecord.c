@@ -0,0 +1,31 @@
+#include "canRecord.h"
+
+void can_record_init(can_record_t *sm, uint8_t confirm)
+{
+    *sm = (can_record_t){.recording = -1, .pending = -1, .confirm = confirm ? confirm : 1};
+}
+
+can_record_action_t can_record_update(can_record_t *sm, bool requested)
+{
+    if (requested == sm->recording) {
+        sm->pending = -1;
+        sm->count = 0;
+        return CAN_RECORD_NONE;
+    }
+    if (requested != sm->pending) {
+        sm->pending = requested;
+        sm->count = 0;
+    }
+    if (++sm->count < sm->confirm) {
+        return CAN_RECORD_NONE;
+    }
+
+    bool first = sm->recording < 0;
+    sm->recording = requested;
+    sm->pending = -1;
+    sm->count = 0;
+    if (requested) {
+        return CAN_RECORD_START;
+    }
+    return first ? CAN_RECORD_NONE : CAN_RECORD_STOP;
+}
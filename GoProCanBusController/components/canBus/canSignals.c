@@ -0,0 +1,56 @@
+#include <math.h>
+#include "canSignals.h"
+
+// Payload bit of the n-th signal bit, counted from the least significant
+static int bit_position(const can_signal_t *signal, int n)
+{
+    if (signal->byte_order == CAN_BYTE_ORDER_INTEL) {
+        return signal->start + n;
+    }
+    // Motorola bits run down within a byte, then on to the next byte's top bit
+    int bit = signal->start;
+    for (int i = signal->length - 1; i > n; i--) {
+        bit = (bit % 8 == 0) ? bit + 15 : bit - 1;
+    }
+    return bit;
+}
+
+float can_signal_decode(const can_signal_t *signal, const uint8_t data[8])
+{
+    uint32_t raw = 0;
+    for (int n = 0; n < signal->length; n++) {
+        int bit = bit_position(signal, n);
+        if (bit >= 0 && bit < 64 && (data[bit / 8] >> (bit % 8)) & 1) {
+            raw |= 1u << n;
+        }
+    }
+
+    int64_t value = raw;
+    if (signal->is_signed && signal->length < 32 && (raw >> (signal->length - 1)) & 1) {
+        value -= (int64_t)1 << signal->length;
+    } else if (signal->is_signed && signal->length == 32) {
+        value = (int32_t)raw;
+    }
+    return value * signal->factor + signal->offset;
+}
+
+void can_signal_encode(const can_signal_t *signal, uint8_t data[8], float value)
+{
+    int64_t min = signal->is_signed ? -((int64_t)1 << (signal->length - 1)) : 0;
+    int64_t max = signal->is_signed ? ((int64_t)1 << (signal->length - 1)) - 1 : ((int64_t)1 << signal->length) - 1;
+    float scaled = signal->factor != 0 ? (value - signal->offset) / signal->factor : 0;
+    int64_t raw = llroundf(scaled);
+    raw = raw < min ? min : raw > max ? max : raw;
+
+    for (int n = 0; n < signal->length; n++) {
+        int bit = bit_position(signal, n);
+        if (bit < 0 || bit >= 64) {
+            continue;
+        }
+        if (((uint64_t)raw >> n) & 1) {
+            data[bit / 8] |= 1u << (bit % 8);
+        } else {
+            data[bit / 8] &= ~(1u << (bit % 8));
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "stationTable.h"
+#include "linkMonitor.h"
+#include "timerWheel.h"
+#include "canBus.h"
+#include "canStatus.h"
+
+#define BATTERY_UNKNOWN 255
+#define SD_UNKNOWN      65535
+
+// The last camera's identifier has to stay an 11-bit one
+_Static_assert(CONFIG_CAN_STATUS_BASE_ID + MAX_CAMERAS - 1 <= 0x7ff,
+               "CONFIG_CAN_STATUS_BASE_ID leaves no identifier for the last camera");
+
+const can_signal_t can_status_signals[CAN_STATUS_SIGNAL_COUNT] = {
+    [CAN_STATUS_RECORDING] = {
+        .name = "recording",
+        .id = CONFIG_CAN_STATUS_BASE_ID,
+        .start = 0,
+        .length = 1,
+        .byte_order = CAN_BYTE_ORDER_INTEL,
+        .factor = 1,
+    },
+    [CAN_STATUS_JOINED] = {
+        .name = "joined",
+        .id = CONFIG_CAN_STATUS_BASE_ID,
+        .start = 1,
+        .length = 1,
+        .byte_order = CAN_BYTE_ORDER_INTEL,
+        .factor = 1,
+    },
+    [CAN_STATUS_BATTERY] = {
+        .name = "battery",
+        .id = CONFIG_CAN_STATUS_BASE_ID,
+        .start = 8,
+        .length = 8,
+        .byte_order = CAN_BYTE_ORDER_INTEL,
+        .factor = 1,
+    },
+    [CAN_STATUS_SD_REMAINING] = {
+        .name = "sd_remaining",
+        .id = CONFIG_CAN_STATUS_BASE_ID,
+        .start = 16,
+        .length = 16,
+        .byte_order = CAN_BYTE_ORDER_INTEL,
+        .factor = 16,
+    },
+    [CAN_STATUS_LINK_QUALITY] = {
+        .name = "link_quality",
+        .id = CONFIG_CAN_STATUS_BASE_ID,
+        .start = 32,
+        .length = 8,
+        .byte_order = CAN_BYTE_ORDER_INTEL,
+        .factor = 1,
+    },
+};
+
+// One camera per tick, so each camera's frame comes round once a period
+#define TICK_MS (CONFIG_CAN_STATUS_INTERVAL_MS / MAX_CAMERAS > 0 ? CONFIG_CAN_STATUS_INTERVAL_MS / MAX_CAMERAS : 1)
+
+static timer_node_t status_timer;
+static int next_camera;
+// Recording state last published per camera, -1 before the first frame
+static int8_t published[MAX_CAMERAS];
+
+// Best of the camera's links, 100 less its loss rate, 0 while down or not
+// probed yet
+static uint8_t link_quality(int camera)
+{
+    uint8_t best = 0;
+    for (int transport = 0; transport < LINK_TRANSPORT_COUNT; transport++) {
+        link_stats_t stats;
+        if (!link_monitor_get(camera, transport, &stats) ||
+            stats.state == LINK_STATE_UNKNOWN || stats.state == LINK_STATE_DOWN) {
+            continue;
+        }
+        uint8_t quality = 100 - (stats.loss_permille < 1000 ? stats.loss_permille : 1000) / 10;
+        if (quality > best) {
+            best = quality;
+        }
+    }
+    return best;
+}
+
+void can_status_pack(const camera_state_t *state, bool joined, uint8_t link_quality, uint8_t data[8])
+{
+    const can_signal_t *s = can_status_signals;
+    memset(data, 0, 8);
+    can_signal_encode(&s[CAN_STATUS_RECORDING], data, state->recording);
+    can_signal_encode(&s[CAN_STATUS_JOINED], data, joined);
+    can_signal_encode(&s[CAN_STATUS_BATTERY], data,
+                      state->battery == CAMERA_BATTERY_UNKNOWN ? BATTERY_UNKNOWN : state->battery);
+    // In MiB, the signal's factor makes steps of 16 of them
+    can_signal_encode(&s[CAN_STATUS_SD_REMAINING], data,
+                      state->sd_remaining == CAMERA_SD_UNKNOWN ? (float)SD_UNKNOWN * 16 : state->sd_remaining / 1024.0f);
+    can_signal_encode(&s[CAN_STATUS_LINK_QUALITY], data, link_quality);
+}
+
+static void publish(int camera, const camera_state_t *state, can_tx_priority_t priority)
+{
+    uint32_t ip;
+    can_frame_t frame = {
+        .id = CONFIG_CAN_STATUS_BASE_ID + camera,
+        .len = 8,
+    };
+    can_status_pack(state, station_table_camera_ip(camera, &ip), link_quality(camera), frame.data);
+    if (can_bus_transmit(&frame, priority, 0)) {
+        published[camera] = state->recording;
+    }
+}
+
+static void status_tick(timer_node_t *node, void *arg)
+{
+    camera_state_t states[MAX_CAMERAS];
+    camera_state_snapshot(states);
+
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        if (published[camera] >= 0 && published[camera] != states[camera].recording) {
+            publish(camera, &states[camera], CAN_TX_PRIORITY_HIGH);
+        }
+    }
+    publish(next_camera, &states[next_camera], CAN_TX_PRIORITY_LOW);
+    next_camera = (next_camera + 1) % MAX_CAMERAS;
+}
+
+void can_status_start(void)
+{
+    memset(published, -1, sizeof(published));
+    timer_node_init(&status_timer, status_tick, NULL);
+    timer_service_start(&status_timer, TICK_MS, TICK_MS);
+}
@@ -0,0 +1,48 @@
+#include "canTime.h"
+
+#define N2K_DATE_UNAVAILABLE 0xffff
+#define N2K_TIME_UNAVAILABLE 0xffffffff
+#define N2K_TIME_UNIT_US     100
+
+// J1939 identifier: priority, data page, PDU format, PDU specific, source.
+// PDU formats from 240 up are broadcasts and the PDU specific byte is part
+// of the PGN.
+static uint32_t pgn_of(uint32_t id)
+{
+    uint32_t pgn = (id >> 8) & 0x3ffff;
+    if (((pgn >> 8) & 0xff) < 240) {
+        pgn &= 0x3ff00;
+    }
+    return pgn;
+}
+
+bool can_time_decode_nmea2000(const can_frame_t *frame, int64_t *utc_us)
+{
+    if (!frame->extd || frame->rtr || frame->len < 8 || pgn_of(frame->id) != CAN_TIME_PGN_SYSTEM_TIME) {
+        return false;
+    }
+    // Byte 0 is the sequence id, byte 1 the time source
+    uint16_t days = frame->data[2] | frame->data[3] << 8;
+    uint32_t tenths_ms = frame->data[4] | frame->data[5] << 8 | frame->data[6] << 16 | (uint32_t)frame->data[7] << 24;
+    if (days == N2K_DATE_UNAVAILABLE || tenths_ms == N2K_TIME_UNAVAILABLE) {
+        return false;
+    }
+    *utc_us = (int64_t)days * 86400 * 1000000 + (int64_t)tenths_ms * N2K_TIME_UNIT_US;
+    return true;
+}
+
+bool can_time_decode_unix(const can_frame_t *frame, uint32_t id, int64_t *utc_us)
+{
+    if (frame->extd || frame->rtr || frame->id != id || frame->len < 8) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | frame->data[i];
+    }
+    if (value == 0 || value > INT64_MAX) {
+        return false;
+    }
+    *utc_us = value;
+    return true;
+}
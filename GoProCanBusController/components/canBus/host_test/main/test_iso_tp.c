@@ -0,0 +1,419 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "isoTp.h"
+
+#define TIMEOUT_US      1000000
+#define BUFFER_SIZE     256
+#define POOL_COUNT      2
+#define MAX_FRAMES      64
+#define PAD             0xcc
+
+static uint8_t memory[POOL_COUNT][BUFFER_SIZE];
+static isotp_buffer_t pool[POOL_COUNT];
+static isotp_link_t iso_link;
+
+// What the link handed to the bus and to the application
+static uint8_t frames[MAX_FRAMES][ISOTP_FRAME_LEN];
+static int frame_count;
+static bool bus_full;
+static uint8_t *received;
+static size_t received_len;
+static int received_count;
+static int sent_ok, sent_failed;
+
+static uint8_t message[BUFFER_SIZE + 1];
+
+static bool bus_send(void *ctx, const uint8_t *frame, uint8_t len)
+{
+    TEST_ASSERT_EQUAL_INT(ISOTP_FRAME_LEN, len);
+    if (bus_full || frame_count == MAX_FRAMES) {
+        return false;
+    }
+    memcpy(frames[frame_count++], frame, len);
+    return true;
+}
+
+static void on_received(void *ctx, uint8_t *data, size_t len)
+{
+    received = data;
+    received_len = len;
+    received_count++;
+}
+
+static void on_sent(void *ctx, bool ok)
+{
+    if (ok) {
+        sent_ok++;
+    } else {
+        sent_failed++;
+    }
+}
+
+static void start(uint8_t block_size)
+{
+    for (int i = 0; i < POOL_COUNT; i++) {
+        pool[i] = (isotp_buffer_t){.data = memory[i], .size = BUFFER_SIZE};
+    }
+    isotp_config_t config = {
+        .block_size = block_size,
+        .st_min = 0,
+        .timeout_us = TIMEOUT_US,
+        .padding = PAD,
+    };
+    isotp_callbacks_t callbacks = {
+        .send = bus_send,
+        .received = on_received,
+        .sent = on_sent,
+    };
+    isotp_init(&iso_link, &config, &callbacks, pool, POOL_COUNT);
+    frame_count = 0;
+    bus_full = false;
+    received = NULL;
+    received_len = 0;
+    received_count = 0;
+    sent_ok = 0;
+    sent_failed = 0;
+}
+
+static void feed(const uint8_t *frame, int64_t now_us)
+{
+    isotp_receive(&iso_link, frame, ISOTP_FRAME_LEN, now_us);
+}
+
+static void feed_first(uint16_t len, int64_t now_us)
+{
+    uint8_t frame[ISOTP_FRAME_LEN] = {ISOTP_PCI_FIRST << 4 | len >> 8, len & 0xff};
+    memcpy(&frame[2], message, 6);
+    feed(frame, now_us);
+}
+
+// Consecutive frame index (from 1) of a len byte message
+static void feed_consecutive(int index, uint8_t sn, uint16_t len, int64_t now_us)
+{
+    uint8_t frame[ISOTP_FRAME_LEN] = {ISOTP_PCI_CONSECUTIVE << 4 | (sn & 0x0f)};
+    int pos = 6 + (index - 1) * 7;
+    int chunk = len - pos < 7 ? len - pos : 7;
+    memcpy(&frame[1], &message[pos], chunk);
+    feed(frame, now_us);
+}
+
+static void feed_flow_control(uint8_t status, uint8_t block_size, int64_t now_us)
+{
+    uint8_t frame[ISOTP_FRAME_LEN] = {ISOTP_PCI_FLOW_CONTROL << 4 | status, block_size, 0};
+    feed(frame, now_us);
+}
+
+// After the 6 bytes of the first frame, 7 a frame
+static int consecutive_frames(uint16_t len)
+{
+    return (len - 6 + 7 - 1) / 7;
+}
+
+static bool pool_free(void)
+{
+    for (int i = 0; i < POOL_COUNT; i++) {
+        if (pool[i].busy) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The last frame the link sent is a flow control with this status
+static void check_flow_control(uint8_t status)
+{
+    TEST_ASSERT_TRUE(frame_count > 0);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_FLOW_CONTROL << 4 | status, frames[frame_count - 1][0]);
+}
+
+void setUp(void)
+{
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = i * 7 + 1;
+    }
+    start(0);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_single_frame(void)
+{
+    const uint8_t frame[ISOTP_FRAME_LEN] = {0x03, 'a', 'b', 'c', PAD, PAD, PAD, PAD};
+    feed(frame, 0);
+    TEST_ASSERT_EQUAL_INT(1, received_count);
+    TEST_ASSERT_EQUAL_INT(3, received_len);
+    TEST_ASSERT_EQUAL_MEMORY("abc", received, 3);
+    TEST_ASSERT_EQUAL_INT(0, frame_count);
+    isotp_release(&iso_link, received);
+    TEST_ASSERT_TRUE(pool_free());
+
+    // Sent as one padded frame, and done at once
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, (const uint8_t *)"xyz", 3, 0));
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    const uint8_t expected[ISOTP_FRAME_LEN] = {0x03, 'x', 'y', 'z', PAD, PAD, PAD, PAD};
+    TEST_ASSERT_EQUAL_MEMORY(expected, frames[0], ISOTP_FRAME_LEN);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+}
+
+static void test_receive_without_blocks(void)
+{
+    const uint16_t len = 20;
+    feed_first(len, 0);
+    check_flow_control(ISOTP_FS_CTS);
+    TEST_ASSERT_EQUAL_UINT8(0, frames[0][1]);
+    for (int i = 1; i <= consecutive_frames(len); i++) {
+        feed_consecutive(i, i, len, i * 100);
+    }
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    TEST_ASSERT_EQUAL_INT(1, received_count);
+    TEST_ASSERT_EQUAL_INT(len, received_len);
+    TEST_ASSERT_EQUAL_MEMORY(message, received, len);
+    TEST_ASSERT_FALSE(pool_free());
+    isotp_release(&iso_link, received);
+    TEST_ASSERT_TRUE(pool_free());
+}
+
+static void test_receive_in_blocks(void)
+{
+    const uint16_t len = 6 + 7 * 9;
+    start(4);
+    feed_first(len, 0);
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    TEST_ASSERT_EQUAL_UINT8(4, frames[0][1]);
+    // Another flow control after every 4 frames, none after the last one
+    for (int i = 1; i <= 8; i++) {
+        feed_consecutive(i, i, len, i * 100);
+        TEST_ASSERT_EQUAL_INT(1 + i / 4, frame_count);
+    }
+    feed_consecutive(9, 9, len, 900);
+    TEST_ASSERT_EQUAL_INT(3, frame_count);
+    check_flow_control(ISOTP_FS_CTS);
+    TEST_ASSERT_EQUAL_INT(1, received_count);
+    TEST_ASSERT_EQUAL_MEMORY(message, received, len);
+}
+
+static void test_send_without_blocks(void)
+{
+    const uint16_t len = 30;
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, len, 0));
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_FIRST << 4, frames[0][0]);
+    TEST_ASSERT_EQUAL_UINT8(len, frames[0][1]);
+    TEST_ASSERT_EQUAL_MEMORY(message, &frames[0][2], 6);
+
+    // Nothing more until the receiver's flow control
+    isotp_poll(&iso_link, 1000);
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    TEST_ASSERT_FALSE(isotp_send(&iso_link, message, len, 1000));
+
+    feed_flow_control(ISOTP_FS_CTS, 0, 2000);
+    TEST_ASSERT_EQUAL_INT(1 + consecutive_frames(len), frame_count);
+    for (int i = 1; i <= consecutive_frames(len); i++) {
+        TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | i, frames[i][0]);
+    }
+    // The last frame carries the remaining 3 bytes, then padding
+    TEST_ASSERT_EQUAL_MEMORY(&message[27], &frames[4][1], 3);
+    TEST_ASSERT_EQUAL_HEX8(PAD, frames[4][4]);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+}
+
+static void test_send_in_blocks(void)
+{
+    const uint16_t len = 6 + 7 * 5;
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, len, 0));
+    feed_flow_control(ISOTP_FS_CTS, 2, 100);
+    TEST_ASSERT_EQUAL_INT(3, frame_count);
+    isotp_poll(&iso_link, 200);
+    TEST_ASSERT_EQUAL_INT(3, frame_count);
+
+    feed_flow_control(ISOTP_FS_CTS, 2, 300);
+    TEST_ASSERT_EQUAL_INT(5, frame_count);
+    feed_flow_control(ISOTP_FS_CTS, 2, 400);
+    TEST_ASSERT_EQUAL_INT(6, frame_count);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | 5, frames[5][0]);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+}
+
+// Sequence numbers run 1 to 15, then 0 and up again
+static void test_sequence_number_wraps(void)
+{
+    const uint16_t len = 6 + 7 * 20;
+    feed_first(len, 0);
+    for (int i = 1; i <= 20; i++) {
+        feed_consecutive(i, i, len, i);
+    }
+    TEST_ASSERT_EQUAL_INT(1, received_count);
+    TEST_ASSERT_EQUAL_MEMORY(message, received, len);
+    isotp_release(&iso_link, received);
+
+    frame_count = 0;
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, len, 100));
+    feed_flow_control(ISOTP_FS_CTS, 0, 100);
+    TEST_ASSERT_EQUAL_INT(21, frame_count);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | 15, frames[15][0]);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | 0, frames[16][0]);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | 4, frames[20][0]);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+}
+
+static void test_out_of_order_frame_aborts(void)
+{
+    const uint16_t len = 40;
+    feed_first(len, 0);
+    feed_consecutive(1, 1, len, 100);
+    TEST_ASSERT_FALSE(pool_free());
+    feed_consecutive(3, 3, len, 200);
+    TEST_ASSERT_TRUE(pool_free());
+
+    // The rest of the message is ignored
+    feed_consecutive(2, 2, len, 300);
+    for (int i = 3; i <= consecutive_frames(len); i++) {
+        feed_consecutive(i, i, len, 300);
+    }
+    TEST_ASSERT_EQUAL_INT(0, received_count);
+    TEST_ASSERT_TRUE(pool_free());
+    TEST_ASSERT_EQUAL_INT(INT64_MAX, isotp_next_poll_us(&iso_link));
+}
+
+// The sender holds on through N_WFTmax waits in a row, one more gives up
+static void test_wait_then_overflow(void)
+{
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 20, 0));
+    for (int i = 0; i < ISOTP_MAX_WAITS; i++) {
+        feed_flow_control(ISOTP_FS_WAIT, 0, i * 500000);
+    }
+    // Each wait restarts N_Bs
+    isotp_poll(&iso_link, (ISOTP_MAX_WAITS - 1) * 500000 + TIMEOUT_US - 1);
+    TEST_ASSERT_EQUAL_INT(0, sent_failed);
+    feed_flow_control(ISOTP_FS_CTS, 0, ISOTP_MAX_WAITS * 500000);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 20, 0));
+    for (int i = 0; i <= ISOTP_MAX_WAITS; i++) {
+        feed_flow_control(ISOTP_FS_WAIT, 0, i);
+    }
+    TEST_ASSERT_EQUAL_INT(1, sent_failed);
+
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 20, 0));
+    feed_flow_control(ISOTP_FS_WAIT, 0, 1);
+    feed_flow_control(ISOTP_FS_OVERFLOW, 0, 2);
+    TEST_ASSERT_EQUAL_INT(2, sent_failed);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 3, 3));
+}
+
+static void test_flow_control_timeout(void)
+{
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 20, 0));
+    TEST_ASSERT_EQUAL_INT(TIMEOUT_US, isotp_next_poll_us(&iso_link));
+    isotp_poll(&iso_link, TIMEOUT_US - 1);
+    TEST_ASSERT_EQUAL_INT(0, sent_failed);
+    isotp_poll(&iso_link, TIMEOUT_US);
+    TEST_ASSERT_EQUAL_INT(1, sent_failed);
+
+    // Also between blocks
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, 30, 0));
+    feed_flow_control(ISOTP_FS_CTS, 1, 100);
+    isotp_poll(&iso_link, 100 + TIMEOUT_US);
+    TEST_ASSERT_EQUAL_INT(2, sent_failed);
+    TEST_ASSERT_EQUAL_INT(0, sent_ok);
+}
+
+static void test_consecutive_frame_timeout(void)
+{
+    const uint16_t len = 30;
+    feed_first(len, 0);
+    feed_consecutive(1, 1, len, 500000);
+    TEST_ASSERT_EQUAL_INT(500000 + TIMEOUT_US, isotp_next_poll_us(&iso_link));
+    isotp_poll(&iso_link, 500000 + TIMEOUT_US - 1);
+    TEST_ASSERT_FALSE(pool_free());
+    isotp_poll(&iso_link, 500000 + TIMEOUT_US);
+    TEST_ASSERT_TRUE(pool_free());
+    feed_consecutive(2, 2, len, 500000 + TIMEOUT_US);
+    TEST_ASSERT_EQUAL_INT(0, received_count);
+}
+
+// A frame the bus refuses goes out on a later poll, nothing is lost
+static void test_bus_refuses_then_takes(void)
+{
+    const uint16_t len = 20;
+    bus_full = true;
+    TEST_ASSERT_TRUE(isotp_send(&iso_link, message, len, 0));
+    TEST_ASSERT_EQUAL_INT(0, frame_count);
+    int64_t retry = isotp_next_poll_us(&iso_link);
+    TEST_ASSERT_TRUE(retry > 0 && retry < TIMEOUT_US);
+    bus_full = false;
+    isotp_poll(&iso_link, retry);
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_FIRST << 4, frames[0][0]);
+
+    // Refused halfway through the consecutive frames
+    bus_full = true;
+    feed_flow_control(ISOTP_FS_CTS, 0, retry + 10);
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    bus_full = false;
+    isotp_poll(&iso_link, isotp_next_poll_us(&iso_link));
+    TEST_ASSERT_EQUAL_INT(1 + consecutive_frames(len), frame_count);
+    TEST_ASSERT_EQUAL_HEX8(ISOTP_PCI_CONSECUTIVE << 4 | 1, frames[1][0]);
+    TEST_ASSERT_EQUAL_INT(1, sent_ok);
+
+    // And a flow control
+    frame_count = 0;
+    bus_full = true;
+    feed_first(len, 0);
+    bus_full = false;
+    isotp_poll(&iso_link, isotp_next_poll_us(&iso_link));
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    check_flow_control(ISOTP_FS_CTS);
+}
+
+static void test_pool_exhausted(void)
+{
+    const uint8_t frame[ISOTP_FRAME_LEN] = {0x01, 'a'};
+    feed(frame, 0);
+    uint8_t *first = received;
+    feed(frame, 0);
+    TEST_ASSERT_EQUAL_INT(2, received_count);
+    TEST_ASSERT_FALSE(pool_free());
+
+    // Both buffers are with the receiver: a single frame is dropped, a first
+    // frame answered with an overflow
+    feed(frame, 0);
+    TEST_ASSERT_EQUAL_INT(2, received_count);
+    feed_first(20, 0);
+    TEST_ASSERT_EQUAL_INT(1, frame_count);
+    check_flow_control(ISOTP_FS_OVERFLOW);
+    feed_consecutive(1, 1, 20, 100);
+    TEST_ASSERT_EQUAL_INT(2, received_count);
+
+    isotp_release(&iso_link, first);
+    feed_first(20, 200);
+    check_flow_control(ISOTP_FS_CTS);
+
+    // Longer than any buffer
+    start(0);
+    feed_first(BUFFER_SIZE + 1, 0);
+    check_flow_control(ISOTP_FS_OVERFLOW);
+    TEST_ASSERT_TRUE(pool_free());
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_frame);
+    RUN_TEST(test_receive_without_blocks);
+    RUN_TEST(test_receive_in_blocks);
+    RUN_TEST(test_send_without_blocks);
+    RUN_TEST(test_send_in_blocks);
+    RUN_TEST(test_sequence_number_wraps);
+    RUN_TEST(test_out_of_order_frame_aborts);
+    RUN_TEST(test_wait_then_overflow);
+    RUN_TEST(test_flow_control_timeout);
+    RUN_TEST(test_consecutive_frame_timeout);
+    RUN_TEST(test_bus_refuses_then_takes);
+    RUN_TEST(test_pool_exhausted);
+    exit(UNITY_END());
+}
@@ -0,0 +1,41 @@
+#ifndef CAN_BUS_H
+#define CAN_BUS_H
+
+// Vehicle CAN bus over the TWAI controller. Frames are matched against a
+// table of signals; the record signal starts and stops every camera on the
+// transport auto-selection would pick for it, and the marker signal drops a
+// HiLight. A time frame, if configured, sets the clock of timeSync.h. Frames
+// going out wait in one queue per priority for a transmit task of their own,
+// so a busy bus never holds up reception.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include "canPort.h"
+
+typedef enum {
+    CAN_TX_PRIORITY_HIGH,       // Sent before any low priority frame waiting
+    CAN_TX_PRIORITY_LOW,
+    CAN_TX_PRIORITY_COUNT,
+} can_tx_priority_t;
+
+// Installs the TWAI driver, starts the receive, dispatch and transmit tasks,
+// the status publisher and the ISO-TP link. Does nothing when
+// CONFIG_CAN_BUS_ENABLED is off.
+esp_err_t can_bus_init(void);
+
+// Feeds one standard frame received at rx_us (esp_timer time), as the receive
+// task does for every frame off the bus
+void can_bus_ingest(uint32_t id, const uint8_t *data, uint8_t len, int64_t rx_us);
+
+// Queues a frame for the transmit task, waiting up to wait ticks for room.
+// False if the queue of its priority stayed full or the bus is not running.
+bool can_bus_transmit(const can_frame_t *frame, can_tx_priority_t priority, TickType_t wait);
+
+// Sees every start and stop of the record state machine, on the ingesting
+// task and before the cameras are told
+typedef void (*can_record_hook_t)(bool recording, int64_t rx_us, void *ctx);
+
+void can_bus_set_record_hook(can_record_hook_t hook, void *ctx);
+
+#endif // CAN_BUS_H
@@ -0,0 +1,26 @@
+#ifndef CAN_ISO_TP_H
+#define CAN_ISO_TP_H
+
+// The REST API over ISO-TP, for a PC or logger on the vehicle bus. Requests
+// arrive on CONFIG_CAN_ISOTP_RX_ID as
+//
+//   <method> <path>\n<body>        e.g. "POST /api/command\n{...}"
+//
+// and are answered on CONFIG_CAN_ISOTP_TX_ID with
+//
+//   <HTTP status>\n<body>
+//
+// Each request is passed on to the controller's own web server over
+// loopback, so every route behaves exactly as it does over Wi-Fi. One
+// request is served at a time; the next may already be arriving meanwhile.
+
+#include <stdint.h>
+#include "canPort.h"
+
+// Starts the link and its tasks, called by can_bus_init()
+void can_isotp_start(void);
+
+// Hands over a frame received on CONFIG_CAN_ISOTP_RX_ID, never blocks
+void can_isotp_receive(const can_frame_t *frame, int64_t rx_us);
+
+#endif // CAN_ISO_TP_H
@@ -0,0 +1,33 @@
+#ifndef CAN_PORT_H
+#define CAN_PORT_H
+
+// The bus under canBus.c: the TWAI controller on the chip, an in-process bus
+// on the linux target (see canSim.h).
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint32_t id;
+    bool extd;                  // 29-bit identifier
+    bool rtr;                   // Remote frame, no payload
+    uint8_t len;
+    uint8_t data[8];
+} can_frame_t;
+
+// Frames the port holds until the receive task takes them, a whole ISO-TP
+// block at the default block size with room to spare
+#define CAN_PORT_RX_QUEUE_LEN 16
+
+// Brings the controller up at the configured bit rate, accepting every frame
+esp_err_t can_port_start(void);
+
+// Waits up to wait ticks for the next frame, ESP_ERR_TIMEOUT if none came
+esp_err_t can_port_receive(can_frame_t *frame, TickType_t wait);
+
+// Queues a frame for sending, waiting up to wait ticks for room
+esp_err_t can_port_transmit(const can_frame_t *frame, TickType_t wait);
+
+#endif // CAN_PORT_H
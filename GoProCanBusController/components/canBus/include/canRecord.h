@@ -0,0 +1,30 @@
+#ifndef CAN_RECORD_H
+#define CAN_RECORD_H
+
+// Turns the record signal, repeated in every frame, into start and stop
+// edges. A new value has to be seen in a number of frames in a row before it
+// counts, so one bad frame cannot toggle the cameras.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    CAN_RECORD_NONE,
+    CAN_RECORD_START,
+    CAN_RECORD_STOP,
+} can_record_action_t;
+
+typedef struct {
+    int8_t recording;           // Last accepted value, -1 before the first
+    int8_t pending;             // Value being confirmed
+    uint8_t count;              // Frames in a row that carried it
+    uint8_t confirm;            // Frames needed
+} can_record_t;
+
+void can_record_init(can_record_t *sm, uint8_t confirm);
+
+// Feeds the value of one frame. The first value seen only starts recording,
+// cameras are assumed idle until then.
+can_record_action_t can_record_update(can_record_t *sm, bool requested);
+
+#endif // CAN_RECORD_H
@@ -0,0 +1,33 @@
+#ifndef CAN_SIGNALS_H
+#define CAN_SIGNALS_H
+
+// Signals packed in CAN frames, described the way a DBC file does: start bit,
+// length, byte order, sign, and a linear scale to physical units.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    CAN_BYTE_ORDER_INTEL,       // Little endian, start is the least significant bit
+    CAN_BYTE_ORDER_MOTOROLA,    // Big endian, start is the most significant bit
+} can_byte_order_t;
+
+typedef struct {
+    const char *name;
+    uint32_t id;                // 11-bit identifier of the frame that carries it
+    uint8_t start;
+    uint8_t length;             // Bits, 1 to 32
+    can_byte_order_t byte_order;
+    bool is_signed;
+    float factor;               // physical = raw * factor + offset
+    float offset;
+} can_signal_t;
+
+// Physical value of the signal in an 8-byte payload
+float can_signal_decode(const can_signal_t *signal, const uint8_t data[8]);
+
+// Packs a physical value into the payload, clamped to what the signal can hold.
+// Other bits of the payload are left as they are.
+void can_signal_encode(const can_signal_t *signal, uint8_t data[8], float value);
+
+#endif // CAN_SIGNALS_H
@@ -0,0 +1,18 @@
+#ifndef CAN_SIM_H
+#define CAN_SIM_H
+
+// In-process CAN bus of the linux target. Frames injected here are received
+// by the controller as if they came off the wire; frames it sends go to the
+// transmit hook instead of a transceiver.
+
+#include "canPort.h"
+
+// Puts a frame on the bus, false if the receive queue is full and it is lost
+bool can_sim_inject(const can_frame_t *frame);
+
+// Sees every frame the controller sends, on the sending task
+typedef void (*can_sim_tx_hook_t)(const can_frame_t *frame, void *ctx);
+
+void can_sim_set_tx_hook(can_sim_tx_hook_t hook, void *ctx);
+
+#endif // CAN_SIM_H
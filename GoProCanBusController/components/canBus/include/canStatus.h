@@ -0,0 +1,42 @@
+#ifndef CAN_STATUS_H
+#define CAN_STATUS_H
+
+// Camera state published on the bus for dashes and loggers. Camera n sends
+// an 8-byte frame on CONFIG_CAN_STATUS_BASE_ID + n, packed by the signal
+// table below, all Intel byte order:
+//
+//   bit 0          recording
+//   bit 1          joined, the camera holds a DHCP lease
+//   bits 8..15     battery in percent, 255 unknown
+//   bits 16..31    SD card space left in steps of 16 MiB, 65535 unknown
+//   bits 32..39    link quality in percent, the best of the camera's links
+//                  by linkMonitor.h, 0 while all are down
+//
+// Each frame repeats every CONFIG_CAN_STATUS_INTERVAL_MS, the cameras spread
+// evenly over the period. A camera that starts or stops recording sends at
+// once, ahead of the periodic frames.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cameraState.h"
+#include "canSignals.h"
+
+typedef enum {
+    CAN_STATUS_RECORDING,
+    CAN_STATUS_JOINED,
+    CAN_STATUS_BATTERY,
+    CAN_STATUS_SD_REMAINING,
+    CAN_STATUS_LINK_QUALITY,
+    CAN_STATUS_SIGNAL_COUNT,
+} can_status_signal_t;
+
+// Identifiers are camera 0's
+extern const can_signal_t can_status_signals[CAN_STATUS_SIGNAL_COUNT];
+
+// Payload of one camera's status frame
+void can_status_pack(const camera_state_t *state, bool joined, uint8_t link_quality, uint8_t data[8]);
+
+// Publishes until reboot, called by can_bus_init()
+void can_status_start(void);
+
+#endif // CAN_STATUS_H
@@ -0,0 +1,21 @@
+#ifndef CAN_TIME_H
+#define CAN_TIME_H
+
+// Time frames on the vehicle bus, decoded to UTC microseconds since 1970.
+// Each returns false for another frame or one that says the time is not
+// available.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "canPort.h"
+
+// NMEA 2000 System Time, PGN 126992, from any source address: days since
+// 1970 and tenths of a millisecond since midnight, as a GPS broadcasts them
+#define CAN_TIME_PGN_SYSTEM_TIME 126992
+
+bool can_time_decode_nmea2000(const can_frame_t *frame, int64_t *utc_us);
+
+// Eight bytes of microseconds since 1970, little endian, on a standard identifier
+bool can_time_decode_unix(const can_frame_t *frame, uint32_t id, int64_t *utc_us);
+
+#endif // CAN_TIME_H
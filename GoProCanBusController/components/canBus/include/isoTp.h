@@ -0,0 +1,122 @@
+#ifndef ISO_TP_H
+#define ISO_TP_H
+
+// ISO 15765-2 (ISO-TP) over classic CAN, normal addressing: messages of up
+// to 4095 bytes split into single, first and consecutive frames, with flow
+// control from the receiver. One link is one pair of identifiers and carries
+// one message each way at a time.
+//
+// Received messages are reassembled in place, in buffers from a pool the
+// caller preallocates, and handed over without a copy; the receiver owns the
+// buffer until it calls isotp_release(). A first frame that finds no free
+// buffer, or none big enough, is refused with an overflow flow control.
+//
+// Time is passed in and all I/O goes through callbacks, so this builds and
+// runs on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ISOTP_MAX_LEN       4095
+#define ISOTP_FRAME_LEN     8
+
+// Protocol control information, the high nibble of the first byte
+#define ISOTP_PCI_SINGLE        0x0
+#define ISOTP_PCI_FIRST         0x1
+#define ISOTP_PCI_CONSECUTIVE   0x2
+#define ISOTP_PCI_FLOW_CONTROL  0x3
+
+// Flow status of a flow control frame
+#define ISOTP_FS_CTS        0   // Continue to send
+#define ISOTP_FS_WAIT       1
+#define ISOTP_FS_OVERFLOW   2
+
+// Wait flow controls a sender accepts in a row before it gives up (N_WFTmax)
+#define ISOTP_MAX_WAITS     10
+
+typedef struct {
+    uint8_t *data;
+    uint16_t size;
+    bool busy;                  // Reassembling or owned by the receiver
+} isotp_buffer_t;
+
+typedef struct {
+    uint8_t block_size;         // Consecutive frames per flow control, 0 for all
+    uint8_t st_min;             // Gap asked between consecutive frames, as encoded on the wire
+    uint32_t timeout_us;        // N_Bs and N_Cr: longest wait for the peer's next frame
+    int16_t padding;            // Byte frames are padded to 8 with, -1 to send them short
+} isotp_config_t;
+
+typedef struct {
+    // Queues one frame for the bus, false if there is no room; the frame is
+    // offered again on the next poll
+    bool (*send)(void *ctx, const uint8_t *frame, uint8_t len);
+    // A whole message arrived in a pool buffer, release it when done
+    void (*received)(void *ctx, uint8_t *message, size_t len);
+    // The message given to isotp_send() went out, or failed
+    void (*sent)(void *ctx, bool ok);
+    void *ctx;
+} isotp_callbacks_t;
+
+typedef enum {
+    ISOTP_IDLE,
+    ISOTP_RX_CONSECUTIVE,       // Receiving consecutive frames
+    ISOTP_TX_FIRST,             // Single or first frame not out yet
+    ISOTP_TX_WAIT_FC,           // Sent a first frame or a block, waiting for flow control
+    ISOTP_TX_CONSECUTIVE,       // Sending consecutive frames
+} isotp_state_t;
+
+typedef struct {
+    isotp_config_t config;
+    isotp_callbacks_t cb;
+    isotp_buffer_t *pool;
+    int pool_count;
+
+    isotp_state_t rx_state;
+    isotp_buffer_t *rx_buffer;
+    uint16_t rx_len;
+    uint16_t rx_pos;
+    uint8_t rx_sn;              // Sequence number of the next consecutive frame
+    uint8_t rx_block_left;      // Frames until the next flow control, 0 if unlimited
+    int64_t rx_deadline_us;
+    int8_t fc_pending;          // Flow status still to send, -1 if none
+    int64_t fc_retry_us;
+
+    isotp_state_t tx_state;
+    const uint8_t *tx_data;
+    uint16_t tx_len;
+    uint16_t tx_pos;
+    uint8_t tx_sn;
+    uint8_t tx_block_size;      // From the receiver's flow control
+    uint8_t tx_block_left;
+    uint32_t tx_st_min_us;
+    uint8_t tx_waits;
+    int64_t tx_next_us;         // When the next consecutive frame may go
+    int64_t tx_deadline_us;
+} isotp_link_t;
+
+void isotp_init(isotp_link_t *link, const isotp_config_t *config, const isotp_callbacks_t *cb,
+                isotp_buffer_t *pool, int pool_count);
+
+// Feeds one frame received on the link's identifier
+void isotp_receive(isotp_link_t *link, const uint8_t *frame, uint8_t len, int64_t now_us);
+
+// Starts sending a message, which must stay untouched until the sent
+// callback. False if a message is still going out or it is too long.
+bool isotp_send(isotp_link_t *link, const uint8_t *data, size_t len, int64_t now_us);
+
+// Sends what is due and expires timeouts
+void isotp_poll(isotp_link_t *link, int64_t now_us);
+
+// When isotp_poll() next has something to do, INT64_MAX if nothing is pending
+int64_t isotp_next_poll_us(const isotp_link_t *link);
+
+// Gives a buffer from the received callback back to the pool, from any task
+void isotp_release(isotp_link_t *link, uint8_t *message);
+
+// STmin as microseconds, and the other way round
+uint32_t isotp_st_min_to_us(uint8_t st_min);
+uint8_t isotp_st_min_from_us(uint32_t us);
+
+#endif // ISO_TP_H
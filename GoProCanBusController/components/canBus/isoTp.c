@@ -0,0 +1,332 @@
+#include <string.h>
+#include "isoTp.h"
+
+#define SINGLE_MAX          (ISOTP_FRAME_LEN - 1)
+#define FIRST_PAYLOAD       (ISOTP_FRAME_LEN - 2)
+#define CONSECUTIVE_PAYLOAD (ISOTP_FRAME_LEN - 1)
+
+// A frame the bus had no room for is offered again this much later
+#define RETRY_US 1000
+
+uint32_t isotp_st_min_to_us(uint8_t st_min)
+{
+    if (st_min <= 0x7f) {
+        return st_min * 1000u;
+    }
+    if (st_min >= 0xf1 && st_min <= 0xf9) {
+        return (st_min - 0xf0) * 100u;
+    }
+    // Reserved values read as the longest gap there is
+    return 127000;
+}
+
+uint8_t isotp_st_min_from_us(uint32_t us)
+{
+    if (us == 0) {
+        return 0;
+    }
+    if (us < 1000) {
+        return 0xf0 + (us + 99) / 100;
+    }
+    uint32_t ms = (us + 999) / 1000;
+    return ms > 0x7f ? 0x7f : ms;
+}
+
+void isotp_init(isotp_link_t *link, const isotp_config_t *config, const isotp_callbacks_t *cb,
+                isotp_buffer_t *pool, int pool_count)
+{
+    memset(link, 0, sizeof(*link));
+    link->config = *config;
+    link->cb = *cb;
+    link->pool = pool;
+    link->pool_count = pool_count;
+    link->fc_pending = -1;
+    for (int i = 0; i < pool_count; i++) {
+        pool[i].busy = false;
+    }
+}
+
+static bool send_frame(isotp_link_t *link, uint8_t *frame, uint8_t len)
+{
+    if (link->config.padding >= 0) {
+        memset(frame + len, link->config.padding, ISOTP_FRAME_LEN - len);
+        len = ISOTP_FRAME_LEN;
+    }
+    return link->cb.send(link->cb.ctx, frame, len);
+}
+
+// Claims a free buffer big enough for len bytes. The receiver may release
+// one from another task meanwhile, so the claim is a compare and swap.
+static isotp_buffer_t *acquire(isotp_link_t *link, uint16_t len)
+{
+    for (int i = 0; i < link->pool_count; i++) {
+        isotp_buffer_t *buffer = &link->pool[i];
+        bool expected = false;
+        if (buffer->size >= len &&
+            __atomic_compare_exchange_n(&buffer->busy, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return buffer;
+        }
+    }
+    return NULL;
+}
+
+void isotp_release(isotp_link_t *link, uint8_t *message)
+{
+    for (int i = 0; i < link->pool_count; i++) {
+        if (link->pool[i].data == message) {
+            __atomic_store_n(&link->pool[i].busy, false, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+
+static void rx_abort(isotp_link_t *link)
+{
+    if (link->rx_buffer != NULL) {
+        isotp_release(link, link->rx_buffer->data);
+        link->rx_buffer = NULL;
+    }
+    link->rx_state = ISOTP_IDLE;
+}
+
+static void send_flow_control(isotp_link_t *link, uint8_t status, int64_t now_us)
+{
+    uint8_t frame[ISOTP_FRAME_LEN] = {ISOTP_PCI_FLOW_CONTROL << 4 | status};
+    if (status == ISOTP_FS_CTS) {
+        frame[1] = link->config.block_size;
+        frame[2] = link->config.st_min;
+    }
+    link->fc_pending = send_frame(link, frame, 3) ? -1 : status;
+    link->fc_retry_us = now_us + RETRY_US;
+    if (link->rx_state == ISOTP_RX_CONSECUTIVE) {
+        link->rx_deadline_us = now_us + link->config.timeout_us;
+    }
+}
+
+static void tx_finish(isotp_link_t *link, bool ok)
+{
+    link->tx_state = ISOTP_IDLE;
+    link->tx_data = NULL;
+    if (link->cb.sent != NULL) {
+        link->cb.sent(link->cb.ctx, ok);
+    }
+}
+
+static void receive_single(isotp_link_t *link, const uint8_t *frame, uint8_t len)
+{
+    uint8_t dl = frame[0] & 0x0f;
+    if (dl == 0 || dl > SINGLE_MAX || dl > len - 1) {
+        return;
+    }
+    // A new message replaces one still being reassembled
+    rx_abort(link);
+    isotp_buffer_t *buffer = acquire(link, dl);
+    if (buffer == NULL) {
+        return;
+    }
+    memcpy(buffer->data, &frame[1], dl);
+    link->cb.received(link->cb.ctx, buffer->data, dl);
+}
+
+static void receive_first(isotp_link_t *link, const uint8_t *frame, uint8_t len, int64_t now_us)
+{
+    uint16_t dl = (frame[0] & 0x0f) << 8 | frame[1];
+    if (len < ISOTP_FRAME_LEN || dl <= SINGLE_MAX) {
+        return;
+    }
+    rx_abort(link);
+    isotp_buffer_t *buffer = acquire(link, dl);
+    if (buffer == NULL) {
+        send_flow_control(link, ISOTP_FS_OVERFLOW, now_us);
+        return;
+    }
+    memcpy(buffer->data, &frame[2], FIRST_PAYLOAD);
+    link->rx_buffer = buffer;
+    link->rx_len = dl;
+    link->rx_pos = FIRST_PAYLOAD;
+    link->rx_sn = 1;
+    link->rx_block_left = link->config.block_size;
+    link->rx_state = ISOTP_RX_CONSECUTIVE;
+    send_flow_control(link, ISOTP_FS_CTS, now_us);
+}
+
+static void receive_consecutive(isotp_link_t *link, const uint8_t *frame, uint8_t len, int64_t now_us)
+{
+    if (link->rx_state != ISOTP_RX_CONSECUTIVE) {
+        return;
+    }
+    uint16_t chunk = link->rx_len - link->rx_pos;
+    chunk = chunk < CONSECUTIVE_PAYLOAD ? chunk : CONSECUTIVE_PAYLOAD;
+    if ((frame[0] & 0x0f) != link->rx_sn || len - 1 < chunk) {
+        rx_abort(link);
+        return;
+    }
+    memcpy(link->rx_buffer->data + link->rx_pos, &frame[1], chunk);
+    link->rx_pos += chunk;
+    link->rx_sn = (link->rx_sn + 1) & 0x0f;
+
+    if (link->rx_pos == link->rx_len) {
+        isotp_buffer_t *buffer = link->rx_buffer;
+        link->rx_buffer = NULL;
+        link->rx_state = ISOTP_IDLE;
+        link->cb.received(link->cb.ctx, buffer->data, link->rx_len);
+        return;
+    }
+    link->rx_deadline_us = now_us + link->config.timeout_us;
+    if (link->config.block_size != 0 && --link->rx_block_left == 0) {
+        link->rx_block_left = link->config.block_size;
+        send_flow_control(link, ISOTP_FS_CTS, now_us);
+    }
+}
+
+static void receive_flow_control(isotp_link_t *link, const uint8_t *frame, uint8_t len, int64_t now_us)
+{
+    if (link->tx_state != ISOTP_TX_WAIT_FC || len < 3) {
+        return;
+    }
+    switch (frame[0] & 0x0f) {
+    case ISOTP_FS_CTS:
+        link->tx_block_size = frame[1];
+        link->tx_block_left = frame[1];
+        link->tx_st_min_us = isotp_st_min_to_us(frame[2]);
+        link->tx_waits = 0;
+        link->tx_state = ISOTP_TX_CONSECUTIVE;
+        link->tx_next_us = now_us;
+        isotp_poll(link, now_us);
+        break;
+    case ISOTP_FS_WAIT:
+        if (++link->tx_waits > ISOTP_MAX_WAITS) {
+            tx_finish(link, false);
+        } else {
+            link->tx_deadline_us = now_us + link->config.timeout_us;
+        }
+        break;
+    default:
+        // Overflow, or a status this end does not know
+        tx_finish(link, false);
+        break;
+    }
+}
+
+void isotp_receive(isotp_link_t *link, const uint8_t *frame, uint8_t len, int64_t now_us)
+{
+    if (len == 0) {
+        return;
+    }
+    switch (frame[0] >> 4) {
+    case ISOTP_PCI_SINGLE:
+        receive_single(link, frame, len);
+        break;
+    case ISOTP_PCI_FIRST:
+        receive_first(link, frame, len, now_us);
+        break;
+    case ISOTP_PCI_CONSECUTIVE:
+        receive_consecutive(link, frame, len, now_us);
+        break;
+    case ISOTP_PCI_FLOW_CONTROL:
+        receive_flow_control(link, frame, len, now_us);
+        break;
+    }
+}
+
+bool isotp_send(isotp_link_t *link, const uint8_t *data, size_t len, int64_t now_us)
+{
+    if (link->tx_state != ISOTP_IDLE || len == 0 || len > ISOTP_MAX_LEN) {
+        return false;
+    }
+    link->tx_data = data;
+    link->tx_len = len;
+    link->tx_pos = 0;
+    link->tx_state = ISOTP_TX_FIRST;
+    link->tx_next_us = now_us;
+    isotp_poll(link, now_us);
+    return true;
+}
+
+// Sends every frame that is due, stopping at the first the bus has no room for
+static void transmit(isotp_link_t *link, int64_t now_us)
+{
+    while ((link->tx_state == ISOTP_TX_FIRST || link->tx_state == ISOTP_TX_CONSECUTIVE) &&
+           now_us >= link->tx_next_us) {
+        uint8_t frame[ISOTP_FRAME_LEN];
+        uint8_t len;
+        uint16_t chunk = 0;
+        if (link->tx_state == ISOTP_TX_FIRST && link->tx_len <= SINGLE_MAX) {
+            frame[0] = ISOTP_PCI_SINGLE << 4 | link->tx_len;
+            memcpy(&frame[1], link->tx_data, link->tx_len);
+            len = 1 + link->tx_len;
+        } else if (link->tx_state == ISOTP_TX_FIRST) {
+            frame[0] = ISOTP_PCI_FIRST << 4 | link->tx_len >> 8;
+            frame[1] = link->tx_len & 0xff;
+            memcpy(&frame[2], link->tx_data, FIRST_PAYLOAD);
+            len = ISOTP_FRAME_LEN;
+        } else {
+            chunk = link->tx_len - link->tx_pos;
+            chunk = chunk < CONSECUTIVE_PAYLOAD ? chunk : CONSECUTIVE_PAYLOAD;
+            frame[0] = ISOTP_PCI_CONSECUTIVE << 4 | link->tx_sn;
+            memcpy(&frame[1], link->tx_data + link->tx_pos, chunk);
+            len = 1 + chunk;
+        }
+        if (!send_frame(link, frame, len)) {
+            link->tx_next_us = now_us + RETRY_US;
+            return;
+        }
+
+        if (link->tx_state == ISOTP_TX_FIRST) {
+            if (link->tx_len <= SINGLE_MAX) {
+                tx_finish(link, true);
+                return;
+            }
+            link->tx_pos = FIRST_PAYLOAD;
+            link->tx_sn = 1;
+            link->tx_waits = 0;
+            link->tx_state = ISOTP_TX_WAIT_FC;
+            link->tx_deadline_us = now_us + link->config.timeout_us;
+            return;
+        }
+        link->tx_pos += chunk;
+        link->tx_sn = (link->tx_sn + 1) & 0x0f;
+        if (link->tx_pos == link->tx_len) {
+            tx_finish(link, true);
+            return;
+        }
+        if (link->tx_block_size != 0 && --link->tx_block_left == 0) {
+            link->tx_state = ISOTP_TX_WAIT_FC;
+            link->tx_deadline_us = now_us + link->config.timeout_us;
+            return;
+        }
+        link->tx_next_us = now_us + link->tx_st_min_us;
+    }
+}
+
+void isotp_poll(isotp_link_t *link, int64_t now_us)
+{
+    if (link->fc_pending >= 0 && now_us >= link->fc_retry_us) {
+        send_flow_control(link, link->fc_pending, now_us);
+    }
+    if (link->rx_state == ISOTP_RX_CONSECUTIVE && now_us >= link->rx_deadline_us) {
+        rx_abort(link);
+    }
+    if (link->tx_state == ISOTP_TX_WAIT_FC && now_us >= link->tx_deadline_us) {
+        tx_finish(link, false);
+    }
+    transmit(link, now_us);
+}
+
+int64_t isotp_next_poll_us(const isotp_link_t *link)
+{
+    int64_t next = INT64_MAX;
+    if (link->fc_pending >= 0) {
+        next = link->fc_retry_us;
+    }
+    if (link->rx_state == ISOTP_RX_CONSECUTIVE && link->rx_deadline_us < next) {
+        next = link->rx_deadline_us;
+    }
+    if (link->tx_state == ISOTP_TX_WAIT_FC && link->tx_deadline_us < next) {
+        next = link->tx_deadline_us;
+    }
+    if ((link->tx_state == ISOTP_TX_FIRST || link->tx_state == ISOTP_TX_CONSECUTIVE) && link->tx_next_us < next) {
+        next = link->tx_next_us;
+    }
+    return next;
+}
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "cameraState.h"
+#include "stationTable.h"
+#include "canBus.h"
+#include "canTrace.h"
+#include "canReplay.h"
+
+static const char *TAG = "can_replay";
+
+#define JOIN_TIMEOUT_MS 30000
+
+// Per-frame CPU times kept for the percentiles, a uniform sample of all of them
+#define CPU_SAMPLES 4096
+
+// Longest log line read, longer ones are skipped
+#define LINE_MAX_LEN 256
+
+typedef struct {
+    int64_t log_us;             // After the first frame of the log
+    bool recording;
+} replay_action_t;
+
+typedef struct {
+    replay_action_t *items;
+    size_t count;
+    size_t capacity;
+} replay_actions_t;
+
+static replay_actions_t actions;
+static FILE *actions_out;
+// Log time of the frame being ingested, for the record hook
+static int64_t frame_log_us;
+
+static uint32_t cpu_samples[CPU_SAMPLES];
+static uint64_t cpu_frames;
+static uint64_t cpu_total_ns;
+static uint32_t cpu_max_ns;
+
+static const char *setting(const char *env, const char *fallback)
+{
+    const char *value = getenv(env);
+    return value != NULL && value[0] != '\0' ? value : fallback;
+}
+
+static bool append(replay_actions_t *list, int64_t log_us, bool recording)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        replay_action_t *items = realloc(list->items, capacity * sizeof(*items));
+        if (items == NULL) {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = (replay_action_t){.log_us = log_us, .recording = recording};
+    return true;
+}
+
+static void record_hook(bool recording, int64_t rx_us, void *ctx)
+{
+    if (!append(&actions, frame_log_us, recording)) {
+        ESP_LOGE(TAG, "Out of memory for record actions");
+    }
+    if (actions_out != NULL) {
+        fprintf(actions_out, "%lld.%06lld %s\n", (long long)(frame_log_us / 1000000),
+                (long long)(frame_log_us % 1000000), recording ? "start" : "stop");
+    }
+}
+
+static int64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Reservoir sampling, so hours of log keep a fair sample in fixed memory
+static void observe_cpu(uint32_t ns)
+{
+    if (cpu_frames < CPU_SAMPLES) {
+        cpu_samples[cpu_frames] = ns;
+    } else {
+        uint64_t slot = esp_random() % (cpu_frames + 1);
+        if (slot < CPU_SAMPLES) {
+            cpu_samples[slot] = ns;
+        }
+    }
+    cpu_frames++;
+    cpu_total_ns += ns;
+    cpu_max_ns = ns > cpu_max_ns ? ns : cpu_max_ns;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report_cpu(void)
+{
+    if (cpu_frames == 0) {
+        return;
+    }
+    size_t n = cpu_frames < CPU_SAMPLES ? cpu_frames : CPU_SAMPLES;
+    qsort(cpu_samples, n, sizeof(cpu_samples[0]), compare_ns);
+    ESP_LOGI(TAG, "CPU per frame: mean %llu ns, p50 %lu ns, p99 %lu ns, max %lu ns",
+             (unsigned long long)(cpu_total_ns / cpu_frames), (unsigned long)cpu_samples[(n - 1) * 50 / 100],
+             (unsigned long)cpu_samples[(n - 1) * 99 / 100], (unsigned long)cpu_max_ns);
+}
+
+// Reads one line, false at the end of the file or if the line was too long
+// and had to be dropped
+static bool read_line(FILE *in, char *line, size_t size, bool *eof)
+{
+    *eof = fgets(line, size, in) == NULL;
+    if (*eof || strchr(line, '\n') != NULL || feof(in)) {
+        return !*eof;
+    }
+    int c;
+    while ((c = fgetc(in)) != '\n' && c != EOF) {
+    }
+    return false;
+}
+
+// Sleeps until the frame is due, or not at all when replaying flat out
+static void pace(int speed, int64_t start_us, int64_t log_us)
+{
+    if (speed <= 0) {
+        return;
+    }
+    int64_t wait_us = start_us + log_us / speed - esp_timer_get_time();
+    TickType_t ticks = wait_us / 1000 / portTICK_PERIOD_MS;
+    if (ticks > 0) {
+        vTaskDelay(ticks);
+    }
+}
+
+// Compares the actions against the expected file, logging the first difference
+static bool check(const char *path)
+{
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        ESP_LOGE(TAG, "Cannot read %s", path);
+        return false;
+    }
+
+    bool ok = true;
+    size_t index = 0;
+    char line[LINE_MAX_LEN];
+    for (int number = 1; ok && fgets(line, sizeof(line), in) != NULL; number++) {
+        double seconds;
+        char action[8];
+        if (line[0] == '#' || sscanf(line, "%lf %7s", &seconds, action) != 2) {
+            continue;
+        }
+        bool recording = strcmp(action, "start") == 0;
+        if (!recording && strcmp(action, "stop") != 0) {
+            ESP_LOGE(TAG, "%s:%d: unknown action %s", path, number, action);
+            ok = false;
+        } else if (index == actions.count) {
+            ESP_LOGE(TAG, "%s:%d: expected %s at %.6f s, the log ran out first", path, number, action, seconds);
+            ok = false;
+        } else {
+            const replay_action_t *got = &actions.items[index++];
+            int64_t diff = got->log_us - (int64_t)(seconds * 1000000.0 + 0.5);
+            if (got->recording != recording || llabs(diff) > CONFIG_CAN_REPLAY_TOLERANCE_US) {
+                ESP_LOGE(TAG, "%s:%d: expected %s at %.6f s, got %s at %.6f s", path, number, action, seconds,
+                         got->recording ? "start" : "stop", got->log_us / 1000000.0);
+                ok = false;
+            }
+        }
+    }
+    fclose(in);
+
+    if (ok && index < actions.count) {
+        const replay_action_t *extra = &actions.items[index];
+        ESP_LOGE(TAG, "Unexpected %s at %.6f s, and %u more", extra->recording ? "start" : "stop",
+                 extra->log_us / 1000000.0, (unsigned)(actions.count - index - 1));
+        ok = false;
+    }
+    return ok;
+}
+
+// Cameras joined get the commands too, but the replay does not need any
+static void wait_for_cameras(void)
+{
+    for (int waited = 0; waited < JOIN_TIMEOUT_MS; waited += 100) {
+        int count = 0;
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            uint32_t ip;
+            count += station_table_camera_ip(camera, &ip);
+        }
+        if (count >= CONFIG_WIFI_SIM_CAMERAS) {
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+static void can_replay_task(void *arg)
+{
+    const char *path = setting("CAN_REPLAY_FILE", CONFIG_CAN_REPLAY_FILE);
+    const char *expect = setting("CAN_REPLAY_EXPECT", CONFIG_CAN_REPLAY_EXPECT);
+    const char *speed_env = getenv("CAN_REPLAY_SPEED");
+    int speed = speed_env != NULL ? atoi(speed_env) : CONFIG_CAN_REPLAY_SPEED;
+
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        ESP_LOGE(TAG, "Cannot read %s", path);
+        exit(1);
+    }
+    actions_out = fopen(CONFIG_CAN_REPLAY_OUTPUT, "w");
+    if (actions_out == NULL) {
+        ESP_LOGW(TAG, "Cannot write %s, actions are only checked", CONFIG_CAN_REPLAY_OUTPUT);
+    }
+    wait_for_cameras();
+    can_bus_set_record_hook(record_hook, NULL);
+    if (speed > 0) {
+        ESP_LOGI(TAG, "Replaying %s at %dx", path, speed);
+    } else {
+        ESP_LOGI(TAG, "Replaying %s at full speed", path);
+    }
+
+    can_trace_parser_t parser;
+    can_trace_parser_init(&parser);
+    can_trace_record_t record;
+    char line[LINE_MAX_LEN];
+    uint32_t skipped = 0, ignored = 0;
+    int64_t first_us = 0;
+    bool first = true;
+    int64_t start_us = esp_timer_get_time();
+
+    bool eof = false;
+    while (!eof) {
+        if (!read_line(in, line, sizeof(line), &eof)) {
+            skipped += !eof;
+            continue;
+        }
+        if (!can_trace_parse_line(&parser, line, &record)) {
+            skipped++;
+            continue;
+        }
+        if (first) {
+            first_us = record.time_us;
+            first = false;
+        }
+        // Extended and remote frames carry no signal the receive task decodes
+        if (record.frame.extd || record.frame.rtr) {
+            ignored++;
+            continue;
+        }
+        frame_log_us = record.time_us - first_us;
+        pace(speed, start_us, frame_log_us);
+
+        int64_t cpu_start = thread_cpu_ns();
+        can_bus_ingest(record.frame.id, record.frame.data, record.frame.len, esp_timer_get_time());
+        observe_cpu(thread_cpu_ns() - cpu_start);
+    }
+    fclose(in);
+    can_bus_set_record_hook(NULL, NULL);
+    if (actions_out != NULL) {
+        fclose(actions_out);
+    }
+
+    int64_t wall_us = esp_timer_get_time() - start_us;
+    ESP_LOGI(TAG, "%llu frames ingested in %.3f s (%.3f s of log), %lu extended or remote, %lu lines skipped",
+             (unsigned long long)cpu_frames, wall_us / 1000000.0, frame_log_us / 1000000.0,
+             (unsigned long)ignored, (unsigned long)skipped);
+    report_cpu();
+    ESP_LOGI(TAG, "%u record actions", (unsigned)actions.count);
+
+    bool ok = true;
+    if (expect[0] != '\0') {
+        ok = check(expect);
+        ESP_LOGI(TAG, "Record actions %s %s", ok ? "match" : "differ from", expect);
+    }
+    // Lets the cameras take the last command before the process goes
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    exit(ok ? 0 : 1);
+}
+
+void can_replay_start(void)
+{
+    // Just above idle: flat out, the replay takes what the controller leaves
+    xTaskCreate(can_replay_task, "can_replay", 6144, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
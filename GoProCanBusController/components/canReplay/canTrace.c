@@ -0,0 +1,248 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "canTrace.h"
+
+void can_trace_parser_init(can_trace_parser_t *parser)
+{
+    *parser = (can_trace_parser_t){0};
+}
+
+static const char *skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static bool starts_with(const char *p, const char *prefix)
+{
+    return strncmp(p, prefix, strlen(prefix)) == 0;
+}
+
+static bool parse_time(const char **p, int64_t *time_us)
+{
+    char *end;
+    double seconds = strtod(*p, &end);
+    if (end == *p) {
+        return false;
+    }
+    *time_us = (int64_t)(seconds * 1000000.0 + (seconds < 0 ? -0.5 : 0.5));
+    *p = end;
+    return true;
+}
+
+// An identifier in hex unless told otherwise, extended when it is too big for
+// a standard one, ends in "x", or is written with more than three hex digits
+static bool parse_id(const char **p, int base, can_frame_t *frame)
+{
+    const char *start = *p;
+    if (base == 16 && start[0] == '0' && (start[1] == 'x' || start[1] == 'X')) {
+        start += 2;
+    }
+    char *end;
+    unsigned long id = strtoul(start, &end, base);
+    if (end == start || *start == '-' || *start == '+') {
+        return false;
+    }
+    frame->id = id;
+    frame->extd = (base == 16 && end - start > 3) || id > 0x7ff;
+    if (*end == 'x') {
+        frame->extd = true;
+        end++;
+    }
+    if (id > (frame->extd ? 0x1fffffffUL : 0x7ffUL)) {
+        return false;
+    }
+    *p = end;
+    return true;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = tolower((unsigned char)c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// Bytes separated by spaces, as many as fit and no more than max
+static bool parse_byte_list(const char **p, int base, uint8_t max, can_frame_t *frame)
+{
+    frame->len = 0;
+    while (frame->len < max) {
+        const char *start = skip_spaces(*p);
+        char *end;
+        unsigned long value = strtoul(start, &end, base);
+        if (end == start || value > 0xff) {
+            break;
+        }
+        frame->data[frame->len++] = value;
+        *p = end;
+    }
+    return frame->len == max;
+}
+
+// Bytes as one run of hex digit pairs, spaces between pairs allowed
+static bool parse_byte_run(const char **p, can_frame_t *frame)
+{
+    const char *s = *p;
+    frame->len = 0;
+    while (1) {
+        s = skip_spaces(s);
+        int high = hex_digit(s[0]);
+        if (high < 0) {
+            break;
+        }
+        int low = hex_digit(s[1]);
+        if (low < 0 || frame->len == sizeof(frame->data)) {
+            return false;
+        }
+        frame->data[frame->len++] = high << 4 | low;
+        s += 2;
+    }
+    *p = s;
+    return true;
+}
+
+// (time) iface 123#1122 or (time) iface 123 [2] 11 22
+static bool parse_candump(const char *p, can_trace_record_t *record)
+{
+    p++;
+    if (!parse_time(&p, &record->time_us) || *p != ')') {
+        return false;
+    }
+    p = skip_spaces(p + 1);
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+        p++;
+    }
+    p = skip_spaces(p);
+
+    can_frame_t *frame = &record->frame;
+    if (!parse_id(&p, 16, frame)) {
+        return false;
+    }
+    if (*p == '#') {
+        p++;
+        if (*p == '#') {
+            return false;
+        }
+        if (*p == 'R') {
+            frame->rtr = true;
+            frame->len = hex_digit(p[1]) >= 0 ? hex_digit(p[1]) : 0;
+            return frame->len <= sizeof(frame->data);
+        }
+        return parse_byte_run(&p, frame);
+    }
+
+    p = skip_spaces(p);
+    if (*p != '[') {
+        return false;
+    }
+    p++;
+    char *end;
+    unsigned long len = strtoul(p, &end, 10);
+    if (end == p || *end != ']' || len > sizeof(frame->data)) {
+        return false;
+    }
+    p = skip_spaces(end + 1);
+    if (starts_with(p, "remote request")) {
+        frame->rtr = true;
+        frame->len = len;
+        return true;
+    }
+    return parse_byte_list(&p, 16, len, frame);
+}
+
+// time channel id Rx|Tx d|r dlc bytes...
+static bool parse_asc(can_trace_parser_t *parser, const char *p, can_trace_record_t *record)
+{
+    int64_t time_us;
+    if (!parse_time(&p, &time_us)) {
+        return false;
+    }
+    p = skip_spaces(p);
+    // Channel
+    char *end;
+    strtoul(p, &end, 10);
+    if (end == p) {
+        return false;
+    }
+    p = skip_spaces(end);
+
+    int base = parser->decimal ? 10 : 16;
+    can_frame_t *frame = &record->frame;
+    if (!parse_id(&p, base, frame) || (*p != ' ' && *p != '\t')) {
+        return false;
+    }
+    p = skip_spaces(p);
+    if (!starts_with(p, "Rx") && !starts_with(p, "Tx")) {
+        return false;
+    }
+    p = skip_spaces(p + 2);
+    if ((*p != 'd' && *p != 'r') || (p[1] != ' ' && p[1] != '\t')) {
+        return false;
+    }
+    frame->rtr = *p == 'r';
+    p = skip_spaces(p + 1);
+    int dlc = hex_digit(*p);
+    if (dlc < 0 || dlc > sizeof(frame->data)) {
+        return false;
+    }
+    p++;
+    if (frame->rtr) {
+        frame->len = dlc;
+    } else if (!parse_byte_list(&p, base, dlc, frame)) {
+        return false;
+    }
+
+    if (parser->relative) {
+        time_us += parser->last_us;
+    }
+    parser->last_us = time_us;
+    record->time_us = time_us;
+    return true;
+}
+
+// seconds,id,data
+static bool parse_csv(const char *p, can_trace_record_t *record)
+{
+    if (!parse_time(&p, &record->time_us)) {
+        return false;
+    }
+    p = skip_spaces(p);
+    if (*p != ',') {
+        return false;
+    }
+    p = skip_spaces(p + 1);
+    if (!parse_id(&p, 16, &record->frame)) {
+        return false;
+    }
+    p = skip_spaces(p);
+    if (*p != ',') {
+        return false;
+    }
+    p++;
+    return parse_byte_run(&p, &record->frame) && (*p == '\0' || *p == '\r' || *p == '\n' || *p == ',');
+}
+
+bool can_trace_parse_line(can_trace_parser_t *parser, const char *line, can_trace_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    const char *p = skip_spaces(line);
+
+    if (*p == '(') {
+        return parse_candump(p, record);
+    }
+    if (strchr(p, ',') != NULL) {
+        return parse_csv(p, record);
+    }
+    if (starts_with(p, "base ")) {
+        parser->decimal = strstr(p, "base dec") != NULL;
+        parser->relative = strstr(p, "timestamps relative") != NULL;
+        return false;
+    }
+    return parse_asc(parser, p, record);
+}
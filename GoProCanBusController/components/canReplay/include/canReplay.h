@@ -0,0 +1,13 @@
+#ifndef CAN_REPLAY_H
+#define CAN_REPLAY_H
+
+// Replays a captured CAN log on the host build, see CONFIG_CAN_REPLAY_AT_BOOT.
+// Frames are paced by their log times, scaled by the replay speed, and each
+// one goes through can_bus_ingest() as if the receive task had taken it off
+// the bus. At the end it reports the CPU time ingestion took per frame and
+// checks the record actions against the expected ones.
+
+// Starts the replay task, which exits the process when the log is done
+void can_replay_start(void);
+
+#endif // CAN_REPLAY_H
@@ -0,0 +1,36 @@
+#ifndef CAN_TRACE_H
+#define CAN_TRACE_H
+
+// Reads captured CAN logs line by line. Three formats are understood, and
+// the format is told apart per line, so the caller needs no hint:
+//
+//   candump -L     (1436509052.249713) can0 123#11223344
+//   candump -ta    (1436509052.249713)  can0  123   [4]  11 22 33 44
+//   Vector ASC        0.004000 1  123             Rx   d 4 11 22 33 44
+//   CSV            0.004000,0x123,11223344        (seconds, id, data)
+//
+// Identifiers longer than three digits, or marked with an "x" in ASC, are
+// extended. ASC "base dec" and "timestamps relative" headers are honoured.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "canPort.h"
+
+typedef struct {
+    bool decimal;               // ASC identifiers and bytes in decimal
+    bool relative;              // ASC times count from the line before
+    int64_t last_us;
+} can_trace_parser_t;
+
+typedef struct {
+    int64_t time_us;            // Log time, its origin depends on the logger
+    can_frame_t frame;
+} can_trace_record_t;
+
+void can_trace_parser_init(can_trace_parser_t *parser);
+
+// False for headers, comments, error and CAN FD frames, and anything else
+// that is not a classic data or remote frame
+bool can_trace_parse_line(can_trace_parser_t *parser, const char *line, can_trace_record_t *record);
+
+#endif // CAN_TRACE_H
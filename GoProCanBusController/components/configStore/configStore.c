@@ -0,0 +1,429 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "lwip/inet.h"
+#include "cJSON.h"
+#include "persist.h"
+#include "configStore.h"
+
+static const char *TAG = "config_store";
+
+#define MAX_SUBSCRIBERS  4
+#define CONFIG_MAX_BODY  512
+
+// Smart Remote ports, REMOTE_CAMERA_PORT and REMOTE_LISTEN_PORT in udpServer
+#define DEFAULT_CAMERA_PORT  8484
+#define DEFAULT_LISTEN_PORT  8383
+
+// Two copies: readers use the published one, the writer fills the other
+static runtime_config_t copies[2];
+static int published;
+static uint32_t readers[2];             // Pins per copy
+static uint32_t generation;
+static SemaphoreHandle_t write_lock;
+static config_store_fn_t subscribers[MAX_SUBSCRIBERS];
+static int subscriber_count;
+static persist_id_t config_id = -1;
+
+typedef enum {
+    FIELD_STRING,
+    FIELD_U8,
+    FIELD_U16,
+    FIELD_U32,
+    FIELD_IP,
+} field_type_t;
+
+// Every field the REST endpoint knows, with its limits and change group
+typedef struct {
+    const char *name;
+    field_type_t type;
+    uint16_t offset;
+    uint16_t size;
+    uint32_t min;                       // Length for strings
+    uint32_t max;
+    uint32_t group;
+    bool secret;                        // Never sent back
+} config_field_t;
+
+#define FIELD(name, type, member, min, max, group, secret) \
+    {name, type, offsetof(runtime_config_t, member), sizeof(((runtime_config_t *)0)->member), min, max, group, secret}
+
+static const config_field_t fields[] = {
+    FIELD("ssid", FIELD_STRING, ssid, 1, 32, RUNTIME_CONFIG_WIFI, false),
+    FIELD("password", FIELD_STRING, password, 0, 63, RUNTIME_CONFIG_WIFI, true),
+    FIELD("channel", FIELD_U8, channel, 1, 13, RUNTIME_CONFIG_WIFI, false),
+    FIELD("max_stations", FIELD_U8, max_stations, 1, CONFIG_ESP_MAX_STA_CONN, RUNTIME_CONFIG_WIFI, false),
+    FIELD("ip", FIELD_IP, ip, 0, 0, RUNTIME_CONFIG_NETWORK, false),
+    FIELD("netmask", FIELD_IP, netmask, 0, 0, RUNTIME_CONFIG_NETWORK, false),
+    FIELD("gateway", FIELD_IP, gateway, 0, 0, RUNTIME_CONFIG_NETWORK, false),
+    FIELD("camera_port", FIELD_U16, camera_port, 1, 65535, RUNTIME_CONFIG_PORTS, false),
+    FIELD("listen_port", FIELD_U16, listen_port, 1, 65535, RUNTIME_CONFIG_PORTS, false),
+    FIELD("ws_push_interval_ms", FIELD_U32, ws_push_interval_ms, 20, 5000, RUNTIME_CONFIG_WEB, false),
+    FIELD("remote_poll_interval_ms", FIELD_U32, remote_poll_interval_ms, 100, 10000, RUNTIME_CONFIG_REMOTE, false),
+    FIELD("remote_wakeup_interval_ms", FIELD_U32, remote_wakeup_interval_ms, 100, 10000, RUNTIME_CONFIG_REMOTE, false),
+    FIELD("remote_retry_interval_ms", FIELD_U32, remote_retry_interval_ms, 20, 5000, RUNTIME_CONFIG_REMOTE, false),
+    FIELD("remote_max_missed_polls", FIELD_U8, remote_max_missed_polls, 1, 20, RUNTIME_CONFIG_REMOTE, false),
+    FIELD("remote_max_retries", FIELD_U8, remote_max_retries, 0, 10, RUNTIME_CONFIG_REMOTE, false),
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+static void config_defaults(runtime_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    strlcpy(config->ssid, CONFIG_ESP_WIFI_SSID, sizeof(config->ssid));
+    strlcpy(config->password, CONFIG_ESP_WIFI_PASSWORD, sizeof(config->password));
+    config->channel = CONFIG_ESP_WIFI_CHANNEL;
+    config->max_stations = CONFIG_ESP_MAX_STA_CONN;
+    config->ip = inet_addr(CONFIG_STATIC_IP_ADDR);
+    config->netmask = inet_addr(CONFIG_STATIC_NETMASK_ADDR);
+    config->gateway = inet_addr(CONFIG_STATIC_GW_ADDR);
+    config->camera_port = DEFAULT_CAMERA_PORT;
+    config->listen_port = DEFAULT_LISTEN_PORT;
+    config->ws_push_interval_ms = CONFIG_WS_PUSH_INTERVAL_MS;
+    config->remote_poll_interval_ms = CONFIG_REMOTE_POLL_INTERVAL_MS;
+    config->remote_wakeup_interval_ms = CONFIG_REMOTE_WAKEUP_INTERVAL_MS;
+    config->remote_retry_interval_ms = CONFIG_REMOTE_RETRY_INTERVAL_MS;
+    config->remote_max_missed_polls = CONFIG_REMOTE_MAX_MISSED_POLLS;
+    config->remote_max_retries = CONFIG_REMOTE_MAX_RETRIES;
+}
+
+static uint32_t field_get(const runtime_config_t *config, const config_field_t *field)
+{
+    const uint8_t *p = (const uint8_t *)config + field->offset;
+    switch (field->type) {
+    case FIELD_U8:
+        return *p;
+    case FIELD_U16:
+        return *(const uint16_t *)p;
+    case FIELD_U32:
+    case FIELD_IP:
+        return *(const uint32_t *)p;
+    default:
+        return 0;
+    }
+}
+
+static void field_set(runtime_config_t *config, const config_field_t *field, uint32_t value)
+{
+    uint8_t *p = (uint8_t *)config + field->offset;
+    switch (field->type) {
+    case FIELD_U8:
+        *p = value;
+        break;
+    case FIELD_U16:
+        *(uint16_t *)p = value;
+        break;
+    case FIELD_U32:
+    case FIELD_IP:
+        *(uint32_t *)p = value;
+        break;
+    default:
+        break;
+    }
+}
+
+// Returns the name of the first bad field, NULL if the configuration is usable
+static const char *config_validate(const runtime_config_t *config)
+{
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        const config_field_t *field = &fields[i];
+        if (field->type == FIELD_STRING) {
+            const char *s = (const char *)config + field->offset;
+            size_t len = strnlen(s, field->size);
+            if (len < field->min || len > field->max) {
+                return field->name;
+            }
+        } else if (field->type != FIELD_IP) {
+            uint32_t value = field_get(config, field);
+            if (value < field->min || value > field->max) {
+                return field->name;
+            }
+        }
+    }
+    // WPA2 wants 8 to 63 characters, an empty password means an open network
+    size_t password_len = strlen(config->password);
+    if (password_len > 0 && password_len < 8) {
+        return "password";
+    }
+    uint32_t mask = ntohl(config->netmask);
+    if (mask == 0 || (~mask & (~mask + 1)) != 0) {
+        return "netmask";
+    }
+    uint32_t host = ntohl(config->ip) & ~mask;
+    if (host == 0 || host == ~mask) {
+        return "ip";
+    }
+    if ((config->gateway & config->netmask) != (config->ip & config->netmask)) {
+        return "gateway";
+    }
+    if (config->camera_port == config->listen_port) {
+        return "listen_port";
+    }
+    return NULL;
+}
+
+static uint32_t config_diff(const runtime_config_t *a, const runtime_config_t *b)
+{
+    uint32_t changed = 0;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        const config_field_t *field = &fields[i];
+        if (memcmp((const uint8_t *)a + field->offset, (const uint8_t *)b + field->offset, field->size) != 0) {
+            changed |= field->group;
+        }
+    }
+    return changed;
+}
+
+const runtime_config_t *config_store_acquire(void)
+{
+    while (1) {
+        int index = __atomic_load_n(&published, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&readers[index], 1, __ATOMIC_SEQ_CST);
+        // The writer may have started refilling this copy before the pin landed
+        if (__atomic_load_n(&published, __ATOMIC_SEQ_CST) == index) {
+            return &copies[index];
+        }
+        __atomic_fetch_sub(&readers[index], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void config_store_release(const runtime_config_t *config)
+{
+    __atomic_fetch_sub(&readers[config - copies], 1, __ATOMIC_SEQ_CST);
+}
+
+void config_store_get(runtime_config_t *config)
+{
+    const runtime_config_t *current = config_store_acquire();
+    *config = *current;
+    config_store_release(current);
+}
+
+uint32_t config_store_generation(void)
+{
+    return __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+}
+
+bool config_store_subscribe(config_store_fn_t fn)
+{
+    if (subscriber_count >= MAX_SUBSCRIBERS) {
+        return false;
+    }
+    subscribers[subscriber_count++] = fn;
+    return true;
+}
+
+// Fills the spare copy once its last reader is gone and publishes it,
+// called with write_lock held
+static void config_publish(const runtime_config_t *config)
+{
+    int spare = published ^ 1;
+    while (__atomic_load_n(&readers[spare], __ATOMIC_SEQ_CST) != 0) {
+        vTaskDelay(1);
+    }
+    copies[spare] = *config;
+    __atomic_store_n(&published, spare, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&generation, 1, __ATOMIC_RELEASE);
+}
+
+esp_err_t config_store_update(const runtime_config_t *config, const char **error)
+{
+    const char *bad = config_validate(config);
+    if (bad != NULL) {
+        if (error != NULL) {
+            *error = bad;
+        }
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    uint32_t changed = config_diff(&copies[published], config);
+    if (changed != 0) {
+        config_publish(config);
+    }
+    xSemaphoreGive(write_lock);
+
+    if (changed == 0) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Configuration changed, groups 0x%lx", (unsigned long)changed);
+    persist_mark_dirty(config_id);
+    const runtime_config_t *current = config_store_acquire();
+    for (int i = 0; i < subscriber_count; i++) {
+        subscribers[i](current, changed);
+    }
+    config_store_release(current);
+    return ESP_OK;
+}
+
+static void config_snapshot(void *buf, void *ctx)
+{
+    config_store_get(buf);
+}
+
+static const persist_record_t config_record = {
+    .key = "config",
+    .version = 1,
+    .size = sizeof(runtime_config_t),
+    .snapshot = config_snapshot,
+};
+
+esp_err_t config_store_init(void)
+{
+    write_lock = xSemaphoreCreateMutex();
+    if (write_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    runtime_config_t config;
+    config_defaults(&config);
+    config_id = persist_register(&config_record);
+    runtime_config_t saved;
+    if (persist_load(config_id, &saved) == ESP_OK) {
+        const char *bad = config_validate(&saved);
+        if (bad == NULL) {
+            config = saved;
+        } else {
+            ESP_LOGW(TAG, "Saved configuration has a bad %s, using the defaults", bad);
+        }
+    }
+    copies[0] = config;
+    published = 0;
+    ESP_LOGI(TAG, "SSID %s on channel %u", config.ssid, config.channel);
+    return ESP_OK;
+}
+
+static cJSON *config_to_json(const runtime_config_t *config)
+{
+    cJSON *root = cJSON_CreateObject();
+    for (int i = 0; i < FIELD_COUNT && root != NULL; i++) {
+        const config_field_t *field = &fields[i];
+        if (field->secret) {
+            continue;
+        }
+        if (field->type == FIELD_STRING) {
+            cJSON_AddStringToObject(root, field->name, (const char *)config + field->offset);
+        } else if (field->type == FIELD_IP) {
+            struct in_addr addr = {.s_addr = field_get(config, field)};
+            cJSON_AddStringToObject(root, field->name, inet_ntoa(addr));
+        } else {
+            cJSON_AddNumberToObject(root, field->name, field_get(config, field));
+        }
+    }
+    return root;
+}
+
+// Copies the fields present in the body over config, returns the name of a
+// field with the wrong type or NULL
+static const char *config_from_json(const cJSON *root, runtime_config_t *config)
+{
+    const cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        const config_field_t *field = NULL;
+        for (int i = 0; i < FIELD_COUNT && field == NULL; i++) {
+            if (strcmp(fields[i].name, item->string) == 0) {
+                field = &fields[i];
+            }
+        }
+        if (field == NULL) {
+            return item->string;
+        }
+        if (field->type == FIELD_STRING) {
+            if (!cJSON_IsString(item) || strlen(item->valuestring) >= field->size) {
+                return field->name;
+            }
+            memset((char *)config + field->offset, 0, field->size);
+            strlcpy((char *)config + field->offset, item->valuestring, field->size);
+        } else if (field->type == FIELD_IP) {
+            struct in_addr addr;
+            if (!cJSON_IsString(item) || inet_aton(item->valuestring, &addr) == 0) {
+                return field->name;
+            }
+            field_set(config, field, addr.s_addr);
+        } else {
+            if (!cJSON_IsNumber(item) || item->valuedouble < 0 || item->valuedouble > UINT32_MAX) {
+                return field->name;
+            }
+            uint32_t value = item->valuedouble;
+            if (value < field->min || value > field->max) {
+                return field->name;
+            }
+            field_set(config, field, value);
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t config_send(httpd_req_t *req)
+{
+    runtime_config_t config;
+    config_store_get(&config);
+    cJSON *root = config_to_json(&config);
+    char *body = root != NULL ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (body == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    esp_err_t ret = httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+    free(body);
+    return ret;
+}
+
+static esp_err_t config_send_error(httpd_req_t *req, const char *message, const char *field)
+{
+    char body[128];
+    snprintf(body, sizeof(body), "{\"error\":\"%s\",\"field\":\"%s\"}", message, field != NULL ? field : "");
+    httpd_resp_set_status(req, "400 Bad Request");
+    return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t config_store_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        return config_send(req);
+    }
+    if (req->content_len == 0 || req->content_len > CONFIG_MAX_BODY) {
+        return config_send_error(req, "body missing or too large", NULL);
+    }
+
+    char body[CONFIG_MAX_BODY + 1];
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    if (!cJSON_IsObject(root)) {
+        cJSON_Delete(root);
+        return config_send_error(req, "body must be a JSON object", NULL);
+    }
+    runtime_config_t config;
+    config_store_get(&config);
+    // The name points into the parsed tree, copy it before the tree goes
+    char bad_name[33] = "";
+    const char *bad = config_from_json(root, &config);
+    if (bad != NULL) {
+        strlcpy(bad_name, bad, sizeof(bad_name));
+    }
+    cJSON_Delete(root);
+    if (bad != NULL) {
+        return config_send_error(req, "unknown field or bad value", bad_name);
+    }
+    if (config_store_update(&config, &bad) != ESP_OK) {
+        return config_send_error(req, "invalid configuration", bad);
+    }
+    return config_send(req);
+}
@@ -0,0 +1,70 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+// Runtime configuration. Kconfig supplies the defaults, the persistence
+// service the saved values, and POST /api/config changes them without a
+// reflash. Readers never lock: they pin the published copy while the writer
+// fills the other one, and a copy is only reused once nobody pins it.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+// ESP32 cache line, so the two copies never share one
+#define RUNTIME_CONFIG_ALIGN 32
+
+// Groups of fields, passed to subscribers as a mask of what changed
+#define RUNTIME_CONFIG_WIFI     (1u << 0)   // SSID, password, channel, max stations
+#define RUNTIME_CONFIG_NETWORK  (1u << 1)   // Address, netmask, gateway
+#define RUNTIME_CONFIG_PORTS    (1u << 2)
+#define RUNTIME_CONFIG_REMOTE   (1u << 3)   // Smart Remote timing
+#define RUNTIME_CONFIG_WEB      (1u << 4)
+
+typedef struct {
+    char ssid[33];
+    char password[65];
+    uint8_t channel;
+    uint8_t max_stations;
+    uint32_t ip;                    // Network byte order
+    uint32_t netmask;
+    uint32_t gateway;
+    uint16_t camera_port;           // Smart Remote port the cameras listen on
+    uint16_t listen_port;           // Port camera replies come back to
+    uint32_t ws_push_interval_ms;
+    uint32_t remote_poll_interval_ms;
+    uint32_t remote_wakeup_interval_ms;
+    uint32_t remote_retry_interval_ms;
+    uint8_t remote_max_missed_polls;
+    uint8_t remote_max_retries;
+} __attribute__((aligned(RUNTIME_CONFIG_ALIGN))) runtime_config_t;
+
+// Called on the writer's task after the new copy is published
+typedef void (*config_store_fn_t)(const runtime_config_t *config, uint32_t changed);
+
+// Loads the saved configuration over the Kconfig defaults, the persistence
+// service must already be running
+esp_err_t config_store_init(void);
+
+// Pins the current copy, lock-free and safe from any task. Release it soon:
+// the next update after the one that replaces it waits for the release.
+const runtime_config_t *config_store_acquire(void);
+void config_store_release(const runtime_config_t *config);
+
+// Copies the current configuration, for callers that hold it for long
+void config_store_get(runtime_config_t *config);
+
+// Bumped on every published update, a cheap way to notice a change
+uint32_t config_store_generation(void);
+
+// At most 4 subscribers, register them before the first update
+bool config_store_subscribe(config_store_fn_t fn);
+
+// Validates and publishes a new configuration, then saves it and notifies
+// subscribers. On ESP_ERR_INVALID_ARG *error names the offending field.
+esp_err_t config_store_update(const runtime_config_t *config, const char **error);
+
+// GET returns the configuration, POST changes the fields present in the body
+esp_err_t config_store_handler(httpd_req_t *req);
+
+#endif // CONFIG_STORE_H
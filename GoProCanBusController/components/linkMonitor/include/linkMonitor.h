@@ -0,0 +1,51 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+// Per-camera link quality. Wi-Fi is measured with ICMP echo probes sent from
+// one task, the Smart Remote link with the status polls the remote engine
+// already sends. Each sample updates a smoothed round trip time and loss
+// rate, from which the link is rated up, degraded or down.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+typedef enum {
+    LINK_TRANSPORT_WIFI,        // IP reachability over the softAP, as used by HTTP
+    LINK_TRANSPORT_REMOTE,      // Smart Remote UDP
+    LINK_TRANSPORT_COUNT,
+} link_transport_t;
+
+typedef enum {
+    LINK_STATE_UNKNOWN,         // No sample since the camera got its address
+    LINK_STATE_UP,
+    LINK_STATE_DEGRADED,        // Lossy or slow, or the last probe was lost
+    LINK_STATE_DOWN,            // CONFIG_LINK_DOWN_MISSES probes lost in a row
+} link_state_t;
+
+typedef struct {
+    link_state_t state;
+    uint32_t rtt_us;            // Smoothed over the last ~8 answers
+    uint16_t loss_permille;     // Smoothed over the last ~8 probes
+    uint8_t misses;             // Lost in a row
+    uint32_t probes;
+    uint32_t answers;
+    uint32_t last_answer_ms;
+} link_stats_t;
+
+// Starts the probe task
+void link_monitor_init(void);
+
+// Adds one sample, for transports whose probes are sent elsewhere
+void link_monitor_record(int camera, link_transport_t transport, bool answered, uint32_t rtt_us);
+
+link_state_t link_monitor_state(int camera, link_transport_t transport);
+bool link_monitor_get(int camera, link_transport_t transport, link_stats_t *stats);
+
+const char *link_state_name(link_state_t state);
+
+// GET reports every link of every camera
+esp_err_t link_monitor_handler(httpd_req_t *req);
+
+#endif // LINK_MONITOR_H
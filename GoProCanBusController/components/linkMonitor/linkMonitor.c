@@ -0,0 +1,301 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "stationTable.h"
+#include "metrics.h"
+#include "linkMonitor.h"
+
+static const char *TAG = "link_monitor";
+
+// One camera is visited per tick, so every camera is probed once per interval
+#define LINK_TICK_MS        (CONFIG_LINK_PROBE_INTERVAL_MS / STATION_TABLE_MAX)
+
+// EWMA weight of a new sample is 1 / 2^LINK_EWMA_SHIFT
+#define LINK_EWMA_SHIFT     3
+
+// Loss rate above which a link is degraded even if no probe is missing now
+#define LINK_DEGRADED_LOSS  200     // Permille
+
+#define ICMP_ECHO_REQUEST   8
+#define ICMP_ECHO_REPLY     0
+#define ICMP_PROBE_ID       0x4c4d  // "LM", tells our replies from anyone else's
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;
+    uint16_t id;
+    uint16_t seq;               // Camera in the top 4 bits, counter below
+} icmp_echo_t;
+
+_Static_assert(STATION_TABLE_MAX <= 16, "ICMP sequence numbers carry the camera in 4 bits");
+
+// The ICMP probe in flight for one camera
+typedef struct {
+    bool outstanding;
+    uint16_t seq;
+    int64_t sent_us;
+} icmp_probe_t;
+
+static portMUX_TYPE link_lock = portMUX_INITIALIZER_UNLOCKED;
+static link_stats_t links[STATION_TABLE_MAX][LINK_TRANSPORT_COUNT];
+static icmp_probe_t probes[STATION_TABLE_MAX];
+static int icmp_socket = -1;
+static uint16_t probe_counter;
+
+static const metric_histogram_t rtt_metric[LINK_TRANSPORT_COUNT] = {
+    [LINK_TRANSPORT_WIFI] = METRIC_LINK_RTT_WIFI,
+    [LINK_TRANSPORT_REMOTE] = METRIC_LINK_RTT_REMOTE,
+};
+
+static const char *transport_name[LINK_TRANSPORT_COUNT] = {
+    [LINK_TRANSPORT_WIFI] = "wifi",
+    [LINK_TRANSPORT_REMOTE] = "remote",
+};
+
+const char *link_state_name(link_state_t state)
+{
+    static const char *names[] = {"unknown", "up", "degraded", "down"};
+    return state <= LINK_STATE_DOWN ? names[state] : "invalid";
+}
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static link_state_t rate(const link_stats_t *link)
+{
+    if (link->misses >= CONFIG_LINK_DOWN_MISSES) {
+        return LINK_STATE_DOWN;
+    }
+    if (link->answers == 0) {
+        return link->misses > 0 ? LINK_STATE_DEGRADED : LINK_STATE_UNKNOWN;
+    }
+    if (link->misses > 0 || link->loss_permille > LINK_DEGRADED_LOSS ||
+        link->rtt_us > CONFIG_LINK_DEGRADED_RTT_MS * 1000) {
+        return LINK_STATE_DEGRADED;
+    }
+    return LINK_STATE_UP;
+}
+
+void link_monitor_record(int camera, link_transport_t transport, bool answered, uint32_t rtt_us)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX || transport >= LINK_TRANSPORT_COUNT) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&link_lock);
+    link_stats_t *link = &links[camera][transport];
+    link_state_t before = link->state;
+    link->probes++;
+    if (answered) {
+        // The first answer seeds the average instead of creeping up from 0
+        if (link->answers == 0) {
+            link->rtt_us = rtt_us;
+        } else {
+            link->rtt_us += ((int32_t)rtt_us - (int32_t)link->rtt_us) >> LINK_EWMA_SHIFT;
+        }
+        link->answers++;
+        link->misses = 0;
+        link->last_answer_ms = now_ms();
+        link->loss_permille -= link->loss_permille >> LINK_EWMA_SHIFT;
+    } else {
+        if (link->misses < UINT8_MAX) {
+            link->misses++;
+        }
+        link->loss_permille += (1000 - link->loss_permille) >> LINK_EWMA_SHIFT;
+    }
+    link->state = rate(link);
+    link_state_t after = link->state;
+    taskEXIT_CRITICAL(&link_lock);
+
+    if (answered) {
+        metrics_observe(rtt_metric[transport], rtt_us);
+    } else {
+        metrics_inc(METRIC_LINK_PROBES_LOST);
+    }
+    if (after != before) {
+        metrics_inc(METRIC_LINK_STATE_CHANGES);
+        ESP_LOGI(TAG, "Camera %d %s link %s", camera, transport_name[transport], link_state_name(after));
+    }
+}
+
+link_state_t link_monitor_state(int camera, link_transport_t transport)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX || transport >= LINK_TRANSPORT_COUNT) {
+        return LINK_STATE_UNKNOWN;
+    }
+    return __atomic_load_n(&links[camera][transport].state, __ATOMIC_RELAXED);
+}
+
+bool link_monitor_get(int camera, link_transport_t transport, link_stats_t *stats)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX || transport >= LINK_TRANSPORT_COUNT) {
+        return false;
+    }
+    taskENTER_CRITICAL(&link_lock);
+    *stats = links[camera][transport];
+    taskEXIT_CRITICAL(&link_lock);
+    return true;
+}
+
+// A camera that lost its address starts over when it comes back
+static void station_bound(int camera, const station_t *station, bool bound)
+{
+    if (bound || camera >= STATION_TABLE_MAX) {
+        return;
+    }
+    taskENTER_CRITICAL(&link_lock);
+    memset(links[camera], 0, sizeof(links[camera]));
+    taskEXIT_CRITICAL(&link_lock);
+}
+
+static uint16_t icmp_checksum(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (p[i] << 8) | p[i + 1];
+    }
+    if (len & 1) {
+        sum += p[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return htons(~sum);
+}
+
+// Settles the previous probe of one camera and sends the next, O(1)
+static void probe_camera(int camera)
+{
+    icmp_probe_t *probe = &probes[camera];
+    uint32_t ip;
+    if (!station_table_camera_ip(camera, &ip)) {
+        // Gone before it could answer, that is not a lost probe
+        probe->outstanding = false;
+        return;
+    }
+    if (probe->outstanding) {
+        probe->outstanding = false;
+        link_monitor_record(camera, LINK_TRANSPORT_WIFI, false, 0);
+    }
+    icmp_echo_t echo = {
+        .type = ICMP_ECHO_REQUEST,
+        .id = htons(ICMP_PROBE_ID),
+        .seq = htons((camera << 12) | (probe_counter++ & 0x0fff)),
+    };
+    echo.checksum = icmp_checksum(&echo, sizeof(echo));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = ip,
+    };
+
+    probe->seq = ntohs(echo.seq);
+    probe->sent_us = esp_timer_get_time();
+    probe->outstanding = true;
+    if (sendto(icmp_socket, &echo, sizeof(echo), 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGD(TAG, "Probe to camera %d failed: errno %d", camera, errno);
+    }
+}
+
+// Matches every queued echo reply with the probe it answers
+static void probe_drain(void)
+{
+    uint8_t buf[64];
+    while (1) {
+        int len = recv(icmp_socket, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            break;
+        }
+        int64_t now = esp_timer_get_time();
+
+        // Raw sockets hand over the IP header too
+        int header_len = (buf[0] & 0x0f) * 4;
+        if (len < header_len + (int)sizeof(icmp_echo_t)) {
+            continue;
+        }
+        const icmp_echo_t *echo = (const icmp_echo_t *)(buf + header_len);
+        if (echo->type != ICMP_ECHO_REPLY || ntohs(echo->id) != ICMP_PROBE_ID) {
+            continue;
+        }
+        uint16_t seq = ntohs(echo->seq);
+        int camera = seq >> 12;
+        if (camera >= STATION_TABLE_MAX || !probes[camera].outstanding || probes[camera].seq != seq) {
+            continue;
+        }
+        probes[camera].outstanding = false;
+        link_monitor_record(camera, LINK_TRANSPORT_WIFI, true, now - probes[camera].sent_us);
+    }
+}
+
+// Sleeps in select() so a reply is timed when it arrives, not at the next tick
+static void link_monitor_task(void *arg)
+{
+    int camera = 0;
+    uint32_t next_tick = now_ms();
+
+    while (1) {
+        int32_t wait_ms = (int32_t)(next_tick - now_ms());
+        if (wait_ms > 0) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(icmp_socket, &readable);
+            struct timeval timeout = {.tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000};
+            if (select(icmp_socket + 1, &readable, NULL, NULL, &timeout) > 0) {
+                probe_drain();
+                continue;
+            }
+        }
+
+        probe_camera(camera);
+        camera = (camera + 1) % STATION_TABLE_MAX;
+        next_tick += LINK_TICK_MS;
+    }
+}
+
+void link_monitor_init(void)
+{
+    icmp_socket = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (icmp_socket < 0) {
+        ESP_LOGE(TAG, "Failed to create ICMP socket: errno %d", errno);
+        return;
+    }
+    station_table_subscribe(station_bound);
+
+    TaskHandle_t task;
+    if (xTaskCreate(link_monitor_task, "link_monitor", 3072, NULL, 4, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+}
+
+esp_err_t link_monitor_handler(httpd_req_t *req)
+{
+    char body[32 + STATION_TABLE_MAX * LINK_TRANSPORT_COUNT * 128];
+    size_t len = snprintf(body, sizeof(body), "{\"links\":[");
+    bool first = true;
+    uint32_t now = now_ms();
+
+    for (int camera = 0; camera < STATION_TABLE_MAX; camera++) {
+        for (int t = 0; t < LINK_TRANSPORT_COUNT && len < sizeof(body); t++) {
+            link_stats_t link;
+            link_monitor_get(camera, t, &link);
+            len += snprintf(body + len, sizeof(body) - len,
+                            "%s{\"camera\":%d,\"transport\":\"%s\",\"state\":\"%s\",\"rtt_us\":%lu,"
+                            "\"loss_permille\":%u,\"misses\":%u,\"probes\":%lu,\"answers\":%lu,\"idle_ms\":%ld}",
+                            first ? "" : ",", camera, transport_name[t], link_state_name(link.state),
+                            (unsigned long)link.rtt_us, link.loss_permille, link.misses,
+                            (unsigned long)link.probes, (unsigned long)link.answers,
+                            link.answers ? (long)(now - link.last_answer_ms) : -1L);
+            first = false;
+        }
+    }
+    if (len < sizeof(body)) {
+        len += snprintf(body + len, sizeof(body) - len, "]}");
+    }
+    return httpd_resp_send(req, body, len < sizeof(body) ? len : sizeof(body) - 1);
+}
@@ -0,0 +1,73 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Monotonic counters, exported as <name>_total
+typedef enum {
+    METRIC_BLE_CONNECTS,
+    METRIC_BLE_RECONNECTS,
+    METRIC_BLE_DISCONNECTS,
+    METRIC_HTTP_CLIENT_REQUESTS,
+    METRIC_HTTP_CLIENT_ERRORS,
+    METRIC_HTTP_SERVER_REQUESTS,
+    METRIC_WEB_ASSET_REQUESTS,
+    METRIC_WEB_ASSET_NOT_MODIFIED,
+    METRIC_WEB_ASSET_BYTES,
+    METRIC_WS_UPDATES,
+    METRIC_REMOTE_FRAMES_SENT,
+    METRIC_REMOTE_FRAMES_RECEIVED,
+    METRIC_REMOTE_FRAMES_DROPPED,
+    METRIC_REMOTE_BROADCAST_MISSED,
+    METRIC_LINK_PROBES_LOST,
+    METRIC_LINK_STATE_CHANGES,
+    METRIC_CAN_FRAMES_RECEIVED,
+    METRIC_CAN_TRIGGERS_DROPPED,
+    METRIC_CAN_FRAMES_SENT,
+    METRIC_CAN_TX_DROPPED,
+    METRIC_CAN_ISOTP_DROPPED,
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+// Latency histograms with fixed buckets, observed in microseconds
+typedef enum {
+    METRIC_SHUTTER_LATENCY_WIFI,
+    METRIC_SHUTTER_LATENCY_BLE,
+    METRIC_SHUTTER_LATENCY_REMOTE,
+    METRIC_WEB_ASSET_LATENCY,
+    METRIC_REMOTE_BROADCAST_SKEW,
+    METRIC_EVENT_HANDLER_LATENCY,
+    METRIC_LINK_RTT_WIFI,
+    METRIC_LINK_RTT_REMOTE,
+    METRIC_TRACE_DISPATCH,
+    METRIC_TRACE_SEND,
+    METRIC_TRACE_ACK,
+    METRIC_TRACE_CONFIRM,
+    METRIC_TRACE_TOTAL,
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+// Lock-free: each core adds into its own slot, slots are summed on scrape
+void metrics_add(metric_counter_t counter, uint32_t value);
+void metrics_observe(metric_histogram_t histogram, uint32_t value_us);
+
+static inline void metrics_inc(metric_counter_t counter)
+{
+    metrics_add(counter, 1);
+}
+
+// Gauges are read when /metrics is scraped, e.g. a queue depth
+typedef int32_t (*metrics_gauge_fn_t)(void);
+void metrics_register_gauge(const char *name, const char *help, metrics_gauge_fn_t read);
+
+// Tasks whose free stack is reported as gopro_task_stack_free_bytes
+void metrics_register_task(TaskHandle_t task);
+
+// GET /metrics in the Prometheus text exposition format
+esp_err_t metrics_http_handler(httpd_req_t *req);
+
+#endif // METRICS_H
@@ -0,0 +1,273 @@
+#include <stdarg.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "metrics.h"
+
+static const char *TAG = "metrics";
+
+#define METRICS_MAX_GAUGES  8
+#define METRICS_MAX_TASKS   12
+#define METRICS_LINE_LEN    160
+
+// Bucket upper bounds in microseconds, +Inf is implicit
+static const uint32_t bucket_bounds_us[] = {
+    5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000,
+};
+#define BUCKET_COUNT (sizeof(bucket_bounds_us) / sizeof(bucket_bounds_us[0]) + 1)
+
+typedef struct {
+    const char *name;
+    const char *help;
+} counter_desc_t;
+
+// Histograms of one family share a name and differ by label
+typedef struct {
+    const char *family;
+    const char *help;
+    const char *labels;
+} histogram_desc_t;
+
+static const counter_desc_t counter_desc[METRIC_COUNTER_COUNT] = {
+    [METRIC_BLE_CONNECTS] = {"gopro_ble_connects", "BLE connections established"},
+    [METRIC_BLE_RECONNECTS] = {"gopro_ble_reconnects", "BLE connections re-established after a disconnect"},
+    [METRIC_BLE_DISCONNECTS] = {"gopro_ble_disconnects", "BLE connections lost or closed"},
+    [METRIC_HTTP_CLIENT_REQUESTS] = {"gopro_http_client_requests", "HTTP requests sent to cameras"},
+    [METRIC_HTTP_CLIENT_ERRORS] = {"gopro_http_client_errors", "HTTP requests to cameras that failed"},
+    [METRIC_HTTP_SERVER_REQUESTS] = {"gopro_http_server_requests", "REST and web UI requests served"},
+    [METRIC_WEB_ASSET_REQUESTS] = {"gopro_web_asset_requests", "Web UI asset requests"},
+    [METRIC_WEB_ASSET_NOT_MODIFIED] = {"gopro_web_asset_not_modified", "Web UI asset requests answered with 304"},
+    [METRIC_WEB_ASSET_BYTES] = {"gopro_web_asset_bytes", "Web UI body bytes sent"},
+    [METRIC_WS_UPDATES] = {"gopro_ws_updates", "Camera state updates pushed over the WebSocket"},
+    [METRIC_REMOTE_FRAMES_SENT] = {"gopro_remote_frames_sent", "Smart Remote UDP frames sent to cameras"},
+    [METRIC_REMOTE_FRAMES_RECEIVED] = {"gopro_remote_frames_received", "Smart Remote UDP frames received from cameras"},
+    [METRIC_REMOTE_FRAMES_DROPPED] = {"gopro_remote_frames_dropped", "Smart Remote UDP frames from hosts that are not a camera"},
+    [METRIC_REMOTE_BROADCAST_MISSED] = {"gopro_remote_broadcast_missed", "Cameras that never acked a broadcast command, retries included"},
+    [METRIC_LINK_PROBES_LOST] = {"gopro_link_probes_lost", "Link probes and status polls a camera never answered"},
+    [METRIC_LINK_STATE_CHANGES] = {"gopro_link_state_changes", "Camera links that went up, degraded or down"},
+    [METRIC_CAN_FRAMES_RECEIVED] = {"gopro_can_frames_received", "CAN frames received"},
+    [METRIC_CAN_TRIGGERS_DROPPED] = {"gopro_can_triggers_dropped", "CAN record changes dropped because the dispatch queue was full"},
+    [METRIC_CAN_FRAMES_SENT] = {"gopro_can_frames_sent", "CAN frames sent"},
+    [METRIC_CAN_TX_DROPPED] = {"gopro_can_tx_dropped", "CAN frames dropped because a transmit queue was full or the bus did not take them"},
+    [METRIC_CAN_ISOTP_DROPPED] = {"gopro_can_isotp_dropped", "ISO-TP frames dropped because the link task fell behind"},
+};
+
+static const histogram_desc_t histogram_desc[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_SHUTTER_LATENCY_WIFI] = {"gopro_shutter_latency_seconds", "Time to send a shutter command", "transport=\"wifi\""},
+    [METRIC_SHUTTER_LATENCY_BLE] = {"gopro_shutter_latency_seconds", "Time to send a shutter command", "transport=\"ble\""},
+    [METRIC_SHUTTER_LATENCY_REMOTE] = {"gopro_shutter_latency_seconds", "Time to send a shutter command", "transport=\"remote\""},
+    [METRIC_WEB_ASSET_LATENCY] = {"gopro_web_asset_seconds", "Time from web UI request to last byte queued", NULL},
+    [METRIC_REMOTE_BROADCAST_SKEW] = {"gopro_remote_broadcast_skew_seconds", "Time between the first and the last camera ack of a broadcast command", NULL},
+    [METRIC_EVENT_HANDLER_LATENCY] = {"gopro_event_handler_seconds", "Time the softAP Wi-Fi and DHCP handlers hold the default event loop", NULL},
+    [METRIC_LINK_RTT_WIFI] = {"gopro_link_rtt_seconds", "Round trip time of link probes", "transport=\"wifi\""},
+    [METRIC_LINK_RTT_REMOTE] = {"gopro_link_rtt_seconds", "Round trip time of link probes", "transport=\"remote\""},
+    [METRIC_TRACE_DISPATCH] = {"gopro_trace_stage_seconds", "Time a traced shutter command spent in each stage", "stage=\"dispatch\""},
+    [METRIC_TRACE_SEND] = {"gopro_trace_stage_seconds", "Time a traced shutter command spent in each stage", "stage=\"send\""},
+    [METRIC_TRACE_ACK] = {"gopro_trace_stage_seconds", "Time a traced shutter command spent in each stage", "stage=\"ack\""},
+    [METRIC_TRACE_CONFIRM] = {"gopro_trace_stage_seconds", "Time a traced shutter command spent in each stage", "stage=\"confirm\""},
+    [METRIC_TRACE_TOTAL] = {"gopro_trace_stage_seconds", "Time a traced shutter command spent in each stage", "stage=\"total\""},
+};
+
+typedef struct {
+    uint32_t buckets[BUCKET_COUNT];
+    uint32_t count;
+    uint32_t sum_ms;
+} histogram_t;
+
+// One slot per core, so the cores never contend on a counter
+static uint32_t counters[portNUM_PROCESSORS][METRIC_COUNTER_COUNT];
+static histogram_t histograms[portNUM_PROCESSORS][METRIC_HISTOGRAM_COUNT];
+
+typedef struct {
+    const char *name;
+    const char *help;
+    metrics_gauge_fn_t read;
+} gauge_t;
+
+static gauge_t gauges[METRICS_MAX_GAUGES];
+static int gauge_count = 0;
+static TaskHandle_t tasks[METRICS_MAX_TASKS];
+static int task_count = 0;
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// A task can be preempted between reading its core id and the add, the
+// atomic add keeps that safe without taking a lock
+void metrics_add(metric_counter_t counter, uint32_t value)
+{
+    __atomic_fetch_add(&counters[xPortGetCoreID()][counter], value, __ATOMIC_RELAXED);
+}
+
+void metrics_observe(metric_histogram_t histogram, uint32_t value_us)
+{
+    histogram_t *h = &histograms[xPortGetCoreID()][histogram];
+    size_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && value_us > bucket_bounds_us[bucket]) {
+        bucket++;
+    }
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ms, (value_us + 500) / 1000, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+void metrics_register_gauge(const char *name, const char *help, metrics_gauge_fn_t read)
+{
+    taskENTER_CRITICAL(&registry_lock);
+    if (gauge_count < METRICS_MAX_GAUGES) {
+        gauges[gauge_count++] = (gauge_t){name, help, read};
+        read = NULL;
+    }
+    taskEXIT_CRITICAL(&registry_lock);
+    if (read != NULL) {
+        ESP_LOGE(TAG, "No room for gauge %s", name);
+    }
+}
+
+void metrics_register_task(TaskHandle_t task)
+{
+    taskENTER_CRITICAL(&registry_lock);
+    if (task_count < METRICS_MAX_TASKS) {
+        tasks[task_count++] = task;
+        task = NULL;
+    }
+    taskEXIT_CRITICAL(&registry_lock);
+    if (task != NULL) {
+        ESP_LOGE(TAG, "No room to track another task");
+    }
+}
+
+static uint32_t counter_total(metric_counter_t counter)
+{
+    uint32_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        total += __atomic_load_n(&counters[core][counter], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+static histogram_t histogram_total(metric_histogram_t histogram)
+{
+    histogram_t total = {0};
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const histogram_t *h = &histograms[core][histogram];
+        for (size_t b = 0; b < BUCKET_COUNT; b++) {
+            total.buckets[b] += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        }
+        total.count += __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        total.sum_ms += __atomic_load_n(&h->sum_ms, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+// Formats one line into the scratch buffer and sends it as its own chunk,
+// so the whole page never has to fit in memory
+static esp_err_t send_line(httpd_req_t *req, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static esp_err_t send_line(httpd_req_t *req, const char *fmt, ...)
+{
+    char line[METRICS_LINE_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+}
+
+static esp_err_t send_header(httpd_req_t *req, const char *name, const char *help, const char *type)
+{
+    esp_err_t ret = send_line(req, "# HELP %s %s\n", name, help);
+    if (ret == ESP_OK) {
+        ret = send_line(req, "# TYPE %s %s\n", name, type);
+    }
+    return ret;
+}
+
+static esp_err_t send_histogram(httpd_req_t *req, metric_histogram_t histogram)
+{
+    const histogram_desc_t *desc = &histogram_desc[histogram];
+    const char *labels = desc->labels != NULL ? desc->labels : "";
+    const char *sep = desc->labels != NULL ? "," : "";
+    histogram_t total = histogram_total(histogram);
+    uint32_t cumulative = 0;
+    esp_err_t ret = ESP_OK;
+
+    for (size_t b = 0; b < BUCKET_COUNT && ret == ESP_OK; b++) {
+        cumulative += total.buckets[b];
+        if (b < BUCKET_COUNT - 1) {
+            ret = send_line(req, "%s_bucket{%s%sle=\"%lu.%06lu\"} %lu\n", desc->family, labels, sep,
+                            (unsigned long)(bucket_bounds_us[b] / 1000000),
+                            (unsigned long)(bucket_bounds_us[b] % 1000000), (unsigned long)cumulative);
+        } else {
+            ret = send_line(req, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", desc->family, labels, sep,
+                            (unsigned long)cumulative);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = send_line(req, "%s_sum{%s} %lu.%03lu\n", desc->family, labels,
+                        (unsigned long)(total.sum_ms / 1000), (unsigned long)(total.sum_ms % 1000));
+    }
+    if (ret == ESP_OK) {
+        ret = send_line(req, "%s_count{%s} %lu\n", desc->family, labels, (unsigned long)total.count);
+    }
+    return ret;
+}
+
+esp_err_t metrics_http_handler(httpd_req_t *req)
+{
+    esp_err_t ret = ESP_OK;
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT && ret == ESP_OK; c++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s_total", counter_desc[c].name);
+        ret = send_header(req, name, counter_desc[c].help, "counter");
+        if (ret == ESP_OK) {
+            ret = send_line(req, "%s %lu\n", name, (unsigned long)counter_total(c));
+        }
+    }
+
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT && ret == ESP_OK; h++) {
+        // Members of one family are adjacent, only the first one carries the header
+        if (h == 0 || strcmp(histogram_desc[h].family, histogram_desc[h - 1].family) != 0) {
+            ret = send_header(req, histogram_desc[h].family, histogram_desc[h].help, "histogram");
+        }
+        if (ret == ESP_OK) {
+            ret = send_histogram(req, h);
+        }
+    }
+
+    if (ret == ESP_OK) {
+        ret = send_header(req, "gopro_free_heap_bytes", "Free heap", "gauge");
+    }
+    if (ret == ESP_OK) {
+        ret = send_line(req, "gopro_free_heap_bytes %lu\n", (unsigned long)esp_get_free_heap_size());
+    }
+    if (ret == ESP_OK) {
+        ret = send_header(req, "gopro_min_free_heap_bytes", "Lowest free heap since boot", "gauge");
+    }
+    if (ret == ESP_OK) {
+        ret = send_line(req, "gopro_min_free_heap_bytes %lu\n", (unsigned long)esp_get_minimum_free_heap_size());
+    }
+
+    for (int g = 0; g < gauge_count && ret == ESP_OK; g++) {
+        ret = send_header(req, gauges[g].name, gauges[g].help, "gauge");
+        if (ret == ESP_OK) {
+            ret = send_line(req, "%s %ld\n", gauges[g].name, (long)gauges[g].read());
+        }
+    }
+
+    if (ret == ESP_OK && task_count > 0) {
+        ret = send_header(req, "gopro_task_stack_free_bytes", "Lowest free stack seen per task", "gauge");
+    }
+    for (int t = 0; t < task_count && ret == ESP_OK; t++) {
+        ret = send_line(req, "gopro_task_stack_free_bytes{task=\"%s\"} %u\n",
+                        pcTaskGetName(tasks[t]), (unsigned)uxTaskGetStackHighWaterMark(tasks[t]));
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Scrape aborted: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
@@ -0,0 +1,55 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+// Asynchronous NVS persistence. Owners mark a record dirty from any task,
+// including event handlers, and one service task writes every dirty record
+// that actually changed after a coalescing window.
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#define PERSIST_MAX_RECORDS 8
+
+typedef int persist_id_t;
+
+typedef struct {
+    const char *key;            // NVS key, at most 15 characters
+    uint8_t version;            // Bump when the payload layout changes
+    uint16_t size;              // Payload bytes
+    // Copies the current state into buf, runs on the persistence task
+    void (*snapshot)(void *buf, void *ctx);
+    void *ctx;
+} persist_record_t;
+
+typedef struct {
+    uint32_t writes;            // Records written since boot
+    uint32_t unchanged;         // Dirty records skipped because the CRC matched
+    uint32_t commits;
+    uint32_t writes_last_hour;
+    uint32_t last_write_us;     // Duration of the last commit, including its writes
+    uint32_t max_write_us;
+} persist_stats_t;
+
+// Starts the service task, NVS must already be initialised
+esp_err_t persist_init(void);
+
+// The record must outlive the service, returns -1 when the table is full
+persist_id_t persist_register(const persist_record_t *record);
+
+// Reads a record back: ESP_ERR_NVS_NOT_FOUND if it was never written,
+// ESP_ERR_INVALID_VERSION if it has another layout, ESP_ERR_INVALID_CRC if damaged
+esp_err_t persist_load(persist_id_t id, void *buf);
+
+// Never blocks, safe to call from event handlers
+void persist_mark_dirty(persist_id_t id);
+
+// Writes every dirty record now instead of after the window, e.g. before a restart
+void persist_flush(void);
+
+void persist_get_stats(persist_stats_t *stats);
+
+// For metrics_register_gauge()
+int32_t persist_writes_last_hour(void);
+int32_t persist_max_write_us(void);
+
+#endif // PERSIST_H
@@ -0,0 +1,263 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "persist.h"
+
+static const char *TAG = "persist";
+
+#define PERSIST_NAMESPACE "persist"
+#define PERSIST_MAGIC     0xA5
+
+// Stored in front of every payload
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t version;
+    uint16_t size;
+    uint32_t crc;               // CRC32 of the payload
+} persist_header_t;
+
+typedef struct {
+    const persist_record_t *record;
+    uint32_t crc;               // Of the copy in flash, 0 if unknown
+} persist_slot_t;
+
+static persist_slot_t slots[PERSIST_MAX_RECORDS];
+static int slot_count = 0;
+static uint32_t dirty = 0;      // Bit per record
+static TaskHandle_t persist_task_handle = NULL;
+static SemaphoreHandle_t write_lock = NULL;
+static uint8_t buffer[sizeof(persist_header_t) + CONFIG_PERSIST_MAX_RECORD_SIZE];
+
+// Writes per minute over the last hour, for the rate gauge
+#define HOUR_MINUTES 60
+static uint16_t minute_writes[HOUR_MINUTES];
+static uint32_t minute_stamp[HOUR_MINUTES];
+
+static persist_stats_t stats;
+
+static uint32_t payload_crc(const void *payload, size_t size)
+{
+    return esp_rom_crc32_le(0, payload, size);
+}
+
+static void count_writes(uint32_t count)
+{
+    uint32_t minute = esp_timer_get_time() / (60 * 1000 * 1000);
+    int index = minute % HOUR_MINUTES;
+    if (minute_stamp[index] != minute) {
+        minute_stamp[index] = minute;
+        minute_writes[index] = 0;
+    }
+    minute_writes[index] += count;
+}
+
+int32_t persist_writes_last_hour(void)
+{
+    uint32_t minute = esp_timer_get_time() / (60 * 1000 * 1000);
+    int32_t total = 0;
+    for (int i = 0; i < HOUR_MINUTES; i++) {
+        if (minute - minute_stamp[i] < HOUR_MINUTES) {
+            total += minute_writes[i];
+        }
+    }
+    return total;
+}
+
+int32_t persist_max_write_us(void)
+{
+    return stats.max_write_us;
+}
+
+// Only the first change of a window has to wake the task
+static void mark_records(uint32_t records)
+{
+    uint32_t previous = __atomic_fetch_or(&dirty, records, __ATOMIC_ACQ_REL);
+    if (previous == 0 && persist_task_handle != NULL) {
+        xTaskNotifyGive(persist_task_handle);
+    }
+}
+
+// Writes the dirty records whose content changed, then commits once. A
+// record only counts as in flash once the commit went through, until then
+// it stays dirty and its CRC is left alone.
+static void write_dirty(void)
+{
+    uint32_t pending = __atomic_exchange_n(&dirty, 0, __ATOMIC_ACQ_REL);
+    if (pending == 0) {
+        return;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(PERSIST_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Opening NVS failed: %s", esp_err_to_name(err));
+        // The task sleeps another window before it tries again
+        mark_records(pending);
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    uint32_t written = 0;
+    uint32_t written_mask = 0;
+    uint32_t failed = 0;
+    uint32_t crcs[PERSIST_MAX_RECORDS];
+    persist_header_t *header = (persist_header_t *)buffer;
+    uint8_t *payload = buffer + sizeof(persist_header_t);
+
+    for (int i = 0; i < slot_count; i++) {
+        if (!(pending & (1u << i))) {
+            continue;
+        }
+        const persist_record_t *record = slots[i].record;
+        record->snapshot(payload, record->ctx);
+        uint32_t crc = payload_crc(payload, record->size);
+        if (crc == slots[i].crc) {
+            stats.unchanged++;
+            continue;
+        }
+        header->magic = PERSIST_MAGIC;
+        header->version = record->version;
+        header->size = record->size;
+        header->crc = crc;
+        err = nvs_set_blob(handle, record->key, buffer, sizeof(persist_header_t) + record->size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Writing %s failed: %s", record->key, esp_err_to_name(err));
+            failed |= 1u << i;
+            continue;
+        }
+        crcs[i] = crc;
+        written_mask |= 1u << i;
+        written++;
+    }
+    if (written > 0) {
+        err = nvs_commit(handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Commit failed: %s", esp_err_to_name(err));
+            failed |= written_mask;
+            written_mask = 0;
+            written = 0;
+        }
+    }
+    nvs_close(handle);
+
+    for (int i = 0; i < slot_count; i++) {
+        if (written_mask & (1u << i)) {
+            slots[i].crc = crcs[i];
+        }
+    }
+    if (failed != 0) {
+        mark_records(failed);
+    }
+
+    if (written > 0) {
+        uint32_t elapsed = esp_timer_get_time() - start;
+        stats.writes += written;
+        stats.commits++;
+        stats.last_write_us = elapsed;
+        if (elapsed > stats.max_write_us) {
+            stats.max_write_us = elapsed;
+        }
+        count_writes(written);
+        ESP_LOGI(TAG, "Wrote %lu records in %lu us", (unsigned long)written, (unsigned long)elapsed);
+    }
+}
+
+void persist_flush(void)
+{
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    write_dirty();
+    xSemaphoreGive(write_lock);
+}
+
+// Sleeps until the first record goes dirty, then lets the window fill up
+static void persist_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_PERSIST_COALESCE_MS));
+        persist_flush();
+    }
+}
+
+esp_err_t persist_init(void)
+{
+    write_lock = xSemaphoreCreateMutex();
+    if (write_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(persist_task, "persist_task", 3072, NULL, 2, &persist_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+persist_id_t persist_register(const persist_record_t *record)
+{
+    if (slot_count >= PERSIST_MAX_RECORDS || record->size > CONFIG_PERSIST_MAX_RECORD_SIZE) {
+        ESP_LOGE(TAG, "Cannot register %s", record->key);
+        return -1;
+    }
+    slots[slot_count].record = record;
+    slots[slot_count].crc = 0;
+    return slot_count++;
+}
+
+esp_err_t persist_load(persist_id_t id, void *buf)
+{
+    if (id < 0 || id >= slot_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const persist_record_t *record = slots[id].record;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(PERSIST_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    size_t size = sizeof(buffer);
+    err = nvs_get_blob(handle, record->key, buffer, &size);
+    nvs_close(handle);
+
+    const persist_header_t *header = (const persist_header_t *)buffer;
+    const uint8_t *payload = buffer + sizeof(persist_header_t);
+    if (err == ESP_OK) {
+        if (size < sizeof(persist_header_t) || header->magic != PERSIST_MAGIC ||
+            header->version != record->version || header->size != record->size ||
+            size != sizeof(persist_header_t) + header->size) {
+            err = ESP_ERR_INVALID_VERSION;
+        } else if (payload_crc(payload, header->size) != header->crc) {
+            err = ESP_ERR_INVALID_CRC;
+        } else {
+            memcpy(buf, payload, record->size);
+            slots[id].crc = header->crc;
+        }
+    }
+    xSemaphoreGive(write_lock);
+
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Discarding %s: %s", record->key, esp_err_to_name(err));
+    }
+    return err;
+}
+
+void persist_mark_dirty(persist_id_t id)
+{
+    if (id < 0 || id >= slot_count) {
+        return;
+    }
+    mark_records(1u << id);
+}
+
+void persist_get_stats(persist_stats_t *out)
+{
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    *out = stats;
+    out->writes_last_hour = persist_writes_last_hour();
+    xSemaphoreGive(write_lock);
+}
@@ -0,0 +1,62 @@
+#ifndef SHUTTER_TRACE_H
+#define SHUTTER_TRACE_H
+
+// End-to-end tracing of shutter commands. A trace starts where the command
+// is triggered (a CAN frame, the web UI button, a REST call) and follows each
+// camera it is sent to through send, ack and the camera's own status report,
+// with a microsecond timestamp per stage. Stage durations feed the
+// gopro_trace_stage_seconds histograms; the last traces are kept for
+// GET /api/trace, which answers in the Chrome trace event format.
+//
+// Acks and status reports do not carry the trace id, so a trace is bound to
+// each camera it is sent to and those stages land on the camera's bound trace.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+// Wide enough never to wrap in practice: an id picks its slot modulo
+// CONFIG_SHUTTER_TRACE_KEEP, which a wrap would throw off
+typedef uint32_t trace_id_t;
+
+#define TRACE_NONE 0
+
+typedef enum {
+    TRACE_SOURCE_CAN,
+    TRACE_SOURCE_BUTTON,        // Web UI shutter button
+    TRACE_SOURCE_HTTP,          // REST API
+    TRACE_SOURCE_COUNT,
+} trace_source_t;
+
+typedef enum {
+    TRACE_STAGE_SENT,           // Handed to the transport
+    TRACE_STAGE_ACKED,          // Accepted by the camera
+    TRACE_STAGE_CONFIRMED,      // Camera reported the expected recording state
+    TRACE_STAGE_COUNT,
+} trace_stage_t;
+
+// Starts a trace for a command that leaves cameras recording or not.
+// trigger_us is the esp_timer time of the trigger, 0 for now.
+trace_id_t trace_begin(trace_source_t source, bool recording, int64_t trigger_us);
+
+// The command reached the task that sends it
+void trace_dispatched(trace_id_t id);
+
+// Stages of the camera from now on belong to this trace
+void trace_bind(trace_id_t id, int camera);
+
+// Stamps a stage on the camera's bound trace, once; later calls are ignored
+void trace_camera_stage(int camera, trace_stage_t stage);
+
+// Status report of a camera, confirms its bound trace if the state matches
+void trace_camera_recording(int camera, bool recording);
+
+// Microseconds from the trigger to a stage of one camera, false if the trace
+// is no longer kept or the camera has not reached the stage
+bool trace_stage_offset(trace_id_t id, int camera, trace_stage_t stage, uint32_t *offset_us);
+
+// GET returns the kept traces as Chrome trace events
+esp_err_t trace_http_handler(httpd_req_t *req);
+
+#endif // SHUTTER_TRACE_H
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "stationTable.h"
+#include "metrics.h"
+#include "shutterTrace.h"
+
+// Bytes of JSON one trace can take: its trigger span and three per camera
+#define TRACE_JSON_MAX (256 + STATION_TABLE_MAX * TRACE_STAGE_COUNT * 200)
+
+typedef struct {
+    trace_id_t id;
+    uint8_t source;
+    bool recording;
+    int64_t trigger_us;
+    // Microseconds after the trigger, 0 until the stage is reached
+    uint32_t dispatched;
+    uint32_t stages[STATION_TABLE_MAX][TRACE_STAGE_COUNT];
+} trace_t;
+
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+static trace_t traces[CONFIG_SHUTTER_TRACE_KEEP];
+static trace_id_t bound[STATION_TABLE_MAX];
+static trace_id_t last_id;
+
+static const char *source_names[TRACE_SOURCE_COUNT] = {
+    [TRACE_SOURCE_CAN] = "can",
+    [TRACE_SOURCE_BUTTON] = "button",
+    [TRACE_SOURCE_HTTP] = "http",
+};
+
+static const char *stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_SENT] = "send",
+    [TRACE_STAGE_ACKED] = "ack",
+    [TRACE_STAGE_CONFIRMED] = "confirm",
+};
+
+static const metric_histogram_t stage_metric[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_SENT] = METRIC_TRACE_SEND,
+    [TRACE_STAGE_ACKED] = METRIC_TRACE_ACK,
+    [TRACE_STAGE_CONFIRMED] = METRIC_TRACE_CONFIRM,
+};
+
+// Slot of a trace still kept, NULL once a newer trace took it over
+static trace_t *find(trace_id_t id)
+{
+    trace_t *trace = &traces[id % CONFIG_SHUTTER_TRACE_KEEP];
+    return id != TRACE_NONE && trace->id == id ? trace : NULL;
+}
+
+// Offset of now from the trigger, never 0 so it reads as reached
+static uint32_t offset_of(const trace_t *trace)
+{
+    int64_t offset = esp_timer_get_time() - trace->trigger_us;
+    return offset < 1 ? 1 : offset > UINT32_MAX ? UINT32_MAX : (uint32_t)offset;
+}
+
+trace_id_t trace_begin(trace_source_t source, bool recording, int64_t trigger_us)
+{
+    taskENTER_CRITICAL(&trace_lock);
+    if (++last_id == TRACE_NONE) {
+        last_id++;
+    }
+    trace_t *trace = &traces[last_id % CONFIG_SHUTTER_TRACE_KEEP];
+    memset(trace, 0, sizeof(*trace));
+    trace->id = last_id;
+    trace->source = source;
+    trace->recording = recording;
+    trace->trigger_us = trigger_us != 0 ? trigger_us : esp_timer_get_time();
+    trace_id_t id = last_id;
+    taskEXIT_CRITICAL(&trace_lock);
+    return id;
+}
+
+void trace_dispatched(trace_id_t id)
+{
+    taskENTER_CRITICAL(&trace_lock);
+    trace_t *trace = find(id);
+    uint32_t dispatched = 0;
+    if (trace != NULL && trace->dispatched == 0) {
+        dispatched = trace->dispatched = offset_of(trace);
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+
+    if (dispatched != 0) {
+        metrics_observe(METRIC_TRACE_DISPATCH, dispatched);
+    }
+}
+
+void trace_bind(trace_id_t id, int camera)
+{
+    if (camera >= 0 && camera < STATION_TABLE_MAX) {
+        __atomic_store_n(&bound[camera], id, __ATOMIC_RELAXED);
+    }
+}
+
+// Stamps a stage and returns how long it took since the one before, 0 if it
+// was not stamped
+static uint32_t stamp(int camera, trace_stage_t stage, uint32_t *total)
+{
+    trace_t *trace = find(bound[camera]);
+    if (trace == NULL || trace->stages[camera][stage] != 0) {
+        return 0;
+    }
+    uint32_t now = offset_of(trace);
+    trace->stages[camera][stage] = now;
+    *total = now;
+
+    uint32_t before = trace->dispatched;
+    for (int s = stage - 1; s >= 0; s--) {
+        if (trace->stages[camera][s] != 0) {
+            before = trace->stages[camera][s];
+            break;
+        }
+    }
+    return now > before ? now - before : 1;
+}
+
+void trace_camera_stage(int camera, trace_stage_t stage)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX || stage >= TRACE_STAGE_COUNT) {
+        return;
+    }
+    uint32_t total = 0;
+    taskENTER_CRITICAL(&trace_lock);
+    uint32_t took = stamp(camera, stage, &total);
+    taskEXIT_CRITICAL(&trace_lock);
+
+    if (took != 0) {
+        metrics_observe(stage_metric[stage], took);
+    }
+}
+
+void trace_camera_recording(int camera, bool recording)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX) {
+        return;
+    }
+    uint32_t total = 0;
+    uint32_t took = 0;
+    taskENTER_CRITICAL(&trace_lock);
+    trace_t *trace = find(bound[camera]);
+    if (trace != NULL && trace->recording == recording) {
+        took = stamp(camera, TRACE_STAGE_CONFIRMED, &total);
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+
+    if (took != 0) {
+        metrics_observe(METRIC_TRACE_CONFIRM, took);
+        metrics_observe(METRIC_TRACE_TOTAL, total);
+    }
+}
+
+bool trace_stage_offset(trace_id_t id, int camera, trace_stage_t stage, uint32_t *offset_us)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX || stage >= TRACE_STAGE_COUNT) {
+        return false;
+    }
+    taskENTER_CRITICAL(&trace_lock);
+    const trace_t *trace = find(id);
+    uint32_t offset = trace != NULL ? trace->stages[camera][stage] : 0;
+    taskEXIT_CRITICAL(&trace_lock);
+    *offset_us = offset;
+    return offset != 0;
+}
+
+// One complete event ("ph":"X"), timestamps in microseconds since boot
+static size_t span(char *buf, size_t size, bool *first, const char *name, const trace_t *trace,
+                   int tid, uint32_t from, uint32_t to)
+{
+    size_t len = snprintf(buf, size,
+                          "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                          "\"ts\":%lld,\"dur\":%lu,\"args\":{\"trace\":%lu,\"recording\":%s}}",
+                          *first ? "" : ",", name, source_names[trace->source], tid,
+                          (long long)(trace->trigger_us + from), (unsigned long)(to - from),
+                          (unsigned long)trace->id, trace->recording ? "true" : "false");
+    *first = false;
+    return len < size ? len : size - 1;
+}
+
+// Trigger to dispatch on the controller row, the stages of each camera on its own row
+static size_t trace_json(char *buf, size_t size, const trace_t *trace, bool *first)
+{
+    size_t len = span(buf, size, first, "dispatch", trace, 0, 0, trace->dispatched);
+    for (int camera = 0; camera < STATION_TABLE_MAX; camera++) {
+        uint32_t from = trace->dispatched;
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            uint32_t to = trace->stages[camera][s];
+            if (to == 0) {
+                continue;
+            }
+            len += span(buf + len, size - len, first, stage_names[s], trace, camera + 1, from, to);
+            from = to;
+        }
+    }
+    return len;
+}
+
+esp_err_t trace_http_handler(httpd_req_t *req)
+{
+    // Off the stack, the HTTP server runs one handler at a time
+    static char json[TRACE_JSON_MAX];
+
+    httpd_resp_set_type(req, "application/json");
+    size_t len = snprintf(json, sizeof(json), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    len += snprintf(json + len, sizeof(json) - len,
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"controller\"}}");
+    for (int camera = 0; camera < STATION_TABLE_MAX; camera++) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"camera %d\"}}",
+                        camera + 1, camera);
+    }
+    esp_err_t err = httpd_resp_send_chunk(req, json, len);
+
+    // Oldest first, each copied out of the lock before it is formatted
+    bool first = false;
+    taskENTER_CRITICAL(&trace_lock);
+    trace_id_t newest = last_id;
+    taskEXIT_CRITICAL(&trace_lock);
+    for (int i = CONFIG_SHUTTER_TRACE_KEEP - 1; i >= 0 && err == ESP_OK; i--) {
+        trace_t trace;
+        taskENTER_CRITICAL(&trace_lock);
+        const trace_t *kept = find(newest - i);
+        bool valid = kept != NULL;
+        if (valid) {
+            trace = *kept;
+        }
+        taskEXIT_CRITICAL(&trace_lock);
+        if (!valid) {
+            continue;
+        }
+        len = trace_json(json, sizeof(json), &trace, &first);
+        err = httpd_resp_send_chunk(req, json, len);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, "]}", 2);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return err;
+}
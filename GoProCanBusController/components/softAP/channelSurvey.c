@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "configStore.h"
+#include "metrics.h"
+#include "channelSurvey.h"
+
+static const char *TAG = "channel_survey";
+
+// Networks kept from one scan, the loudest ones come first
+#define SURVEY_MAX_RECORDS   32
+
+// Listen time per channel; passive, so the survey sends nothing
+#define SURVEY_DWELL_MS      120
+
+// Cost of a network on its own channel regardless of its signal, beacons
+// and retries take airtime even when they are weak
+#define SURVEY_BSS_COST      1000
+
+// Share of a network's cost seen 0, 1, 2 and 3 channels away
+static const uint8_t overlap_pct[] = {100, 70, 40, 15};
+
+static SemaphoreHandle_t survey_lock;
+static channel_survey_t last;
+static wifi_ap_record_t records[SURVEY_MAX_RECORDS];
+
+void channel_survey_score(const wifi_ap_record_t *ap, int count, channel_survey_t *survey)
+{
+    memset(survey->score, 0, sizeof(survey->score));
+    memset(survey->bss, 0, sizeof(survey->bss));
+    memset(survey->strongest, -127, sizeof(survey->strongest));
+
+    for (int i = 0; i < count; i++) {
+        int primary = ap[i].primary;
+        if (primary < 1 || primary > SURVEY_CHANNELS) {
+            continue;
+        }
+        survey->bss[primary - 1]++;
+        if (ap[i].rssi > survey->strongest[primary - 1]) {
+            survey->strongest[primary - 1] = ap[i].rssi;
+        }
+
+        // Signal above the noise floor, squared so one loud network
+        // outweighs several distant ones
+        int level = ap[i].rssi + 100;
+        level = level < 0 ? 0 : level > 100 ? 100 : level;
+        uint32_t cost = SURVEY_BSS_COST + level * level;
+
+        for (int d = 0; d < sizeof(overlap_pct); d++) {
+            if (primary - d >= 1) {
+                survey->score[primary - d - 1] += cost * overlap_pct[d] / 100;
+            }
+            if (d > 0 && primary + d <= SURVEY_CHANNELS) {
+                survey->score[primary + d - 1] += cost * overlap_pct[d] / 100;
+            }
+        }
+    }
+}
+
+// Lowest score, the current channel wins ties
+static uint8_t quietest(const channel_survey_t *survey, uint8_t current)
+{
+    uint8_t best = current;
+    for (int c = 1; c <= SURVEY_CHANNELS; c++) {
+        if (survey->score[c - 1] < survey->score[best - 1]) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+// Scans every channel, an access point needs the station interface for it
+static esp_err_t survey_scan(uint16_t *count)
+{
+    wifi_mode_t mode;
+    esp_err_t err = esp_wifi_get_mode(&mode);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (mode == WIFI_MODE_AP) {
+        err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    wifi_scan_config_t scan = {
+        .show_hidden = true,
+        .scan_type = WIFI_SCAN_TYPE_PASSIVE,
+        .scan_time.passive = SURVEY_DWELL_MS,
+    };
+    err = esp_wifi_scan_start(&scan, true);
+    if (err == ESP_OK) {
+        *count = SURVEY_MAX_RECORDS;
+        err = esp_wifi_scan_get_ap_records(count, records);
+    }
+
+    if (mode == WIFI_MODE_AP) {
+        esp_wifi_set_mode(WIFI_MODE_AP);
+    }
+    return err;
+}
+
+esp_err_t channel_survey_run(void)
+{
+    xSemaphoreTake(survey_lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    uint16_t count = 0;
+    esp_err_t err = survey_scan(&count);
+    if (err != ESP_OK) {
+        xSemaphoreGive(survey_lock);
+        ESP_LOGE(TAG, "Scan failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    runtime_config_t config;
+    config_store_get(&config);
+    channel_survey_t survey;
+    channel_survey_score(records, count, &survey);
+    survey.previous = config.channel;
+    survey.chosen = quietest(&survey, config.channel);
+
+    // Moving drops every camera, only do it for a clear gain
+    uint32_t current_score = survey.score[config.channel - 1];
+    uint32_t best_score = survey.score[survey.chosen - 1];
+    if ((uint64_t)best_score * 100 > (uint64_t)current_score * (100 - CONFIG_CHANNEL_SURVEY_MIN_GAIN)) {
+        survey.chosen = config.channel;
+    }
+    survey.finished_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    last = survey;
+    xSemaphoreGive(survey_lock);
+
+    ESP_LOGI(TAG, "%u networks in %lld ms, channel %u scores %lu, channel %u scores %lu",
+             count, (long long)(esp_timer_get_time() - start) / 1000,
+             config.channel, (unsigned long)current_score, survey.chosen, (unsigned long)best_score);
+
+    if (survey.chosen != config.channel) {
+        config.channel = survey.chosen;
+        err = config_store_update(&config, NULL);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Moving to channel %u failed: %s", survey.chosen, esp_err_to_name(err));
+        }
+    }
+    return err;
+}
+
+bool channel_survey_get(channel_survey_t *survey)
+{
+    xSemaphoreTake(survey_lock, portMAX_DELAY);
+    *survey = last;
+    xSemaphoreGive(survey_lock);
+    return survey->finished_ms != 0;
+}
+
+static int32_t channel_gauge(void)
+{
+    const runtime_config_t *config = config_store_acquire();
+    int32_t channel = config->channel;
+    config_store_release(config);
+    return channel;
+}
+
+void channel_survey_init(void)
+{
+    survey_lock = xSemaphoreCreateMutex();
+    metrics_register_gauge("gopro_wifi_channel", "Channel the softAP is on", channel_gauge);
+}
+
+esp_err_t channel_survey_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_POST) {
+        esp_err_t err = channel_survey_run();
+        if (err != ESP_OK) {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Survey failed");
+        }
+    }
+
+    channel_survey_t survey;
+    if (!channel_survey_get(&survey)) {
+        return httpd_resp_send(req, "{\"channels\":[]}", HTTPD_RESP_USE_STRLEN);
+    }
+    char body[64 + SURVEY_CHANNELS * 64];
+    size_t len = snprintf(body, sizeof(body), "{\"previous\":%u,\"chosen\":%u,\"age_ms\":%lu,\"channels\":[",
+                          survey.previous, survey.chosen,
+                          (unsigned long)((uint32_t)(esp_timer_get_time() / 1000) - survey.finished_ms));
+    for (int i = 0; i < SURVEY_CHANNELS && len < sizeof(body); i++) {
+        len += snprintf(body + len, sizeof(body) - len,
+                        "%s{\"channel\":%d,\"score\":%lu,\"bss\":%u,\"strongest\":%d}",
+                        i ? "," : "", i + 1, (unsigned long)survey.score[i], survey.bss[i], survey.strongest[i]);
+    }
+    if (len < sizeof(body)) {
+        len += snprintf(body + len, sizeof(body) - len, "]}");
+    }
+    return httpd_resp_send(req, body, len < sizeof(body) ? len : sizeof(body) - 1);
+}
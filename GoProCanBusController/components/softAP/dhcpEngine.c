@@ -0,0 +1,372 @@
+#include <string.h>
+#include "dhcpEngine.h"
+
+// BOOTP header, RFC 2131 section 2
+#define BOOTP_OP                0
+#define BOOTP_HTYPE             1
+#define BOOTP_HLEN              2
+#define BOOTP_XID               4
+#define BOOTP_FLAGS             10
+#define BOOTP_CIADDR            12
+#define BOOTP_YIADDR            16
+#define BOOTP_GIADDR            24
+#define BOOTP_CHADDR            28
+#define BOOTP_CHADDR_LEN        16
+#define BOOTP_COOKIE            236
+#define BOOTP_OPTIONS           240
+
+#define BOOTP_REQUEST           1
+#define BOOTP_REPLY             2
+#define HTYPE_ETHERNET          1
+
+static const uint8_t magic_cookie[4] = {99, 130, 83, 99};
+
+// Options, RFC 2132
+#define OPT_PAD                 0
+#define OPT_SUBNET_MASK         1
+#define OPT_ROUTER              3
+#define OPT_REQUESTED_IP        50
+#define OPT_LEASE_TIME          51
+#define OPT_MESSAGE_TYPE        53
+#define OPT_SERVER_ID           54
+#define OPT_RENEWAL_TIME        58
+#define OPT_REBINDING_TIME      59
+#define OPT_END                 255
+
+enum {
+    DHCPDISCOVER = 1,
+    DHCPOFFER,
+    DHCPREQUEST,
+    DHCPDECLINE,
+    DHCPACK,
+    DHCPNAK,
+    DHCPRELEASE,
+};
+
+// The options of a request that decide its answer, addresses 0 if absent
+typedef struct {
+    uint8_t type;
+    uint32_t requested_ip;
+    uint32_t server_id;
+} dhcp_options_t;
+
+static uint32_t host_order(uint32_t ip)
+{
+    const uint8_t *octet = (const uint8_t *)&ip;
+    return (uint32_t)octet[0] << 24 | octet[1] << 16 | octet[2] << 8 | octet[3];
+}
+
+static uint32_t net_order(uint32_t host)
+{
+    uint8_t octet[4] = {host >> 24, host >> 16, host >> 8, host};
+    uint32_t ip;
+    memcpy(&ip, octet, sizeof(ip));
+    return ip;
+}
+
+static uint32_t read_ip(const uint8_t *p)
+{
+    uint32_t ip;
+    memcpy(&ip, p, sizeof(ip));
+    return ip;
+}
+
+static bool parse_options(const uint8_t *msg, size_t len, dhcp_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    size_t i = BOOTP_OPTIONS;
+    while (i < len && msg[i] != OPT_END) {
+        if (msg[i] == OPT_PAD) {
+            i++;
+            continue;
+        }
+        if (i + 2 > len || i + 2 + msg[i + 1] > len) {
+            return false;
+        }
+        uint8_t code = msg[i];
+        uint8_t size = msg[i + 1];
+        const uint8_t *value = &msg[i + 2];
+        if (code == OPT_MESSAGE_TYPE && size == 1) {
+            options->type = value[0];
+        } else if (code == OPT_REQUESTED_IP && size == 4) {
+            options->requested_ip = read_ip(value);
+        } else if (code == OPT_SERVER_ID && size == 4) {
+            options->server_id = read_ip(value);
+        }
+        i += 2 + size;
+    }
+    return options->type != 0;
+}
+
+static bool lease_live(const dhcp_lease_t *lease, uint32_t now_ms)
+{
+    return lease->state != DHCP_LEASE_FREE && (int32_t)(lease->expires_ms - now_ms) > 0;
+}
+
+static const dhcp_reservation_t *reservation_of_mac(const dhcp_engine_t *engine, const uint8_t *mac)
+{
+    for (int i = 0; i < engine->reserved_count; i++) {
+        if (memcmp(engine->reserved[i].mac, mac, DHCP_MAC_LEN) == 0) {
+            return &engine->reserved[i];
+        }
+    }
+    return NULL;
+}
+
+static bool is_reserved(const dhcp_engine_t *engine, uint32_t ip)
+{
+    for (int i = 0; i < engine->reserved_count; i++) {
+        if (engine->reserved[i].ip == ip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static dhcp_lease_t *lease_of_mac(dhcp_engine_t *engine, const uint8_t *mac, uint32_t now_ms)
+{
+    for (int i = 0; i < DHCP_MAX_LEASES; i++) {
+        dhcp_lease_t *lease = &engine->leases[i];
+        if (lease->state != DHCP_LEASE_DECLINED && lease_live(lease, now_ms) &&
+            memcmp(lease->mac, mac, DHCP_MAC_LEN) == 0) {
+            return lease;
+        }
+    }
+    return NULL;
+}
+
+// Held by another station, or declined
+static bool ip_taken(const dhcp_engine_t *engine, uint32_t ip, const uint8_t *mac, uint32_t now_ms)
+{
+    for (int i = 0; i < DHCP_MAX_LEASES; i++) {
+        const dhcp_lease_t *lease = &engine->leases[i];
+        if (lease->ip == ip && lease_live(lease, now_ms) &&
+            (lease->state == DHCP_LEASE_DECLINED || memcmp(lease->mac, mac, DHCP_MAC_LEN) != 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool pool_free(const dhcp_engine_t *engine, uint32_t ip, const uint8_t *mac, uint32_t now_ms)
+{
+    uint32_t host = host_order(ip);
+    return host >= engine->pool_first && host <= engine->pool_last && ip != engine->config.ip &&
+           !is_reserved(engine, ip) && !ip_taken(engine, ip, mac, now_ms);
+}
+
+// The reservation, the address the station holds, the one it asks for if
+// that is free, or the first free one of the pool; 0 if the pool is full
+static uint32_t address_for(dhcp_engine_t *engine, const uint8_t *mac, uint32_t requested, uint32_t now_ms)
+{
+    const dhcp_reservation_t *reservation = reservation_of_mac(engine, mac);
+    if (reservation != NULL) {
+        return reservation->ip;
+    }
+    const dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+    if (lease != NULL) {
+        return lease->ip;
+    }
+    if (requested != 0 && pool_free(engine, requested, mac, now_ms)) {
+        return requested;
+    }
+    for (uint32_t host = engine->pool_first; host <= engine->pool_last; host++) {
+        if (pool_free(engine, net_order(host), mac, now_ms)) {
+            return net_order(host);
+        }
+    }
+    return 0;
+}
+
+static bool lease_store(dhcp_engine_t *engine, const uint8_t *mac, uint32_t ip, dhcp_lease_state_t state,
+                        uint32_t expires_ms, uint32_t now_ms)
+{
+    dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+    for (int i = 0; lease == NULL && i < DHCP_MAX_LEASES; i++) {
+        if (!lease_live(&engine->leases[i], now_ms)) {
+            lease = &engine->leases[i];
+        }
+    }
+    if (lease == NULL) {
+        return false;
+    }
+    memcpy(lease->mac, mac, DHCP_MAC_LEN);
+    lease->ip = ip;
+    lease->state = state;
+    lease->expires_ms = expires_ms;
+    return true;
+}
+
+static uint8_t *put_option(uint8_t *p, uint8_t code, const void *value, uint8_t size)
+{
+    p[0] = code;
+    p[1] = size;
+    memcpy(&p[2], value, size);
+    return p + 2 + size;
+}
+
+static uint8_t *put_seconds(uint8_t *p, uint8_t code, uint32_t seconds)
+{
+    uint32_t value = net_order(seconds);
+    return put_option(p, code, &value, sizeof(value));
+}
+
+static size_t build_reply(const dhcp_engine_t *engine, const uint8_t *msg, uint8_t type, uint32_t yiaddr,
+                          uint8_t *reply)
+{
+    memset(reply, 0, DHCP_REPLY_LEN);
+    reply[BOOTP_OP] = BOOTP_REPLY;
+    reply[BOOTP_HTYPE] = HTYPE_ETHERNET;
+    reply[BOOTP_HLEN] = DHCP_MAC_LEN;
+    memcpy(&reply[BOOTP_XID], &msg[BOOTP_XID], 4);
+    memcpy(&reply[BOOTP_FLAGS], &msg[BOOTP_FLAGS], 2);
+    if (type == DHCPACK) {
+        memcpy(&reply[BOOTP_CIADDR], &msg[BOOTP_CIADDR], 4);
+    }
+    memcpy(&reply[BOOTP_YIADDR], &yiaddr, 4);
+    memcpy(&reply[BOOTP_GIADDR], &msg[BOOTP_GIADDR], 4);
+    memcpy(&reply[BOOTP_CHADDR], &msg[BOOTP_CHADDR], BOOTP_CHADDR_LEN);
+    memcpy(&reply[BOOTP_COOKIE], magic_cookie, sizeof(magic_cookie));
+
+    const dhcp_config_t *config = &engine->config;
+    uint8_t *p = &reply[BOOTP_OPTIONS];
+    p = put_option(p, OPT_MESSAGE_TYPE, &type, 1);
+    p = put_option(p, OPT_SERVER_ID, &config->ip, 4);
+    if (type != DHCPNAK) {
+        p = put_seconds(p, OPT_LEASE_TIME, config->lease_s);
+        p = put_seconds(p, OPT_RENEWAL_TIME, config->lease_s / 2);
+        p = put_seconds(p, OPT_REBINDING_TIME, config->lease_s / 8 * 7);
+        p = put_option(p, OPT_SUBNET_MASK, &config->netmask, 4);
+        if (config->gateway != 0) {
+            p = put_option(p, OPT_ROUTER, &config->gateway, 4);
+        }
+    }
+    *p = OPT_END;
+    return DHCP_REPLY_LEN;
+}
+
+void dhcp_engine_init(dhcp_engine_t *engine, const dhcp_config_t *config)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->config = *config;
+
+    uint32_t host = host_order(config->ip);
+    uint32_t mask = host_order(config->netmask);
+    uint32_t network = host & mask;
+    uint32_t broadcast = network | ~mask;
+    // Past the server's address, or from the bottom if it sits at the top
+    engine->pool_first = host + 1 < broadcast ? host + 1 : network + 1;
+    engine->pool_last = engine->pool_first + DHCP_POOL_SIZE - 1;
+    if (engine->pool_last >= broadcast || engine->pool_last < engine->pool_first) {
+        engine->pool_last = broadcast - 1;
+    }
+}
+
+int dhcp_engine_reserve(dhcp_engine_t *engine, const dhcp_reservation_t *reservations, int count)
+{
+    uint32_t mask = host_order(engine->config.netmask);
+    uint32_t network = host_order(engine->config.ip) & mask;
+
+    engine->reserved_count = 0;
+    for (int i = 0; i < count && engine->reserved_count < DHCP_MAX_RESERVATIONS; i++) {
+        const dhcp_reservation_t *entry = &reservations[i];
+        uint32_t host = host_order(entry->ip);
+        if ((host & mask) != network || host == network || host == (network | ~mask) ||
+            entry->ip == engine->config.ip || reservation_of_mac(engine, entry->mac) != NULL ||
+            is_reserved(engine, entry->ip)) {
+            continue;
+        }
+        engine->reserved[engine->reserved_count++] = *entry;
+    }
+
+    // A station holding another's reserved address, or a reserved station
+    // holding some other address, is told no on its next renewal
+    for (int i = 0; i < DHCP_MAX_LEASES; i++) {
+        dhcp_lease_t *lease = &engine->leases[i];
+        if (lease->state == DHCP_LEASE_FREE || lease->state == DHCP_LEASE_DECLINED) {
+            continue;
+        }
+        const dhcp_reservation_t *own = reservation_of_mac(engine, lease->mac);
+        if (own != NULL ? own->ip != lease->ip : is_reserved(engine, lease->ip)) {
+            lease->state = DHCP_LEASE_FREE;
+        }
+    }
+    return engine->reserved_count;
+}
+
+size_t dhcp_engine_handle(dhcp_engine_t *engine, const uint8_t *msg, size_t len, uint32_t now_ms,
+                          uint8_t *reply, dhcp_event_t *event)
+{
+    memset(event, 0, sizeof(*event));
+    dhcp_options_t options;
+    if (len < BOOTP_OPTIONS || msg[BOOTP_OP] != BOOTP_REQUEST || msg[BOOTP_HTYPE] != HTYPE_ETHERNET ||
+        msg[BOOTP_HLEN] != DHCP_MAC_LEN || memcmp(&msg[BOOTP_COOKIE], magic_cookie, sizeof(magic_cookie)) != 0 ||
+        !parse_options(msg, len, &options)) {
+        return 0;
+    }
+    const uint8_t *mac = &msg[BOOTP_CHADDR];
+    uint32_t ciaddr = read_ip(&msg[BOOTP_CIADDR]);
+    bool ours = options.server_id == 0 || options.server_id == engine->config.ip;
+    memcpy(event->mac, mac, DHCP_MAC_LEN);
+
+    switch (options.type) {
+    case DHCPDISCOVER: {
+        uint32_t ip = address_for(engine, mac, options.requested_ip, now_ms);
+        dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+        if (ip == 0) {
+            return 0;
+        }
+        // A bound station asking again keeps its lease as it is
+        if (lease == NULL || lease->ip != ip || lease->state != DHCP_LEASE_BOUND) {
+            if (!lease_store(engine, mac, ip, DHCP_LEASE_OFFERED, now_ms + DHCP_OFFER_HOLD_MS, now_ms)) {
+                return 0;
+            }
+        }
+        return build_reply(engine, msg, DHCPOFFER, ip, reply);
+    }
+    case DHCPREQUEST: {
+        if (!ours) {
+            // Took another server's offer, ours is free again
+            dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+            if (lease != NULL && lease->state == DHCP_LEASE_OFFERED) {
+                lease->state = DHCP_LEASE_FREE;
+            }
+            return 0;
+        }
+        uint32_t requested = options.requested_ip != 0 ? options.requested_ip : ciaddr;
+        if (requested == 0) {
+            return 0;
+        }
+        // Anything else, e.g. a pool address a reserved camera held before,
+        // is refused so the station starts over and is offered the right one
+        if (address_for(engine, mac, requested, now_ms) != requested ||
+            !lease_store(engine, mac, requested, DHCP_LEASE_BOUND, now_ms + engine->config.lease_s * 1000, now_ms)) {
+            return build_reply(engine, msg, DHCPNAK, 0, reply);
+        }
+        event->type = DHCP_EVENT_BOUND;
+        event->ip = requested;
+        event->reply_to = ciaddr;
+        return build_reply(engine, msg, DHCPACK, requested, reply);
+    }
+    case DHCPDECLINE: {
+        dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+        if (ours && lease != NULL && lease->ip == options.requested_ip) {
+            memset(lease->mac, 0, DHCP_MAC_LEN);
+            lease->state = DHCP_LEASE_DECLINED;
+            lease->expires_ms = now_ms + engine->config.lease_s * 1000;
+        }
+        return 0;
+    }
+    case DHCPRELEASE: {
+        dhcp_lease_t *lease = lease_of_mac(engine, mac, now_ms);
+        if (ours && lease != NULL && lease->ip == ciaddr) {
+            lease->state = DHCP_LEASE_FREE;
+            event->type = DHCP_EVENT_RELEASED;
+            event->ip = ciaddr;
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+#include "esp_log.h"
+#include "persist.h"
+#include "lwip/inet.h"
+#include "stationTable.h"
+#include "dhcpServer.h"
+#include "dhcpReservations.h"
+
+static const char *TAG = "dhcp_reservations";
+
+// Bytes of JSON per reservation in the GET response
+#define RESERVATION_JSON_LEN   64
+
+// Payload of the persisted record, reservation n is camera slot n
+typedef struct {
+    uint8_t count;
+    station_reservation_t entries[STATION_TABLE_MAX];
+} reservation_table_t;
+
+static void reservations_snapshot(void *buf, void *ctx)
+{
+    reservation_table_t *table = buf;
+    memset(table, 0, sizeof(*table));
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        station_t station;
+        if (!station_table_get(i, &station) || station.reserved_ip == 0) {
+            break;
+        }
+        memcpy(table->entries[i].mac, station.mac, STATION_MAC_LEN);
+        table->entries[i].ip = station.reserved_ip;
+        table->count++;
+    }
+}
+
+static const persist_record_t reservations_record = {
+    .key = "dhcp_resv",
+    .version = 1,
+    .size = sizeof(reservation_table_t),
+    .snapshot = reservations_snapshot,
+};
+
+static persist_id_t reservations_id = -1;
+
+void dhcp_reservations_load(void)
+{
+    reservations_id = persist_register(&reservations_record);
+
+    reservation_table_t table;
+    esp_err_t err = persist_load(reservations_id, &table);
+    if (err != ESP_OK) {
+        return;
+    }
+    if (table.count > STATION_TABLE_MAX || !station_table_reserve(table.entries, table.count)) {
+        ESP_LOGE(TAG, "Ignoring invalid stored reservations");
+        return;
+    }
+
+    ESP_LOGI(TAG, "%d reservations loaded", table.count);
+}
+
+static esp_err_t reservations_send(httpd_req_t *req)
+{
+    char body[16 + STATION_TABLE_MAX * RESERVATION_JSON_LEN];
+    size_t len = snprintf(body, sizeof(body), "{\"reservations\":[");
+    bool first = true;
+    for (int i = 0; i < STATION_TABLE_MAX && len < sizeof(body); i++) {
+        station_t station;
+        if (!station_table_get(i, &station) || station.reserved_ip == 0) {
+            continue;
+        }
+        const uint8_t *ip = (const uint8_t *)&station.reserved_ip;
+        len += snprintf(body + len, sizeof(body) - len,
+                        "%s{\"camera\":%d,\"mac\":\"" MACSTR "\",\"ip\":\"%u.%u.%u.%u\"}",
+                        first ? "" : ",", i, MAC2STR(station.mac), ip[0], ip[1], ip[2], ip[3]);
+        first = false;
+    }
+    if (len < sizeof(body)) {
+        len += snprintf(body + len, sizeof(body) - len, "]}");
+    }
+    return httpd_resp_send(req, body, len < sizeof(body) ? len : sizeof(body) - 1);
+}
+
+esp_err_t dhcp_reservations_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        return reservations_send(req);
+    }
+
+    // Cameras from slot 0 up to the first one without an address keep the
+    // address and slot they hold now
+    station_reservation_t reservations[STATION_TABLE_MAX];
+    int count = 0;
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        station_t station;
+        if (!station_table_get(i, &station) || station.ip == 0) {
+            break;
+        }
+        memcpy(reservations[count].mac, station.mac, STATION_MAC_LEN);
+        reservations[count].ip = station.ip;
+        count++;
+    }
+    if (count == 0) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "{\"error\":\"no camera holds an address\"}", HTTPD_RESP_USE_STRLEN);
+    }
+
+    if (!station_table_reserve(reservations, count)) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Invalid reservations");
+    }
+    dhcp_server_reserve();
+    // Written by the persistence task, the request does not wait for flash
+    persist_mark_dirty(reservations_id);
+    ESP_LOGI(TAG, "%d reservations queued for saving", count);
+    return reservations_send(req);
+}
@@ -0,0 +1,158 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_mac.h"
+#include "lwip/sockets.h"
+#include "metrics.h"
+#include "stationTable.h"
+#include "dhcpEngine.h"
+#include "dhcpServer.h"
+
+static const char *TAG = "dhcp_server";
+
+// Largest message a client must accept, RFC 2131 section 2
+#define DHCP_MSG_MAX 576
+
+static dhcp_engine_t engine;
+static SemaphoreHandle_t engine_lock;
+static esp_netif_t *server_netif;
+static uint8_t msg[DHCP_MSG_MAX];
+static uint8_t reply[DHCP_REPLY_LEN];
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Called with engine_lock held
+static void reserve_from_station_table(void)
+{
+    dhcp_reservation_t reservations[STATION_TABLE_MAX];
+    int count = 0;
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        station_t station;
+        if (station_table_get(i, &station) && station.reserved_ip != 0) {
+            memcpy(reservations[count].mac, station.mac, DHCP_MAC_LEN);
+            reservations[count].ip = station.reserved_ip;
+            count++;
+        }
+    }
+    int taken = dhcp_engine_reserve(&engine, reservations, count);
+    if (taken < count) {
+        ESP_LOGW(TAG, "%d reservations are not on the access point's network, those cameras get pool addresses",
+                 count - taken);
+    }
+}
+
+static void configure(const esp_netif_ip_info_t *ip_info, uint32_t lease_s)
+{
+    dhcp_config_t config = {
+        .ip = ip_info->ip.addr,
+        .netmask = ip_info->netmask.addr,
+        .gateway = ip_info->gw.addr,
+        .lease_s = lease_s,
+    };
+    dhcp_engine_init(&engine, &config);
+    reserve_from_station_table();
+}
+
+// The access point is the only interface, so replies broadcast on it
+static int server_open(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return -1;
+    }
+    int enable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) < 0) {
+        ESP_LOGE(TAG, "Enabling broadcast failed: errno %d", errno);
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(DHCP_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static void dhcp_server_task(void *arg)
+{
+    int sock = server_open();
+    if (sock < 0) {
+        vTaskDelete(NULL);
+    }
+
+    while (1) {
+        int len = recvfrom(sock, msg, sizeof(msg), 0, NULL, NULL);
+        if (len < 0) {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        dhcp_event_t event;
+        xSemaphoreTake(engine_lock, portMAX_DELAY);
+        size_t reply_len = dhcp_engine_handle(&engine, msg, len, now_ms(), reply, &event);
+        xSemaphoreGive(engine_lock);
+
+        // A station without an address yet only hears a broadcast
+        if (reply_len > 0) {
+            struct sockaddr_in to = {
+                .sin_family = AF_INET,
+                .sin_port = htons(DHCP_CLIENT_PORT),
+                .sin_addr.s_addr = event.reply_to != 0 ? event.reply_to : htonl(INADDR_BROADCAST),
+            };
+            if (sendto(sock, reply, reply_len, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+                ESP_LOGW(TAG, "Reply to " MACSTR " failed: errno %d", MAC2STR(event.mac), errno);
+            }
+        }
+        if (event.type == DHCP_EVENT_BOUND) {
+            ip_event_ap_staipassigned_t assigned = {.esp_netif = server_netif, .ip.addr = event.ip};
+            memcpy(assigned.mac, event.mac, DHCP_MAC_LEN);
+            esp_event_post(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &assigned, sizeof(assigned), 0);
+        }
+    }
+}
+
+void dhcp_server_start(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info, uint32_t lease_s)
+{
+    engine_lock = xSemaphoreCreateMutex();
+    server_netif = netif;
+    configure(ip_info, lease_s);
+
+    TaskHandle_t task;
+    if (xTaskCreate(dhcp_server_task, "dhcp_server", 3072, NULL, 5, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+    ESP_LOGI(TAG, "Serving " IPSTR " with %d reservations", IP2STR(&ip_info->ip), engine.reserved_count);
+}
+
+void dhcp_server_configure(const esp_netif_ip_info_t *ip_info)
+{
+    if (engine_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    configure(ip_info, engine.config.lease_s);
+    xSemaphoreGive(engine_lock);
+}
+
+void dhcp_server_reserve(void)
+{
+    if (engine_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    reserve_from_station_table();
+    xSemaphoreGive(engine_lock);
+}
@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "dhcpEngine.h"
+
+#define LEASE_S 7200
+
+// Message types and options the tests put in or look for
+#define DISCOVER    1
+#define OFFER       2
+#define REQUEST     3
+#define DECLINE     4
+#define ACK         5
+#define NAK         6
+#define RELEASE     7
+
+#define OPT_REQUESTED_IP    50
+#define OPT_MESSAGE_TYPE    53
+#define OPT_SERVER_ID       54
+
+static const uint8_t mac_a[DHCP_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x01};
+static const uint8_t mac_b[DHCP_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x02};
+static const uint8_t mac_c[DHCP_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x03};
+
+static dhcp_engine_t engine;
+static uint8_t reply[DHCP_REPLY_LEN];
+static dhcp_event_t event;
+
+// IPv4 in network byte order, as lwIP keeps it
+static uint32_t ip4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    uint8_t octets[4] = {a, b, c, d};
+    uint32_t ip;
+    memcpy(&ip, octets, sizeof(ip));
+    return ip;
+}
+
+static void configure(uint32_t ip, uint32_t netmask)
+{
+    dhcp_config_t config = {.ip = ip, .netmask = netmask, .gateway = ip, .lease_s = LEASE_S};
+    dhcp_engine_init(&engine, &config);
+}
+
+// Sends one client message, addresses 0 are left out. Returns the reply's
+// message type, 0 if there was none.
+static int client_send(int type, const uint8_t *mac, uint32_t ciaddr, uint32_t requested, uint32_t server_id,
+                       uint32_t now_ms)
+{
+    uint8_t msg[300] = {1, 1, DHCP_MAC_LEN};
+    memcpy(&msg[4], "\x12\x34\x56\x78", 4);
+    memcpy(&msg[12], &ciaddr, 4);
+    memcpy(&msg[28], mac, DHCP_MAC_LEN);
+    memcpy(&msg[236], "\x63\x82\x53\x63", 4);
+    uint8_t *p = &msg[240];
+    *p++ = OPT_MESSAGE_TYPE;
+    *p++ = 1;
+    *p++ = type;
+    if (requested != 0) {
+        *p++ = OPT_REQUESTED_IP;
+        *p++ = 4;
+        memcpy(p, &requested, 4);
+        p += 4;
+    }
+    if (server_id != 0) {
+        *p++ = OPT_SERVER_ID;
+        *p++ = 4;
+        memcpy(p, &server_id, 4);
+        p += 4;
+    }
+    *p++ = 255;
+
+    memset(reply, 0, sizeof(reply));
+    if (dhcp_engine_handle(&engine, msg, p - msg, now_ms, reply, &event) == 0) {
+        return 0;
+    }
+    TEST_ASSERT_EQUAL_UINT8(2, reply[0]);
+    TEST_ASSERT_EQUAL_MEMORY(&msg[4], &reply[4], 4);
+    TEST_ASSERT_EQUAL_MEMORY(mac, &reply[28], DHCP_MAC_LEN);
+    TEST_ASSERT_EQUAL_UINT8(OPT_MESSAGE_TYPE, reply[240]);
+    return reply[242];
+}
+
+static uint32_t yiaddr(void)
+{
+    uint32_t ip;
+    memcpy(&ip, &reply[16], sizeof(ip));
+    return ip;
+}
+
+// DISCOVER then REQUEST of what was offered, returns the bound address
+static uint32_t join(const uint8_t *mac, uint32_t now_ms)
+{
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac, 0, 0, 0, now_ms));
+    uint32_t offered = yiaddr();
+    TEST_ASSERT_EQUAL_INT(ACK, client_send(REQUEST, mac, 0, offered, engine.config.ip, now_ms));
+    TEST_ASSERT_EQUAL_INT(DHCP_EVENT_BOUND, event.type);
+    TEST_ASSERT_EQUAL_HEX32(offered, event.ip);
+    return offered;
+}
+
+static dhcp_reservation_t reservation(const uint8_t *mac, uint32_t ip)
+{
+    dhcp_reservation_t entry = {.ip = ip};
+    memcpy(entry.mac, mac, DHCP_MAC_LEN);
+    return entry;
+}
+
+void setUp(void)
+{
+    configure(ip4(10, 71, 79, 1), ip4(255, 255, 255, 0));
+}
+
+void tearDown(void)
+{
+}
+
+static void test_pool_follows_the_server_address(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 2), join(mac_a, 0));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 3), join(mac_b, 0));
+
+    configure(ip4(192, 168, 4, 1), ip4(255, 255, 255, 0));
+    TEST_ASSERT_EQUAL_HEX32(ip4(192, 168, 4, 2), join(mac_a, 0));
+}
+
+static void test_reserved_mac_gets_its_address(void)
+{
+    dhcp_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 40))};
+    TEST_ASSERT_EQUAL_INT(1, dhcp_engine_reserve(&engine, table, 1));
+
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac_a, 0, ip4(10, 71, 79, 2), 0, 0));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 40), yiaddr());
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 40), join(mac_a, 0));
+}
+
+static void test_reserved_address_never_handed_out(void)
+{
+    dhcp_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 2))};
+    dhcp_engine_reserve(&engine, table, 1);
+
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 3), join(mac_b, 0));
+
+    // Not even when asked for by name
+    TEST_ASSERT_EQUAL_INT(NAK, client_send(REQUEST, mac_b, 0, ip4(10, 71, 79, 2), 0, 0));
+    TEST_ASSERT_EQUAL_INT(DHCP_EVENT_NONE, event.type);
+}
+
+static void test_old_address_of_a_reserved_camera_is_refused(void)
+{
+    // The camera rebooting with the pool address it had before the reservation
+    dhcp_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 40))};
+    dhcp_engine_reserve(&engine, table, 1);
+
+    TEST_ASSERT_EQUAL_INT(NAK, client_send(REQUEST, mac_a, 0, ip4(10, 71, 79, 2), 0, 0));
+    TEST_ASSERT_EQUAL_HEX32(0, event.reply_to);
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 40), join(mac_a, 0));
+}
+
+static void test_reservation_replaces_a_conflicting_lease(void)
+{
+    uint32_t held = join(mac_b, 0);
+    dhcp_reservation_t table[] = {reservation(mac_a, held)};
+    dhcp_engine_reserve(&engine, table, 1);
+
+    // The stranger's renewal is refused, it starts over elsewhere
+    TEST_ASSERT_EQUAL_INT(NAK, client_send(REQUEST, mac_b, held, 0, 0, 1000));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 3), join(mac_b, 1000));
+    TEST_ASSERT_EQUAL_HEX32(held, join(mac_a, 1000));
+}
+
+static void test_reservations_off_the_network_are_skipped(void)
+{
+    dhcp_reservation_t table[] = {
+        reservation(mac_a, ip4(192, 168, 4, 7)),
+        reservation(mac_b, ip4(10, 71, 79, 255)),
+    };
+    TEST_ASSERT_EQUAL_INT(0, dhcp_engine_reserve(&engine, table, 2));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 2), join(mac_a, 0));
+
+    table[1] = reservation(mac_a, ip4(10, 71, 79, 1));
+    TEST_ASSERT_EQUAL_INT(0, dhcp_engine_reserve(&engine, &table[1], 1));
+
+    // A repeated MAC keeps its first entry only
+    dhcp_reservation_t twice[] = {
+        reservation(mac_b, ip4(10, 71, 79, 20)),
+        reservation(mac_b, ip4(10, 71, 79, 21)),
+    };
+    TEST_ASSERT_EQUAL_INT(1, dhcp_engine_reserve(&engine, twice, 2));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 20), join(mac_b, 0));
+}
+
+static void test_renewal_is_acked_to_the_client(void)
+{
+    uint32_t ip = join(mac_a, 0);
+    TEST_ASSERT_EQUAL_INT(ACK, client_send(REQUEST, mac_a, ip, 0, 0, LEASE_S * 500));
+    TEST_ASSERT_EQUAL_INT(DHCP_EVENT_BOUND, event.type);
+    TEST_ASSERT_EQUAL_HEX32(ip, event.reply_to);
+
+    // A station asking again keeps what it has
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac_a, 0, 0, 0, LEASE_S * 500));
+    TEST_ASSERT_EQUAL_HEX32(ip, yiaddr());
+}
+
+static void test_offer_taken_elsewhere_is_freed(void)
+{
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac_a, 0, 0, 0, 0));
+    uint32_t offered = yiaddr();
+    TEST_ASSERT_EQUAL_INT(0, client_send(REQUEST, mac_a, 0, ip4(10, 0, 0, 9), ip4(10, 0, 0, 1), 0));
+    TEST_ASSERT_EQUAL_HEX32(offered, join(mac_b, 0));
+}
+
+static void test_unanswered_offer_expires(void)
+{
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac_a, 0, 0, 0, 0));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 3), join(mac_b, DHCP_OFFER_HOLD_MS - 1));
+    TEST_ASSERT_EQUAL_HEX32(ip4(10, 71, 79, 2), join(mac_c, DHCP_OFFER_HOLD_MS));
+}
+
+static void test_release_and_decline(void)
+{
+    uint32_t ip = join(mac_a, 0);
+    TEST_ASSERT_EQUAL_INT(0, client_send(RELEASE, mac_a, ip, 0, engine.config.ip, 10));
+    TEST_ASSERT_EQUAL_INT(DHCP_EVENT_RELEASED, event.type);
+    TEST_ASSERT_EQUAL_HEX32(ip, join(mac_b, 10));
+
+    // Someone answers on the address mac_a was given, it stays out of the pool
+    uint32_t declined = join(mac_a, 20);
+    TEST_ASSERT_EQUAL_INT(0, client_send(DECLINE, mac_a, 0, declined, engine.config.ip, 20));
+    TEST_ASSERT_EQUAL_INT(OFFER, client_send(DISCOVER, mac_a, 0, declined, 0, 30));
+    TEST_ASSERT_TRUE(yiaddr() != declined);
+}
+
+static void test_lease_expires(void)
+{
+    uint32_t ip = join(mac_a, 0);
+    TEST_ASSERT_EQUAL_INT(NAK, client_send(REQUEST, mac_b, 0, ip, 0, LEASE_S * 1000 - 1));
+    TEST_ASSERT_EQUAL_INT(ACK, client_send(REQUEST, mac_b, 0, ip, 0, LEASE_S * 1000));
+}
+
+static void test_full_pool_goes_unanswered(void)
+{
+    // A /28 leaves .2 to .14 after the server
+    configure(ip4(10, 0, 0, 1), ip4(255, 255, 255, 240));
+    uint8_t mac[DHCP_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x01, 0x00};
+    for (int i = 2; i <= 14; i++) {
+        mac[5] = i;
+        TEST_ASSERT_EQUAL_HEX32(ip4(10, 0, 0, i), join(mac, 0));
+    }
+    mac[5] = 15;
+    TEST_ASSERT_EQUAL_INT(0, client_send(DISCOVER, mac, 0, 0, 0, 0));
+}
+
+static void test_malformed_messages_are_ignored(void)
+{
+    uint8_t msg[300] = {1, 1, DHCP_MAC_LEN};
+    TEST_ASSERT_EQUAL_INT(0, dhcp_engine_handle(&engine, msg, sizeof(msg), 0, reply, &event));
+
+    // An option running past the end
+    memcpy(&msg[236], "\x63\x82\x53\x63", 4);
+    msg[240] = OPT_MESSAGE_TYPE;
+    msg[241] = 1;
+    msg[242] = DISCOVER;
+    msg[243] = OPT_REQUESTED_IP;
+    msg[244] = 200;
+    TEST_ASSERT_EQUAL_INT(0, dhcp_engine_handle(&engine, msg, 250, 0, reply, &event));
+    TEST_ASSERT_EQUAL_INT(0, dhcp_engine_handle(&engine, msg, 100, 0, reply, &event));
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pool_follows_the_server_address);
+    RUN_TEST(test_reserved_mac_gets_its_address);
+    RUN_TEST(test_reserved_address_never_handed_out);
+    RUN_TEST(test_old_address_of_a_reserved_camera_is_refused);
+    RUN_TEST(test_reservation_replaces_a_conflicting_lease);
+    RUN_TEST(test_reservations_off_the_network_are_skipped);
+    RUN_TEST(test_renewal_is_acked_to_the_client);
+    RUN_TEST(test_offer_taken_elsewhere_is_freed);
+    RUN_TEST(test_unanswered_offer_expires);
+    RUN_TEST(test_release_and_decline);
+    RUN_TEST(test_lease_expires);
+    RUN_TEST(test_full_pool_goes_unanswered);
+    RUN_TEST(test_malformed_messages_are_ignored);
+    exit(UNITY_END());
+}
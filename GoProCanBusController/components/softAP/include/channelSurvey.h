@@ -0,0 +1,46 @@
+#ifndef CHANNEL_SURVEY_H
+#define CHANNEL_SURVEY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#if CONFIG_IDF_TARGET_LINUX
+#include "wifiSim.h"
+#else
+#include <esp_wifi.h>
+#endif
+#include <esp_http_server.h>
+
+#define SURVEY_CHANNELS 13      // 2.4 GHz channels 1 to 13
+
+// Per-channel result of the last scan, index 0 is channel 1
+typedef struct {
+    uint32_t score[SURVEY_CHANNELS];    // Interference seen on the channel, lower is quieter
+    uint8_t bss[SURVEY_CHANNELS];       // Networks whose primary channel this is
+    int8_t strongest[SURVEY_CHANNELS];  // Loudest of them in dBm, -127 if none
+    uint8_t previous;                   // Channel before the survey
+    uint8_t chosen;                     // Channel after it
+    uint32_t finished_ms;               // 0 if no survey ran yet
+} channel_survey_t;
+
+// Called by wifi_init_softap before the first survey
+void channel_survey_init(void);
+
+// Scores every channel from a list of scanned networks. A network adds to
+// its own channel and, less, to the ones its 20 MHz signal overlaps.
+void channel_survey_score(const wifi_ap_record_t *records, int count, channel_survey_t *survey);
+
+// Scans, scores and moves the access point to the quietest channel if it
+// beats the current one by CONFIG_CHANNEL_SURVEY_MIN_GAIN percent. The move
+// goes through the configuration store, so the channel is saved and every
+// camera rejoins on it. Blocks for the duration of the scan.
+esp_err_t channel_survey_run(void);
+
+// Copies the last survey, false if none ran yet
+bool channel_survey_get(channel_survey_t *survey);
+
+// GET reports the last survey, POST runs a new one
+esp_err_t channel_survey_handler(httpd_req_t *req);
+
+#endif // CHANNEL_SURVEY_H
@@ -0,0 +1,93 @@
+#ifndef DHCP_ENGINE_H
+#define DHCP_ENGINE_H
+
+// Address assignment of the softAP's DHCP server. A reserved MAC always
+// gets its reserved address and nobody else ever does; other stations get
+// the first free address of the pool. Messages go in and replies come out
+// as buffers with the time passed in, so this builds and runs on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHCP_MAC_LEN            6
+#define DHCP_MAX_LEASES         16
+#define DHCP_MAX_RESERVATIONS   16
+
+// Addresses after the server's own that make up the pool, as ESP-IDF's
+// server hands out
+#define DHCP_POOL_SIZE          100
+
+// Smallest BOOTP message, replies are padded up to it
+#define DHCP_REPLY_LEN          300
+
+#define DHCP_SERVER_PORT        67
+#define DHCP_CLIENT_PORT        68
+
+// How long an offered address is held for the station's request
+#define DHCP_OFFER_HOLD_MS      10000
+
+typedef struct {
+    uint32_t ip;                // Server, all addresses in network byte order
+    uint32_t netmask;
+    uint32_t gateway;           // Router option, left out if 0
+    uint32_t lease_s;
+} dhcp_config_t;
+
+typedef struct {
+    uint8_t mac[DHCP_MAC_LEN];
+    uint32_t ip;
+} dhcp_reservation_t;
+
+typedef enum {
+    DHCP_LEASE_FREE,
+    DHCP_LEASE_OFFERED,
+    DHCP_LEASE_BOUND,
+    DHCP_LEASE_DECLINED,        // Someone else answers on it, kept out of the pool
+} dhcp_lease_state_t;
+
+typedef struct {
+    uint8_t mac[DHCP_MAC_LEN];
+    uint32_t ip;
+    dhcp_lease_state_t state;
+    uint32_t expires_ms;
+} dhcp_lease_t;
+
+typedef struct {
+    dhcp_config_t config;
+    uint32_t pool_first;        // Host byte order, inclusive
+    uint32_t pool_last;
+    dhcp_reservation_t reserved[DHCP_MAX_RESERVATIONS];
+    int reserved_count;
+    dhcp_lease_t leases[DHCP_MAX_LEASES];
+} dhcp_engine_t;
+
+typedef enum {
+    DHCP_EVENT_NONE,
+    DHCP_EVENT_BOUND,           // An ACK went out, also on every renewal
+    DHCP_EVENT_RELEASED,
+} dhcp_event_type_t;
+
+// What a handled message did, and where its reply goes
+typedef struct {
+    dhcp_event_type_t type;
+    uint8_t mac[DHCP_MAC_LEN];
+    uint32_t ip;
+    uint32_t reply_to;          // Client's address, 0 to broadcast the reply
+} dhcp_event_t;
+
+// Derives the pool from the server's address and mask, dropping every lease
+// and reservation. Also used when the network changes.
+void dhcp_engine_init(dhcp_engine_t *engine, const dhcp_config_t *config);
+
+// Replaces the reservations. Entries outside the subnet, on the server, the
+// network or the broadcast address, or repeating a MAC or address are
+// skipped; returns how many were taken. Leases that conflict are dropped.
+int dhcp_engine_reserve(dhcp_engine_t *engine, const dhcp_reservation_t *reservations, int count);
+
+// Handles one message from a client. Returns the length of the reply built
+// in reply (at least DHCP_REPLY_LEN bytes), 0 if there is none.
+size_t dhcp_engine_handle(dhcp_engine_t *engine, const uint8_t *msg, size_t len, uint32_t now_ms,
+                          uint8_t *reply, dhcp_event_t *event);
+
+#endif // DHCP_ENGINE_H
@@ -0,0 +1,16 @@
+#ifndef DHCP_RESERVATIONS_H
+#define DHCP_RESERVATIONS_H
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+// Reads the MAC to IP reservations back through the persistence service and
+// pins them in the station table, before the DHCP server starts
+void dhcp_reservations_load(void);
+
+// GET lists the reservations, POST reserves the address every camera holds now;
+// the DHCP server applies them at once, flash gets them after the persistence window
+esp_err_t dhcp_reservations_handler(httpd_req_t *req);
+
+#endif // DHCP_RESERVATIONS_H
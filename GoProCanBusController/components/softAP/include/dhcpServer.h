@@ -0,0 +1,23 @@
+#ifndef DHCP_SERVER_H
+#define DHCP_SERVER_H
+
+// DHCP server of the access point, in place of ESP-IDF's, which cannot pin
+// an address to a MAC. Reserved cameras get their address from the station
+// table's reservations; each ACK is posted as IP_EVENT_AP_STAIPASSIGNED,
+// the event ESP-IDF's server raises.
+
+#include <stdint.h>
+#include "esp_netif.h"
+
+// Starts answering on the access point's interface, whose own DHCP server
+// must be stopped. The pool follows ip_info.
+void dhcp_server_start(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info, uint32_t lease_s);
+
+// The access point moved to another network: the pool follows it, leases
+// are dropped and the reservations that still fit are applied again
+void dhcp_server_configure(const esp_netif_ip_info_t *ip_info);
+
+// Applies the station table's reservations again after they changed
+void dhcp_server_reserve(void);
+
+#endif // DHCP_SERVER_H
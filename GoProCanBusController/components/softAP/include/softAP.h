@@ -8,7 +8,6 @@
 #include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_mac.h"
-#include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "esp_log.h"
@@ -18,6 +17,13 @@
 #include "nvs_flash.h"
 #include "esp_types.h"
 
+// The linux target has no Wi-Fi driver, an in-process access point stands in
+#if CONFIG_IDF_TARGET_LINUX
+#include "wifiSim.h"
+#else
+#include "esp_wifi.h"
+#endif
+
 #include "lwip/netdb.h"
 #include "lwip/etharp.h"
 #include "lwip/sockets.h"
@@ -1,30 +1,150 @@
 #include "softAP.h"
 #include "esp_http_client.h"
+#include "esp_timer.h"
+#include "stationTable.h"
+#include "dhcpReservations.h"
+#include "dhcpServer.h"
+#include "persist.h"
+#include "metrics.h"
+#include "configStore.h"
+#include "channelSurvey.h"
+#include "timerWheel.h"
 
 // Static variables if needed
 static const char *TAG = "softAP";
 static esp_netif_t *ap_netif = NULL;
 
+// How often leases that were not renewed are dropped from the station table
+#define LEASE_CHECK_PERIOD_MS (10 * 1000)
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Which MAC owns which camera slot survives a reboot, so cameras keep their numbers
+static void cameras_snapshot(void *buf, void *ctx) {
+    station_table_save_slots(buf);
+}
+
+static const persist_record_t cameras_record = {
+    .key = "cameras",
+    .version = 1,
+    .size = sizeof(station_slots_t),
+    .snapshot = cameras_snapshot,
+};
+
+static persist_id_t cameras_id = -1;
+
+// Marks the slot table dirty on every bind, the service skips the write
+// when no camera changed slots
+static void station_bound(int camera, const station_t *station, bool bound) {
+    if (bound) {
+        persist_mark_dirty(cameras_id);
+    }
+}
 
 // Event handler implementations
 void wifi_event_handler(void* arg, esp_event_base_t event_base,
                         int32_t event_id, void* event_data) {
-    // Handle Wi-Fi events here
+    int64_t start = esp_timer_get_time();
+    if (event_id == WIFI_EVENT_AP_STACONNECTED) {
+        wifi_event_ap_staconnected_t *event = event_data;
+        int camera = station_table_connected(event->mac, event->aid, now_ms());
+        ESP_LOGI(TAG, "station " MACSTR " join, AID=%d, camera %d", MAC2STR(event->mac), event->aid, camera);
+    } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        wifi_event_ap_stadisconnected_t *event = event_data;
+        int camera = station_table_disconnected(event->mac);
+        ESP_LOGI(TAG, "station " MACSTR " leave, AID=%d, camera %d", MAC2STR(event->mac), event->aid, camera);
+    }
+    metrics_observe(METRIC_EVENT_HANDLER_LATENCY, esp_timer_get_time() - start);
 }
 void dhcp_event_handler(void* arg, esp_event_base_t event_base,
                         int32_t event_id, void* event_data) {
-    // Handle DHCP events here
+    // Runs on the DHCP ACK, subscribers can reach the camera from here on
+    int64_t start = esp_timer_get_time();
+    if (event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        ip_event_ap_staipassigned_t *event = event_data;
+        int camera = station_table_ip_assigned(event->mac, event->ip.addr, now_ms());
+        ESP_LOGI(TAG, "station " MACSTR " assigned " IPSTR ", camera %d",
+                 MAC2STR(event->mac), IP2STR(&event->ip), camera);
+        // Bound where the server put it all the same, so it stays reachable
+        station_t station;
+        if (station_table_get(camera, &station) && station.reserved_ip != 0 &&
+            station.reserved_ip != event->ip.addr) {
+            const uint8_t *reserved = (const uint8_t *)&station.reserved_ip;
+            ESP_LOGW(TAG, "camera %d holds " IPSTR " instead of its reserved %u.%u.%u.%u", camera,
+                     IP2STR(&event->ip), reserved[0], reserved[1], reserved[2], reserved[3]);
+        }
+    }
+    metrics_observe(METRIC_EVENT_HANDLER_LATENCY, esp_timer_get_time() - start);
+}
+
+static timer_node_t lease_timer;
+
+static void lease_check(timer_node_t *node, void *arg) {
+    station_table_expire(now_ms());
+}
+
+static void ap_config_from(const runtime_config_t *config, wifi_config_t *wifi_config) {
+    memset(wifi_config, 0, sizeof(*wifi_config));
+    strlcpy((char *)wifi_config->ap.ssid, config->ssid, sizeof(wifi_config->ap.ssid));
+    wifi_config->ap.ssid_len = strlen(config->ssid);
+    strlcpy((char *)wifi_config->ap.password, config->password, sizeof(wifi_config->ap.password));
+    wifi_config->ap.channel = config->channel;
+    wifi_config->ap.max_connection = config->max_stations;
+    wifi_config->ap.authmode = config->password[0] ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+}
+
+static void ip_info_from(const runtime_config_t *config, esp_netif_ip_info_t *ip_info) {
+    ip_info->ip.addr = config->ip;
+    ip_info->gw.addr = config->gateway;
+    ip_info->netmask.addr = config->netmask;
+}
+
+// Applies a new SSID or address to the running access point. Stations are
+// dropped either way and rejoin with the new settings.
+static void config_changed(const runtime_config_t *config, uint32_t changed) {
+    if ((changed & RUNTIME_CONFIG_NETWORK) && ap_netif != NULL) {
+        esp_netif_ip_info_t ip_info;
+        ip_info_from(config, &ip_info);
+        esp_err_t err = esp_netif_set_ip_info(ap_netif, &ip_info);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Setting the address failed: %s", esp_err_to_name(err));
+        }
+        dhcp_server_configure(&ip_info);
+        ESP_LOGI(TAG, "Access point moved to " IPSTR, IP2STR(&ip_info.ip));
+    }
+    if (changed & RUNTIME_CONFIG_WIFI) {
+        wifi_config_t wifi_config;
+        ap_config_from(config, &wifi_config);
+        esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Applying the Wi-Fi settings failed: %s", esp_err_to_name(err));
+        }
+        ESP_LOGI(TAG, "SSID %s on channel %d", config->ssid, config->channel);
+    }
 }
 
 // Function implementation
 void wifi_init_softap(void) {
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    ap_netif = esp_netif_create_default_wifi_ap();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
+    runtime_config_t config;
+    config_store_get(&config);
+    wifi_config_t wifi_config;
+    ap_config_from(&config, &wifi_config);
+
+    // A station that stops renewing its lease loses its binding
+    uint32_t lease_minutes = 120;
+
+#if !CONFIG_IDF_TARGET_LINUX
+    // The simulator has no netif or DHCP server, it calls the handlers itself
+    ap_netif = esp_netif_create_default_wifi_ap();
+
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                     ESP_EVENT_ANY_ID,
                                                     &wifi_event_handler,
@@ -37,34 +157,44 @@ void wifi_init_softap(void) {
                                                     NULL,
                                                     NULL));
 
-    wifi_config_t wifi_config = {
-        .ap = {
-            .ssid = ESP_WIFI_SSID,
-            .ssid_len = strlen(ESP_WIFI_SSID),
-            .channel = ESP_WIFI_CHANNEL,
-            .password = ESP_WIFI_PASS,
-            .max_connection = MAX_STA_CONN,
-            .authmode = WIFI_AUTH_OPEN
-        },
-    };
-
     // Set the IP
     ESP_ERROR_CHECK(esp_netif_dhcps_stop(ap_netif));
 
     esp_netif_ip_info_t ip_info;
 
-    IP4_ADDR(&ip_info.ip, 10, 71, 79, 1);
-    IP4_ADDR(&ip_info.gw, 10, 71, 79, 1);
-    IP4_ADDR(&ip_info.netmask, 255, 255, 255, 0);
+    ip_info_from(&config, &ip_info);
 
     ESP_ERROR_CHECK(esp_netif_set_ip_info(ap_netif, &ip_info));
-    ESP_ERROR_CHECK(esp_netif_dhcps_start(ap_netif));
+#endif
+    station_table_init(lease_minutes * 60 * 1000);
+
+    cameras_id = persist_register(&cameras_record);
+    station_slots_t saved;
+    if (persist_load(cameras_id, &saved) == ESP_OK) {
+        station_table_restore_slots(&saved);
+    }
+    station_table_subscribe(station_bound);
+
+    dhcp_reservations_load();
+#if !CONFIG_IDF_TARGET_LINUX
+    // ESP-IDF's server stays stopped, ours gives reserved cameras their address
+    dhcp_server_start(ap_netif, &ip_info, lease_minutes * 60);
+#endif
+
+    timer_node_init(&lease_timer, lease_check, NULL);
+    timer_service_start(&lease_timer, LEASE_CHECK_PERIOD_MS, LEASE_CHECK_PERIOD_MS);
 
     // Start Wi-Fi
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
+    config_store_subscribe(config_changed);
+
+    // No camera has joined yet, so moving to a quieter channel costs nothing
+    channel_survey_init();
+#if CONFIG_CHANNEL_SURVEY_AT_BOOT
+    channel_survey_run();
+#endif
 
-    ESP_LOGI(TAG, "wifi_init_softap finished. SSID:%s password:%s channel:%d",
-             ESP_WIFI_SSID, ESP_WIFI_PASS, ESP_WIFI_CHANNEL);
+    ESP_LOGI(TAG, "wifi_init_softap finished. SSID:%s channel:%d", config.ssid, config.channel);
 }
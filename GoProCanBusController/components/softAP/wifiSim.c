@@ -0,0 +1,163 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "lwip/inet.h"
+#include "softAP.h"
+
+static const char *TAG = "wifi_sim";
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+
+typedef struct {
+    bool used;
+    uint8_t mac[6];
+} sim_station_t;
+
+static SemaphoreHandle_t sim_lock;
+static wifi_mode_t sim_mode = WIFI_MODE_NULL;
+static wifi_config_t sim_config;
+static sim_station_t stations[MAX_STA_CONN];
+static wifi_ap_record_t scan_records[20];
+static uint16_t scan_count;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    sim_lock = xSemaphoreCreateMutex();
+    return sim_lock != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    sim_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+    *mode = sim_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *config)
+{
+    if (interface != WIFI_IF_AP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(sim_lock, portMAX_DELAY);
+    bool moved = sim_config.ap.channel != 0 && sim_config.ap.channel != config->ap.channel;
+    sim_config = *config;
+    xSemaphoreGive(sim_lock);
+
+    // On hardware a channel change drops every station and they rejoin, here
+    // they are simply assumed to follow
+    if (moved) {
+        ESP_LOGI(TAG, "Stations follow the access point to channel %d", config->ap.channel);
+    }
+    return ESP_OK;
+}
+
+// Stations the simulator starts with, once everything that watches the
+// station table had the time to subscribe
+static void sim_join_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_WIFI_SIM_JOIN_DELAY_MS));
+    uint32_t first = ntohl(inet_addr(CONFIG_WIFI_SIM_FIRST_IP));
+    for (int i = 0; i < CONFIG_WIFI_SIM_CAMERAS; i++) {
+        // Locally administered, the last byte tells the cameras apart
+        uint8_t mac[6] = {0x02, 'G', 'P', 0x00, 0x00, i};
+        wifi_sim_join(mac, htonl(first + i));
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    ESP_LOGI(TAG, "Simulated access point %s up, %d cameras join in %d ms",
+             (const char *)sim_config.ap.ssid, CONFIG_WIFI_SIM_CAMERAS, CONFIG_WIFI_SIM_JOIN_DELAY_MS);
+    if (CONFIG_WIFI_SIM_CAMERAS > 0) {
+        xTaskCreate(sim_join_task, "wifi_sim_join", 3072, NULL, 5, NULL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    return sim_mode == WIFI_MODE_STA || sim_mode == WIFI_MODE_APSTA ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *count, wifi_ap_record_t *records)
+{
+    xSemaphoreTake(sim_lock, portMAX_DELAY);
+    if (*count > scan_count) {
+        *count = scan_count;
+    }
+    memcpy(records, scan_records, *count * sizeof(wifi_ap_record_t));
+    xSemaphoreGive(sim_lock);
+    return ESP_OK;
+}
+
+void wifi_sim_set_scan(const wifi_ap_record_t *records, uint16_t count)
+{
+    xSemaphoreTake(sim_lock, portMAX_DELAY);
+    scan_count = count < sizeof(scan_records) / sizeof(scan_records[0]) ? count
+                 : sizeof(scan_records) / sizeof(scan_records[0]);
+    memcpy(scan_records, records, scan_count * sizeof(wifi_ap_record_t));
+    xSemaphoreGive(sim_lock);
+}
+
+// Slot of a joined station, -1 if it is not joined
+static int find_station(const uint8_t mac[6])
+{
+    for (int i = 0; i < MAX_STA_CONN; i++) {
+        if (stations[i].used && memcmp(stations[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t wifi_sim_join(const uint8_t mac[6], uint32_t ip)
+{
+    xSemaphoreTake(sim_lock, portMAX_DELAY);
+    int aid = find_station(mac);
+    for (int i = 0; i < MAX_STA_CONN && i < sim_config.ap.max_connection && aid < 0; i++) {
+        if (!stations[i].used) {
+            stations[i].used = true;
+            memcpy(stations[i].mac, mac, 6);
+            aid = i;
+        }
+    }
+    xSemaphoreGive(sim_lock);
+    if (aid < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    wifi_event_ap_staconnected_t connected = {.aid = aid + 1};
+    memcpy(connected.mac, mac, 6);
+    wifi_event_handler(NULL, WIFI_EVENT, WIFI_EVENT_AP_STACONNECTED, &connected);
+
+    ip_event_ap_staipassigned_t assigned = {.ip.addr = ip};
+    memcpy(assigned.mac, mac, 6);
+    dhcp_event_handler(NULL, IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &assigned);
+    return ESP_OK;
+}
+
+esp_err_t wifi_sim_leave(const uint8_t mac[6])
+{
+    xSemaphoreTake(sim_lock, portMAX_DELAY);
+    int slot = find_station(mac);
+    if (slot >= 0) {
+        stations[slot].used = false;
+    }
+    xSemaphoreGive(sim_lock);
+    if (slot < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    wifi_event_ap_stadisconnected_t disconnected = {.aid = slot + 1};
+    memcpy(disconnected.mac, mac, 6);
+    wifi_event_handler(NULL, WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, &disconnected);
+    return ESP_OK;
+}
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "stationTable.h"
+
+#define LEASE_MS 60000
+
+static const uint8_t mac_a[STATION_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x01};
+static const uint8_t mac_b[STATION_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x02};
+static const uint8_t mac_c[STATION_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x00, 0x03};
+
+// Last bind and unbind seen by the subscriber
+static int bind_calls;
+static int last_camera;
+static uint32_t last_ip;
+static bool last_bound;
+
+static void station_bound(int camera, const station_t *station, bool bound)
+{
+    bind_calls++;
+    last_camera = camera;
+    last_ip = station->ip;
+    last_bound = bound;
+}
+
+// IPv4 in network byte order, as lwIP keeps it
+static uint32_t ip4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    uint8_t octets[4] = {a, b, c, d};
+    uint32_t ip;
+    memcpy(&ip, octets, sizeof(ip));
+    return ip;
+}
+
+static station_reservation_t reservation(const uint8_t *mac, uint32_t ip)
+{
+    station_reservation_t entry = {.ip = ip};
+    memcpy(entry.mac, mac, STATION_MAC_LEN);
+    return entry;
+}
+
+void setUp(void)
+{
+    static bool subscribed;
+    if (!subscribed) {
+        subscribed = station_table_subscribe(station_bound);
+    }
+    station_table_init(LEASE_MS);
+    bind_calls = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_reserve_rejects_invalid_tables(void)
+{
+    station_reservation_t table[STATION_TABLE_MAX + 1];
+
+    table[0] = reservation(mac_a, 0);
+    TEST_ASSERT_FALSE(station_table_reserve(table, 1));
+
+    table[0] = reservation(mac_a, ip4(10, 71, 79, 2));
+    table[1] = reservation(mac_a, ip4(10, 71, 79, 3));
+    TEST_ASSERT_FALSE(station_table_reserve(table, 2));
+
+    table[1] = reservation(mac_b, ip4(10, 71, 79, 2));
+    TEST_ASSERT_FALSE(station_table_reserve(table, 2));
+
+    for (int i = 0; i <= STATION_TABLE_MAX; i++) {
+        uint8_t mac[STATION_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x01, i};
+        table[i] = reservation(mac, ip4(10, 71, 79, 2 + i));
+    }
+    TEST_ASSERT_FALSE(station_table_reserve(table, STATION_TABLE_MAX + 1));
+
+    // Nothing was pinned by the failed attempts
+    station_t station;
+    TEST_ASSERT_FALSE(station_table_get(0, &station));
+}
+
+static void test_reserved_mac_keeps_its_slot(void)
+{
+    station_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 2))};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+
+    // A stranger joining first does not get the reserved slot
+    TEST_ASSERT_EQUAL_INT(1, station_table_connected(mac_b, 1, 0));
+    TEST_ASSERT_EQUAL_INT(0, station_table_connected(mac_a, 2, 0));
+}
+
+static void test_reserved_slot_never_handed_out(void)
+{
+    station_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 2))};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+
+    for (int i = 0; i < STATION_TABLE_MAX - 1; i++) {
+        uint8_t mac[STATION_MAC_LEN] = {0x02, 'G', 'P', 0x00, 0x02, i};
+        TEST_ASSERT_EQUAL_INT(i + 1, station_table_connected(mac, i + 1, 0));
+    }
+    // Every other slot is taken and the reserved camera is away
+    TEST_ASSERT_EQUAL_INT(-1, station_table_connected(mac_c, STATION_TABLE_MAX, 0));
+    TEST_ASSERT_EQUAL_INT(0, station_table_connected(mac_a, STATION_TABLE_MAX, 0));
+}
+
+static void test_association_does_not_bind(void)
+{
+    uint32_t reserved = ip4(10, 71, 79, 2);
+    station_reservation_t table[] = {reservation(mac_a, reserved)};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+
+    TEST_ASSERT_EQUAL_INT(0, station_table_connected(mac_a, 1, 0));
+    TEST_ASSERT_FALSE(station_table_camera_ip(0, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, station_table_find_ip(reserved));
+    TEST_ASSERT_EQUAL_INT(0, bind_calls);
+}
+
+static void test_ack_binds_the_address(void)
+{
+    uint32_t reserved = ip4(10, 71, 79, 2);
+    station_reservation_t table[] = {reservation(mac_a, reserved)};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+    station_table_connected(mac_a, 1, 0);
+
+    TEST_ASSERT_EQUAL_INT(0, station_table_ip_assigned(mac_a, reserved, 10));
+    uint32_t ip;
+    TEST_ASSERT_TRUE(station_table_camera_ip(0, &ip));
+    TEST_ASSERT_EQUAL_HEX32(reserved, ip);
+    TEST_ASSERT_EQUAL_INT(0, station_table_find_ip(reserved));
+    TEST_ASSERT_EQUAL_INT(1, bind_calls);
+    TEST_ASSERT_TRUE(last_bound);
+
+    // A renewal of the same address is not a new bind
+    station_table_ip_assigned(mac_a, reserved, 20);
+    TEST_ASSERT_EQUAL_INT(1, bind_calls);
+}
+
+static void test_ack_of_another_address_still_binds(void)
+{
+    uint32_t reserved = ip4(10, 71, 79, 2);
+    uint32_t given = ip4(10, 71, 79, 7);
+    station_reservation_t table[] = {reservation(mac_a, reserved)};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+    station_table_connected(mac_a, 1, 0);
+
+    station_table_ip_assigned(mac_a, given, 10);
+    uint32_t ip;
+    TEST_ASSERT_TRUE(station_table_camera_ip(0, &ip));
+    TEST_ASSERT_EQUAL_HEX32(given, ip);
+    TEST_ASSERT_EQUAL_INT(-1, station_table_find_ip(reserved));
+
+    station_t station;
+    TEST_ASSERT_TRUE(station_table_get(0, &station));
+    TEST_ASSERT_EQUAL_HEX32(reserved, station.reserved_ip);
+}
+
+static void test_disconnect_unbinds(void)
+{
+    uint32_t reserved = ip4(10, 71, 79, 2);
+    station_reservation_t table[] = {reservation(mac_a, reserved)};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+    station_table_connected(mac_a, 1, 0);
+    station_table_ip_assigned(mac_a, reserved, 10);
+
+    TEST_ASSERT_EQUAL_INT(0, station_table_disconnected(mac_a));
+    TEST_ASSERT_FALSE(station_table_camera_ip(0, NULL));
+    TEST_ASSERT_FALSE(last_bound);
+    TEST_ASSERT_EQUAL_HEX32(reserved, last_ip);
+
+    // Rejoining does not bind before the next ACK
+    bind_calls = 0;
+    station_table_connected(mac_a, 1, 20);
+    TEST_ASSERT_FALSE(station_table_camera_ip(0, NULL));
+    TEST_ASSERT_EQUAL_INT(0, bind_calls);
+}
+
+static void test_reserve_moves_a_known_mac(void)
+{
+    // mac_a sits in slot 1 from an earlier run
+    station_slots_t slots = {0};
+    memcpy(slots.mac[1], mac_a, STATION_MAC_LEN);
+    station_table_restore_slots(&slots);
+    TEST_ASSERT_EQUAL_INT(1, station_table_find_mac(mac_a));
+
+    station_reservation_t table[] = {reservation(mac_a, ip4(10, 71, 79, 2))};
+    TEST_ASSERT_TRUE(station_table_reserve(table, 1));
+    TEST_ASSERT_EQUAL_INT(0, station_table_find_mac(mac_a));
+
+    station_t station;
+    TEST_ASSERT_FALSE(station_table_get(1, &station));
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reserve_rejects_invalid_tables);
+    RUN_TEST(test_reserved_mac_keeps_its_slot);
+    RUN_TEST(test_reserved_slot_never_handed_out);
+    RUN_TEST(test_association_does_not_bind);
+    RUN_TEST(test_ack_binds_the_address);
+    RUN_TEST(test_ack_of_another_address_still_binds);
+    RUN_TEST(test_disconnect_unbinds);
+    RUN_TEST(test_reserve_moves_a_known_mac);
+    exit(UNITY_END());
+}
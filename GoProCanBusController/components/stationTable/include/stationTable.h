@@ -0,0 +1,68 @@
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+// Binds each station of the softAP to a camera slot by MAC and to its DHCP
+// lease by IP. Fed from the Wi-Fi and IP events, so a camera can be reached
+// as soon as its lease is acked. Plain C so it also builds on the host.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef STATION_TABLE_MAX
+#define STATION_TABLE_MAX 4
+#endif
+
+#define STATION_MAC_LEN 6
+
+typedef struct {
+    uint8_t mac[STATION_MAC_LEN];
+    uint32_t ip;                // IPv4 in network byte order, 0 while unbound
+    uint32_t lease_ms;          // When the lease was last acked
+    uint8_t aid;                // Association id, 0 while not associated
+    bool used;                  // Slot belongs to this MAC, kept across rejoins
+    uint32_t reserved_ip;       // Fixed address from the reservation table, 0 if none
+} station_t;
+
+// One fixed MAC to IP pairing, reservation n always lands in camera slot n
+typedef struct {
+    uint8_t mac[STATION_MAC_LEN];
+    uint32_t ip;                // IPv4 in network byte order
+} station_reservation_t;
+
+// Which MAC owns each camera slot, the part of the table kept across reboots
+typedef struct {
+    uint8_t mac[STATION_TABLE_MAX][STATION_MAC_LEN];
+} station_slots_t;
+
+// Called when a camera gets an address (bound) or loses it (unbound), outside the table lock
+typedef void (*station_bind_fn_t)(int camera, const station_t *station, bool bound);
+
+// Leases not renewed within lease_ms are dropped by station_table_expire()
+void station_table_init(uint32_t lease_ms);
+
+// Pins each reserved MAC to its slot and address. Fails without changing
+// anything if there are too many, an address is 0 or a MAC or address repeats.
+bool station_table_reserve(const station_reservation_t *reservations, int count);
+
+// Copy slot ownership out, or give slots back to their MACs at boot before
+// any station joins; reserved slots are left alone
+void station_table_save_slots(station_slots_t *slots);
+void station_table_restore_slots(const station_slots_t *slots);
+
+// Up to four subscribers, registered before the access point starts
+bool station_table_subscribe(station_bind_fn_t fn);
+
+// Event entry points, each returns the camera slot or -1 if the table is full.
+// Association claims the slot, the DHCP ACK binds the address.
+int station_table_connected(const uint8_t *mac, uint8_t aid, uint32_t now_ms);
+int station_table_ip_assigned(const uint8_t *mac, uint32_t ip, uint32_t now_ms);
+int station_table_disconnected(const uint8_t *mac);
+void station_table_expire(uint32_t now_ms);
+
+// Lookups, all O(1)
+bool station_table_get(int camera, station_t *station);
+bool station_table_camera_ip(int camera, uint32_t *ip);
+int station_table_find_ip(uint32_t ip);
+int station_table_find_mac(const uint8_t *mac);
+
+#endif // STATION_TABLE_H
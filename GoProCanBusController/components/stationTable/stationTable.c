@@ -0,0 +1,345 @@
+#include <string.h>
+#include "stationTable.h"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+static portMUX_TYPE table_lock = portMUX_INITIALIZER_UNLOCKED;
+#define TABLE_LOCK()    portENTER_CRITICAL(&table_lock)
+#define TABLE_UNLOCK()  portEXIT_CRITICAL(&table_lock)
+#else
+#define TABLE_LOCK()
+#define TABLE_UNLOCK()
+#endif
+
+#define MAX_SUBSCRIBERS 4
+
+// Open addressing on the low MAC bytes, at most half full
+#define MAC_BUCKETS 32
+_Static_assert(STATION_TABLE_MAX * 2 <= MAC_BUCKETS, "MAC index too small for the station table");
+
+static station_t stations[STATION_TABLE_MAX];
+static int8_t mac_index[MAC_BUCKETS];
+static int8_t host_index[256];          // Slot by last address octet
+static uint32_t lease_ms;
+static station_bind_fn_t subscribers[MAX_SUBSCRIBERS];
+static int subscriber_count;
+
+static uint8_t host_of(uint32_t ip)
+{
+    return ((const uint8_t *)&ip)[3];
+}
+
+static unsigned mac_hash(const uint8_t *mac)
+{
+    return (mac[3] * 31u + mac[4] * 7u + mac[5]) & (MAC_BUCKETS - 1);
+}
+
+static int mac_lookup(const uint8_t *mac)
+{
+    for (unsigned i = mac_hash(mac);; i = (i + 1) & (MAC_BUCKETS - 1)) {
+        int slot = mac_index[i];
+        if (slot < 0) {
+            return -1;
+        }
+        if (memcmp(stations[slot].mac, mac, STATION_MAC_LEN) == 0) {
+            return slot;
+        }
+    }
+}
+
+static void mac_insert(int slot)
+{
+    unsigned i = mac_hash(stations[slot].mac);
+    while (mac_index[i] >= 0) {
+        i = (i + 1) & (MAC_BUCKETS - 1);
+    }
+    mac_index[i] = slot;
+}
+
+// Only needed when a slot is handed to a new MAC, which is rare
+static void mac_rebuild(void)
+{
+    memset(mac_index, -1, sizeof(mac_index));
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        if (stations[i].used) {
+            mac_insert(i);
+        }
+    }
+}
+
+// A known MAC keeps its slot, a new one takes a free slot or one whose
+// station has left
+static int slot_for(const uint8_t *mac)
+{
+    int slot = mac_lookup(mac);
+    if (slot >= 0) {
+        return slot;
+    }
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        if (!stations[i].used) {
+            slot = i;
+            break;
+        }
+    }
+    for (int i = 0; slot < 0 && i < STATION_TABLE_MAX; i++) {
+        if (stations[i].aid == 0 && stations[i].ip == 0 && stations[i].reserved_ip == 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+    bool replaced = stations[slot].used;
+    memset(&stations[slot], 0, sizeof(stations[slot]));
+    memcpy(stations[slot].mac, mac, STATION_MAC_LEN);
+    stations[slot].used = true;
+    if (replaced) {
+        mac_rebuild();
+    } else {
+        mac_insert(slot);
+    }
+    return slot;
+}
+
+// Clears the address of a slot, returns true if it had one
+static bool unbind(int slot)
+{
+    station_t *station = &stations[slot];
+    if (station->ip == 0) {
+        return false;
+    }
+    host_index[host_of(station->ip)] = -1;
+    station->ip = 0;
+    return true;
+}
+
+static void notify(int slot, const station_t *copy, bool bound)
+{
+    for (int i = 0; i < subscriber_count; i++) {
+        subscribers[i](slot, copy, bound);
+    }
+}
+
+void station_table_init(uint32_t lease)
+{
+    TABLE_LOCK();
+    memset(stations, 0, sizeof(stations));
+    memset(mac_index, -1, sizeof(mac_index));
+    memset(host_index, -1, sizeof(host_index));
+    lease_ms = lease;
+    TABLE_UNLOCK();
+}
+
+bool station_table_subscribe(station_bind_fn_t fn)
+{
+    if (subscriber_count >= MAX_SUBSCRIBERS) {
+        return false;
+    }
+    subscribers[subscriber_count++] = fn;
+    return true;
+}
+
+bool station_table_reserve(const station_reservation_t *reservations, int count)
+{
+    if (count < 0 || count > STATION_TABLE_MAX) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (reservations[i].ip == 0) {
+            return false;
+        }
+        for (int j = 0; j < i; j++) {
+            if (reservations[j].ip == reservations[i].ip ||
+                memcmp(reservations[j].mac, reservations[i].mac, STATION_MAC_LEN) == 0) {
+                return false;
+            }
+        }
+    }
+
+    TABLE_LOCK();
+    for (int i = 0; i < count; i++) {
+        unbind(i);
+        memset(&stations[i], 0, sizeof(stations[i]));
+        memcpy(stations[i].mac, reservations[i].mac, STATION_MAC_LEN);
+        stations[i].used = true;
+        stations[i].reserved_ip = reservations[i].ip;
+    }
+    // A reserved MAC may already sit in another slot
+    for (int i = count; i < STATION_TABLE_MAX; i++) {
+        stations[i].reserved_ip = 0;
+        for (int j = 0; j < count && stations[i].used; j++) {
+            if (memcmp(stations[i].mac, reservations[j].mac, STATION_MAC_LEN) == 0) {
+                unbind(i);
+                memset(&stations[i], 0, sizeof(stations[i]));
+            }
+        }
+    }
+    mac_rebuild();
+    TABLE_UNLOCK();
+    return true;
+}
+
+void station_table_save_slots(station_slots_t *slots)
+{
+    TABLE_LOCK();
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        memcpy(slots->mac[i], stations[i].mac, STATION_MAC_LEN);
+    }
+    TABLE_UNLOCK();
+}
+
+void station_table_restore_slots(const station_slots_t *slots)
+{
+    static const uint8_t none[STATION_MAC_LEN];
+
+    TABLE_LOCK();
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        if (stations[i].used || memcmp(slots->mac[i], none, STATION_MAC_LEN) == 0 ||
+            mac_lookup(slots->mac[i]) >= 0) {
+            continue;
+        }
+        memcpy(stations[i].mac, slots->mac[i], STATION_MAC_LEN);
+        stations[i].used = true;
+        mac_insert(i);
+    }
+    TABLE_UNLOCK();
+}
+
+int station_table_connected(const uint8_t *mac, uint8_t aid, uint32_t now_ms)
+{
+    // Only the slot is claimed, a reserved camera too is not bound until its
+    // DHCP ACK shows which address it holds
+    TABLE_LOCK();
+    int slot = slot_for(mac);
+    if (slot >= 0) {
+        stations[slot].aid = aid;
+    }
+    TABLE_UNLOCK();
+    return slot;
+}
+
+int station_table_ip_assigned(const uint8_t *mac, uint32_t ip, uint32_t now_ms)
+{
+    // Up to two stations lose an address: this one and a previous holder of ip
+    station_t lost[2];
+    int lost_slot[2];
+    int lost_count = 0;
+    station_t copy;
+    bool bound = false;
+
+    TABLE_LOCK();
+    int slot = slot_for(mac);
+    if (slot >= 0) {
+        station_t *station = &stations[slot];
+        if (station->ip != ip) {
+            int previous = host_index[host_of(ip)];
+            if (previous >= 0 && previous != slot && stations[previous].ip == ip) {
+                lost[lost_count] = stations[previous];
+                lost_slot[lost_count++] = previous;
+                unbind(previous);
+            }
+            if (station->ip != 0) {
+                lost[lost_count] = *station;
+                lost_slot[lost_count++] = slot;
+                unbind(slot);
+            }
+            station->ip = ip;
+            host_index[host_of(ip)] = slot;
+            bound = true;
+        }
+        station->lease_ms = now_ms;
+        copy = *station;
+    }
+    TABLE_UNLOCK();
+
+    for (int i = 0; i < lost_count; i++) {
+        notify(lost_slot[i], &lost[i], false);
+    }
+    if (bound) {
+        notify(slot, &copy, true);
+    }
+    return slot;
+}
+
+int station_table_disconnected(const uint8_t *mac)
+{
+    station_t copy;
+    bool unbound = false;
+
+    TABLE_LOCK();
+    int slot = mac_lookup(mac);
+    if (slot >= 0) {
+        copy = stations[slot];
+        stations[slot].aid = 0;
+        unbound = unbind(slot);
+    }
+    TABLE_UNLOCK();
+
+    if (unbound) {
+        notify(slot, &copy, false);
+    }
+    return slot;
+}
+
+void station_table_expire(uint32_t now_ms)
+{
+    for (int i = 0; i < STATION_TABLE_MAX; i++) {
+        station_t copy;
+        bool expired = false;
+
+        TABLE_LOCK();
+        if (stations[i].ip != 0 && (int32_t)(now_ms - stations[i].lease_ms) > (int32_t)lease_ms) {
+            copy = stations[i];
+            expired = unbind(i);
+        }
+        TABLE_UNLOCK();
+
+        if (expired) {
+            notify(i, &copy, false);
+        }
+    }
+}
+
+bool station_table_get(int camera, station_t *station)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX) {
+        return false;
+    }
+    TABLE_LOCK();
+    *station = stations[camera];
+    TABLE_UNLOCK();
+    return station->used;
+}
+
+bool station_table_camera_ip(int camera, uint32_t *ip)
+{
+    if (camera < 0 || camera >= STATION_TABLE_MAX) {
+        return false;
+    }
+    TABLE_LOCK();
+    uint32_t addr = stations[camera].ip;
+    TABLE_UNLOCK();
+    if (ip != NULL) {
+        *ip = addr;
+    }
+    return addr != 0;
+}
+
+int station_table_find_ip(uint32_t ip)
+{
+    TABLE_LOCK();
+    int slot = host_index[host_of(ip)];
+    if (slot >= 0 && stations[slot].ip != ip) {
+        slot = -1;
+    }
+    TABLE_UNLOCK();
+    return slot;
+}
+
+int station_table_find_mac(const uint8_t *mac)
+{
+    TABLE_LOCK();
+    int slot = mac_lookup(mac);
+    TABLE_UNLOCK();
+    return slot;
+}
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include "clockDiscipline.h"
+
+// A small error is divided by this and taken out at each sample, the rest
+// waits for the next
+#define PHASE_GAIN_DIV  2
+// Likewise for the rate error a small error implies
+#define FREQ_GAIN_DIV   16
+
+void clock_discipline_init(clock_discipline_t *clock, uint32_t step_us)
+{
+    *clock = (clock_discipline_t){.step_us = step_us};
+}
+
+static int64_t predict(const clock_discipline_t *clock, int64_t local_us)
+{
+    int64_t elapsed = local_us - clock->base_local_us;
+    return clock->base_utc_us + elapsed + elapsed * clock->drift_ppb / 1000000000;
+}
+
+void clock_discipline_sample(clock_discipline_t *clock, int64_t utc_us, int64_t local_us)
+{
+    clock->samples++;
+    if (!clock->synced) {
+        clock->synced = true;
+        clock->base_local_us = local_us;
+        clock->base_utc_us = utc_us;
+        clock->last_error_us = 0;
+        return;
+    }
+
+    int64_t predicted = predict(clock, local_us);
+    int64_t error = utc_us - predicted;
+    int64_t elapsed = local_us - clock->base_local_us;
+    clock->last_error_us = error;
+    if (llabs(error) > clock->step_us) {
+        // A new source or a jump of the old one, the rate is not to blame
+        clock->steps++;
+        clock->base_local_us = local_us;
+        clock->base_utc_us = utc_us;
+        return;
+    }
+
+    if (elapsed > 0) {
+        int64_t drift = clock->drift_ppb + error * 1000000000 / elapsed / FREQ_GAIN_DIV;
+        if (drift > CLOCK_DRIFT_MAX_PPB) {
+            drift = CLOCK_DRIFT_MAX_PPB;
+        } else if (drift < -CLOCK_DRIFT_MAX_PPB) {
+            drift = -CLOCK_DRIFT_MAX_PPB;
+        }
+        clock->drift_ppb = drift;
+    }
+    clock->base_local_us = local_us;
+    clock->base_utc_us = predicted + error / PHASE_GAIN_DIV;
+}
+
+bool clock_discipline_utc(const clock_discipline_t *clock, int64_t local_us, int64_t *utc_us)
+{
+    if (!clock->synced) {
+        return false;
+    }
+    *utc_us = predict(clock, local_us);
+    return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, after Howard Hinnant's
+// days_from_civil; eras of 400 years keep it exact without tables
+static int64_t days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int64_t days, clock_date_t *date)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t doe = days - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    date->day = doy - (153 * mp + 2) / 5 + 1;
+    date->month = mp < 10 ? mp + 3 : mp - 9;
+    date->year = yoe + era * 400 + (date->month <= 2);
+}
+
+void clock_date_from_utc(int64_t utc_s, clock_date_t *date)
+{
+    int64_t days = utc_s / 86400;
+    int64_t rem = utc_s % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        days--;
+    }
+    civil_from_days(days, date);
+    date->hour = rem / 3600;
+    date->minute = rem / 60 % 60;
+    date->second = rem % 60;
+}
+
+int64_t clock_date_to_utc(const clock_date_t *date)
+{
+    return days_from_civil(date->year, date->month, date->day) * 86400 + date->hour * 3600 +
+           date->minute * 60 + date->second;
+}
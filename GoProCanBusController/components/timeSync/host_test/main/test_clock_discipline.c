@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include "unity.h"
+#include "clockDiscipline.h"
+
+#define STEP_US         100000
+#define SAMPLE_US       1000000
+// Some UTC time in 2024, in microseconds
+#define UTC_START_US    1718000000000000LL
+
+static clock_discipline_t discipline;
+
+static clock_date_t date(int year, int month, int day, int hour, int minute, int second)
+{
+    return (clock_date_t){year, month, day, hour, minute, second};
+}
+
+static void check_date(int64_t utc_s, clock_date_t expected)
+{
+    clock_date_t got;
+    clock_date_from_utc(utc_s, &got);
+    TEST_ASSERT_EQUAL_INT(expected.year, got.year);
+    TEST_ASSERT_EQUAL_INT(expected.month, got.month);
+    TEST_ASSERT_EQUAL_INT(expected.day, got.day);
+    TEST_ASSERT_EQUAL_INT(expected.hour, got.hour);
+    TEST_ASSERT_EQUAL_INT(expected.minute, got.minute);
+    TEST_ASSERT_EQUAL_INT(expected.second, got.second);
+    TEST_ASSERT_EQUAL(utc_s, clock_date_to_utc(&expected));
+}
+
+// Samples a reference every second from a local clock off by rate_ppb, so
+// UTC moves on by 1 - rate_ppb / 1e9 of each local second. Returns the last
+// local time.
+static int64_t run_clock(int64_t rate_ppb, int samples)
+{
+    int64_t local_us = 0;
+    for (int i = 0; i < samples; i++) {
+        local_us += SAMPLE_US;
+        int64_t utc_us = UTC_START_US + local_us - local_us * rate_ppb / 1000000000;
+        clock_discipline_sample(&discipline, utc_us, local_us);
+    }
+    return local_us;
+}
+
+void setUp(void)
+{
+    clock_discipline_init(&discipline, STEP_US);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_known_dates(void)
+{
+    check_date(0, date(1970, 1, 1, 0, 0, 0));
+    check_date(951782400, date(2000, 2, 29, 0, 0, 0));
+    check_date(951868799, date(2000, 2, 29, 23, 59, 59));
+    check_date(951868800, date(2000, 3, 1, 0, 0, 0));
+    check_date(1709164800 + 12 * 3600 + 34 * 60 + 56, date(2024, 2, 29, 12, 34, 56));
+    check_date(2147483647, date(2038, 1, 19, 3, 14, 7));
+    // 2100 is not a leap year, February ends on the 28th
+    check_date(4107456000, date(2100, 2, 28, 0, 0, 0));
+    check_date(4107542400, date(2100, 3, 1, 0, 0, 0));
+}
+
+static void test_negative_times(void)
+{
+    check_date(-1, date(1969, 12, 31, 23, 59, 59));
+    check_date(-86400, date(1969, 12, 31, 0, 0, 0));
+    check_date(-86401, date(1969, 12, 30, 23, 59, 59));
+    check_date(-2203891200, date(1900, 3, 1, 0, 0, 0));
+}
+
+// Every day from 1900 to 2200 round trips, and follows the previous one
+static void test_round_trip_every_day(void)
+{
+    clock_date_t previous;
+    clock_date_from_utc(-2208988800 - 86400, &previous);
+    TEST_ASSERT_EQUAL_INT(1899, previous.year);
+    for (int64_t utc_s = -2208988800; utc_s < 7258118400; utc_s += 86400) {
+        clock_date_t got;
+        clock_date_from_utc(utc_s + 3661, &got);
+        TEST_ASSERT_EQUAL(utc_s + 3661, clock_date_to_utc(&got));
+        TEST_ASSERT_EQUAL_INT(1, got.hour);
+        bool next_day = got.year == previous.year && got.month == previous.month && got.day == previous.day + 1;
+        bool next_month = got.year == previous.year && got.month == previous.month + 1 && got.day == 1;
+        bool next_year = got.year == previous.year + 1 && got.month == 1 && got.day == 1 && previous.month == 12;
+        TEST_ASSERT_TRUE(next_day || next_month || next_year);
+
+        // February has 29 days exactly in leap years
+        if (got.month == 3 && got.day == 1) {
+            bool leap = (got.year % 4 == 0 && got.year % 100 != 0) || got.year % 400 == 0;
+            TEST_ASSERT_EQUAL_INT(leap ? 29 : 28, previous.day);
+        }
+        previous = got;
+    }
+}
+
+static void test_first_sample_sets_the_clock(void)
+{
+    int64_t utc_us;
+    TEST_ASSERT_FALSE(clock_discipline_utc(&discipline, 0, &utc_us));
+    clock_discipline_sample(&discipline, UTC_START_US, 5000);
+    TEST_ASSERT_TRUE(clock_discipline_utc(&discipline, 5000 + SAMPLE_US, &utc_us));
+    TEST_ASSERT_EQUAL(UTC_START_US + SAMPLE_US, utc_us);
+    TEST_ASSERT_EQUAL_UINT32(0, discipline.steps);
+}
+
+static void test_large_error_steps(void)
+{
+    clock_discipline_sample(&discipline, UTC_START_US, 0);
+    discipline.drift_ppb = 20000;
+
+    // An error of step_us exactly is still slewed
+    clock_discipline_sample(&discipline, UTC_START_US + SAMPLE_US + 20 + STEP_US, SAMPLE_US);
+    TEST_ASSERT_EQUAL_UINT32(0, discipline.steps);
+    TEST_ASSERT_EQUAL(STEP_US, discipline.last_error_us);
+
+    // Over it the clock jumps to the reference and keeps its rate
+    int32_t drift = discipline.drift_ppb;
+    int64_t utc_now = UTC_START_US + 5000000000LL;
+    clock_discipline_sample(&discipline, utc_now, 2 * SAMPLE_US);
+    TEST_ASSERT_EQUAL_UINT32(1, discipline.steps);
+    TEST_ASSERT_EQUAL(drift, discipline.drift_ppb);
+    int64_t utc_us;
+    TEST_ASSERT_TRUE(clock_discipline_utc(&discipline, 2 * SAMPLE_US, &utc_us));
+    TEST_ASSERT_EQUAL(utc_now, utc_us);
+
+    // Backwards too
+    clock_discipline_sample(&discipline, utc_now - STEP_US, 2 * SAMPLE_US + 1);
+    TEST_ASSERT_EQUAL_UINT32(2, discipline.steps);
+}
+
+// A local clock 200 ppm fast is learnt, and the prediction error settles
+static void test_slew_converges(void)
+{
+    int64_t local_us = run_clock(200000, 600);
+    TEST_ASSERT_EQUAL_UINT32(0, discipline.steps);
+    TEST_ASSERT_TRUE(llabs(discipline.drift_ppb + 200000) < 1000);
+    TEST_ASSERT_TRUE(llabs(discipline.last_error_us) < 5);
+
+    // And holds between samples: a minute on, still within a few microseconds
+    int64_t utc_us;
+    int64_t later = local_us + 60 * SAMPLE_US;
+    TEST_ASSERT_TRUE(clock_discipline_utc(&discipline, later, &utc_us));
+    int64_t expected = UTC_START_US + later - later * 200000 / 1000000000;
+    TEST_ASSERT_TRUE(llabs(utc_us - expected) < 100);
+}
+
+// Rates no crystal runs at are held at the bound, either way
+static void test_drift_is_clamped(void)
+{
+    run_clock(50000000, 200);
+    TEST_ASSERT_EQUAL_UINT32(0, discipline.steps);
+    TEST_ASSERT_EQUAL_INT(-CLOCK_DRIFT_MAX_PPB, discipline.drift_ppb);
+
+    clock_discipline_init(&discipline, STEP_US);
+    run_clock(-50000000, 200);
+    TEST_ASSERT_EQUAL_UINT32(0, discipline.steps);
+    TEST_ASSERT_EQUAL_INT(CLOCK_DRIFT_MAX_PPB, discipline.drift_ppb);
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_known_dates);
+    RUN_TEST(test_negative_times);
+    RUN_TEST(test_round_trip_every_day);
+    RUN_TEST(test_first_sample_sets_the_clock);
+    RUN_TEST(test_large_error_steps);
+    RUN_TEST(test_slew_converges);
+    RUN_TEST(test_drift_is_clamped);
+    exit(UNITY_END());
+}
@@ -0,0 +1,48 @@
+#ifndef CLOCK_DISCIPLINE_H
+#define CLOCK_DISCIPLINE_H
+
+// Keeps UTC on top of the free-running esp_timer clock. Each reference
+// sample (UTC as read at some local time) is compared with the clock's own
+// prediction: a large error steps the clock, a small one is slewed out
+// and also corrects the rate, so the clock keeps time between samples that
+// come a second or more apart. Plain C so it also builds on the host.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rate corrections are bounded to what a crystal can be off by
+#define CLOCK_DRIFT_MAX_PPB 500000
+
+typedef struct {
+    bool synced;
+    int64_t base_local_us;      // Local time of the last correction
+    int64_t base_utc_us;        // UTC at base_local_us
+    int32_t drift_ppb;          // Local clock rate error, corrected between samples
+    int64_t last_error_us;      // Prediction error of the last sample
+    uint32_t step_us;           // Errors above this step the clock instead of slewing
+    uint32_t samples;
+    uint32_t steps;
+} clock_discipline_t;
+
+void clock_discipline_init(clock_discipline_t *clock, uint32_t step_us);
+
+// Feeds one reference: UTC was utc_us at local time local_us
+void clock_discipline_sample(clock_discipline_t *clock, int64_t utc_us, int64_t local_us);
+
+// UTC at a local time, false before the first sample
+bool clock_discipline_utc(const clock_discipline_t *clock, int64_t local_us, int64_t *utc_us);
+
+// Calendar fields of a UTC time, and back, without the C library's time zones
+typedef struct {
+    int year;
+    int month;                  // 1 to 12
+    int day;                    // 1 to 31
+    int hour;
+    int minute;
+    int second;
+} clock_date_t;
+
+void clock_date_from_utc(int64_t utc_s, clock_date_t *date);
+int64_t clock_date_to_utc(const clock_date_t *date);
+
+#endif // CLOCK_DISCIPLINE_H
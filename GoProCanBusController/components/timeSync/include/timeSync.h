@@ -0,0 +1,55 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+// Wall clock for lining footage up with telemetry. UTC comes from a time
+// frame on the CAN bus (or POST /api/time when there is none) and is kept
+// on the esp_timer clock by clockDiscipline.h between frames.
+//
+// Each camera gets the date and time once it has an address, sent so that it
+// lands on a whole second, and the camera's clock is then read back around a
+// second boundary to measure what is left of its offset. Markers drop a
+// HiLight on every recording camera and keep the UTC instant of the trigger,
+// so a HiLight in the video and a row of the log name the same moment.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+typedef enum {
+    TIME_SOURCE_NONE,
+    TIME_SOURCE_CAN,
+    TIME_SOURCE_HTTP,           // POST /api/time, e.g. from the phone running the web UI
+} time_source_t;
+
+typedef enum {
+    TIME_MARKER_CAN,            // Marker signal on the CAN bus
+    TIME_MARKER_RECORD,         // Recording started
+    TIME_MARKER_HTTP,           // POST /api/marker
+} time_marker_source_t;
+
+// Subscribes to the station table and starts the sync task, before the
+// access point starts
+void time_sync_init(void);
+
+// One reference reading: UTC was utc_us at esp_timer time local_us
+void time_sync_reference(time_source_t source, int64_t utc_us, int64_t local_us);
+
+// UTC at an esp_timer time, false until a reference has been seen
+bool time_sync_utc_at(int64_t local_us, int64_t *utc_us);
+
+// Queues a marker triggered at esp_timer time trigger_us for a bit per
+// camera to HiLight, never blocks
+void time_sync_marker(time_marker_source_t source, int64_t trigger_us, uint32_t cameras);
+
+// Bit per camera recording right now, for markers that are not a start
+uint32_t time_sync_recording_cameras(void);
+
+// GET reports the clock, each camera's offset and the last markers, POST
+// {"utc_ms": ...} sets the clock
+esp_err_t time_sync_handler(httpd_req_t *req);
+
+// POST drops a marker now
+esp_err_t time_sync_marker_handler(httpd_req_t *req);
+
+#endif // TIME_SYNC_H
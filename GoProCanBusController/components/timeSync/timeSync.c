@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "cameraCommand.h"
+#include "cameraState.h"
+#include "stationTable.h"
+#include "linkMonitor.h"
+#include "ble_gopro.h"
+#include "metrics.h"
+#include "clockDiscipline.h"
+#include "timeSync.h"
+
+static const char *TAG = "time_sync";
+
+// Markers waiting for their HiLights, a burst of button presses fits
+#define MARKER_QUEUE_LEN 8
+
+// How often the sync task looks for cameras to set when nothing wakes it
+#define SYNC_TICK_MS 1000
+
+// Tries per join before a camera is left until it joins again or is resynced
+#define PUSH_ATTEMPTS 5
+
+// Least time left before the second the time is sent for, so the task can
+// sleep until then instead of missing it
+#define PUSH_LEAD_US 200000
+
+// How long the camera's clock is read back for; two seconds roll over in it
+#define MEASURE_WINDOW_US 2500000
+
+// An HTTP reference is coarse, one from the bus wins for this long
+#define CAN_REFERENCE_HOLD_US (5 * 1000000LL)
+
+// Status id of the camera's date and time in /gp/gpControl/status, as
+// "%YY%MM%DD%hh%mm%ss" in hex
+#define STATUS_DATE_TIME "40"
+#define STATUS_BODY_MAX  4096
+
+// Open GoPro set date and time: year (big endian), month, day, hour, minute, second
+#define BLE_CMD_SET_DATE_TIME 0x0D
+#define BLE_DATE_TIME_LEN     7
+
+#define TIME_BODY_MAX    64
+
+// Cameras keep local time, UTC shifted by the configured offset
+#define UTC_OFFSET_S     (CONFIG_TIME_SYNC_UTC_OFFSET_MIN * 60)
+
+typedef struct {
+    bool pending;               // Has an address and is waiting to be set
+    uint8_t attempts;
+    bool set;
+    int64_t set_utc_us;
+    bool measured;
+    int64_t offset_us;          // Camera clock minus UTC
+    uint32_t uncertainty_us;    // Half the window the offset was bracketed in
+    int64_t measured_utc_us;
+    uint32_t generation;        // Counts the slot's joins and leaves
+} camera_clock_t;
+
+typedef struct {
+    time_marker_source_t source;
+    int64_t trigger_us;         // esp_timer time of the trigger
+    int64_t utc_us;             // 0 when the clock was not set yet
+    uint32_t cameras;           // Bit per camera to HiLight
+    uint32_t hilights;          // Bit per camera that took the HiLight
+    uint32_t delay_us[MAX_CAMERAS]; // From the trigger to the camera's ack
+} time_marker_t;
+
+static const char *const source_names[] = {
+    [TIME_SOURCE_NONE] = "none",
+    [TIME_SOURCE_CAN] = "can",
+    [TIME_SOURCE_HTTP] = "http",
+};
+
+static const char *const marker_names[] = {
+    [TIME_MARKER_CAN] = "can",
+    [TIME_MARKER_RECORD] = "record",
+    [TIME_MARKER_HTTP] = "http",
+};
+
+static portMUX_TYPE sync_lock = portMUX_INITIALIZER_UNLOCKED;
+static clock_discipline_t wall_clock;
+static time_source_t clock_source;
+static int64_t last_reference_us;
+static int64_t last_can_reference_us = -CAN_REFERENCE_HOLD_US;
+static camera_clock_t cameras[MAX_CAMERAS];
+static time_marker_t markers[CONFIG_TIME_SYNC_MARKERS_KEPT];
+static uint32_t marker_count;
+
+static QueueHandle_t marker_queue;
+static TaskHandle_t sync_task_handle;
+
+// Only the sync task reads camera status, one at a time
+static char status_body[STATUS_BODY_MAX];
+
+void time_sync_reference(time_source_t source, int64_t utc_us, int64_t local_us)
+{
+    taskENTER_CRITICAL(&sync_lock);
+    bool held = source != TIME_SOURCE_CAN && local_us - last_can_reference_us < CAN_REFERENCE_HOLD_US;
+    bool first = !held && !wall_clock.synced;
+    if (!held) {
+        if (source == TIME_SOURCE_CAN) {
+            last_can_reference_us = local_us;
+        }
+        clock_discipline_sample(&wall_clock, utc_us, local_us);
+        clock_source = source;
+        last_reference_us = local_us;
+    }
+    taskEXIT_CRITICAL(&sync_lock);
+    // Cameras that joined before there was a time to give them are due now
+    if (first && sync_task_handle != NULL) {
+        xTaskNotifyGive(sync_task_handle);
+    }
+}
+
+bool time_sync_utc_at(int64_t local_us, int64_t *utc_us)
+{
+    taskENTER_CRITICAL(&sync_lock);
+    bool synced = clock_discipline_utc(&wall_clock, local_us, utc_us);
+    taskEXIT_CRITICAL(&sync_lock);
+    return synced;
+}
+
+static bool utc_now(int64_t *utc_us)
+{
+    return time_sync_utc_at(esp_timer_get_time(), utc_us);
+}
+
+// Sleeps until local_us, at most two ticks late: a delay of n ticks ends on
+// the nth tick interrupt, which can be anything up to a tick away. A
+// request's own latency varies by more than that and the offset left is
+// measured afterwards anyway.
+static void wait_until(int64_t local_us)
+{
+    int64_t wait_us = local_us - esp_timer_get_time();
+    if (wait_us > 0) {
+        int64_t tick_us = portTICK_PERIOD_MS * 1000;
+        vTaskDelay((wait_us + tick_us - 1) / tick_us + 1);
+    }
+}
+
+// "%19%0A%13..." as year in the century, month, day, hour, minute, second
+static bool parse_camera_date(const char *text, int64_t *camera_s)
+{
+    unsigned fields[6];
+    if (sscanf(text, "%%%2x%%%2x%%%2x%%%2x%%%2x%%%2x", &fields[0], &fields[1], &fields[2], &fields[3],
+               &fields[4], &fields[5]) != 6) {
+        return false;
+    }
+    clock_date_t date = {
+        .year = 2000 + fields[0],
+        .month = fields[1],
+        .day = fields[2],
+        .hour = fields[3],
+        .minute = fields[4],
+        .second = fields[5],
+    };
+    *camera_s = clock_date_to_utc(&date);
+    return true;
+}
+
+// Reads the camera's clock. It was read somewhere between sent_us and
+// answered_us, both UTC.
+static bool read_camera_time(esp_http_client_handle_t client, int camera, int64_t *camera_s,
+                             int64_t *sent_us, int64_t *answered_us)
+{
+    char url[64];
+    if (!camera_base_url(camera, url, sizeof(url))) {
+        return false;
+    }
+    strlcat(url, "/gp/gpControl/status", sizeof(url));
+    esp_http_client_set_url(client, url);
+
+    utc_now(sent_us);
+    esp_err_t err = esp_http_client_open(client, 0);
+    metrics_inc(METRIC_HTTP_CLIENT_REQUESTS);
+    if (err != ESP_OK || esp_http_client_fetch_headers(client) < 0) {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
+        esp_http_client_close(client);
+        return false;
+    }
+    // The camera read its clock before it sent the headers
+    utc_now(answered_us);
+    int len = esp_http_client_read_response(client, status_body, sizeof(status_body) - 1);
+    if (len < 0 || !esp_http_client_is_complete_data_received(client) ||
+        esp_http_client_get_status_code(client) != 200) {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
+        esp_http_client_close(client);
+        return false;
+    }
+    status_body[len] = '\0';
+
+    cJSON *root = cJSON_Parse(status_body);
+    cJSON *item = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "status"), STATUS_DATE_TIME);
+    bool ok = cJSON_IsString(item) && parse_camera_date(item->valuestring, camera_s);
+    cJSON_Delete(root);
+    return ok;
+}
+
+static esp_err_t set_camera_time_http(esp_http_client_handle_t client, int camera, int64_t camera_s)
+{
+    clock_date_t date;
+    clock_date_from_utc(camera_s, &date);
+    char url[128];
+    if (!camera_base_url(camera, url, sizeof(url))) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t len = strlen(url);
+    snprintf(url + len, sizeof(url) - len, "/gp/gpControl/command/setup/date_time?p=%%%02x%%%02x%%%02x%%%02x%%%02x%%%02x",
+             date.year % 100, date.month, date.day, date.hour, date.minute, date.second);
+    esp_http_client_set_url(client, url);
+    esp_err_t err = esp_http_client_perform(client);
+    metrics_inc(METRIC_HTTP_CLIENT_REQUESTS);
+    if (err == ESP_OK && esp_http_client_get_status_code(client) != 200) {
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        metrics_inc(METRIC_HTTP_CLIENT_ERRORS);
+    }
+    return err;
+}
+
+static esp_err_t set_camera_time_ble(int64_t camera_s)
+{
+    clock_date_t date;
+    clock_date_from_utc(camera_s, &date);
+    uint8_t packet[] = {
+        2 + BLE_DATE_TIME_LEN, BLE_CMD_SET_DATE_TIME, BLE_DATE_TIME_LEN,
+        date.year >> 8, date.year & 0xff, date.month, date.day, date.hour, date.minute, date.second,
+    };
+    return gopro_write_command(packet, sizeof(packet)) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// Picks the whole second to set: far enough ahead to sleep until, once the
+// one-way delay is taken off
+static int64_t next_second(int64_t utc_us, int64_t one_way_us)
+{
+    int64_t second = utc_us / 1000000 + 1;
+    if (second * 1000000 - one_way_us - utc_us < PUSH_LEAD_US) {
+        second++;
+    }
+    return second;
+}
+
+// Sends the time so that it arrives as the second it names begins
+static esp_err_t send_on_second(int camera, esp_http_client_handle_t client, int64_t one_way_us, int64_t *set_utc_us)
+{
+    int64_t local_now = esp_timer_get_time();
+    int64_t utc_us;
+    if (!time_sync_utc_at(local_now, &utc_us)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t second = next_second(utc_us, one_way_us);
+    wait_until(local_now + second * 1000000 - one_way_us - utc_us);
+    *set_utc_us = second * 1000000;
+    if (client == NULL) {
+        return set_camera_time_ble(second + UTC_OFFSET_S);
+    }
+    return set_camera_time_http(client, camera, second + UTC_OFFSET_S);
+}
+
+// Reads the camera's clock back to back until its seconds roll over, which
+// happened between the read before and the read after. The narrowest of the
+// windows seen gives the offset.
+static bool measure_offset(esp_http_client_handle_t client, int camera, int64_t *offset_us, uint32_t *uncertainty_us)
+{
+    int64_t start = esp_timer_get_time();
+    int64_t last_s = 0, last_sent = 0;
+    bool have_last = false, found = false;
+    int64_t best_width = INT64_MAX;
+
+    while (esp_timer_get_time() - start < MEASURE_WINDOW_US) {
+        int64_t camera_s, sent, answered;
+        if (!read_camera_time(client, camera, &camera_s, &sent, &answered)) {
+            have_last = false;
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (have_last && camera_s == last_s + 1 && answered - last_sent < best_width) {
+            // The camera turned to camera_s between last_sent and answered
+            int64_t tick_utc = last_sent + (answered - last_sent) / 2;
+            best_width = answered - last_sent;
+            *offset_us = (camera_s - UTC_OFFSET_S) * 1000000 - tick_utc;
+            *uncertainty_us = best_width / 2;
+            found = true;
+        }
+        last_s = camera_s;
+        last_sent = sent;
+        have_last = true;
+    }
+    return found;
+}
+
+static void push_time(int camera)
+{
+    camera_clock_t result = {0};
+    esp_err_t err;
+
+    // Setting and measuring takes seconds, the slot may change hands meanwhile
+    taskENTER_CRITICAL(&sync_lock);
+    uint32_t generation = cameras[camera].generation;
+    taskEXIT_CRITICAL(&sync_lock);
+
+    if (camera_base_url(camera, NULL, 0)) {
+        esp_http_client_handle_t client = camera_command_http_client(camera);
+        if (client == NULL) {
+            return;
+        }
+        // A first read says the camera is there and how far away it is
+        int64_t camera_s, sent, answered;
+        if (!read_camera_time(client, camera, &camera_s, &sent, &answered)) {
+            err = ESP_ERR_TIMEOUT;
+        } else {
+            int64_t read_utc_s = (sent + (answered - sent) / 2) / 1000000;
+            ESP_LOGI(TAG, "Camera %d was %lld s off", camera, (long long)(camera_s - UTC_OFFSET_S - read_utc_s));
+            err = send_on_second(camera, client, (answered - sent) / 2, &result.set_utc_us);
+        }
+        if (err == ESP_OK && CONFIG_TIME_SYNC_MEASURE) {
+            result.measured = measure_offset(client, camera, &result.offset_us, &result.uncertainty_us);
+            utc_now(&result.measured_utc_us);
+        }
+        esp_http_client_cleanup(client);
+    } else if (camera == 0 && connected_camera.command_handle != 0) {
+        // Over BLE nothing reads the clock back, and the delay is a guess
+        err = send_on_second(camera, NULL, 0, &result.set_utc_us);
+    } else {
+        err = ESP_ERR_INVALID_STATE;
+    }
+
+    taskENTER_CRITICAL(&sync_lock);
+    camera_clock_t *cam = &cameras[camera];
+    // Dropped if the camera left, or another one joined in its slot
+    bool stale = cam->generation != generation;
+    if (!stale && err == ESP_OK) {
+        cam->pending = false;
+        cam->set = true;
+        cam->set_utc_us = result.set_utc_us;
+        cam->measured = result.measured;
+        cam->offset_us = result.offset_us;
+        cam->uncertainty_us = result.uncertainty_us;
+        cam->measured_utc_us = result.measured_utc_us;
+    } else if (!stale && ++cam->attempts >= PUSH_ATTEMPTS) {
+        cam->pending = false;
+    }
+    uint8_t attempts = cam->attempts;
+    taskEXIT_CRITICAL(&sync_lock);
+
+    if (stale) {
+        ESP_LOGI(TAG, "Camera %d left while its time was set, result dropped", camera);
+    } else if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Setting the time of camera %d failed (%d of %d): %s", camera, attempts, PUSH_ATTEMPTS,
+                 esp_err_to_name(err));
+    } else if (result.measured) {
+        ESP_LOGI(TAG, "Camera %d set, off by %lld us +/- %lu us", camera, (long long)result.offset_us,
+                 (unsigned long)result.uncertainty_us);
+    } else {
+        ESP_LOGI(TAG, "Camera %d set", camera);
+    }
+}
+
+// Due when it has an address, is not recording and its Wi-Fi link is not down
+static bool push_due(int camera, const camera_state_t *state, int64_t utc_us)
+{
+    taskENTER_CRITICAL(&sync_lock);
+    camera_clock_t *cam = &cameras[camera];
+    if (CONFIG_TIME_SYNC_RESYNC_MIN > 0 && cam->set && !cam->pending &&
+        utc_us - cam->set_utc_us > CONFIG_TIME_SYNC_RESYNC_MIN * 60 * 1000000LL) {
+        cam->pending = true;
+        cam->attempts = 0;
+    }
+    bool pending = cam->pending;
+    taskEXIT_CRITICAL(&sync_lock);
+    // Cameras refuse settings while recording
+    return pending && !state->recording && link_monitor_state(camera, LINK_TRANSPORT_WIFI) != LINK_STATE_DOWN;
+}
+
+static void sync_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SYNC_TICK_MS));
+        int64_t utc_us;
+        if (!utc_now(&utc_us)) {
+            continue;
+        }
+        camera_state_t states[MAX_CAMERAS];
+        camera_state_snapshot(states);
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            if (push_due(camera, &states[camera], utc_us)) {
+                push_time(camera);
+            }
+        }
+    }
+}
+
+static void station_bound(int camera, const station_t *station, bool bound)
+{
+    if (camera < 0 || camera >= MAX_CAMERAS) {
+        return;
+    }
+    taskENTER_CRITICAL(&sync_lock);
+    cameras[camera] = (camera_clock_t){
+        .pending = bound && CONFIG_TIME_SYNC_PUSH_ON_CONNECT,
+        .generation = cameras[camera].generation + 1,
+    };
+    taskEXIT_CRITICAL(&sync_lock);
+    if (bound && sync_task_handle != NULL) {
+        xTaskNotifyGive(sync_task_handle);
+    }
+}
+
+void time_sync_marker(time_marker_source_t source, int64_t trigger_us, uint32_t cameras)
+{
+    time_marker_t marker = {.source = source, .trigger_us = trigger_us, .cameras = cameras};
+    if (marker_queue == NULL || xQueueSend(marker_queue, &marker, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Marker queue full, %s marker dropped", marker_names[source]);
+    }
+}
+
+uint32_t time_sync_recording_cameras(void)
+{
+    camera_state_t states[MAX_CAMERAS];
+    camera_state_snapshot(states);
+    uint32_t cameras = 0;
+    for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+        if (states[camera].recording) {
+            cameras |= 1u << camera;
+        }
+    }
+    return cameras;
+}
+
+// HiLights the marker's cameras, one after another like a shutter dispatch.
+// The mask is taken when the marker is queued: a camera the start just went
+// to may not have acked it yet, but it is recording all the same.
+static void marker_task(void *arg)
+{
+    const camera_command_t *hilight = camera_command_find("hilight");
+    time_marker_t marker;
+    while (1) {
+        xQueueReceive(marker_queue, &marker, portMAX_DELAY);
+        if (!time_sync_utc_at(marker.trigger_us, &marker.utc_us)) {
+            marker.utc_us = 0;
+        }
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            camera_transport_t transport;
+            if (!(marker.cameras & (1u << camera)) || !camera_transport_pick(hilight, camera, &transport)) {
+                continue;
+            }
+            if (camera_command_send(hilight, camera, 0, transport) == ESP_OK) {
+                marker.hilights |= 1u << camera;
+                marker.delay_us[camera] = esp_timer_get_time() - marker.trigger_us;
+            }
+        }
+
+        taskENTER_CRITICAL(&sync_lock);
+        markers[marker_count++ % CONFIG_TIME_SYNC_MARKERS_KEPT] = marker;
+        taskEXIT_CRITICAL(&sync_lock);
+        ESP_LOGI(TAG, "Marker from %s at %lld.%06lld UTC, HiLight on cameras 0x%lx", marker_names[marker.source],
+                 (long long)(marker.utc_us / 1000000), (long long)(marker.utc_us % 1000000),
+                 (unsigned long)marker.hilights);
+    }
+}
+
+void time_sync_init(void)
+{
+    clock_discipline_init(&wall_clock, CONFIG_TIME_SYNC_STEP_MS * 1000);
+    station_table_subscribe(station_bound);
+
+    marker_queue = xQueueCreate(MARKER_QUEUE_LEN, sizeof(time_marker_t));
+    if (marker_queue == NULL) {
+        ESP_LOGE(TAG, "No memory for the marker queue");
+        return;
+    }
+    TaskHandle_t task;
+    // Above the sync task, whose reads of a camera's clock take seconds
+    if (xTaskCreate(marker_task, "time_marker", 4096, NULL, 5, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
+    if (xTaskCreate(sync_task, "time_sync", 4096, NULL, 3, &sync_task_handle) == pdPASS) {
+        metrics_register_task(sync_task_handle);
+    }
+}
+
+static esp_err_t send_error(httpd_req_t *req, const char *message)
+{
+    char body[96];
+    snprintf(body, sizeof(body), "{\"error\":\"%s\"}", message);
+    httpd_resp_set_status(req, "400 Bad Request");
+    return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+// NULL once the clock has taken the time, or what was wrong with the body
+static const char *set_from_request(httpd_req_t *req)
+{
+    int64_t local_us = esp_timer_get_time();
+    char body[TIME_BODY_MAX + 1];
+    if (req->content_len == 0 || req->content_len > TIME_BODY_MAX) {
+        return "body missing or too large";
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return "body not received";
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    cJSON *item = cJSON_GetObjectItem(root, "utc_ms");
+    bool ok = cJSON_IsNumber(item) && item->valuedouble > 0;
+    if (ok) {
+        time_sync_reference(TIME_SOURCE_HTTP, (int64_t)item->valuedouble * 1000, local_us);
+    }
+    cJSON_Delete(root);
+    return ok ? NULL : "expected {\"utc_ms\": <milliseconds since 1970>}";
+}
+
+// One chunk of the body, false once the connection has failed
+static bool send_chunk(httpd_req_t *req, const char *chunk, int len)
+{
+    return httpd_resp_send_chunk(req, chunk, len) == ESP_OK;
+}
+
+esp_err_t time_sync_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_POST) {
+        const char *error = set_from_request(req);
+        if (error != NULL) {
+            return send_error(req, error);
+        }
+    }
+
+    // Off the stack, the HTTP server runs one handler at a time
+    static char json[512];
+    int64_t now = esp_timer_get_time();
+    int64_t utc_us = 0;
+    taskENTER_CRITICAL(&sync_lock);
+    clock_discipline_t clock = wall_clock;
+    time_source_t source = clock_source;
+    int64_t reference_us = last_reference_us;
+    camera_clock_t clocks[MAX_CAMERAS];
+    memcpy(clocks, cameras, sizeof(clocks));
+    uint32_t count = marker_count;
+    taskEXIT_CRITICAL(&sync_lock);
+    clock_discipline_utc(&clock, now, &utc_us);
+
+    int len = snprintf(json, sizeof(json),
+                       "{\"synced\":%s,\"source\":\"%s\",\"utc_us\":%lld,\"reference_age_ms\":%lld,"
+                       "\"samples\":%lu,\"steps\":%lu,\"drift_ppb\":%ld,\"last_error_us\":%lld,\"cameras\":[",
+                       clock.synced ? "true" : "false", source_names[source], (long long)utc_us,
+                       clock.synced ? (long long)((now - reference_us) / 1000) : -1LL,
+                       (unsigned long)clock.samples, (unsigned long)clock.steps, (long)clock.drift_ppb,
+                       (long long)clock.last_error_us);
+    bool ok = send_chunk(req, json, len);
+
+    for (int camera = 0; camera < MAX_CAMERAS && ok; camera++) {
+        const camera_clock_t *cam = &clocks[camera];
+        len = snprintf(json, sizeof(json), "%s{\"camera\":%d,\"pending\":%s,\"set\":%s", camera ? "," : "",
+                       camera, cam->pending ? "true" : "false", cam->set ? "true" : "false");
+        if (cam->measured) {
+            len += snprintf(json + len, sizeof(json) - len,
+                            ",\"offset_us\":%lld,\"uncertainty_us\":%lu,\"measured_age_s\":%lld",
+                            (long long)cam->offset_us, (unsigned long)cam->uncertainty_us,
+                            (long long)((utc_us - cam->measured_utc_us) / 1000000));
+        }
+        len += snprintf(json + len, sizeof(json) - len, "}");
+        ok = send_chunk(req, json, len);
+    }
+    ok = ok && send_chunk(req, "],\"markers\":[", HTTPD_RESP_USE_STRLEN);
+
+    // Oldest first, each copied out of the lock before it is formatted
+    uint32_t kept = count < CONFIG_TIME_SYNC_MARKERS_KEPT ? count : CONFIG_TIME_SYNC_MARKERS_KEPT;
+    for (uint32_t i = count - kept; i < count && ok; i++) {
+        taskENTER_CRITICAL(&sync_lock);
+        time_marker_t marker = markers[i % CONFIG_TIME_SYNC_MARKERS_KEPT];
+        taskEXIT_CRITICAL(&sync_lock);
+        len = snprintf(json, sizeof(json), "%s{\"source\":\"%s\",\"utc_us\":%lld,\"age_ms\":%lld,\"hilight_delay_us\":[",
+                       i > count - kept ? "," : "", marker_names[marker.source], (long long)marker.utc_us,
+                       (long long)((now - marker.trigger_us) / 1000));
+        for (int camera = 0; camera < MAX_CAMERAS; camera++) {
+            if (marker.hilights & (1u << camera)) {
+                len += snprintf(json + len, sizeof(json) - len, "%s%lu", camera ? "," : "",
+                                (unsigned long)marker.delay_us[camera]);
+            } else {
+                len += snprintf(json + len, sizeof(json) - len, "%snull", camera ? "," : "");
+            }
+        }
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+        ok = send_chunk(req, json, len);
+    }
+    ok = ok && send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    return ok && send_chunk(req, NULL, 0) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t time_sync_marker_handler(httpd_req_t *req)
+{
+    time_sync_marker(TIME_MARKER_HTTP, esp_timer_get_time(), time_sync_recording_cameras());
+    return httpd_resp_send(req, "{}", HTTPD_RESP_USE_STRLEN);
+}
@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include "unity.h"
+#include "timerWheel.h"
+
+// First tick of each outer level, where a deadline stops fitting the one below
+#define L1_TICKS    (1u << TIMER_WHEEL_L0_BITS)
+#define L2_TICKS    (1u << (TIMER_WHEEL_L0_BITS + TIMER_WHEEL_LN_BITS))
+#define L3_TICKS    (1u << (TIMER_WHEEL_L0_BITS + 2 * TIMER_WHEEL_LN_BITS))
+
+#define MAX_FIRES   8
+
+typedef struct {
+    int fires;
+    uint32_t ticks[MAX_FIRES];  // Tick each run was for
+    timer_node_t *cancel;       // Cancelled from the callback, may be itself
+    uint32_t restart;           // Re-armed this many ticks later if not 0
+} record_t;
+
+static timer_wheel_t wheel;
+static timer_node_t node_a, node_b;
+static record_t record_a, record_b;
+
+// The wheel steps past a tick before running it
+static uint32_t current_tick(void)
+{
+    return wheel.now - 1;
+}
+
+static void fired(timer_node_t *node, void *arg)
+{
+    record_t *record = arg;
+    if (record->fires < MAX_FIRES) {
+        record->ticks[record->fires] = current_tick();
+    }
+    record->fires++;
+    if (record->cancel != NULL) {
+        timer_wheel_cancel(&wheel, record->cancel);
+    }
+    if (record->restart != 0) {
+        timer_wheel_add(&wheel, node, current_tick() + record->restart, 0);
+    }
+}
+
+static void start(uint32_t now)
+{
+    timer_wheel_init(&wheel, now);
+    timer_node_init(&node_a, fired, &record_a);
+    timer_node_init(&node_b, fired, &record_b);
+    record_a = (record_t){0};
+    record_b = (record_t){0};
+}
+
+// Arms a one-shot delta ticks ahead and checks it fires on that tick exactly
+static void check_fires_on_time(uint32_t now, uint32_t delta)
+{
+    start(now);
+    uint32_t expires = now + delta;
+    timer_wheel_add(&wheel, &node_a, expires, 0);
+    TEST_ASSERT_EQUAL_INT(0, timer_wheel_advance(&wheel, expires - 1));
+    TEST_ASSERT_TRUE(timer_node_pending(&node_a));
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, expires));
+    TEST_ASSERT_EQUAL_INT(1, record_a.fires);
+    TEST_ASSERT_EQUAL_UINT32(expires, record_a.ticks[0]);
+    TEST_ASSERT_FALSE(timer_node_pending(&node_a));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.pending);
+}
+
+void setUp(void)
+{
+    start(0);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_one_shot_fires_once(void)
+{
+    check_fires_on_time(0, 1);
+    check_fires_on_time(1000, 37);
+    TEST_ASSERT_EQUAL_INT(0, timer_wheel_advance(&wheel, 5000));
+    TEST_ASSERT_EQUAL_INT(1, record_a.fires);
+}
+
+// Deadlines just inside each level and at the far end of it, from aligned and
+// unaligned starting ticks, so every level cascades down into level 0
+static void test_cascade_from_each_level(void)
+{
+    const uint32_t deltas[] = {
+        L1_TICKS - 1, L1_TICKS, L1_TICKS + 1,
+        L2_TICKS - 1, L2_TICKS, L2_TICKS + 1,
+        L3_TICKS - 1, L3_TICKS, L3_TICKS + 1,
+        TIMER_WHEEL_MAX_TICKS,
+    };
+    const uint32_t starts[] = {0, 1, L1_TICKS - 1, 12345, L2_TICKS + 77};
+    for (unsigned s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+        for (unsigned d = 0; d < sizeof(deltas) / sizeof(deltas[0]); d++) {
+            check_fires_on_time(starts[s], deltas[d]);
+        }
+    }
+}
+
+static void test_far_deadline_is_clamped(void)
+{
+    timer_wheel_add(&wheel, &node_a, TIMER_WHEEL_MAX_TICKS + 1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(TIMER_WHEEL_MAX_TICKS, node_a.expires);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, TIMER_WHEEL_MAX_TICKS));
+}
+
+// The tick counter runs over 2^32 after 497 days at 10 ms
+static void test_tick_wrap(void)
+{
+    check_fires_on_time(0xffffff00, 0x200);
+    check_fires_on_time(0xfffffff0, L2_TICKS + 3);
+    check_fires_on_time(0xffffffff, 1);
+    check_fires_on_time(UINT32_MAX - L3_TICKS, L3_TICKS + 10);
+
+    // A periodic timer keeps its cadence across the wrap
+    start(0xfffffffa);
+    timer_wheel_add(&wheel, &node_a, 0xfffffffc, 5);
+    TEST_ASSERT_EQUAL_INT(3, timer_wheel_advance(&wheel, 6));
+    TEST_ASSERT_EQUAL_UINT32(0xfffffffc, record_a.ticks[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, record_a.ticks[1]);
+    TEST_ASSERT_EQUAL_UINT32(6, record_a.ticks[2]);
+}
+
+static void test_periodic_rearms_without_drift(void)
+{
+    timer_wheel_add(&wheel, &node_a, 10, 10);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 14));
+    TEST_ASSERT_TRUE(timer_node_pending(&node_a));
+    TEST_ASSERT_EQUAL_UINT32(20, node_a.expires);
+
+    // Advancing late still runs it on every period it covers
+    TEST_ASSERT_EQUAL_INT(3, timer_wheel_advance(&wheel, 45));
+    TEST_ASSERT_EQUAL_UINT32(20, record_a.ticks[1]);
+    TEST_ASSERT_EQUAL_UINT32(30, record_a.ticks[2]);
+    TEST_ASSERT_EQUAL_UINT32(40, record_a.ticks[3]);
+    TEST_ASSERT_EQUAL_UINT32(50, node_a.expires);
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.pending);
+
+    // A period longer than level 0 goes through the cascade every time
+    start(0);
+    timer_wheel_add(&wheel, &node_a, 1000, 1000);
+    TEST_ASSERT_EQUAL_INT(4, timer_wheel_advance(&wheel, 4000));
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT32(1000 * (i + 1), record_a.ticks[i]);
+    }
+}
+
+static void test_callback_cancels_itself(void)
+{
+    record_a.cancel = &node_a;
+    timer_wheel_add(&wheel, &node_a, 5, 5);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 100));
+    TEST_ASSERT_FALSE(timer_node_pending(&node_a));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.pending);
+}
+
+static void test_callback_restarts_itself(void)
+{
+    record_a.restart = 7;
+    timer_wheel_add(&wheel, &node_a, 3, 0);
+    TEST_ASSERT_EQUAL_INT(3, timer_wheel_advance(&wheel, 20));
+    TEST_ASSERT_EQUAL_UINT32(3, record_a.ticks[0]);
+    TEST_ASSERT_EQUAL_UINT32(10, record_a.ticks[1]);
+    TEST_ASSERT_EQUAL_UINT32(17, record_a.ticks[2]);
+    TEST_ASSERT_EQUAL_UINT32(24, node_a.expires);
+
+    // Restarting a periodic timer replaces its next run
+    start(0);
+    record_a.restart = 300;
+    timer_wheel_add(&wheel, &node_a, 2, 4);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 301));
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 302));
+    TEST_ASSERT_EQUAL_UINT32(302, record_a.ticks[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.pending);
+}
+
+// A deadline already passed runs on the next tick instead of being lost
+static void test_passed_deadline_fires_next(void)
+{
+    timer_wheel_add(&wheel, &node_a, 4, 0);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 4));
+    timer_wheel_add(&wheel, &node_a, 4, 0);
+    TEST_ASSERT_EQUAL_INT(0, timer_wheel_advance(&wheel, 3));
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 5));
+    TEST_ASSERT_EQUAL_UINT32(5, record_a.ticks[1]);
+
+    // A periodic one resumes its period from there, the missed runs are skipped
+    timer_wheel_add(&wheel, &node_a, 2, 3);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 6));
+    TEST_ASSERT_EQUAL_UINT32(7, node_a.expires);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 9));
+    TEST_ASSERT_EQUAL_UINT32(7, record_a.ticks[3]);
+}
+
+static void test_callback_cancels_another_due_timer(void)
+{
+    record_a.cancel = &node_b;
+    timer_wheel_add(&wheel, &node_a, 8, 0);
+    timer_wheel_add(&wheel, &node_b, 8, 0);
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 8));
+    TEST_ASSERT_EQUAL_INT(0, record_b.fires);
+    TEST_ASSERT_FALSE(timer_node_pending(&node_b));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.pending);
+}
+
+static void test_cancel_and_move(void)
+{
+    timer_wheel_add(&wheel, &node_a, 500, 0);
+    timer_wheel_add(&wheel, &node_b, 600, 0);
+    timer_wheel_cancel(&wheel, &node_a);
+    timer_wheel_cancel(&wheel, &node_a);
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.pending);
+
+    // Re-arming a pending timer moves it instead of adding it twice
+    timer_wheel_add(&wheel, &node_b, 20, 0);
+    timer_wheel_add(&wheel, &node_b, 30, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.pending);
+    TEST_ASSERT_EQUAL_INT(0, timer_wheel_advance(&wheel, 29));
+    TEST_ASSERT_EQUAL_INT(1, timer_wheel_advance(&wheel, 1000));
+    TEST_ASSERT_EQUAL_INT(0, record_a.fires);
+    TEST_ASSERT_EQUAL_UINT32(30, record_b.ticks[0]);
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_one_shot_fires_once);
+    RUN_TEST(test_cascade_from_each_level);
+    RUN_TEST(test_far_deadline_is_clamped);
+    RUN_TEST(test_tick_wrap);
+    RUN_TEST(test_periodic_rearms_without_drift);
+    RUN_TEST(test_callback_cancels_itself);
+    RUN_TEST(test_callback_restarts_itself);
+    RUN_TEST(test_passed_deadline_fires_next);
+    RUN_TEST(test_callback_cancels_another_due_timer);
+    RUN_TEST(test_cancel_and_move);
+    exit(UNITY_END());
+}
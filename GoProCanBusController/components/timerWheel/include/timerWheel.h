@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// Hierarchical timer wheel. Timer nodes are embedded in the structs that own
+// them, so arming a timer never allocates; adding and cancelling are O(1).
+// The wheel itself only counts ticks and builds on the host, the timer
+// service below drives it from one FreeRTOS task.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_L0_BITS   8     // 256 ticks at full resolution
+#define TIMER_WHEEL_LN_BITS   6     // Each outer level covers 64 of the one below
+#define TIMER_WHEEL_LEVELS    4     // 2^26 ticks, over 7 days at 10 ms
+
+#define TIMER_WHEEL_L0_SIZE   (1u << TIMER_WHEEL_L0_BITS)
+#define TIMER_WHEEL_LN_SIZE   (1u << TIMER_WHEEL_LN_BITS)
+#define TIMER_WHEEL_MAX_TICKS ((1u << (TIMER_WHEEL_L0_BITS + (TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_LN_BITS)) - 1)
+
+typedef struct timer_node timer_node_t;
+typedef void (*timer_fn_t)(timer_node_t *node, void *arg);
+
+// Slots are circular lists headed by a bare link, 8 bytes a slot
+typedef struct timer_link {
+    struct timer_link *next;    // NULL while the timer is not armed
+    struct timer_link *prev;
+} timer_link_t;
+
+struct timer_node {
+    timer_link_t link;          // First, a slot's links are cast back to nodes
+    uint32_t expires;           // Tick the timer fires on
+    uint32_t period;            // Ticks between runs, 0 for a one-shot
+    timer_fn_t fn;
+    void *arg;
+};
+
+typedef struct {
+    timer_link_t l0[TIMER_WHEEL_L0_SIZE];
+    timer_link_t ln[TIMER_WHEEL_LEVELS - 1][TIMER_WHEEL_LN_SIZE];
+    uint32_t now;               // Next tick to run
+    uint32_t pending;
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t now);
+
+// Sets the callback once, the node can then be armed any number of times
+void timer_node_init(timer_node_t *node, timer_fn_t fn, void *arg);
+
+static inline bool timer_node_pending(const timer_node_t *node)
+{
+    return node->link.next != NULL;
+}
+
+// Arms a timer for an absolute tick, re-arming one that is pending moves it.
+// A tick already passed fires on the next advance.
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint32_t expires, uint32_t period);
+
+// Disarms a timer, harmless if it is not pending
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_node_t *node);
+
+// Runs every timer due up to and including tick now. Periodic timers are
+// re-armed from their previous deadline, so they do not drift. Returns the
+// number of callbacks run.
+int timer_wheel_advance(timer_wheel_t *wheel, uint32_t now);
+
+// Timer service: one wheel driven by its own task. Callbacks run on that task
+// and may arm or cancel any timer, their own included. Once cancel returns
+// the callback is not running and will not run.
+
+void timer_service_init(void);
+
+// Fires after delay_ms and then every period_ms, or once if period_ms is 0
+void timer_service_start(timer_node_t *node, uint32_t delay_ms, uint32_t period_ms);
+void timer_service_cancel(timer_node_t *node);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,85 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "timerWheel.h"
+
+static const char *TAG = "timer_service";
+
+#define TICK_US ((int64_t)CONFIG_TIMER_WHEEL_TICK_MS * 1000)
+
+// A wheel tick shorter than a FreeRTOS tick still waits one
+#define TICK_DELAY (pdMS_TO_TICKS(CONFIG_TIMER_WHEEL_TICK_MS) > 0 ? pdMS_TO_TICKS(CONFIG_TIMER_WHEEL_TICK_MS) : 1)
+
+static timer_wheel_t wheel;
+static SemaphoreHandle_t wheel_lock;    // Recursive, callbacks run holding it
+static TaskHandle_t wheel_task;
+
+static uint32_t now_ticks(void)
+{
+    return (uint32_t)(esp_timer_get_time() / TICK_US);
+}
+
+static uint32_t ms_to_ticks(uint32_t ms)
+{
+    return (ms + CONFIG_TIMER_WHEEL_TICK_MS - 1) / CONFIG_TIMER_WHEEL_TICK_MS;
+}
+
+// Idles on a notification while nothing is armed, ticks only while something is
+static void timer_service_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        xSemaphoreTakeRecursive(wheel_lock, portMAX_DELAY);
+        timer_wheel_advance(&wheel, now_ticks());
+        bool idle = wheel.pending == 0;
+        xSemaphoreGiveRecursive(wheel_lock);
+
+        if (idle) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last_wake = xTaskGetTickCount();
+        } else {
+            ulTaskNotifyTake(pdTRUE, 0);
+            xTaskDelayUntil(&last_wake, TICK_DELAY);
+        }
+    }
+}
+
+void timer_service_init(void)
+{
+    wheel_lock = xSemaphoreCreateRecursiveMutex();
+    // Ticks already passed are never run, the wheel starts at the current one
+    timer_wheel_init(&wheel, now_ticks());
+    if (xTaskCreate(timer_service_task, "timer_wheel", 3072, NULL, 5, &wheel_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create timer task");
+    }
+}
+
+void timer_service_start(timer_node_t *node, uint32_t delay_ms, uint32_t period_ms)
+{
+    xSemaphoreTakeRecursive(wheel_lock, portMAX_DELAY);
+    bool was_idle = wheel.pending == 0;
+    uint32_t now = now_ticks();
+    if (was_idle) {
+        // Nothing is armed, so the ticks slept through need not be walked
+        wheel.now = now;
+    } else if ((int32_t)(now - wheel.now) < 0) {
+        // The wheel may run a tick ahead of the clock
+        now = wheel.now;
+    }
+    timer_wheel_add(&wheel, node, now + ms_to_ticks(delay_ms), ms_to_ticks(period_ms));
+    xSemaphoreGiveRecursive(wheel_lock);
+
+    if (was_idle && wheel_task) {
+        xTaskNotifyGive(wheel_task);
+    }
+}
+
+void timer_service_cancel(timer_node_t *node)
+{
+    xSemaphoreTakeRecursive(wheel_lock, portMAX_DELAY);
+    timer_wheel_cancel(&wheel, node);
+    xSemaphoreGiveRecursive(wheel_lock);
+}
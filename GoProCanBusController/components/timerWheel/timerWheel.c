@@ -0,0 +1,165 @@
+#include <stddef.h>
+#include "timerWheel.h"
+
+#define L0_MASK (TIMER_WHEEL_L0_SIZE - 1)
+#define LN_MASK (TIMER_WHEEL_LN_SIZE - 1)
+
+// Bit where the slot index of an outer level starts, level 1 is the first
+#define LEVEL_SHIFT(level) (TIMER_WHEEL_L0_BITS + ((level) - 1) * TIMER_WHEEL_LN_BITS)
+
+static void list_init(timer_link_t *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static bool list_empty(const timer_link_t *head)
+{
+    return head->next == head;
+}
+
+static void list_append(timer_link_t *head, timer_link_t *link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void list_remove(timer_link_t *link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = NULL;
+    link->prev = NULL;
+}
+
+// Moves every entry of src onto the empty list dst
+static void list_take(timer_link_t *dst, timer_link_t *src)
+{
+    if (list_empty(src)) {
+        list_init(dst);
+        return;
+    }
+    dst->next = src->next;
+    dst->prev = src->prev;
+    dst->next->prev = dst;
+    dst->prev->next = dst;
+    list_init(src);
+}
+
+// Picks the slot by how far away the deadline is, the innermost level whose
+// span covers it keeps the most resolution
+static timer_link_t *slot_for(timer_wheel_t *wheel, uint32_t expires)
+{
+    uint32_t delta = expires - wheel->now;
+    if ((int32_t)delta < 0) {
+        return &wheel->l0[wheel->now & L0_MASK];
+    }
+    if (delta < TIMER_WHEEL_L0_SIZE) {
+        return &wheel->l0[expires & L0_MASK];
+    }
+    int level = 1;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    return &wheel->ln[level - 1][(expires >> LEVEL_SHIFT(level)) & LN_MASK];
+}
+
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t now)
+{
+    for (unsigned i = 0; i < TIMER_WHEEL_L0_SIZE; i++) {
+        list_init(&wheel->l0[i]);
+    }
+    for (int level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+        for (unsigned i = 0; i < TIMER_WHEEL_LN_SIZE; i++) {
+            list_init(&wheel->ln[level][i]);
+        }
+    }
+    wheel->now = now;
+    wheel->pending = 0;
+}
+
+void timer_node_init(timer_node_t *node, timer_fn_t fn, void *arg)
+{
+    node->link.next = NULL;
+    node->link.prev = NULL;
+    node->expires = 0;
+    node->period = 0;
+    node->fn = fn;
+    node->arg = arg;
+}
+
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint32_t expires, uint32_t period)
+{
+    timer_wheel_cancel(wheel, node);
+    if ((int32_t)(expires - wheel->now) > (int32_t)TIMER_WHEEL_MAX_TICKS) {
+        expires = wheel->now + TIMER_WHEEL_MAX_TICKS;
+    }
+    node->expires = expires;
+    node->period = period;
+    list_append(slot_for(wheel, expires), &node->link);
+    wheel->pending++;
+}
+
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_node_t *node)
+{
+    if (!timer_node_pending(node)) {
+        return;
+    }
+    list_remove(&node->link);
+    wheel->pending--;
+}
+
+// Spreads one outer slot over the levels below it, returns its index
+static uint32_t cascade(timer_wheel_t *wheel, int level)
+{
+    uint32_t index = (wheel->now >> LEVEL_SHIFT(level)) & LN_MASK;
+    timer_link_t moving;
+    list_take(&moving, &wheel->ln[level - 1][index]);
+    while (!list_empty(&moving)) {
+        timer_link_t *link = moving.next;
+        list_remove(link);
+        timer_node_t *node = (timer_node_t *)link;
+        list_append(slot_for(wheel, node->expires), link);
+    }
+    return index;
+}
+
+int timer_wheel_advance(timer_wheel_t *wheel, uint32_t now)
+{
+    int ran = 0;
+
+    while ((int32_t)(now - wheel->now) >= 0) {
+        uint32_t index = wheel->now & L0_MASK;
+        // Each time the inner level wraps, the next outer slot moves in
+        if (index == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS && cascade(wheel, level) == 0; level++) {
+            }
+        }
+
+        // Step past the tick first, so anything armed for it from a callback
+        // lands in the next slot instead of the one being emptied
+        timer_link_t due;
+        list_take(&due, &wheel->l0[index]);
+        wheel->now++;
+
+        while (!list_empty(&due)) {
+            timer_node_t *node = (timer_node_t *)due.next;
+            list_remove(&node->link);
+            wheel->pending--;
+            // Re-armed before the callback so it can cancel itself; periods
+            // missed while the wheel was held up are skipped, not replayed
+            if (node->period != 0) {
+                uint32_t next = node->expires + node->period;
+                if ((int32_t)(next - wheel->now) < 0) {
+                    next = wheel->now;
+                }
+                timer_wheel_add(wheel, node, next, node->period);
+            }
+            node->fn(node, node->arg);
+            ran++;
+        }
+    }
+    return ran;
+}
@@ -0,0 +1,372 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "remoteEngine.h"
+
+#define POLL_MS     1000
+#define WAKEUP_MS   500
+#define MAX_MISSED  3
+#define RETRY_MS    100
+#define MAX_RETRIES 2
+
+#define CAMERA_IP   0x0a474f02
+
+#define SENT_MAX    32
+
+typedef struct {
+    int camera;
+    remote_command_id_t command;
+    uint8_t arg;
+} sent_frame_t;
+
+typedef struct {
+    remote_command_id_t command;
+    uint32_t targets;
+    uint32_t acked;
+    uint32_t skew_ms;
+} broadcast_result_t;
+
+// What the engine did through its callbacks since the last setUp()
+static sent_frame_t sent[SENT_MAX];
+static int sent_count;
+static int changed_calls;
+static remote_camera_t last_changed;
+static int acked_calls;
+static remote_command_id_t last_acked;
+static uint32_t last_ack_latency_ms;
+static int polled_calls;
+static bool last_poll_answered;
+static uint32_t last_poll_rtt_ms;
+static int done_calls;
+static broadcast_result_t dones[4];
+
+static remote_engine_t engine;
+
+static void fake_send(void *ctx, int camera, uint32_t ip, const uint8_t *frame, size_t len)
+{
+    TEST_ASSERT_TRUE(len >= REMOTE_HEADER_LEN);
+    TEST_ASSERT_EQUAL_HEX32(CAMERA_IP + camera, ip);
+    TEST_ASSERT_EQUAL_UINT8(REMOTE_DIR_REQUEST, frame[REMOTE_DIRECTION_OFFSET]);
+    if (sent_count == SENT_MAX) {
+        return;
+    }
+    sent_frame_t *out = &sent[sent_count++];
+    out->camera = camera;
+    out->command = REMOTE_CMD_UNKNOWN;
+    for (int i = 0; i < REMOTE_CMD_COUNT; i++) {
+        if (memcmp(remote_command_get(i)->opcode, &frame[REMOTE_OPCODE_OFFSET], 2) == 0) {
+            out->command = i;
+        }
+    }
+    out->arg = len > REMOTE_HEADER_LEN ? frame[REMOTE_HEADER_LEN] : 0;
+}
+
+static void fake_changed(void *ctx, int camera, const remote_camera_t *state)
+{
+    changed_calls++;
+    last_changed = *state;
+}
+
+static void fake_acked(void *ctx, int camera, remote_command_id_t command, uint8_t status, uint32_t latency_ms)
+{
+    acked_calls++;
+    last_acked = command;
+    last_ack_latency_ms = latency_ms;
+}
+
+static void fake_polled(void *ctx, int camera, bool answered, uint32_t rtt_ms)
+{
+    polled_calls++;
+    last_poll_answered = answered;
+    last_poll_rtt_ms = rtt_ms;
+}
+
+static void fake_broadcast_done(void *ctx, remote_command_id_t command, uint32_t targets, uint32_t acked,
+                                uint32_t skew_ms)
+{
+    if (done_calls < 4) {
+        dones[done_calls] = (broadcast_result_t){command, targets, acked, skew_ms};
+    }
+    done_calls++;
+}
+
+// A reply as the camera sends it, direction 0
+static void reply(int camera, remote_command_id_t command, uint8_t status, const uint8_t *payload,
+                  size_t payload_len, uint32_t now_ms)
+{
+    uint8_t frame[REMOTE_RX_MAX_LEN] = {0};
+    frame[REMOTE_STATUS_OFFSET] = status;
+    memcpy(&frame[REMOTE_OPCODE_OFFSET], remote_command_get(command)->opcode, 2);
+    memcpy(&frame[REMOTE_HEADER_LEN], payload, payload_len);
+    remote_engine_receive(&engine, camera, frame, REMOTE_HEADER_LEN + payload_len, now_ms);
+}
+
+static int count_sent(remote_command_id_t command)
+{
+    int count = 0;
+    for (int i = 0; i < sent_count; i++) {
+        count += sent[i].command == command;
+    }
+    return count;
+}
+
+// Attached and answering polls
+static void make_ready(int camera, uint32_t now_ms)
+{
+    remote_engine_attach(&engine, camera, CAMERA_IP + camera, now_ms);
+    remote_engine_tick(&engine, now_ms);
+    reply(camera, REMOTE_CMD_WAKEUP, REMOTE_STATUS_OK, NULL, 0, now_ms);
+    sent_count = 0;
+    changed_calls = 0;
+}
+
+void setUp(void)
+{
+    remote_callbacks_t callbacks = {
+        .send = fake_send,
+        .changed = fake_changed,
+        .acked = fake_acked,
+        .polled = fake_polled,
+        .broadcast_done = fake_broadcast_done,
+    };
+    remote_config_t config = {
+        .poll_interval_ms = POLL_MS,
+        .wakeup_interval_ms = WAKEUP_MS,
+        .max_missed_polls = MAX_MISSED,
+        .retry_interval_ms = RETRY_MS,
+        .max_retries = MAX_RETRIES,
+    };
+    remote_engine_init(&engine, &callbacks, &config);
+    sent_count = 0;
+    changed_calls = 0;
+    acked_calls = 0;
+    polled_calls = 0;
+    done_calls = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_wakeups_until_the_camera_answers(void)
+{
+    remote_engine_attach(&engine, 0, CAMERA_IP, 0);
+    TEST_ASSERT_EQUAL_INT(1, changed_calls);
+    TEST_ASSERT_EQUAL_INT(REMOTE_LINK_WAKING, last_changed.link);
+
+    remote_engine_tick(&engine, 0);
+    TEST_ASSERT_EQUAL_INT(1, sent_count);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_WAKEUP, sent[0].command);
+    TEST_ASSERT_EQUAL_UINT8(1, sent[0].arg);
+
+    // Nothing more until the wakeup interval is up, then another wakeup
+    remote_engine_tick(&engine, WAKEUP_MS - 1);
+    TEST_ASSERT_EQUAL_INT(1, sent_count);
+    remote_engine_tick(&engine, WAKEUP_MS);
+    TEST_ASSERT_EQUAL_INT(2, count_sent(REMOTE_CMD_WAKEUP));
+
+    reply(0, REMOTE_CMD_WAKEUP, REMOTE_STATUS_OK, NULL, 0, WAKEUP_MS + 20);
+    TEST_ASSERT_EQUAL_INT(2, changed_calls);
+    TEST_ASSERT_EQUAL_INT(REMOTE_LINK_READY, last_changed.link);
+
+    // Polls from here on, the first one a poll interval after the answer
+    sent_count = 0;
+    remote_engine_tick(&engine, WAKEUP_MS + 20 + POLL_MS - 1);
+    TEST_ASSERT_EQUAL_INT(0, sent_count);
+    remote_engine_tick(&engine, WAKEUP_MS + 20 + POLL_MS);
+    TEST_ASSERT_EQUAL_INT(1, sent_count);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_STATUS, sent[0].command);
+}
+
+static void test_status_reply_updates_the_camera(void)
+{
+    make_ready(0, 0);
+    remote_engine_tick(&engine, POLL_MS);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_STATUS, sent[0].command);
+
+    uint8_t status[] = {[REMOTE_ST_MODE] = 2, [REMOTE_ST_RECORDING] = 1};
+    reply(0, REMOTE_CMD_STATUS, REMOTE_STATUS_OK, status, sizeof(status), POLL_MS + 35);
+    TEST_ASSERT_EQUAL_INT(1, changed_calls);
+    TEST_ASSERT_TRUE(last_changed.recording);
+    TEST_ASSERT_EQUAL_UINT8(2, last_changed.mode);
+    TEST_ASSERT_EQUAL_UINT8(sizeof(status), last_changed.status_len);
+    TEST_ASSERT_EQUAL_INT(1, polled_calls);
+    TEST_ASSERT_TRUE(last_poll_answered);
+    TEST_ASSERT_EQUAL_UINT32(35, last_poll_rtt_ms);
+
+    // The same status again changes nothing the user sees
+    remote_engine_tick(&engine, 2 * POLL_MS);
+    reply(0, REMOTE_CMD_STATUS, REMOTE_STATUS_OK, status, sizeof(status), 2 * POLL_MS + 10);
+    TEST_ASSERT_EQUAL_INT(1, changed_calls);
+
+    // Too short to carry the recording flag, kept but not applied
+    uint8_t short_status[] = {5};
+    reply(0, REMOTE_CMD_STATUS, REMOTE_STATUS_OK, short_status, sizeof(short_status), 2 * POLL_MS + 20);
+    TEST_ASSERT_EQUAL_INT(1, changed_calls);
+    TEST_ASSERT_EQUAL_UINT8(2, engine.cameras[0].mode);
+}
+
+static void test_command_ack(void)
+{
+    make_ready(0, 0);
+    uint8_t start = REMOTE_SHUTTER_START;
+    TEST_ASSERT_TRUE(remote_engine_send(&engine, 0, REMOTE_CMD_SHUTTER, &start, 1, 10));
+    TEST_ASSERT_EQUAL_INT(1, sent_count);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_SHUTTER, sent[0].command);
+    TEST_ASSERT_EQUAL_UINT8(REMOTE_SHUTTER_START, sent[0].arg);
+
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 52);
+    TEST_ASSERT_EQUAL_INT(1, acked_calls);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_SHUTTER, last_acked);
+    TEST_ASSERT_EQUAL_UINT32(42, last_ack_latency_ms);
+    TEST_ASSERT_TRUE(last_changed.recording);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_UNKNOWN, engine.cameras[0].pending);
+
+    // Nothing left to retry
+    remote_engine_tick(&engine, 10 + RETRY_MS);
+    TEST_ASSERT_EQUAL_INT(1, count_sent(REMOTE_CMD_SHUTTER));
+}
+
+static void test_retries_then_gives_up(void)
+{
+    make_ready(0, 0);
+    uint8_t start = REMOTE_SHUTTER_START;
+    TEST_ASSERT_TRUE(remote_engine_send(&engine, 0, REMOTE_CMD_SHUTTER, &start, 1, 0));
+
+    remote_engine_tick(&engine, RETRY_MS - 1);
+    TEST_ASSERT_EQUAL_INT(1, count_sent(REMOTE_CMD_SHUTTER));
+    for (int retry = 1; retry <= MAX_RETRIES; retry++) {
+        remote_engine_tick(&engine, retry * RETRY_MS);
+        TEST_ASSERT_EQUAL_INT(1 + retry, count_sent(REMOTE_CMD_SHUTTER));
+        TEST_ASSERT_EQUAL_UINT8(REMOTE_SHUTTER_START, sent[sent_count - 1].arg);
+    }
+
+    // Out of retries: dropped without an ack and not sent again
+    remote_engine_tick(&engine, (MAX_RETRIES + 1) * RETRY_MS);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_UNKNOWN, engine.cameras[0].pending);
+    remote_engine_tick(&engine, (MAX_RETRIES + 2) * RETRY_MS);
+    TEST_ASSERT_EQUAL_INT(1 + MAX_RETRIES, count_sent(REMOTE_CMD_SHUTTER));
+    TEST_ASSERT_EQUAL_INT(0, acked_calls);
+    TEST_ASSERT_FALSE(engine.cameras[0].recording);
+
+    // A late ack for the dropped command is not reported
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, (MAX_RETRIES + 3) * RETRY_MS);
+    TEST_ASSERT_EQUAL_INT(0, acked_calls);
+}
+
+static void test_unanswered_polls_lose_the_link(void)
+{
+    make_ready(0, 0);
+    uint32_t now = 0;
+    for (int poll = 1; poll <= MAX_MISSED; poll++) {
+        now += POLL_MS;
+        remote_engine_tick(&engine, now);
+        TEST_ASSERT_EQUAL_INT(REMOTE_LINK_READY, engine.cameras[0].link);
+        TEST_ASSERT_EQUAL_INT(poll, count_sent(REMOTE_CMD_STATUS));
+    }
+    TEST_ASSERT_EQUAL_INT(0, changed_calls);
+
+    // The poll due after the last one missed finds the link gone
+    now += POLL_MS;
+    remote_engine_tick(&engine, now);
+    TEST_ASSERT_EQUAL_INT(1, changed_calls);
+    TEST_ASSERT_EQUAL_INT(REMOTE_LINK_LOST, last_changed.link);
+    TEST_ASSERT_FALSE(last_poll_answered);
+    TEST_ASSERT_EQUAL_INT(MAX_MISSED, polled_calls);
+
+    // Back to wakeups right away, and any answer brings it back
+    remote_engine_tick(&engine, now);
+    TEST_ASSERT_EQUAL_INT(REMOTE_CMD_WAKEUP, sent[sent_count - 1].command);
+    reply(0, REMOTE_CMD_WAKEUP, REMOTE_STATUS_OK, NULL, 0, now + 5);
+    TEST_ASSERT_EQUAL_INT(REMOTE_LINK_READY, last_changed.link);
+}
+
+static void test_detached_camera_is_left_alone(void)
+{
+    make_ready(0, 0);
+    remote_engine_detach(&engine, 0);
+    TEST_ASSERT_EQUAL_INT(REMOTE_LINK_ABSENT, last_changed.link);
+    TEST_ASSERT_EQUAL_INT(-1, remote_engine_find(&engine, CAMERA_IP));
+
+    uint8_t start = REMOTE_SHUTTER_START;
+    TEST_ASSERT_FALSE(remote_engine_send(&engine, 0, REMOTE_CMD_SHUTTER, &start, 1, 10));
+    remote_engine_tick(&engine, 10 * POLL_MS);
+    TEST_ASSERT_EQUAL_INT(0, sent_count);
+}
+
+static void test_broadcast_reports_every_ack(void)
+{
+    make_ready(0, 0);
+    make_ready(1, 0);
+    uint8_t start = REMOTE_SHUTTER_START;
+    TEST_ASSERT_EQUAL_HEX32(0x3, remote_engine_broadcast(&engine, REMOTE_CMD_SHUTTER, &start, 1, 10));
+    TEST_ASSERT_EQUAL_INT(2, count_sent(REMOTE_CMD_SHUTTER));
+
+    reply(1, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 30);
+    TEST_ASSERT_EQUAL_INT(0, done_calls);
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 45);
+    TEST_ASSERT_EQUAL_INT(1, done_calls);
+    TEST_ASSERT_EQUAL_HEX32(0x3, dones[0].targets);
+    TEST_ASSERT_EQUAL_HEX32(0x3, dones[0].acked);
+    TEST_ASSERT_EQUAL_UINT32(15, dones[0].skew_ms);
+}
+
+static void test_second_broadcast_finishes_the_first(void)
+{
+    make_ready(0, 0);
+    make_ready(1, 0);
+    uint8_t start = REMOTE_SHUTTER_START;
+    uint8_t stop = REMOTE_SHUTTER_STOP;
+    remote_engine_broadcast(&engine, REMOTE_CMD_SHUTTER, &start, 1, 10);
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 20);
+
+    // Camera 1 never acked the start, which is reported before the stop goes out
+    remote_engine_broadcast(&engine, REMOTE_CMD_SHUTTER, &stop, 1, 30);
+    TEST_ASSERT_EQUAL_INT(1, done_calls);
+    TEST_ASSERT_EQUAL_HEX32(0x3, dones[0].targets);
+    TEST_ASSERT_EQUAL_HEX32(0x1, dones[0].acked);
+
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 40);
+    reply(1, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 50);
+    TEST_ASSERT_EQUAL_INT(2, done_calls);
+    TEST_ASSERT_EQUAL_HEX32(0x3, dones[1].acked);
+    TEST_ASSERT_EQUAL_UINT32(10, dones[1].skew_ms);
+    TEST_ASSERT_FALSE(engine.cameras[1].recording);
+}
+
+static void test_unicast_replaces_a_broadcast_target(void)
+{
+    make_ready(0, 0);
+    make_ready(1, 0);
+    uint8_t start = REMOTE_SHUTTER_START;
+    uint8_t mode = 1;
+    remote_engine_broadcast(&engine, REMOTE_CMD_SHUTTER, &start, 1, 10);
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 20);
+
+    // Camera 1 is sent something else before it acked, the broadcast is done
+    TEST_ASSERT_TRUE(remote_engine_send(&engine, 1, REMOTE_CMD_MODE, &mode, 1, 30));
+    TEST_ASSERT_EQUAL_INT(1, done_calls);
+    TEST_ASSERT_EQUAL_HEX32(0x1, dones[0].acked);
+
+    // Even the same command sent again by unicast is not counted for it
+    remote_engine_broadcast(&engine, REMOTE_CMD_SHUTTER, &start, 1, 40);
+    TEST_ASSERT_TRUE(remote_engine_send(&engine, 1, REMOTE_CMD_SHUTTER, &start, 1, 50));
+    reply(0, REMOTE_CMD_SHUTTER, REMOTE_STATUS_OK, NULL, 0, 60);
+    TEST_ASSERT_EQUAL_INT(2, done_calls);
+    TEST_ASSERT_EQUAL_HEX32(0x1, dones[1].acked);
+}
+
+void app_main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wakeups_until_the_camera_answers);
+    RUN_TEST(test_status_reply_updates_the_camera);
+    RUN_TEST(test_command_ack);
+    RUN_TEST(test_retries_then_gives_up);
+    RUN_TEST(test_unanswered_polls_lose_the_link);
+    RUN_TEST(test_detached_camera_is_left_alone);
+    RUN_TEST(test_broadcast_reports_every_ack);
+    RUN_TEST(test_second_broadcast_finishes_the_first);
+    RUN_TEST(test_unicast_replaces_a_broadcast_target);
+    exit(UNITY_END());
+}
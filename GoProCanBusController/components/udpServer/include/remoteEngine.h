@@ -0,0 +1,118 @@
+#ifndef REMOTE_ENGINE_H
+#define REMOTE_ENGINE_H
+
+// Per-camera state machine for the Smart Remote protocol. Time is passed in
+// and all I/O goes through callbacks, so this builds and runs on the host.
+
+#include "remoteProtocol.h"
+
+#ifndef REMOTE_MAX_CAMERAS
+#define REMOTE_MAX_CAMERAS 4
+#endif
+
+#define REMOTE_STATUS_MAX 32
+
+typedef enum {
+    REMOTE_LINK_ABSENT,     // Slot unused
+    REMOTE_LINK_WAKING,     // Associated, sending wakeups until it answers
+    REMOTE_LINK_READY,      // Answering status polls
+    REMOTE_LINK_LOST,       // Stopped answering, back to wakeups
+} remote_link_t;
+
+typedef struct {
+    uint32_t ip;                    // IPv4 in network byte order
+    remote_link_t link;
+    bool recording;
+    uint8_t mode;
+    uint32_t last_rx_ms;
+    uint32_t next_tx_ms;            // When the next wakeup or poll is due
+    uint8_t missed_polls;
+    bool poll_outstanding;
+    uint32_t poll_sent_ms;
+    remote_command_id_t pending;    // Command waiting for its reply
+    uint8_t pending_arg;
+    uint32_t pending_since_ms;
+    uint32_t retry_at_ms;           // When the pending command is sent again
+    uint8_t retries;
+    uint8_t status[REMOTE_STATUS_MAX];
+    uint8_t status_len;
+    uint8_t tx[REMOTE_FRAME_MAX_LEN];
+} remote_camera_t;
+
+typedef struct {
+    // Sends one frame to a camera, the frame lives in the camera's tx buffer
+    void (*send)(void *ctx, int camera, uint32_t ip, const uint8_t *frame, size_t len);
+    // Link, recording or mode of a camera changed
+    void (*changed)(void *ctx, int camera, const remote_camera_t *state);
+    // A camera answered a command sent with remote_engine_send()
+    void (*acked)(void *ctx, int camera, remote_command_id_t command, uint8_t status, uint32_t latency_ms);
+    // Sends one frame to every camera on the subnet, NULL if broadcast is not available
+    void (*broadcast)(void *ctx, const uint8_t *frame, size_t len);
+    // A status poll was answered, or was still unanswered when the next one
+    // came due; NULL if nobody measures the link
+    void (*polled)(void *ctx, int camera, bool answered, uint32_t rtt_ms);
+    // Every target of a broadcast acked or ran out of retries, skew is the
+    // time between the first and the last ack
+    void (*broadcast_done)(void *ctx, remote_command_id_t command, uint32_t targets,
+                           uint32_t acked, uint32_t skew_ms);
+    void *ctx;
+} remote_callbacks_t;
+
+typedef struct {
+    uint32_t poll_interval_ms;
+    uint32_t wakeup_interval_ms;
+    uint8_t max_missed_polls;
+    uint32_t retry_interval_ms;     // Unanswered commands are resent this often
+    uint8_t max_retries;
+} remote_config_t;
+
+// The broadcast in flight, one bit per camera
+typedef struct {
+    bool active;
+    remote_command_id_t command;
+    uint32_t targets;
+    uint32_t acked;
+    uint32_t waiting;               // Targets neither acked nor given up on
+    uint32_t first_ack_ms;
+    uint32_t last_ack_ms;
+} remote_broadcast_t;
+
+typedef struct {
+    remote_camera_t cameras[REMOTE_MAX_CAMERAS];
+    remote_callbacks_t cb;
+    remote_config_t config;
+    remote_broadcast_t broadcast;
+    uint8_t broadcast_tx[REMOTE_FRAME_MAX_LEN];
+} remote_engine_t;
+
+void remote_engine_init(remote_engine_t *engine, const remote_callbacks_t *cb, const remote_config_t *config);
+
+// Takes effect from the next poll, wakeup or retry each camera schedules
+void remote_engine_configure(remote_engine_t *engine, const remote_config_t *config);
+
+// A camera joined the access point, wake it up on the next tick
+void remote_engine_attach(remote_engine_t *engine, int camera, uint32_t ip, uint32_t now_ms);
+void remote_engine_detach(remote_engine_t *engine, int camera);
+
+// Camera slot for a source address, -1 if unknown
+int remote_engine_find(const remote_engine_t *engine, uint32_t ip);
+
+// Replaces the camera's pending command. If that was a broadcast's the camera
+// no longer counts towards it, as if it had run out of retries.
+bool remote_engine_send(remote_engine_t *engine, int camera, remote_command_id_t command,
+                        const uint8_t *args, size_t args_len, uint32_t now_ms);
+
+// Sends one frame to every camera that has joined and tracks each ack, cameras
+// that do not ack are retried with unicast. Returns the cameras expected to ack.
+// A broadcast still in flight is reported done first, without the acks it
+// was still waiting for.
+uint32_t remote_engine_broadcast(remote_engine_t *engine, remote_command_id_t command,
+                                 const uint8_t *args, size_t args_len, uint32_t now_ms);
+
+void remote_engine_receive(remote_engine_t *engine, int camera, const uint8_t *buf, size_t len,
+                           uint32_t now_ms);
+
+// Sends every wakeup, status poll and retry that is due
+void remote_engine_tick(remote_engine_t *engine, uint32_t now_ms);
+
+#endif // REMOTE_ENGINE_H
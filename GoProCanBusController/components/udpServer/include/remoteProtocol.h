@@ -0,0 +1,72 @@
+#ifndef REMOTE_PROTOCOL_H
+#define REMOTE_PROTOCOL_H
+
+// GoPro Smart Remote Wi-Fi protocol: frame layout and command catalog.
+// Plain C with no ESP-IDF dependencies so it also builds on the host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REMOTE_CAMERA_PORT      8484    // Cameras listen here, runtime config may override
+#define REMOTE_LISTEN_PORT      8383    // Replies come back here, likewise
+
+// Frame layout, taken from the shutter packet the remote sends:
+//   0..8    reserved, always zero
+//   9       direction, 1 from the remote, 0 from the camera
+//   10      status, 0 in requests, result code in replies
+//   11..12  two letter opcode, e.g. "SH"
+//   13..    arguments
+#define REMOTE_DIRECTION_OFFSET 9
+#define REMOTE_STATUS_OFFSET    10
+#define REMOTE_OPCODE_OFFSET    11
+#define REMOTE_HEADER_LEN       13
+#define REMOTE_MAX_ARGS         16
+#define REMOTE_FRAME_MAX_LEN    (REMOTE_HEADER_LEN + REMOTE_MAX_ARGS)
+#define REMOTE_RX_MAX_LEN       128     // Status replies carry more than requests
+
+#define REMOTE_DIR_REQUEST      1
+#define REMOTE_STATUS_OK        0
+
+// Shutter arguments as sent by the Smart Remote
+#define REMOTE_SHUTTER_START    0x02
+#define REMOTE_SHUTTER_STOP     0x00
+
+// Offsets into the "st" reply payload
+#define REMOTE_ST_MODE          0
+#define REMOTE_ST_RECORDING     1
+
+typedef enum {
+    REMOTE_CMD_WAKEUP,      // "wt", wakes a sleeping camera
+    REMOTE_CMD_STATUS,      // "st", status poll, doubles as keepalive
+    REMOTE_CMD_SHUTTER,     // "SH", start or stop recording
+    REMOTE_CMD_MODE,        // "CM", camera mode
+    REMOTE_CMD_POWER,       // "PW", power off with 0
+    REMOTE_CMD_COUNT,
+    REMOTE_CMD_UNKNOWN = REMOTE_CMD_COUNT,
+} remote_command_id_t;
+
+typedef struct {
+    char opcode[2];
+    uint8_t arg_len;        // Number of argument bytes the command takes
+} remote_command_t;
+
+// A received frame, payload points into the receive buffer
+typedef struct {
+    remote_command_id_t command;
+    char opcode[2];
+    uint8_t status;
+    const uint8_t *payload;
+    size_t payload_len;
+} remote_frame_t;
+
+const remote_command_t *remote_command_get(remote_command_id_t command);
+
+// Writes a request frame into buf, returns its length or 0 if it does not fit
+size_t remote_frame_build(uint8_t *buf, size_t size, remote_command_id_t command,
+                          const uint8_t *args, size_t args_len);
+
+// Parses a frame in place, false if it is too short or not from a camera
+bool remote_frame_parse(const uint8_t *buf, size_t len, remote_frame_t *frame);
+
+#endif // REMOTE_PROTOCOL_H
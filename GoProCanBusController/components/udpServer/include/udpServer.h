@@ -5,12 +5,27 @@
 #include "lwip/sockets.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "remoteProtocol.h"
 
-#define UDP_PORT 8383
-#define UDP_REMOTE_PORT 8484
-#define UDP_REMOTE_IP "10.71.79.2"
+// Engine tick, also the longest a reply waits in the socket before it is handled
+#define UDP_TICK_MS 50
+
+// Datagrams drained from the socket per wakeup before the engine sees them
+#define UDP_RX_BATCH 8
 
 void udp_server_init(void);
-void udp_send_message(const char *message);
+
+// Sends a Smart Remote command to one camera, false if the camera has not joined
+bool udp_remote_send(int camera, remote_command_id_t command, const uint8_t *args, size_t args_len);
+
+// Sends a command to every joined camera, as one broadcast frame when
+// CONFIG_REMOTE_BROADCAST is set. Returns a bit per camera expected to ack.
+uint32_t udp_remote_send_all(remote_command_id_t command, const uint8_t *args, size_t args_len);
+
+// Sees every datagram from a joined camera once the engine has taken it, on
+// the server task with the engine locked
+typedef void (*udp_rx_hook_t)(int camera, const uint8_t *data, size_t len, void *ctx);
+
+void udp_server_set_rx_hook(udp_rx_hook_t hook, void *ctx);
 
 #endif
@@ -0,0 +1,296 @@
+#include <string.h>
+#include "remoteEngine.h"
+
+// Wrap-safe "a is at or after b" for millisecond timestamps
+static bool time_reached(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) >= 0;
+}
+
+static void notify_changed(remote_engine_t *engine, int camera)
+{
+    if (engine->cb.changed != NULL) {
+        engine->cb.changed(engine->cb.ctx, camera, &engine->cameras[camera]);
+    }
+}
+
+static bool transmit(remote_engine_t *engine, int camera, remote_command_id_t command,
+                     const uint8_t *args, size_t args_len)
+{
+    remote_camera_t *cam = &engine->cameras[camera];
+    size_t len = remote_frame_build(cam->tx, sizeof(cam->tx), command, args, args_len);
+    if (len == 0) {
+        return false;
+    }
+    engine->cb.send(engine->cb.ctx, camera, cam->ip, cam->tx, len);
+    return true;
+}
+
+// Reports the broadcast once no target is still waiting for its ack
+static void broadcast_check(remote_engine_t *engine)
+{
+    remote_broadcast_t *bc = &engine->broadcast;
+    if (!bc->active || bc->waiting != 0) {
+        return;
+    }
+    bc->active = false;
+    if (engine->cb.broadcast_done != NULL) {
+        engine->cb.broadcast_done(engine->cb.ctx, bc->command, bc->targets, bc->acked,
+                                  bc->acked ? bc->last_ack_ms - bc->first_ack_ms : 0);
+    }
+}
+
+// The camera no longer owes the broadcast an ack, whether it sent one or not
+static void broadcast_drop(remote_engine_t *engine, int camera)
+{
+    engine->broadcast.waiting &= ~(1u << camera);
+    broadcast_check(engine);
+}
+
+static void set_pending(remote_camera_t *cam, remote_command_id_t command, const uint8_t *args,
+                        size_t args_len, uint32_t now_ms, uint32_t retry_interval_ms)
+{
+    cam->pending = command;
+    cam->pending_arg = args_len > 0 ? args[0] : 0;
+    cam->pending_since_ms = now_ms;
+    cam->retry_at_ms = now_ms + retry_interval_ms;
+    cam->retries = 0;
+}
+
+void remote_engine_init(remote_engine_t *engine, const remote_callbacks_t *cb, const remote_config_t *config)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->cb = *cb;
+    engine->config = *config;
+}
+
+void remote_engine_configure(remote_engine_t *engine, const remote_config_t *config)
+{
+    engine->config = *config;
+}
+
+void remote_engine_attach(remote_engine_t *engine, int camera, uint32_t ip, uint32_t now_ms)
+{
+    if (camera < 0 || camera >= REMOTE_MAX_CAMERAS) {
+        return;
+    }
+    remote_camera_t *cam = &engine->cameras[camera];
+    memset(cam, 0, sizeof(*cam));
+    cam->ip = ip;
+    cam->link = REMOTE_LINK_WAKING;
+    cam->pending = REMOTE_CMD_UNKNOWN;
+    cam->next_tx_ms = now_ms;
+    notify_changed(engine, camera);
+}
+
+void remote_engine_detach(remote_engine_t *engine, int camera)
+{
+    if (camera < 0 || camera >= REMOTE_MAX_CAMERAS || engine->cameras[camera].link == REMOTE_LINK_ABSENT) {
+        return;
+    }
+    engine->cameras[camera].link = REMOTE_LINK_ABSENT;
+    engine->cameras[camera].ip = 0;
+    engine->cameras[camera].pending = REMOTE_CMD_UNKNOWN;
+    notify_changed(engine, camera);
+    broadcast_drop(engine, camera);
+}
+
+int remote_engine_find(const remote_engine_t *engine, uint32_t ip)
+{
+    for (int i = 0; i < REMOTE_MAX_CAMERAS; i++) {
+        if (engine->cameras[i].link != REMOTE_LINK_ABSENT && engine->cameras[i].ip == ip) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool remote_engine_send(remote_engine_t *engine, int camera, remote_command_id_t command,
+                        const uint8_t *args, size_t args_len, uint32_t now_ms)
+{
+    if (camera < 0 || camera >= REMOTE_MAX_CAMERAS || engine->cameras[camera].link == REMOTE_LINK_ABSENT) {
+        return false;
+    }
+    if (!transmit(engine, camera, command, args, args_len)) {
+        return false;
+    }
+    set_pending(&engine->cameras[camera], command, args, args_len, now_ms, engine->config.retry_interval_ms);
+    broadcast_drop(engine, camera);
+    return true;
+}
+
+uint32_t remote_engine_broadcast(remote_engine_t *engine, remote_command_id_t command,
+                                 const uint8_t *args, size_t args_len, uint32_t now_ms)
+{
+    uint32_t targets = 0;
+    for (int i = 0; i < REMOTE_MAX_CAMERAS; i++) {
+        if (engine->cameras[i].link != REMOTE_LINK_ABSENT) {
+            targets |= 1u << i;
+        }
+    }
+    if (targets == 0) {
+        return 0;
+    }
+
+    // Without a broadcast path the same tracking runs over unicast
+    size_t len = remote_frame_build(engine->broadcast_tx, sizeof(engine->broadcast_tx), command, args, args_len);
+    if (len == 0) {
+        return 0;
+    }
+    // The new command replaces whatever the last broadcast still waits for
+    engine->broadcast.waiting = 0;
+    broadcast_check(engine);
+
+    if (engine->cb.broadcast != NULL) {
+        engine->cb.broadcast(engine->cb.ctx, engine->broadcast_tx, len);
+    }
+    for (int i = 0; i < REMOTE_MAX_CAMERAS; i++) {
+        if (targets & (1u << i)) {
+            if (engine->cb.broadcast == NULL) {
+                transmit(engine, i, command, args, args_len);
+            }
+            set_pending(&engine->cameras[i], command, args, args_len, now_ms, engine->config.retry_interval_ms);
+        }
+    }
+    engine->broadcast = (remote_broadcast_t){
+        .active = true,
+        .command = command,
+        .targets = targets,
+        .waiting = targets,
+    };
+    return targets;
+}
+
+// Applies a status reply, returns true if anything shown to the user changed
+static bool apply_status(remote_camera_t *cam, const remote_frame_t *frame)
+{
+    size_t len = frame->payload_len < REMOTE_STATUS_MAX ? frame->payload_len : REMOTE_STATUS_MAX;
+    memcpy(cam->status, frame->payload, len);
+    cam->status_len = len;
+    if (len <= REMOTE_ST_RECORDING) {
+        return false;
+    }
+    bool recording = cam->status[REMOTE_ST_RECORDING] != 0;
+    uint8_t mode = cam->status[REMOTE_ST_MODE];
+    bool changed = recording != cam->recording || mode != cam->mode;
+    cam->recording = recording;
+    cam->mode = mode;
+    return changed;
+}
+
+void remote_engine_receive(remote_engine_t *engine, int camera, const uint8_t *buf, size_t len,
+                           uint32_t now_ms)
+{
+    remote_frame_t frame;
+    if (camera < 0 || camera >= REMOTE_MAX_CAMERAS || !remote_frame_parse(buf, len, &frame)) {
+        return;
+    }
+    remote_camera_t *cam = &engine->cameras[camera];
+    if (cam->link == REMOTE_LINK_ABSENT) {
+        return;
+    }
+
+    // Any answer proves the link is alive
+    bool changed = cam->link != REMOTE_LINK_READY;
+    if (changed) {
+        cam->next_tx_ms = now_ms + engine->config.poll_interval_ms;
+    }
+    cam->link = REMOTE_LINK_READY;
+    cam->last_rx_ms = now_ms;
+    cam->missed_polls = 0;
+
+    switch (frame.command) {
+    case REMOTE_CMD_STATUS:
+        if (cam->poll_outstanding && engine->cb.polled != NULL) {
+            engine->cb.polled(engine->cb.ctx, camera, true, now_ms - cam->poll_sent_ms);
+        }
+        cam->poll_outstanding = false;
+        changed |= apply_status(cam, &frame);
+        break;
+    case REMOTE_CMD_SHUTTER:
+        if (frame.status == REMOTE_STATUS_OK && cam->pending == REMOTE_CMD_SHUTTER) {
+            bool recording = cam->pending_arg == REMOTE_SHUTTER_START;
+            changed |= recording != cam->recording;
+            cam->recording = recording;
+        }
+        break;
+    case REMOTE_CMD_MODE:
+        if (frame.status == REMOTE_STATUS_OK && cam->pending == REMOTE_CMD_MODE) {
+            changed |= cam->pending_arg != cam->mode;
+            cam->mode = cam->pending_arg;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (cam->pending == frame.command) {
+        cam->pending = REMOTE_CMD_UNKNOWN;
+        if (engine->cb.acked != NULL) {
+            engine->cb.acked(engine->cb.ctx, camera, frame.command, frame.status,
+                             now_ms - cam->pending_since_ms);
+        }
+        remote_broadcast_t *bc = &engine->broadcast;
+        if (bc->active && (bc->waiting & (1u << camera))) {
+            if (bc->acked == 0) {
+                bc->first_ack_ms = now_ms;
+            }
+            bc->acked |= 1u << camera;
+            bc->last_ack_ms = now_ms;
+            broadcast_drop(engine, camera);
+        }
+    }
+    if (changed) {
+        notify_changed(engine, camera);
+    }
+}
+
+void remote_engine_tick(remote_engine_t *engine, uint32_t now_ms)
+{
+    static const uint8_t wakeup_arg = 1;
+
+    for (int i = 0; i < REMOTE_MAX_CAMERAS; i++) {
+        remote_camera_t *cam = &engine->cameras[i];
+        if (cam->link == REMOTE_LINK_ABSENT) {
+            continue;
+        }
+
+        // Resend an unanswered command by unicast, or give up on it
+        if (cam->pending != REMOTE_CMD_UNKNOWN && time_reached(now_ms, cam->retry_at_ms)) {
+            if (cam->retries < engine->config.max_retries) {
+                transmit(engine, i, cam->pending, &cam->pending_arg, remote_command_get(cam->pending)->arg_len);
+                cam->retries++;
+                cam->retry_at_ms = now_ms + engine->config.retry_interval_ms;
+            } else {
+                cam->pending = REMOTE_CMD_UNKNOWN;
+                broadcast_drop(engine, i);
+            }
+        }
+
+        if (!time_reached(now_ms, cam->next_tx_ms)) {
+            continue;
+        }
+
+        if (cam->link != REMOTE_LINK_READY) {
+            transmit(engine, i, REMOTE_CMD_WAKEUP, &wakeup_arg, 1);
+            cam->next_tx_ms = now_ms + engine->config.wakeup_interval_ms;
+            continue;
+        }
+
+        // The previous poll is still unanswered
+        if (cam->poll_outstanding && engine->cb.polled != NULL) {
+            engine->cb.polled(engine->cb.ctx, i, false, 0);
+        }
+        if (cam->poll_outstanding && ++cam->missed_polls >= engine->config.max_missed_polls) {
+            cam->link = REMOTE_LINK_LOST;
+            cam->poll_outstanding = false;
+            cam->next_tx_ms = now_ms;
+            notify_changed(engine, i);
+            continue;
+        }
+        transmit(engine, i, REMOTE_CMD_STATUS, NULL, 0);
+        cam->poll_outstanding = true;
+        cam->poll_sent_ms = now_ms;
+        cam->next_tx_ms = now_ms + engine->config.poll_interval_ms;
+    }
+}
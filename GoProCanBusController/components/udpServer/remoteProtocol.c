@@ -0,0 +1,54 @@
+#include <string.h>
+#include "remoteProtocol.h"
+
+static const remote_command_t commands[REMOTE_CMD_COUNT] = {
+    [REMOTE_CMD_WAKEUP] = {{'w', 't'}, 1},
+    [REMOTE_CMD_STATUS] = {{'s', 't'}, 0},
+    [REMOTE_CMD_SHUTTER] = {{'S', 'H'}, 1},
+    [REMOTE_CMD_MODE] = {{'C', 'M'}, 1},
+    [REMOTE_CMD_POWER] = {{'P', 'W'}, 1},
+};
+
+const remote_command_t *remote_command_get(remote_command_id_t command)
+{
+    if (command >= REMOTE_CMD_COUNT) {
+        return NULL;
+    }
+    return &commands[command];
+}
+
+size_t remote_frame_build(uint8_t *buf, size_t size, remote_command_id_t command,
+                          const uint8_t *args, size_t args_len)
+{
+    const remote_command_t *cmd = remote_command_get(command);
+    if (cmd == NULL || args_len != cmd->arg_len || size < REMOTE_HEADER_LEN + args_len) {
+        return 0;
+    }
+    memset(buf, 0, REMOTE_HEADER_LEN);
+    buf[REMOTE_DIRECTION_OFFSET] = REMOTE_DIR_REQUEST;
+    buf[REMOTE_STATUS_OFFSET] = REMOTE_STATUS_OK;
+    memcpy(&buf[REMOTE_OPCODE_OFFSET], cmd->opcode, 2);
+    if (args_len > 0) {
+        memcpy(&buf[REMOTE_HEADER_LEN], args, args_len);
+    }
+    return REMOTE_HEADER_LEN + args_len;
+}
+
+bool remote_frame_parse(const uint8_t *buf, size_t len, remote_frame_t *frame)
+{
+    if (len < REMOTE_HEADER_LEN || buf[REMOTE_DIRECTION_OFFSET] == REMOTE_DIR_REQUEST) {
+        return false;
+    }
+    memcpy(frame->opcode, &buf[REMOTE_OPCODE_OFFSET], 2);
+    frame->status = buf[REMOTE_STATUS_OFFSET];
+    frame->payload = &buf[REMOTE_HEADER_LEN];
+    frame->payload_len = len - REMOTE_HEADER_LEN;
+    frame->command = REMOTE_CMD_UNKNOWN;
+    for (int i = 0; i < REMOTE_CMD_COUNT; i++) {
+        if (memcmp(commands[i].opcode, frame->opcode, 2) == 0) {
+            frame->command = i;
+            break;
+        }
+    }
+    return true;
+}
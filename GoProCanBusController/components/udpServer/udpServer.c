@@ -1,62 +1,378 @@
 #include "udpServer.h"
+#include "remoteEngine.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "softAP.h"
+#include "stationTable.h"
+#include "cameraState.h"
+#include "metrics.h"
+#include "configStore.h"
+#include "linkMonitor.h"
+#include "binLog.h"
+#include "shutterTrace.h"
 
 static const char *TAG = "UDP_SERVER";
-static int udp_socket;
-static struct sockaddr_in remote_addr;
+static int udp_socket = -1;
+static remote_engine_t engine;
+static SemaphoreHandle_t engine_lock;
 
-void udp_server_task(void *pvParameters) {
+// Where each camera is reached, prebuilt so a send only picks its slot
+typedef struct {
+    struct sockaddr_in addr;
+    bool used;
+} udp_slot_t;
+
+static udp_slot_t slots[REMOTE_MAX_CAMERAS];
+
+// Directed broadcast of the softAP subnet, e.g. 10.71.79.255
+static struct sockaddr_in broadcast_addr;
+
+// From the runtime configuration, both in network byte order
+static uint16_t camera_port;
+static uint16_t listen_port;
+
+// Set when the listen port changed, the server task reopens its socket
+static bool reopen;
+
+// Datagrams read in one pass and handed to the engine under one lock
+typedef struct {
+    uint8_t data[REMOTE_RX_MAX_LEN];
+    uint16_t len;
+    uint32_t source;        // IPv4 of the sender, network byte order
+} udp_rx_t;
+
+static udp_rx_t rx_batch[UDP_RX_BATCH];
+
+// Both only change with engine_lock held
+static udp_rx_hook_t rx_hook;
+static void *rx_ctx;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Engine callbacks, all called with engine_lock held
+
+static void remote_send(void *ctx, int camera, uint32_t ip, const uint8_t *frame, size_t len)
+{
+    if (!slots[camera].used) {
+        return;
+    }
+    if (sendto(udp_socket, frame, len, 0, (struct sockaddr *)&slots[camera].addr,
+               sizeof(slots[camera].addr)) < 0) {
+        BINLOGW(TAG, "Send to camera %d failed: errno %d", camera, errno);
+        return;
+    }
+    metrics_inc(METRIC_REMOTE_FRAMES_SENT);
+}
+
+static void remote_broadcast(void *ctx, const uint8_t *frame, size_t len)
+{
+    if (sendto(udp_socket, frame, len, 0, (struct sockaddr *)&broadcast_addr, sizeof(broadcast_addr)) < 0) {
+        BINLOGW(TAG, "Broadcast failed: errno %d", errno);
+        return;
+    }
+    metrics_inc(METRIC_REMOTE_FRAMES_SENT);
+}
+
+static void remote_broadcast_done(void *ctx, remote_command_id_t command, uint32_t targets,
+                                  uint32_t acked, uint32_t skew_ms)
+{
+    uint32_t missed = __builtin_popcount(targets & ~acked);
+    if (missed > 0) {
+        metrics_add(METRIC_REMOTE_BROADCAST_MISSED, missed);
+        BINLOGW(TAG, "Broadcast command %d: cameras 0x%lx of 0x%lx never acked",
+                 command, (unsigned long)(targets & ~acked), (unsigned long)targets);
+    }
+    if (acked != 0) {
+        metrics_observe(METRIC_REMOTE_BROADCAST_SKEW, skew_ms * 1000);
+        BINLOGI(TAG, "Broadcast command %d: acks spread over %lu ms", command, (unsigned long)skew_ms);
+    }
+}
+
+static void remote_changed(void *ctx, int camera, const remote_camera_t *state)
+{
+    BINLOGI(TAG, "Camera %d link %d recording %d mode %d",
+             camera, state->link, state->recording, state->mode);
+    camera_state_set_recording(camera, state->recording);
+    trace_camera_recording(camera, state->recording);
+}
+
+static void remote_acked(void *ctx, int camera, remote_command_id_t command, uint8_t status,
+                         uint32_t latency_ms)
+{
+    if (status != REMOTE_STATUS_OK) {
+        BINLOGW(TAG, "Camera %d rejected command %d: status %u", camera, command, status);
+        return;
+    }
+    if (command == REMOTE_CMD_SHUTTER) {
+        metrics_observe(METRIC_SHUTTER_LATENCY_REMOTE, latency_ms * 1000);
+        trace_camera_stage(camera, TRACE_STAGE_ACKED);
+    }
+}
+
+// Status polls double as the Smart Remote link probes
+static void remote_polled(void *ctx, int camera, bool answered, uint32_t rtt_ms)
+{
+    link_monitor_record(camera, LINK_TRANSPORT_REMOTE, answered, rtt_ms * 1000);
+}
+
+// Called from the station table on the DHCP ACK, so the first wakeup goes
+// out on the next tick instead of after a discovery round
+static void station_bound(int camera, const station_t *station, bool bound)
+{
+    if (camera >= REMOTE_MAX_CAMERAS) {
+        return;
+    }
+    udp_slot_t *slot = &slots[camera];
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    if (bound) {
+        slot->addr.sin_family = AF_INET;
+        slot->addr.sin_port = camera_port;
+        slot->addr.sin_addr.s_addr = station->ip;
+        slot->used = true;
+        remote_engine_attach(&engine, camera, station->ip, now_ms());
+    } else {
+        memset(slot, 0, sizeof(*slot));
+        remote_engine_detach(&engine, camera);
+    }
+    xSemaphoreGive(engine_lock);
+}
+
+// Reads every datagram that is already queued, up to one batch, without blocking
+static int udp_drain(void)
+{
+    int count = 0;
+    while (count < UDP_RX_BATCH) {
+        udp_rx_t *rx = &rx_batch[count];
+        struct sockaddr_in source_addr;
+        socklen_t addr_len = sizeof(source_addr);
+        int len = recvfrom(udp_socket, rx->data, sizeof(rx->data), MSG_DONTWAIT,
+                           (struct sockaddr *)&source_addr, &addr_len);
+        if (len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            }
+            break;
+        }
+        rx->len = len;
+        rx->source = source_addr.sin_addr.s_addr;
+        count++;
+    }
+    return count;
+}
+
+// Hands each datagram of a batch to its camera, the engine parses it in place
+static void udp_dispatch(int count, uint32_t now)
+{
+    for (int i = 0; i < count; i++) {
+        udp_rx_t *rx = &rx_batch[i];
+        int camera = station_table_find_ip(rx->source);
+        if (camera < 0 || camera >= REMOTE_MAX_CAMERAS || !slots[camera].used) {
+            metrics_inc(METRIC_REMOTE_FRAMES_DROPPED);
+            continue;
+        }
+        remote_engine_receive(&engine, camera, rx->data, rx->len, now);
+        if (rx_hook != NULL) {
+            rx_hook(camera, rx->data, rx->len, rx_ctx);
+        }
+    }
+}
+
+// Binds a fresh socket to the listen port, -1 on failure
+static int udp_open(void)
+{
     struct sockaddr_in server_addr;
-    char rx_buffer[128];
-    socklen_t addr_len = sizeof(remote_addr);
 
     // Create UDP socket
-    udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (udp_socket < 0) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
         ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
-        vTaskDelete(NULL);
+        return -1;
     }
 
     // Bind socket to port
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    server_addr.sin_port = htons(UDP_PORT);
+    server_addr.sin_port = listen_port;
 
-    if (bind(udp_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    if (bind(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
-        close(udp_socket);
-        vTaskDelete(NULL);
+        close(sock);
+        return -1;
     }
 
-    ESP_LOGI(TAG, "UDP Server listening on port %d", UDP_PORT);
+#if CONFIG_REMOTE_BROADCAST
+    int enable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) < 0) {
+        ESP_LOGE(TAG, "Enabling broadcast failed: errno %d", errno);
+    }
+#endif
+
+    ESP_LOGI(TAG, "UDP Server listening on port %d", ntohs(listen_port));
+    return sock;
+}
+
+void udp_server_task(void *pvParameters) {
+    udp_socket = udp_open();
+    if (udp_socket < 0) {
+        vTaskDelete(NULL);
+    }
 
+    uint32_t next_tick = now_ms();
     while (1) {
-        int len = recvfrom(udp_socket, rx_buffer, sizeof(rx_buffer) - 1, 0,
-                           (struct sockaddr *)&remote_addr, &addr_len);
+        if (__atomic_exchange_n(&reopen, false, __ATOMIC_ACQ_REL)) {
+            xSemaphoreTake(engine_lock, portMAX_DELAY);
+            close(udp_socket);
+            udp_socket = udp_open();
+            xSemaphoreGive(engine_lock);
+            if (udp_socket < 0) {
+                break;
+            }
+        }
 
-        if (len < 0) {
-            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+        // Sleep until a datagram arrives or the next engine tick is due
+        uint32_t now = now_ms();
+        int32_t wait_ms = (int32_t)(next_tick - now);
+        if (wait_ms < 0) {
+            wait_ms = 0;
+        }
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(udp_socket, &readable);
+        struct timeval timeout = {.tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000};
+        int ready = select(udp_socket + 1, &readable, NULL, NULL, &timeout);
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
             break;
         }
 
-        rx_buffer[len] = '\0';
-        ESP_LOGI(TAG, "Received %d bytes from %s: %s", len, inet_ntoa(remote_addr.sin_addr), rx_buffer);
+        // Keep draining while the batch comes back full, one lock per batch
+        int count = ready > 0 ? UDP_RX_BATCH : 0;
+        while (count == UDP_RX_BATCH) {
+            count = udp_drain();
+            if (count == 0) {
+                break;
+            }
+            metrics_add(METRIC_REMOTE_FRAMES_RECEIVED, count);
+            xSemaphoreTake(engine_lock, portMAX_DELAY);
+            udp_dispatch(count, now_ms());
+            xSemaphoreGive(engine_lock);
+        }
+
+        now = now_ms();
+        if ((int32_t)(now - next_tick) >= 0) {
+            xSemaphoreTake(engine_lock, portMAX_DELAY);
+            remote_engine_tick(&engine, now);
+            xSemaphoreGive(engine_lock);
+            next_tick = now + UDP_TICK_MS;
+        }
     }
 
-    close(udp_socket);
+    if (udp_socket >= 0) {
+        close(udp_socket);
+        udp_socket = -1;
+    }
     vTaskDelete(NULL);
 }
 
-void udp_send_message(const char *message) {
-    remote_addr.sin_family = AF_INET;
-    remote_addr.sin_port = htons(UDP_REMOTE_PORT);
-    inet_pton(AF_INET, UDP_REMOTE_IP, &remote_addr.sin_addr);
+static void remote_config_from(const runtime_config_t *config, remote_config_t *remote)
+{
+    remote->poll_interval_ms = config->remote_poll_interval_ms;
+    remote->wakeup_interval_ms = config->remote_wakeup_interval_ms;
+    remote->max_missed_polls = config->remote_max_missed_polls;
+    remote->retry_interval_ms = config->remote_retry_interval_ms;
+    remote->max_retries = config->remote_max_retries;
+}
+
+// Ports and the broadcast address, called with engine_lock held once the
+// server runs
+static void udp_apply_addresses(const runtime_config_t *config)
+{
+    camera_port = htons(config->camera_port);
+    listen_port = htons(config->listen_port);
+    broadcast_addr.sin_family = AF_INET;
+    broadcast_addr.sin_port = camera_port;
+    broadcast_addr.sin_addr.s_addr = config->ip | ~config->netmask;
+    for (int i = 0; i < REMOTE_MAX_CAMERAS; i++) {
+        if (slots[i].used) {
+            slots[i].addr.sin_port = camera_port;
+        }
+    }
+}
+
+static void config_changed(const runtime_config_t *config, uint32_t changed)
+{
+    if (!(changed & (RUNTIME_CONFIG_REMOTE | RUNTIME_CONFIG_PORTS | RUNTIME_CONFIG_NETWORK))) {
+        return;
+    }
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    uint16_t old_listen_port = listen_port;
+    remote_config_t remote;
+    remote_config_from(config, &remote);
+    remote_engine_configure(&engine, &remote);
+    udp_apply_addresses(config);
+    xSemaphoreGive(engine_lock);
+
+    if (listen_port != old_listen_port) {
+        __atomic_store_n(&reopen, true, __ATOMIC_RELEASE);
+    }
+}
+
+bool udp_remote_send(int camera, remote_command_id_t command, const uint8_t *args, size_t args_len) {
+    if (udp_socket < 0) {
+        return false;
+    }
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    bool sent = remote_engine_send(&engine, camera, command, args, args_len, now_ms());
+    xSemaphoreGive(engine_lock);
+    return sent;
+}
 
-    sendto(udp_socket, message, 14, 0,  // 14 bytes as per your specified packet
-           (struct sockaddr *)&remote_addr, sizeof(remote_addr));
+uint32_t udp_remote_send_all(remote_command_id_t command, const uint8_t *args, size_t args_len) {
+    if (udp_socket < 0) {
+        return 0;
+    }
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    uint32_t targets = remote_engine_broadcast(&engine, command, args, args_len, now_ms());
+    xSemaphoreGive(engine_lock);
+    return targets;
+}
 
-    ESP_LOGI(TAG, "Sent UDP packet (14 bytes)");
+void udp_server_set_rx_hook(udp_rx_hook_t hook, void *ctx) {
+    xSemaphoreTake(engine_lock, portMAX_DELAY);
+    rx_hook = hook;
+    rx_ctx = ctx;
+    xSemaphoreGive(engine_lock);
 }
 
 void udp_server_init(void) {
-    xTaskCreate(udp_server_task, "udp_server_task", 4096, NULL, 5, NULL);
+    static const remote_callbacks_t callbacks = {
+        .send = remote_send,
+        .changed = remote_changed,
+        .acked = remote_acked,
+        .polled = remote_polled,
+#if CONFIG_REMOTE_BROADCAST
+        .broadcast = remote_broadcast,
+#endif
+        .broadcast_done = remote_broadcast_done,
+    };
+
+    engine_lock = xSemaphoreCreateMutex();
+
+    const runtime_config_t *config = config_store_acquire();
+    remote_config_t remote;
+    remote_config_from(config, &remote);
+    remote_engine_init(&engine, &callbacks, &remote);
+    udp_apply_addresses(config);
+    config_store_release(config);
+
+    config_store_subscribe(config_changed);
+    station_table_subscribe(station_bound);
+
+    TaskHandle_t task;
+    if (xTaskCreate(udp_server_task, "udp_server_task", 4096, NULL, 5, &task) == pdPASS) {
+        metrics_register_task(task);
+    }
 }
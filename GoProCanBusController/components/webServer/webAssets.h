@@ -0,0 +1,20 @@
+#ifndef WEBASSETS_H
+#define WEBASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One gzip compressed file of the web UI, generated from data/ at build time
+typedef struct {
+    const char *uri;            // Request path, e.g. "/index.html"
+    const char *content_type;
+    const char *etag;           // Quoted strong ETag of the compressed body
+    const uint8_t *data;        // Gzip body, served as is
+    size_t size;
+} web_asset_t;
+
+// Sorted by uri, generated by tools/embed_assets.py
+extern const web_asset_t web_assets[];
+extern const size_t web_asset_count;
+
+#endif // WEBASSETS_H
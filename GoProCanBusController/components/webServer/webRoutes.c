@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "webRoutes.h"
+#include "shutter.h"
+#include "cameraInfo.h"
+#include "ble_shutter.h"
+#include "ble_gopro.h"
+#include "cameraBatch.h"
+#include "metrics.h"
+#include "dhcpReservations.h"
+#include "configStore.h"
+#include "channelSurvey.h"
+#include "linkMonitor.h"
+#include "binLog.h"
+#include "shutterTrace.h"
+#include "timeSync.h"
+
+static const char *TAG = "webroutes";
+
+static esp_err_t info_handler(httpd_req_t *req)
+{
+  get_camera_info(req);
+  return ESP_OK;
+}
+
+static esp_err_t start_handler(httpd_req_t *req)
+{
+  start_recording(req);
+  return ESP_OK;
+}
+
+static esp_err_t stop_handler(httpd_req_t *req)
+{
+  stop_recording(req);
+  return ESP_OK;
+}
+
+static esp_err_t shutter_start_handler(httpd_req_t *req)
+{
+  start_recording_ble();
+  return httpd_resp_send(req, "Action triggered on ESP32.", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t startscan_handler(httpd_req_t *req)
+{
+  ESP_LOGI(TAG, "Start scan requested");
+  ble_gopro_scan();
+  return httpd_resp_send(req, "BLE scan initiated.", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t stopscan_handler(httpd_req_t *req)
+{
+  ESP_LOGI(TAG, "Stop scan requested");
+  // ble_gopro_discovery_stop();
+  return httpd_resp_send(req, "BLE scan cancelled.", HTTPD_RESP_USE_STRLEN);
+}
+
+// Every REST endpoint, kept sorted by uri and then method for the binary search
+static const web_route_t routes[] = {
+    {"/api/batch", HTTP_POST, "application/json", camera_batch_handler},
+    {"/api/channels", HTTP_GET, "application/json", channel_survey_handler},
+    {"/api/channels", HTTP_POST, "application/json", channel_survey_handler},
+    {"/api/config", HTTP_GET, "application/json", config_store_handler},
+    {"/api/config", HTTP_POST, "application/json", config_store_handler},
+    {"/api/links", HTTP_GET, "application/json", link_monitor_handler},
+    {"/api/marker", HTTP_POST, "application/json", time_sync_marker_handler},
+    {"/api/reservations", HTTP_GET, "application/json", dhcp_reservations_handler},
+    {"/api/reservations", HTTP_POST, "application/json", dhcp_reservations_handler},
+    {"/api/time", HTTP_GET, "application/json", time_sync_handler},
+    {"/api/time", HTTP_POST, "application/json", time_sync_handler},
+    {"/api/trace", HTTP_GET, "application/json", trace_http_handler},
+    {"/info", HTTP_GET, "application/json", info_handler},
+    {"/logs", HTTP_GET, "application/octet-stream", binlog_http_handler},
+    {"/metrics", HTTP_GET, "text/plain; version=0.0.4", metrics_http_handler},
+    {"/shutter_start", HTTP_POST, "text/plain", shutter_start_handler},
+    {"/start", HTTP_POST, "text/plain", start_handler},
+    {"/startscan", HTTP_POST, "text/plain", startscan_handler},
+    {"/stop", HTTP_POST, "text/plain", stop_handler},
+    {"/stopscan", HTTP_POST, "text/plain", stopscan_handler},
+};
+
+#define ROUTE_COUNT (sizeof(routes) / sizeof(routes[0]))
+
+static int route_compare(const void *key, const void *elem)
+{
+  return strcmp(key, ((const web_route_t *)elem)->uri);
+}
+
+const web_route_t *web_route_find(const char *path, httpd_method_t method, bool *path_known)
+{
+  const web_route_t *match = bsearch(path, routes, ROUTE_COUNT, sizeof(web_route_t), route_compare);
+  *path_known = match != NULL;
+  if (match == NULL)
+  {
+    return NULL;
+  }
+
+  // bsearch lands on any entry for the path, walk back to the first one
+  while (match > routes && strcmp((match - 1)->uri, path) == 0)
+  {
+    match--;
+  }
+  for (; match < routes + ROUTE_COUNT && strcmp(match->uri, path) == 0; match++)
+  {
+    if (match->method == method)
+    {
+      return match;
+    }
+  }
+  return NULL;
+}
+
+bool web_routes_check(void)
+{
+  for (size_t i = 1; i < ROUTE_COUNT; i++)
+  {
+    int order = strcmp(routes[i - 1].uri, routes[i].uri);
+    if (order > 0 || (order == 0 && routes[i - 1].method >= routes[i].method))
+    {
+      ESP_LOGE(TAG, "Route table out of order at %s", routes[i].uri);
+      return false;
+    }
+  }
+  return true;
+}
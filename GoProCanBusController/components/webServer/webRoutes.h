@@ -0,0 +1,24 @@
+#ifndef WEBROUTES_H
+#define WEBROUTES_H
+
+#include <stdbool.h>
+#include <esp_http_server.h>
+
+typedef esp_err_t (*web_route_handler_t)(httpd_req_t *req);
+
+// One REST endpoint, the table of these lives in flash
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    const char *content_type;
+    web_route_handler_t handler;
+} web_route_t;
+
+// Finds the route for a request path (without query string) and method.
+// When only the method differs, returns NULL with *path_known set.
+const web_route_t *web_route_find(const char *path, httpd_method_t method, bool *path_known);
+
+// Logs an error if the route table is not sorted, call once at start up
+bool web_routes_check(void);
+
+#endif // WEBROUTES_H
@@ -1,87 +1,296 @@
+#include <stdlib.h>
 #include "webServer.h"
 #include "softAP.h"
-#include "shutter.h"
-#include "cameraInfo.h"
-#include "ble_shutter.h"
-#include "ble_gopro.h"
+#include "cameraState.h"
+#include "webAssets.h"
+#include "webRoutes.h"
+#include "metrics.h"
+#include "configStore.h"
+#include "binLog.h"
 #include "cJSON.h"
+#include "esp_timer.h"
 
 static const char *TAG = "webserver";
 
-// Static function for handling HTTP GET requests
-static esp_err_t get_handler(httpd_req_t *req)
+// Matches the number of sockets the server is started with
+#define HTTP_MAX_CLIENTS 7
+
+// Worst case size of one JSON camera update: every field of every camera
+#define WS_MSG_SIZE (32 + MAX_CAMERAS * 96)
+
+// Largest frame accepted from a client, the UI never sends anything bigger
+#define WS_MAX_RX_LEN 128
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define ASSET_CACHE_CONTROL "public, max-age=" STRINGIFY(CONFIG_WEB_ASSET_MAX_AGE)
+
+static httpd_handle_t server_handle = NULL;
+
+// One serialised update shared by every WebSocket client
+typedef struct
+{
+  size_t len;
+  char payload[WS_MSG_SIZE];
+} ws_broadcast_t;
+
+static int asset_compare(const void *key, const void *elem)
+{
+  return strcmp(key, ((const web_asset_t *)elem)->uri);
+}
+
+// Copies the request path without its query string, false if it does not fit
+static bool request_path(const char *uri, char *path, size_t size)
 {
-  // Open the HTML file
-  FILE *file = fopen("/spiffs/index.html", "r");
-  if (file == NULL)
+  size_t len = strcspn(uri, "?");
+  if (len >= size)
   {
-    ESP_LOGE(TAG, "Failed to open index.html");
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "File not found");
-    return ESP_FAIL;
+    return false;
   }
+  memcpy(path, uri, len);
+  path[len] = '\0';
+  return true;
+}
 
-  // Read and send file content in chunks (chunked encoding)
-  char buffer[128];
-  size_t read_bytes;
-  while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+// Looks up an embedded asset by request path
+static const web_asset_t *find_asset(const char *path)
+{
+  if (strcmp(path, "/") == 0)
   {
-    httpd_resp_send_chunk(req, buffer, read_bytes);
+    path = "/index.html";
   }
-  fclose(file);
+  return bsearch(path, web_assets, web_asset_count, sizeof(web_asset_t), asset_compare);
+}
+
+// Serves the gzip web UI straight from flash, or 304 when the browser copy is current
+static esp_err_t get_handler(httpd_req_t *req, const char *path)
+{
+  int64_t start = esp_timer_get_time();
+  const web_asset_t *asset = find_asset(path);
+  if (asset == NULL)
+  {
+    ESP_LOGE(TAG, "No asset for %s", path);
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
+  }
+
+  httpd_resp_set_hdr(req, "ETag", asset->etag);
+  httpd_resp_set_hdr(req, "Cache-Control", ASSET_CACHE_CONTROL);
 
-  // Indicate the end of the response
-  httpd_resp_send_chunk(req, NULL, 0);
-  return ESP_OK;
+  char if_none_match[24];
+  esp_err_t ret;
+  size_t sent;
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+      strcmp(if_none_match, asset->etag) == 0)
+  {
+    httpd_resp_set_status(req, "304 Not Modified");
+    ret = httpd_resp_send(req, NULL, 0);
+    sent = 0;
+    metrics_inc(METRIC_WEB_ASSET_NOT_MODIFIED);
+  }
+  else
+  {
+    // Every browser we serve accepts gzip, so there is no uncompressed copy
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    ret = httpd_resp_send(req, (const char *)asset->data, asset->size);
+    sent = asset->size;
+  }
+
+  int64_t elapsed = esp_timer_get_time() - start;
+  metrics_inc(METRIC_WEB_ASSET_REQUESTS);
+  metrics_add(METRIC_WEB_ASSET_BYTES, sent);
+  metrics_observe(METRIC_WEB_ASSET_LATENCY, elapsed);
+  BINLOGD(TAG, "GET %s: %u body bytes in %lu us", asset->uri, (unsigned)sent, (unsigned long)elapsed);
+  return ret;
 }
 
-static esp_err_t post_handler(httpd_req_t *req)
+// Single entry point for every GET and POST, resolves the route table first and
+// falls back to the embedded web UI for GETs
+static esp_err_t dispatch_handler(httpd_req_t *req)
 {
-  ESP_LOGI(TAG, "Button clicked! Event triggered. URI: %s", req->uri);
+  char path[64];
+  if (!request_path(req->uri, path, sizeof(path)))
+  {
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Invalid URI");
+  }
 
-  if (strcmp(req->uri, "/start") == 0)
+  metrics_inc(METRIC_HTTP_SERVER_REQUESTS);
+  bool path_known;
+  const web_route_t *route = web_route_find(path, req->method, &path_known);
+  if (route != NULL)
   {
-    start_recording(req);
+    httpd_resp_set_type(req, route->content_type);
+    return route->handler(req);
   }
-  else if (strcmp(req->uri, "/stop") == 0)
+  if (req->method == HTTP_GET && !path_known)
   {
-    stop_recording(req);
+    return get_handler(req, path);
   }
-  else if (strcmp(req->uri, "/info") == 0)
+
+  ESP_LOGE(TAG, "Invalid URI: %s", req->uri);
+  if (path_known)
   {
-    get_camera_info(req);
+    return httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
   }
-  else if (strcmp(req->uri, "/shutter_start") == 0)
+  return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Invalid URI");
+}
+
+// Writes the selected fields of every camera as {"seq":n,"cams":[{"id":0,...}]}
+static size_t ws_serialize(char *buf, size_t size, uint32_t seq,
+                           const camera_state_t *cams, const uint8_t *fields)
+{
+  size_t len = snprintf(buf, size, "{\"seq\":%lu,\"cams\":[", (unsigned long)seq);
+  bool first = true;
+  for (int i = 0; i < MAX_CAMERAS && len < size; i++)
   {
-    start_recording_ble();
+    if (fields[i] == 0)
+    {
+      continue;
+    }
+    len += snprintf(buf + len, size - len, "%s{\"id\":%d", first ? "" : ",", i);
+    first = false;
+    if ((fields[i] & CAMERA_FIELD_RECORDING) && len < size)
+    {
+      len += snprintf(buf + len, size - len, ",\"rec\":%d", cams[i].recording);
+    }
+    if ((fields[i] & CAMERA_FIELD_BATTERY) && len < size)
+    {
+      len += snprintf(buf + len, size - len, ",\"bat\":%d", cams[i].battery);
+    }
+    if ((fields[i] & CAMERA_FIELD_SD_REMAINING) && len < size)
+    {
+      len += snprintf(buf + len, size - len, ",\"sd\":%ld", (long)cams[i].sd_remaining);
+    }
+    if ((fields[i] & CAMERA_FIELD_RSSI) && len < size)
+    {
+      len += snprintf(buf + len, size - len, ",\"rssi\":%d", cams[i].rssi);
+    }
+    if ((fields[i] & CAMERA_FIELD_LINK_QUALITY) && len < size)
+    {
+      len += snprintf(buf + len, size - len, ",\"lq\":%u", cams[i].link_quality);
+    }
+    if (len < size)
+    {
+      len += snprintf(buf + len, size - len, "}");
+    }
   }
-  else if (strcmp(req->uri, "/startscan") == 0)
+  if (len < size)
   {
-    ESP_LOGI(TAG, "Start scan requested");
-    ble_gopro_scan();
-    httpd_resp_send(req, "BLE scan initiated.", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    len += snprintf(buf + len, size - len, "]}");
   }
-  else if (strcmp(req->uri, "/stopscan") == 0)
+  return len < size ? len : size - 1;
+}
+
+// Runs on the server task and sends one update to every WebSocket client
+static void ws_broadcast_work(void *arg)
+{
+  ws_broadcast_t *msg = arg;
+  int client_fds[HTTP_MAX_CLIENTS];
+  size_t clients = HTTP_MAX_CLIENTS;
+
+  if (httpd_get_client_list(server_handle, &clients, client_fds) == ESP_OK)
   {
-    ESP_LOGI(TAG, "Stop scan requested");
-    // ble_gopro_discovery_stop();
-    httpd_resp_send(req, "BLE scan cancelled.", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)msg->payload,
+        .len = msg->len};
+    for (size_t i = 0; i < clients; i++)
+    {
+      if (httpd_ws_get_fd_info(server_handle, client_fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+      {
+        httpd_ws_send_frame_async(server_handle, client_fds[i], &frame);
+      }
+    }
   }
-  else
+  free(msg);
+}
+
+// Waits for camera state changes and pushes them out at most once per frame
+// interval, so a burst of changes costs one serialisation for all clients
+static void ws_push_task(void *arg)
+{
+  camera_state_t cams[MAX_CAMERAS];
+  uint8_t fields[MAX_CAMERAS];
+
+  while (1)
+  {
+    camera_state_wait(portMAX_DELAY);
+    const runtime_config_t *config = config_store_acquire();
+    uint32_t interval_ms = config->ws_push_interval_ms;
+    config_store_release(config);
+    vTaskDelay(pdMS_TO_TICKS(interval_ms));
+
+    uint32_t seq = camera_state_collect(cams, fields);
+    if (seq == 0)
+    {
+      continue;
+    }
+    ws_broadcast_t *msg = malloc(sizeof(ws_broadcast_t));
+    if (msg == NULL)
+    {
+      ESP_LOGE(TAG, "No memory for camera update %lu", (unsigned long)seq);
+      continue;
+    }
+    msg->len = ws_serialize(msg->payload, sizeof(msg->payload), seq, cams, fields);
+    metrics_inc(METRIC_WS_UPDATES);
+    if (httpd_queue_work(server_handle, ws_broadcast_work, msg) != ESP_OK)
+    {
+      free(msg);
+    }
+  }
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+  if (req->method == HTTP_GET)
   {
-    ESP_LOGE(TAG, "Invalid URI: %s", req->uri);
-    httpd_resp_send(req, "Invalid URI", HTTPD_RESP_USE_STRLEN);
+    // Handshake is done, bring the new client up to date with a full snapshot
+    camera_state_t cams[MAX_CAMERAS];
+    uint8_t fields[MAX_CAMERAS];
+    char payload[WS_MSG_SIZE];
+
+    uint32_t seq = camera_state_snapshot(cams);
+    memset(fields, CAMERA_FIELD_ALL, sizeof(fields));
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)payload,
+        .len = ws_serialize(payload, sizeof(payload), seq, cams, fields)};
+    ESP_LOGI(TAG, "WebSocket client connected");
+    return httpd_ws_send_frame(req, &frame);
+  }
+
+  // Clients have nothing to tell us yet, read and drop whatever they send
+  httpd_ws_frame_t frame = {0};
+  esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+  if (ret != ESP_OK || frame.len == 0)
+  {
+    return ret;
+  }
+  if (frame.len > WS_MAX_RX_LEN)
+  {
+    ESP_LOGE(TAG, "WebSocket frame too long: %u", (unsigned)frame.len);
     return ESP_FAIL;
   }
-  httpd_resp_send(req, "Action triggered on ESP32.", HTTPD_RESP_USE_STRLEN);
-  return ESP_OK;
+  uint8_t buffer[WS_MAX_RX_LEN];
+  frame.payload = buffer;
+  return httpd_ws_recv_frame(req, &frame, sizeof(buffer));
 }
 
 void server_initiation(void)
 {
-  httpd_handle_t server_handle = NULL;
   httpd_config_t server_config = HTTPD_DEFAULT_CONFIG();
+  server_config.max_open_sockets = HTTP_MAX_CLIENTS;
+  server_config.uri_match_fn = httpd_uri_match_wildcard;
+
+  // The dispatcher binary searches the table, out of order it would miss
+  // routes, so refuse to serve at all
+  if (!web_routes_check())
+  {
+    ESP_LOGE(TAG, "Route table not sorted, HTTP server not started");
+    return;
+  }
 
   // Start the HTTP Server
   esp_err_t ret = httpd_start(&server_handle, &server_config);
@@ -91,61 +300,36 @@ void server_initiation(void)
     return;
   }
 
-  // Register the GET handler
-  httpd_uri_t uri_get = {
-      .uri = "/",
+  // Register the WebSocket endpoint for live camera state
+  httpd_uri_t uri_ws = {
+      .uri = "/ws",
       .method = HTTP_GET,
-      .handler = get_handler,
-      .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_get);
+      .handler = ws_handler,
+      .user_ctx = NULL,
+      .is_websocket = true};
+  httpd_register_uri_handler(server_handle, &uri_ws);
 
-  // Register the GET handler for camera info if needed
-  httpd_uri_t uri_info = {
-      .uri = "/info",
+  // Everything else goes through the route table, registered last so the
+  // wildcard does not shadow the WebSocket endpoint
+  httpd_uri_t uri_get = {
+      .uri = "/*",
       .method = HTTP_GET,
-      .handler = post_handler,
-      .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_info);
-
-  // Register the POST handler for start recording
-  httpd_uri_t uri_start = {
-      .uri = "/start",
-      .method = HTTP_POST,
-      .handler = post_handler,
-      .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_start);
-
-  // Register the POST handler for stop recording
-  httpd_uri_t uri_stop = {
-      .uri = "/stop",
-      .method = HTTP_POST,
-      .handler = post_handler,
+      .handler = dispatch_handler,
       .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_stop);
-
-  // Register the POST handler for starting BLE scanning
-  httpd_uri_t uri_startscan = {
-      .uri = "/startscan",
-      .method = HTTP_POST,
-      .handler = post_handler,
-      .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_startscan);
+  httpd_register_uri_handler(server_handle, &uri_get);
 
-  // Register the POST handler for starting BLE scanning
-  httpd_uri_t uri_stopscan = {
-      .uri = "/stopscan",
+  httpd_uri_t uri_post = {
+      .uri = "/*",
       .method = HTTP_POST,
-      .handler = post_handler,
+      .handler = dispatch_handler,
       .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_stopscan);
+  httpd_register_uri_handler(server_handle, &uri_post);
 
-  // Register the POST handler for starting BLE pairing
-  httpd_uri_t uri_shutter_start = {
-      .uri = "/shutter_start",
-      .method = HTTP_POST,
-      .handler = post_handler,
-      .user_ctx = NULL};
-  httpd_register_uri_handler(server_handle, &uri_shutter_start);
+  TaskHandle_t push_task;
+  if (xTaskCreate(ws_push_task, "ws_push_task", 3072, NULL, 5, &push_task) == pdPASS)
+  {
+    metrics_register_task(push_task);
+  }
 
   ESP_LOGI(TAG, "HTTP server started and handlers registered");
 }
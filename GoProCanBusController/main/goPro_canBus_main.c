@@ -1,39 +1,26 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
-#include "esp_spiffs.h"
 
 #include "softAP.h"
 #include "webServer.h"
 #include "ble_gopro.h"
+#include "cameraState.h"
+#include "udpServer.h"
+#include "persist.h"
+#include "metrics.h"
+#include "configStore.h"
+#include "linkMonitor.h"
+#include "timerWheel.h"
+#include "binLog.h"
+#include "canBus.h"
+#include "timeSync.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "benchmark.h"
+#include "canReplay.h"
+#endif
 
 static const char *TAG = "GoPro ESP32";
 
-void init_spiffs(void)
-{
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = "storage", // Use the label from partitions.csv
-        .max_files = 5,
-        .format_if_mount_failed = true};
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to mount SPIFFS: %s", esp_err_to_name(ret));
-        return;
-    }
-
-    size_t total = 0, used = 0;
-    ret = esp_spiffs_info("storage", &total, &used);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to get SPIFFS partition information: %s", esp_err_to_name(ret));
-    }
-    else
-    {
-        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
-    }
-}
 void app_main(void)
 {
     /* NVS flash initialization */
@@ -50,10 +37,43 @@ void app_main(void)
         return;
     }
 
+    // Before the softAP, which reads its records and configuration back at start-up
+    ret = persist_init();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "failed to start persistence, error code: %d ", ret);
+        return;
+    }
+    ret = config_store_init();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "failed to load the configuration, error code: %d ", ret);
+        return;
+    }
+    metrics_register_gauge("gopro_persist_writes_last_hour", "NVS records written in the last hour",
+                           persist_writes_last_hour);
+    metrics_register_gauge("gopro_persist_max_write_us", "Longest NVS write and commit since boot, in microseconds",
+                           persist_max_write_us);
+
+    binlog_init();
+    metrics_register_gauge("gopro_binlog_dropped", "Binary log records overwritten before the console drain printed them",
+                           binlog_dropped);
     ESP_LOGI(TAG, "ESP_WIFI_MODE_AP");
 
-    init_spiffs();
+    camera_state_init();
+    timer_service_init();
+    // Subscribes to station binds, before the access point starts
+    time_sync_init();
     wifi_init_softap();
+    udp_server_init();
+    link_monitor_init();
+    can_bus_init();
     server_initiation();
     ble_gopro_init();
+#if CONFIG_BENCHMARK_AT_BOOT
+    benchmark_start();
+#endif
+#if CONFIG_CAN_REPLAY_AT_BOOT
+    can_replay_start();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Compare a benchmark run of the host build against a baseline.
+
+Both files are the JSON the firmware writes with CONFIG_BENCHMARK_AT_BOOT.
+A benchmark regresses when its p50 or p99 grew by more than the threshold;
+failed samples in the new run always count as a regression. Benchmarks in
+only one of the files are listed but never fail the comparison.
+
+Usage: bench_compare.py [--threshold PERCENT] [--update] <baseline.json> <run.json>
+
+--update copies the run over the baseline after printing the comparison.
+Exits with 1 if anything regressed.
+"""
+
+import argparse
+import json
+import shutil
+import sys
+
+METRICS = ("p50", "p99")
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    if results.get("version") != 1:
+        sys.exit("%s: not a version 1 benchmark file" % path)
+    return {bench["name"]: bench for bench in results["benchmarks"]}
+
+
+def change(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float("inf")
+    return (new - old) * 100.0 / old
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed growth in percent (default 10)")
+    parser.add_argument("--update", action="store_true", help="make the run the new baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("run")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    run = load(args.run)
+
+    regressed = []
+    print("%-20s %4s %12s %12s %8s" % ("benchmark", "", "baseline", "run", "change"))
+    for name in sorted(set(baseline) | set(run)):
+        if name not in run:
+            print("%-20s only in the baseline" % name)
+            continue
+        if name not in baseline:
+            print("%-20s new" % name)
+            continue
+        old, new = baseline[name], run[name]
+        if new["failed"]:
+            regressed.append(name)
+            print("%-20s %d of %d samples failed" % (name, new["failed"], new["samples"] + new["failed"]))
+            continue
+        for metric in METRICS:
+            delta = change(old[metric], new[metric])
+            flag = ""
+            if delta > args.threshold:
+                flag = "  REGRESSED"
+                if name not in regressed:
+                    regressed.append(name)
+            print("%-20s %4s %10d%-2s %10d%-2s %+7.1f%%%s" % (
+                name, metric, old[metric], old["unit"], new[metric], new["unit"], delta, flag))
+
+    if regressed:
+        print("\n%d regressed beyond %.0f%%: %s" % (len(regressed), args.threshold, ", ".join(regressed)))
+    if args.update:
+        shutil.copyfile(args.run, args.baseline)
+        print("Baseline updated from %s" % args.run)
+    sys.exit(1 if regressed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Turn binary log records from GET /logs back into text.
+
+Records hold the addresses of their tag and format strings, not the text,
+so the firmware ELF the records came from is needed to look them up. The
+records of both cores are merged and printed oldest first, in the same form
+as the console drain.
+
+Usage: binlog_decode.py <firmware .elf> <dump file | http://host/logs>
+"""
+
+import re
+import struct
+import sys
+import urllib.request
+
+MAGIC = b"BLOG"
+VERSION = 1
+HEADER = struct.Struct("<4sHHIII")
+RECORD = struct.Struct("<IIIIBBBB5I")
+LEVELS = "NEWIDV"
+
+# One printf conversion: flags, width, precision, length and type
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|j|z|t)?([diouxXcsp%])")
+
+
+class Elf:
+    """Just enough of a 32-bit little-endian ELF to read strings by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            sys.exit("%s: not a 32-bit little-endian ELF" % path)
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            # Loaded sections with contents in the file, NOBITS is .bss
+            if flags & 0x2 and sh_type != 8 and size:
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for base, offset, size in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.find(b"\0", start, offset + size)
+                return self.data[start:end if end >= 0 else offset + size].decode("utf-8", "replace")
+        return None
+
+
+def signed(word):
+    return word - (1 << 32) if word & 0x80000000 else word
+
+
+def render(elf, fmt, args):
+    words = iter(args)
+
+    def convert(match):
+        spec, _, kind = match.groups()
+        if kind == "%":
+            return "%"
+        word = next(words, 0)
+        if kind in "di":
+            return ("%" + spec + "d") % signed(word)
+        if kind == "u":
+            return ("%" + spec + "d") % word
+        if kind in "xXo":
+            return ("%" + spec + kind) % word
+        if kind == "c":
+            return ("%" + spec + "c") % (word & 0xff)
+        if kind == "p":
+            return "0x%08x" % word
+        text = elf.string(word)
+        return ("%" + spec + "s") % (text if text is not None else "<0x%08x>" % word)
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def load(source):
+    if source.startswith("http://") or source.startswith("https://"):
+        with urllib.request.urlopen(source, timeout=10) as response:
+            return response.read()
+    with open(source, "rb") as f:
+        return f.read()
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    elf = Elf(sys.argv[1])
+    data = load(sys.argv[2])
+
+    magic, version, record_size, now_us, dropped, count = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+        sys.exit("Not a version %d binary log" % VERSION)
+
+    records = []
+    for i in range(count):
+        offset = HEADER.size + i * RECORD.size
+        if offset + RECORD.size > len(data):
+            break
+        seq, time_us, tag, fmt, level, argc, core, _, *args = RECORD.unpack_from(data, offset)
+        # Zeroed slots were overwritten or still being written
+        if seq == 0:
+            continue
+        # Timestamps are 32 bits of microseconds, order by age so a wrap sorts right
+        age = (now_us - time_us) & 0xffffffff
+        records.append((-age, core, seq, time_us, tag, fmt, level, args[:argc]))
+
+    for _, core, _, time_us, tag, fmt, level, args in sorted(records):
+        tag_text = elf.string(tag) or "<0x%08x>" % tag
+        fmt_text = elf.string(fmt)
+        text = render(elf, fmt_text, args) if fmt_text is not None else "<format 0x%08x>" % fmt
+        letter = LEVELS[level] if level < len(LEVELS) else "?"
+        print("%s (%d) %s: %s" % (letter, time_us // 1000, tag_text, text))
+
+    if dropped:
+        print("%d records were overwritten before the console drain printed them" % dropped, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
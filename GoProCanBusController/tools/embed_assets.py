@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Minify and gzip the web UI into a C asset table.
+
+Every file under the data directory becomes one entry of `web_assets[]`,
+sorted by URI so the web server can binary search it. Each entry carries
+the gzip body, its MIME type and a strong ETag derived from the content.
+
+Usage: embed_assets.py <data dir> <output .c file>
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+TEXT_TYPES = {".html", ".css", ".js", ".json", ".svg"}
+
+
+def minify(data, ext):
+    """Cheap whitespace minifier that keeps line breaks so JS ASI still works."""
+    text = data.decode("utf-8")
+    if ext in (".html", ".svg"):
+        text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    if ext in (".css",):
+        text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line).encode("utf-8")
+
+
+def load_assets(data_dir):
+    assets = []
+    for root, _, files in os.walk(data_dir):
+        for name in files:
+            path = os.path.join(root, name)
+            ext = os.path.splitext(name)[1].lower()
+            uri = "/" + os.path.relpath(path, data_dir).replace(os.sep, "/")
+            with open(path, "rb") as f:
+                raw = f.read()
+            body = minify(raw, ext) if ext in TEXT_TYPES else raw
+            # mtime=0 keeps the output, and therefore the ETag, reproducible
+            packed = gzip.compress(body, compresslevel=9, mtime=0)
+            etag = '"%s"' % hashlib.sha256(packed).hexdigest()[:16]
+            mime = MIME_TYPES.get(ext, "application/octet-stream")
+            assets.append((uri, mime, etag, packed, len(raw)))
+    return sorted(assets, key=lambda a: a[0])
+
+
+def c_bytes(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(rows)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    data_dir, out_path = sys.argv[1], sys.argv[2]
+    assets = load_assets(data_dir)
+
+    out = ["// Generated by tools/embed_assets.py, do not edit", "", '#include "webAssets.h"', ""]
+    for i, (uri, _, _, packed, raw_size) in enumerate(assets):
+        out.append("// %s: %d bytes, %d gzipped" % (uri, raw_size, len(packed)))
+        out.append("static const uint8_t asset_%d[] = {" % i)
+        out.append(c_bytes(packed))
+        out.append("};")
+        out.append("")
+    out.append("const web_asset_t web_assets[] = {")
+    for i, (uri, mime, etag, packed, _) in enumerate(assets):
+        out.append('    {"%s", "%s", "%s", asset_%d, %d},'
+                   % (uri, mime, etag.replace('"', '\\"'), i, len(packed)))
+    out.append("};")
+    out.append("")
+    out.append("const size_t web_asset_count = %d;" % len(assets))
+    out.append("")
+
+    with open(out_path, "w") as f:
+        f.write("\n".join(out))
+
+    for uri, _, _, packed, raw_size in assets:
+        print("%-24s %6d -> %6d bytes" % (uri, raw_size, len(packed)))
+
+
+if __name__ == "__main__":
+    main()
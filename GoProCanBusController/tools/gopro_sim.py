@@ -0,0 +1,588 @@
+#!/usr/bin/env python3
+"""Simulated GoPro cameras for load and latency testing.
+
+Each camera listens on its own address and speaks what the controller uses:
+
+  HTTP (port 80)   the legacy /gp/gpControl API and the Open GoPro /gopro API
+  UDP (port 8484)  the Smart Remote protocol, replies go back to the sender
+  TCP (optional)   a byte-level model of the BLE GATT command, setting and
+                   query characteristics, for tools that drive BLE packets
+
+Delays, jitter and loss are applied per camera and per transport, and a few
+firmware quirks seen on real cameras can be switched on. Cameras get
+consecutive addresses from --first-ip, the same ones the linux build of the
+controller hands its simulated stations, so one process serves a whole
+fleet. Several processes with different --first-ip serve bigger ones.
+
+Usage: gopro_sim.py [--cameras N] [--first-ip 127.0.0.10] [--latency-ms 20]
+                    [--jitter-ms 5] [--loss 0.01] [--quirk busy=500] ...
+                    [--config cameras.json]
+
+--self-check runs one camera through every transport in-process and exits
+with 1 if any reply is wrong.
+
+--config takes a JSON list with one object per camera whose keys override
+the command line for that camera, e.g. [{"latency_ms": 80, "quirks":
+{"status_lag": 1500}}, {}]. Quirks:
+
+  busy=MS        shutter changes within MS of the last one are refused as busy
+  status_lag=MS  status reports the recording state as it was MS ago
+  wake=MS        the first command after idle=S seconds (default 30) is MS late
+  api=legacy     serve only /gp/gpControl, api=open only /gopro
+  no_remote      never answer the Smart Remote protocol
+  no_keepalive   close every HTTP connection after one response
+  clock_ms=MS    the camera's clock starts MS off real time
+  clock_ppm=PPM  and runs PPM fast, negative for slow
+
+Binding 127.0.0.x:80 needs root or CAP_NET_BIND_SERVICE; use --http-port to
+move it when the controller is pointed elsewhere.
+"""
+
+import argparse
+import asyncio
+import datetime
+import ipaddress
+import json
+import random
+import signal
+import struct
+import sys
+import time
+import urllib.parse
+
+# Smart Remote frame layout, see components/udpServer/include/remoteProtocol.h
+REMOTE_HEADER_LEN = 13
+REMOTE_DIRECTION_OFFSET = 9
+REMOTE_STATUS_OFFSET = 10
+REMOTE_OPCODE_OFFSET = 11
+REMOTE_DIR_REQUEST = 1
+REMOTE_STATUS_OK = 0
+REMOTE_STATUS_BUSY = 1
+REMOTE_SHUTTER_START = 0x02
+
+# Status ids of /gp/gpControl/status and /gopro/camera/state
+STATUS_BUSY = "8"
+STATUS_ENCODING = "10"
+STATUS_DATE_TIME = "40"
+STATUS_MODE = "43"
+STATUS_SD_REMAINING = "54"
+STATUS_BATTERY = "70"
+
+# BLE characteristics by their GP-XXXX number, each request one answers on the next
+BLE_COMMAND = 0x0072
+BLE_SETTINGS = 0x0074
+BLE_QUERY = 0x0076
+
+BLE_CMD_SHUTTER = 0x01
+BLE_CMD_SLEEP = 0x05
+BLE_CMD_SET_DATE_TIME = 0x0D
+BLE_CMD_HILIGHT = 0x18
+BLE_CMD_PRESET_GROUP = 0x3E
+BLE_QUERY_STATUS = 0x13
+
+BLE_STATUS_OK = 0
+BLE_STATUS_ERROR = 1
+BLE_STATUS_INVALID = 2
+
+# Mode numbers the controller's set_mode sends, Open GoPro preset groups 1000-1002
+PRESET_GROUP_BASE = 1000
+
+
+class Link:
+    """Delay and loss of one transport."""
+
+    def __init__(self, latency_ms, jitter_ms, loss):
+        self.latency_ms = latency_ms
+        self.jitter_ms = jitter_ms
+        self.loss = loss
+
+    def delay(self):
+        ms = self.latency_ms + random.uniform(-self.jitter_ms, self.jitter_ms)
+        return max(ms, 0) / 1000
+
+    def lost(self):
+        return random.random() < self.loss
+
+
+class Camera:
+    """State of one camera, shared by every transport it speaks."""
+
+    def __init__(self, index, ip, settings):
+        self.index = index
+        self.ip = ip
+        self.links = {t: Link(settings["%s_latency_ms" % t], settings["%s_jitter_ms" % t], settings["%s_loss" % t])
+                      for t in ("http", "remote", "ble")}
+        self.quirks = settings["quirks"]
+        self.mode = 0
+        self.settings = {"2": 1, "3": 8}
+        self.battery = 100 - index % 40
+        self.sd_remaining = 64 * 1024 * 1024
+        self.asleep = False
+        # Recording state over time, for status_lag
+        self.history = [(0.0, False)]
+        self.last_shutter = -1e9
+        self.last_command = time.monotonic()
+        self.counts = {}
+        # Camera clock minus real time as of clock_base, and its rate error
+        self.clock_offset = self.quirks.get("clock_ms", 0) / 1000
+        self.clock_ppm = self.quirks.get("clock_ppm", 0)
+        self.clock_base = time.time()
+        # Camera time of each HiLight
+        self.hilights = []
+
+    @property
+    def recording(self):
+        return self.history[-1][1]
+
+    def count(self, what):
+        self.counts[what] = self.counts.get(what, 0) + 1
+
+    def reported_recording(self):
+        """Recording state as the status reports it, late with status_lag."""
+        when = time.monotonic() - self.quirks.get("status_lag", 0) / 1000
+        state = self.history[0][1]
+        for changed, recording in self.history:
+            if changed > when:
+                break
+            state = recording
+        return state
+
+    def wake_delay(self):
+        """Extra delay of a command, with the wake quirk after idling."""
+        now = time.monotonic()
+        idle = now - self.last_command
+        self.last_command = now
+        if "wake" in self.quirks and idle > self.quirks.get("idle", 30):
+            return self.quirks["wake"] / 1000
+        return 0
+
+    def shutter(self, recording):
+        """Starts or stops recording, False if the camera is busy."""
+        self.count("shutter")
+        now = time.monotonic()
+        if recording == self.recording:
+            return True
+        if now - self.last_shutter < self.quirks.get("busy", 0) / 1000:
+            self.count("busy")
+            return False
+        self.last_shutter = now
+        self.history.append((now, recording))
+        # Only the part status_lag can still look back on is kept
+        horizon = now - self.quirks.get("status_lag", 0) / 1000 - 1
+        while len(self.history) > 2 and self.history[1][0] < horizon:
+            self.history.pop(0)
+        return True
+
+    def clock(self):
+        now = time.time()
+        return now + self.clock_offset + (now - self.clock_base) * self.clock_ppm * 1e-6
+
+    def set_clock(self, year, month, day, hour, minute, second):
+        """Sets the clock, the second it names starts now."""
+        self.count("set_date_time")
+        try:
+            when = datetime.datetime(year, month, day, hour, minute, second, tzinfo=datetime.timezone.utc)
+        except ValueError:
+            return False
+        self.clock_base = time.time()
+        self.clock_offset = when.timestamp() - self.clock_base
+        return True
+
+    def date_time(self):
+        """Clock as the legacy status reports it, %YY%MM%DD%hh%mm%ss in hex."""
+        t = datetime.datetime.fromtimestamp(int(self.clock()), datetime.timezone.utc)
+        return "".join("%%%02X" % v for v in (t.year % 100, t.month, t.day, t.hour, t.minute, t.second))
+
+    def hilight(self):
+        """Tags the moment, only while recording."""
+        self.count("hilight")
+        if not self.recording:
+            return False
+        self.hilights.append(self.clock())
+        return True
+
+    def busy(self):
+        return time.monotonic() - self.last_shutter < self.quirks.get("busy", 0) / 1000
+
+    def status(self):
+        return {
+            "status": {
+                STATUS_BUSY: int(self.busy()),
+                STATUS_ENCODING: int(self.reported_recording()),
+                STATUS_DATE_TIME: self.date_time(),
+                STATUS_MODE: self.mode,
+                STATUS_SD_REMAINING: self.sd_remaining,
+                STATUS_BATTERY: self.battery,
+            },
+            "settings": dict(self.settings),
+        }
+
+    # HTTP
+
+    def http(self, path, query):
+        """Answers one request, returns (status code, body)."""
+        api = self.quirks.get("api")
+        if path.startswith("/gp/gpControl/") and api != "open":
+            return self.http_legacy(path[len("/gp/gpControl/"):], query)
+        if path.startswith("/gopro/") and api != "legacy":
+            return self.http_open(path[len("/gopro/"):], query)
+        return 404, {}
+
+    def http_legacy(self, path, query):
+        if path == "status":
+            return 200, self.status()
+        if path == "command/shutter":
+            return (200, {}) if self.shutter(query.get("p") == "1") else (409, {})
+        if path == "command/setup/date_time":
+            # Six bytes, each sent as %XX and decoded to one character
+            fields = [ord(c) for c in query.get("p", "")]
+            if len(fields) != 6:
+                return 400, {}
+            fields[0] += 2000
+            return (200, {}) if self.set_clock(*fields) else (400, {})
+        if path == "command/storage/tag_moment":
+            return (200, {}) if self.hilight() else (409, {})
+        if path == "command/mode":
+            self.mode = int(query.get("p", 0))
+            return 200, {}
+        parts = path.split("/")
+        if len(parts) == 3 and parts[0] == "setting":
+            self.settings[parts[1]] = int(parts[2])
+            return 200, {}
+        return 404, {}
+
+    def http_open(self, path, query):
+        if path == "camera/state":
+            return 200, self.status()
+        if path == "camera/keep_alive":
+            return 200, {}
+        if path in ("camera/shutter/start", "camera/shutter/stop"):
+            return (200, {}) if self.shutter(path.endswith("start")) else (409, {"error": "busy"})
+        if path == "camera/set_date_time":
+            try:
+                fields = [int(v) for v in query["date"].split("_") + query["time"].split("_")]
+            except (KeyError, ValueError):
+                return 400, {"error": "bad date or time"}
+            return (200, {}) if len(fields) == 6 and self.set_clock(*fields) else (400, {"error": "bad date or time"})
+        if path == "camera/get_date_time":
+            t = datetime.datetime.fromtimestamp(int(self.clock()), datetime.timezone.utc)
+            return 200, {"date": "%d_%d_%d" % (t.year, t.month, t.day),
+                         "time": "%d_%d_%d" % (t.hour, t.minute, t.second)}
+        if path == "media/hilight/moment":
+            return (200, {}) if self.hilight() else (409, {"error": "not recording"})
+        if path == "camera/presets/set_group":
+            self.mode = int(query.get("id", PRESET_GROUP_BASE)) - PRESET_GROUP_BASE
+            return 200, {}
+        if path == "camera/setting":
+            self.settings[query.get("setting", "")] = int(query.get("option", 0))
+            return 200, {}
+        return 404, {}
+
+    # Smart Remote
+
+    def remote(self, frame):
+        """Reply to one request frame, None to stay silent."""
+        if len(frame) < REMOTE_HEADER_LEN or frame[REMOTE_DIRECTION_OFFSET] != REMOTE_DIR_REQUEST:
+            return None
+        opcode = frame[REMOTE_OPCODE_OFFSET:REMOTE_HEADER_LEN]
+        args = frame[REMOTE_HEADER_LEN:]
+        self.count("remote_" + opcode.decode("ascii", "replace"))
+        status = REMOTE_STATUS_OK
+        payload = b""
+        if opcode == b"wt":
+            self.asleep = False
+        elif self.asleep:
+            return None
+        elif opcode == b"st":
+            payload = bytes([self.mode, int(self.reported_recording())])
+        elif opcode == b"SH" and args:
+            status = REMOTE_STATUS_OK if self.shutter(args[0] == REMOTE_SHUTTER_START) else REMOTE_STATUS_BUSY
+        elif opcode == b"CM" and args:
+            self.mode = args[0]
+        elif opcode == b"PW" and args and args[0] == 0:
+            self.asleep = True
+        header = bytearray(REMOTE_HEADER_LEN)
+        header[REMOTE_STATUS_OFFSET] = status
+        header[REMOTE_OPCODE_OFFSET:REMOTE_HEADER_LEN] = opcode
+        return bytes(header) + payload
+
+    # BLE
+
+    def ble(self, characteristic, packet):
+        """Notifications for one GATT write, as (characteristic, bytes)."""
+        message = ble_unpack(packet)
+        if message is None or not message:
+            return []
+        self.count("ble")
+        ident, body = message[0], message[1:]
+        reply_to = characteristic + 1
+        if characteristic == BLE_COMMAND:
+            return [(reply_to, ble_pack(bytes([ident, self.ble_command(ident, body)])))]
+        if characteristic == BLE_SETTINGS:
+            # Setting id, then the value as a length-prefixed field
+            if len(body) >= 1 and len(body) >= 1 + body[0]:
+                self.settings[str(ident)] = int.from_bytes(body[1:1 + body[0]], "big")
+                return [(reply_to, ble_pack(bytes([ident, BLE_STATUS_OK])))]
+            return [(reply_to, ble_pack(bytes([ident, BLE_STATUS_INVALID])))]
+        if characteristic == BLE_QUERY and ident == BLE_QUERY_STATUS:
+            values = self.status()["status"]
+            out = bytearray([ident, BLE_STATUS_OK])
+            for status_id in body:
+                value = values.get(str(status_id))
+                if value is None:
+                    continue
+                # String statuses such as the date go out as their characters
+                if isinstance(value, str):
+                    data = value.encode("ascii")
+                else:
+                    data = int(value).to_bytes(4 if value > 0xff else 1, "big")
+                out += bytes([status_id, len(data)]) + data
+            return [(reply_to, ble_pack(bytes(out)))]
+        return [(reply_to, ble_pack(bytes([ident, BLE_STATUS_INVALID])))]
+
+    def ble_command(self, ident, body):
+        # Arguments come as a length and that many big-endian bytes
+        arg = int.from_bytes(body[1:1 + body[0]], "big") if body and len(body) >= 1 + body[0] else None
+        if ident == BLE_CMD_SHUTTER and arg is not None:
+            return BLE_STATUS_OK if self.shutter(arg != 0) else BLE_STATUS_ERROR
+        if ident == BLE_CMD_PRESET_GROUP and arg is not None:
+            self.mode = arg - PRESET_GROUP_BASE
+            return BLE_STATUS_OK
+        if ident == BLE_CMD_SET_DATE_TIME and body and body[0] == 7 and len(body) >= 8:
+            year = body[1] << 8 | body[2]
+            return BLE_STATUS_OK if self.set_clock(year, *body[3:8]) else BLE_STATUS_INVALID
+        if ident == BLE_CMD_HILIGHT:
+            return BLE_STATUS_OK if self.hilight() else BLE_STATUS_ERROR
+        if ident == BLE_CMD_SLEEP:
+            self.asleep = True
+            return BLE_STATUS_OK
+        return BLE_STATUS_INVALID
+
+
+def ble_pack(message):
+    """Single packet with the general 5-bit header, or the 13-bit one."""
+    if len(message) < 32:
+        return bytes([len(message)]) + message
+    return bytes([0x20 | len(message) >> 8, len(message) & 0xff]) + message
+
+
+def ble_unpack(packet):
+    """Message of a single packet, None for continuations and bad lengths."""
+    if not packet or packet[0] & 0x80:
+        return None
+    kind = packet[0] >> 5 & 0x3
+    if kind == 0:
+        length, start = packet[0] & 0x1f, 1
+    elif kind == 1 and len(packet) >= 2:
+        length, start = (packet[0] & 0x1f) << 8 | packet[1], 2
+    elif kind == 2 and len(packet) >= 3:
+        length, start = packet[1] << 8 | packet[2], 3
+    else:
+        return None
+    message = packet[start:start + length]
+    return message if len(message) == length else None
+
+
+async def serve_http(camera, reader, writer):
+    link = camera.links["http"]
+    keepalive = "no_keepalive" not in camera.quirks
+    try:
+        while True:
+            request = await reader.readline()
+            if not request:
+                break
+            headers = {}
+            while True:
+                line = await reader.readline()
+                if line in (b"\r\n", b"\n", b""):
+                    break
+                name, _, value = line.decode("latin-1").partition(":")
+                headers[name.strip().lower()] = value.strip()
+            if int(headers.get("content-length", 0)):
+                await reader.readexactly(int(headers["content-length"]))
+
+            parts = request.decode("latin-1").split()
+            url = urllib.parse.urlsplit(parts[1] if len(parts) > 1 else "/")
+            query = dict(urllib.parse.parse_qsl(url.query))
+            await asyncio.sleep(link.delay() + camera.wake_delay())
+            camera.count("http")
+            if link.lost():
+                camera.count("http_lost")
+                break
+
+            code, body = camera.http(url.path, query)
+            data = json.dumps(body).encode()
+            close = not keepalive or headers.get("connection", "").lower() == "close"
+            writer.write(b"HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+                         b"Connection: %s\r\n\r\n" % (code, b"OK" if code == 200 else b"Error", len(data),
+                                                      b"close" if close else b"keep-alive") + data)
+            await writer.drain()
+            if close:
+                break
+    except (ConnectionError, asyncio.IncompleteReadError):
+        pass
+    finally:
+        writer.close()
+
+
+class RemoteProtocol(asyncio.DatagramProtocol):
+    def __init__(self, camera):
+        self.camera = camera
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if "no_remote" in self.camera.quirks or self.camera.links["remote"].lost():
+            return
+        reply = self.camera.remote(data)
+        if reply is not None:
+            delay = self.camera.links["remote"].delay() + self.camera.wake_delay()
+            asyncio.get_running_loop().call_later(delay, self.transport.sendto, reply, addr)
+
+
+async def serve_ble(camera, reader, writer):
+    """One write per frame: characteristic (2 bytes), length, packet.
+    Notifications come back framed the same way."""
+    link = camera.links["ble"]
+    try:
+        while True:
+            characteristic, length = struct.unpack(">HB", await reader.readexactly(3))
+            packet = await reader.readexactly(length)
+            await asyncio.sleep(link.delay() + camera.wake_delay())
+            if link.lost():
+                camera.count("ble_lost")
+                continue
+            for notify, data in camera.ble(characteristic, packet):
+                writer.write(struct.pack(">HB", notify, len(data)) + data)
+            await writer.drain()
+    except (ConnectionError, asyncio.IncompleteReadError):
+        pass
+    finally:
+        writer.close()
+
+
+def parse_quirks(items):
+    quirks = {}
+    for item in items:
+        name, _, value = item.partition("=")
+        quirks[name] = value if name == "api" else (int(value) if value else True)
+    return quirks
+
+
+def camera_settings(args, override):
+    settings = {"quirks": dict(args.quirks)}
+    for transport in ("http", "remote", "ble"):
+        for field in ("latency_ms", "jitter_ms", "loss"):
+            key = "%s_%s" % (transport, field)
+            # Per-transport beats the camera's general value, which beats the command line
+            value = getattr(args, field)
+            value = override.get(field, value)
+            settings[key] = override.get(key, value)
+    settings["quirks"].update(override.get("quirks", {}))
+    return settings
+
+
+async def run(args):
+    overrides = []
+    if args.config:
+        with open(args.config) as f:
+            overrides = json.load(f)
+    first = ipaddress.IPv4Address(args.first_ip)
+    loop = asyncio.get_running_loop()
+    cameras = []
+    servers = []
+    for i in range(args.cameras):
+        ip = str(first + i)
+        camera = Camera(i, ip, camera_settings(args, overrides[i] if i < len(overrides) else {}))
+        cameras.append(camera)
+        servers.append(await asyncio.start_server(lambda r, w, c=camera: serve_http(c, r, w), ip, args.http_port))
+        await loop.create_datagram_endpoint(lambda c=camera: RemoteProtocol(c), local_addr=(ip, args.remote_port))
+        if args.ble_port:
+            servers.append(await asyncio.start_server(lambda r, w, c=camera: serve_ble(c, r, w), ip, args.ble_port))
+        print("camera %d on %s: http %d, remote %d%s, quirks %s" %
+              (i, ip, args.http_port, args.remote_port, ", ble %d" % args.ble_port if args.ble_port else "",
+               camera.quirks or "none"), file=sys.stderr)
+
+    # A harness stops the fleet with SIGTERM, the counts still get printed
+    stop = asyncio.Event()
+    loop.add_signal_handler(signal.SIGTERM, stop.set)
+    try:
+        await stop.wait()
+    finally:
+        for camera in cameras:
+            print("camera %d: %s, recording %s, clock %+.3f s, hilights at %s" %
+                  (camera.index, json.dumps(camera.counts, sort_keys=True), camera.recording,
+                   camera.clock() - time.time(), ["%.3f" % t for t in camera.hilights]), file=sys.stderr)
+
+
+def self_check():
+    """Drives one camera through each transport without sockets, returns the failures."""
+    settings = {"%s_%s" % (t, f): 0 for t in ("http", "remote", "ble") for f in ("latency_ms", "jitter_ms", "loss")}
+    settings["quirks"] = {}
+    camera = Camera(0, "127.0.0.10", settings)
+    failures = []
+
+    def check(name, ok):
+        print("%-28s %s" % (name, "ok" if ok else "FAILED"), file=sys.stderr)
+        if not ok:
+            failures.append(name)
+
+    def ble(characteristic, message):
+        replies = camera.ble(characteristic, ble_pack(message))
+        return ble_unpack(replies[0][1]) if len(replies) == 1 else None
+
+    def remote(opcode, args=b""):
+        frame = bytearray(REMOTE_HEADER_LEN)
+        frame[REMOTE_DIRECTION_OFFSET] = REMOTE_DIR_REQUEST
+        frame[REMOTE_OPCODE_OFFSET:REMOTE_HEADER_LEN] = opcode
+        return camera.remote(bytes(frame) + args)
+
+    reply = remote(b"st")
+    check("remote status", reply is not None and reply[REMOTE_HEADER_LEN:] == bytes([0, 0]))
+    reply = remote(b"SH", bytes([REMOTE_SHUTTER_START]))
+    check("remote shutter", reply is not None and reply[REMOTE_STATUS_OFFSET] == REMOTE_STATUS_OK
+          and camera.recording)
+
+    check("http status", camera.http("/gp/gpControl/status", {})[1]["status"][STATUS_ENCODING] == 1)
+    check("http hilight", camera.http("/gopro/media/hilight/moment", {})[0] == 200)
+
+    reply = ble(BLE_COMMAND, bytes([BLE_CMD_SHUTTER, 1, 0]))
+    check("ble shutter", reply == bytes([BLE_CMD_SHUTTER, BLE_STATUS_OK]) and not camera.recording)
+    reply = ble(BLE_SETTINGS, bytes([3, 1, 9]))
+    check("ble setting", reply == bytes([3, BLE_STATUS_OK]) and camera.settings["3"] == 9)
+
+    # Numbers, the date string and an id the camera does not know
+    reply = ble(BLE_QUERY, bytes([BLE_QUERY_STATUS, int(STATUS_ENCODING), int(STATUS_DATE_TIME), 250]))
+    date = camera.date_time().encode("ascii")
+    check("ble status query", reply == bytes([BLE_QUERY_STATUS, BLE_STATUS_OK, int(STATUS_ENCODING), 1, 0,
+                                              int(STATUS_DATE_TIME), len(date)]) + date)
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--cameras", type=int, default=4)
+    parser.add_argument("--first-ip", default="127.0.0.10")
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--remote-port", type=int, default=8484)
+    parser.add_argument("--ble-port", type=int, default=0, help="TCP port of the BLE model, 0 for none")
+    parser.add_argument("--latency-ms", type=float, default=20)
+    parser.add_argument("--jitter-ms", type=float, default=5)
+    parser.add_argument("--loss", type=float, default=0, help="share of requests dropped, 0 to 1")
+    parser.add_argument("--quirk", action="append", default=[], help="NAME[=VALUE], repeatable")
+    parser.add_argument("--config", help="JSON list of per-camera overrides")
+    parser.add_argument("--self-check", action="store_true", help="exercise one camera in-process and exit")
+    args = parser.parse_args()
+    if args.self_check:
+        sys.exit(1 if self_check() else 0)
+    args.quirks = parse_quirks(args.quirk)
+    try:
+        asyncio.run(run(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
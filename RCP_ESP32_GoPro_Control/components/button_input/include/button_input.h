@@ -0,0 +1,31 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+// Edge-interrupt button input. The first edge is reported at once from the
+// input task, then the pin's interrupt stays masked until a one-shot timer
+// confirms the level, so bounce never reaches the handler and nothing polls.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define BUTTON_INPUT_MAX 4
+
+typedef struct {
+    gpio_num_t gpio;
+    bool pressed;
+    int64_t edge_us;            // esp_timer time the edge was seen, in the ISR
+} button_event_t;
+
+// Runs on the input task, keep it short, the next edge waits for it
+typedef void (*button_handler_t)(const button_event_t *event, void *ctx);
+
+// Starts the input task and the GPIO ISR service
+esp_err_t button_input_init(void);
+
+// The pad is configured by the caller, this only takes over its interrupt
+esp_err_t button_input_add(gpio_num_t gpio, bool active_high, uint32_t debounce_ms,
+                           button_handler_t handler, void *ctx);
+
+#endif // BUTTON_INPUT_H
@@ -0,0 +1,133 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "timerWheel.h"
+#include "button_input.h"
+
+static const char *TAG = "button_input";
+
+typedef struct {
+    gpio_num_t gpio;
+    bool active_high;
+    uint32_t debounce_ms;
+    button_handler_t handler;
+    void *ctx;
+    bool pressed;               // Last state handed to the handler
+    timer_node_t settle;
+} button_t;
+
+// One level seen while the button's interrupt was masked
+typedef struct {
+    uint8_t index;
+    uint8_t level;
+    int64_t edge_us;
+} button_edge_t;
+
+static button_t buttons[BUTTON_INPUT_MAX];
+static int button_count;
+static QueueHandle_t edge_queue;
+
+static void IRAM_ATTR button_isr(void *arg) {
+    button_t *button = arg;
+    // Masked until the level has settled, bounce costs one interrupt
+    gpio_intr_disable(button->gpio);
+    button_edge_t edge = {
+        .index = button - buttons,
+        .level = gpio_get_level(button->gpio),
+        .edge_us = esp_timer_get_time(),
+    };
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(edge_queue, &edge, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool is_pressed(const button_t *button, int level) {
+    return (level != 0) == button->active_high;
+}
+
+// Debounce window over, runs on the timer service
+static void button_settle(timer_node_t *node, void *arg) {
+    button_t *button = arg;
+    button_edge_t edge = {.index = button - buttons};
+
+    edge.level = gpio_get_level(button->gpio);
+    if (is_pressed(button, edge.level) == button->pressed) {
+        gpio_intr_enable(button->gpio);
+        // An edge between the sample and unmasking raised no interrupt
+        if (gpio_get_level(button->gpio) == edge.level) {
+            return;
+        }
+        gpio_intr_disable(button->gpio);
+        edge.level = !edge.level;
+    }
+    // Changed while masked, report it and let it settle again
+    edge.edge_us = esp_timer_get_time();
+    xQueueSend(edge_queue, &edge, 0);
+}
+
+static void button_input_task(void *arg) {
+    button_edge_t edge;
+    while (1) {
+        if (!xQueueReceive(edge_queue, &edge, portMAX_DELAY)) {
+            continue;
+        }
+        button_t *button = &buttons[edge.index];
+        bool pressed = is_pressed(button, edge.level);
+        if (pressed != button->pressed) {
+            button->pressed = pressed;
+            button_event_t event = {
+                .gpio = button->gpio,
+                .pressed = pressed,
+                .edge_us = edge.edge_us,
+            };
+            button->handler(&event, button->ctx);
+        }
+        timer_service_start(&button->settle, button->debounce_ms, 0);
+    }
+}
+
+esp_err_t button_input_init(void) {
+    edge_queue = xQueueCreate(BUTTON_INPUT_MAX * 2, sizeof(button_edge_t));
+    if (edge_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Another component may have installed it already
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    // Above the Wi-Fi application tasks, a press goes out before anything else
+    if (xTaskCreate(button_input_task, "button_input", 3072, NULL, 10, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t button_input_add(gpio_num_t gpio, bool active_high, uint32_t debounce_ms,
+                           button_handler_t handler, void *ctx) {
+    if (edge_queue == NULL || button_count == BUTTON_INPUT_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    button_t *button = &buttons[button_count];
+    button->gpio = gpio;
+    button->active_high = active_high;
+    button->debounce_ms = debounce_ms;
+    button->handler = handler;
+    button->ctx = ctx;
+    button->pressed = is_pressed(button, gpio_get_level(gpio));
+    timer_node_init(&button->settle, button_settle, button);
+
+    esp_err_t err = gpio_set_intr_type(gpio, GPIO_INTR_ANYEDGE);
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(gpio, button_isr, button);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to take over GPIO %d: %s", gpio, esp_err_to_name(err));
+        return err;
+    }
+    button_count++;
+    gpio_intr_enable(gpio);
+    return ESP_OK;
+}
@@ -18,6 +18,7 @@
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <netdb.h>
 #include "nvs_flash.h"
 #include "esp_types.h"
@@ -29,6 +30,11 @@
 #include "lwip/sys.h"
 
 #include "camera_control.h"
+#include "stationTable.h"
+#include "persist.h"
+#include "timerWheel.h"
+#include "button_input.h"
+#include "binLog.h"
 
 #define EXAMPLE_WIFI_SSID             "HERO-RC-000000"
 #define EXAMPLE_WIFI_PASS             ""
@@ -39,16 +45,11 @@
 #define EXAMPLE_STATIC_GW_ADDR        "10.71.79.1"
 
 #define BUTTON_GPIO 4
+#define BUTTON_DEBOUNCE_MS 20
 
 #define MAX_CAMERAS                   4
 
 esp_netif_t* ap_netif = NULL;
-static QueueHandle_t button_event_queue = NULL;
-
-typedef struct {
-    uint8_t mac[6];     // MAC address
-    uint32_t ip;        // IP address (32-bit)
-} CameraInfo;
 
 void button_init() {
     gpio_config_t io_conf;
@@ -67,70 +68,43 @@ uint8_t newMacAddress[6] = {0xd8, 0x96, 0x85, 0x00, 0x00, 0x00};
 
 static const char *TAG = "wifi softAP";
 
-// Function to save an array of IP-MAC pairs in NVS
-void save_camera_info_array_to_nvs(CameraInfo *pairs, int num_pairs) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_flash_init();
-    ESP_ERROR_CHECK(err);
-
-    // Open NVS partition
-    err = nvs_open("storage", NVS_READWRITE, &nvs_handle);
-    ESP_ERROR_CHECK(err);
-
-    // Save the IP-MAC pair array to NVS
-    err = nvs_set_blob(nvs_handle, "ip_mac_pairs", pairs, sizeof(CameraInfo) * num_pairs);
-    ESP_ERROR_CHECK(err);
-
-    // Commit the changes to NVS
-    err = nvs_commit(nvs_handle);
-    ESP_ERROR_CHECK(err);
+// Which MAC owns which camera slot, written by the persistence task instead
+// of from the event handler
+static void cameras_snapshot(void *buf, void *ctx) {
+    station_table_save_slots(buf);
+}
 
-    // Close the NVS handle
-    nvs_close(nvs_handle);
+static const persist_record_t cameras_record = {
+    .key = "cameras",
+    .version = 1,
+    .size = sizeof(station_slots_t),
+    .snapshot = cameras_snapshot,
+};
 
-    ESP_LOGI(TAG, "Camera Saved");
-}
+static persist_id_t cameras_id = -1;
 
-// Function to retrieve an array of IP-MAC pairs from NVS
-void retrieve_camera_info_array_from_nvs(CameraInfo *pairs, int num_pairs) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_flash_init();
-    ESP_ERROR_CHECK(err);
-
-    // Open NVS partition
-    err = nvs_open("storage", NVS_READONLY, &nvs_handle);
-    ESP_ERROR_CHECK(err);
-
-    // Read the IP-MAC pair array from NVS
-    size_t required_size = sizeof(CameraInfo) * num_pairs;
-    err = nvs_get_blob(nvs_handle, "ip_mac_pairs", pairs, &required_size);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Error reading IP-MAC pairs from NVS");
+static void station_bound(int camera, const station_t *station, bool bound) {
+    if (bound) {
+        persist_mark_dirty(cameras_id);
     }
-
-    // Close the NVS handle
-    nvs_close(nvs_handle);
 }
 
-
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                     int32_t event_id, void* event_data)
 {
     if (event_id == WIFI_EVENT_AP_STACONNECTED) {
         wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
-        ESP_LOGI(TAG, "station " MACSTR " join, AID=%d",
-                 MAC2STR(event->mac), event->aid);
-
-        CameraInfo camera_array[MAX_CAMERAS];
-        uint32_t ip = (10) | (71) | (79) | (2);
-        memcpy(camera_array[0].mac, event->mac, sizeof(event->mac));
-        camera_array[0].ip = ip;
-        save_camera_info_array_to_nvs(camera_array, MAX_CAMERAS);
+        // The camera record is bound to its address once the DHCP ACK arrives
+        int camera = station_table_connected(event->mac, event->aid,
+                                             (uint32_t)(esp_timer_get_time() / 1000));
+        ESP_LOGI(TAG, "station " MACSTR " join, AID=%d, camera %d",
+                 MAC2STR(event->mac), event->aid, camera);
 
     } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
         wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
-        ESP_LOGI(TAG, "station "MACSTR" leave, AID=%d",
-                 MAC2STR(event->mac), event->aid);
+        int camera = station_table_disconnected(event->mac);
+        ESP_LOGI(TAG, "station "MACSTR" leave, AID=%d, camera %d",
+                 MAC2STR(event->mac), event->aid, camera);
     }
 }
 
@@ -141,7 +115,9 @@ static void dhcp_event_handler(void* arg, esp_event_base_t event_base,
     {
     case IP_EVENT_AP_STAIPASSIGNED:
         ip_event_ap_staipassigned_t *event = (ip_event_ap_staipassigned_t *)event_data;
-        ESP_LOGI("IP_EVENT", "A device was assigned this IP:" IPSTR, IP2STR(&event->ip));
+        int camera = station_table_ip_assigned(event->mac, event->ip.addr,
+                                               (uint32_t)(esp_timer_get_time() / 1000));
+        ESP_LOGI("IP_EVENT", "Camera %d was assigned this IP:" IPSTR, camera, IP2STR(&event->ip));
         break;
 
     default:
@@ -192,6 +168,18 @@ void wifi_init_softap(void)
  
     ESP_ERROR_CHECK(esp_netif_set_ip_info(ap_netif, &ip_info));
     esp_netif_dhcps_start(ap_netif);
+
+    uint32_t lease_minutes = 120;
+    esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_GET, ESP_NETIF_IP_ADDRESS_LEASE_TIME,
+                           &lease_minutes, sizeof(lease_minutes));
+    station_table_init(lease_minutes * 60 * 1000);
+
+    cameras_id = persist_register(&cameras_record);
+    station_slots_t saved;
+    if (persist_load(cameras_id, &saved) == ESP_OK) {
+        station_table_restore_slots(&saved);
+    }
+    station_table_subscribe(station_bound);
     /* STATIC IP ENDS*/
  
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
@@ -201,70 +189,62 @@ void wifi_init_softap(void)
              EXAMPLE_WIFI_SSID, EXAMPLE_WIFI_PASS, EXAMPLE_ESP_WIFI_CHANNEL); 
 }
 
-#define PORT 8384 // Port of the UDP server
-#define HOST_IP_ADDR "10.0.10.71.79.2" // IP address of the UDP server
-
-static void IRAM_ATTR button_isr_handler(void* arg) {
-    uint32_t gpio_num = (uint32_t) arg;
-    xQueueSendFromISR(button_event_queue, &gpio_num, NULL);
-}
-
-void udp_client_task(void *pvParameters) {
-    char message[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x53, 0x48, 0x02};
-    int addr_family = AF_INET;
-    int ip_protocol = IPPROTO_IP;
-    struct sockaddr_in dest_addr;
+#define PORT 8484 // Smart Remote port the camera listens on
 
-    dest_addr.sin_addr.s_addr = inet_addr(HOST_IP_ADDR);
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(PORT);
+static const char shutter_message[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x53, 0x48, 0x02};
+static int shutter_sock = -1;
+static int64_t worst_press_us;
 
-    int sock = socket(addr_family, SOCK_DGRAM, ip_protocol);
-    if (sock < 0) {
+// Opened once at start-up, so a press only pays for the sends
+static esp_err_t shutter_init(void) {
+    shutter_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (shutter_sock < 0) {
         ESP_LOGE("UDP", "Unable to create socket: errno %d", errno);
-        vTaskDelete(NULL);
-        return;
+        return ESP_FAIL;
     }
-    ESP_LOGI("UDP", "Socket created, sending to %s:%d", HOST_IP_ADDR, PORT);
+    ESP_LOGI("UDP", "Socket created, sending to port %d", PORT);
+    return ESP_OK;
+}
 
-    uint32_t io_num;
-    while (1)
+// Every camera that currently holds a lease, returns how many were sent to
+static int shutter_fan_out(void) {
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+    };
+    int sent = 0;
+    for (int camera = 0; camera < STATION_TABLE_MAX; camera++)
     {
-        if (xQueueReceive(button_event_queue, &io_num, portMAX_DELAY))
+        if (!station_table_camera_ip(camera, &dest_addr.sin_addr.s_addr))
         {
-            ESP_LOGI("UDP", "Button pressed, sending packet");
-            int err = sendto(sock, message, strlen(message), 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-            if (err < 0)
-            {
-                ESP_LOGE("UDP", "Error occurred during sending: errno %d", errno);
-                break;
-            }
-            ESP_LOGI("UDP", "Message sent");
+            continue;
         }
+        int err = sendto(shutter_sock, shutter_message, sizeof(shutter_message), 0,
+                         (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+        if (err < 0)
+        {
+            ESP_LOGE("UDP", "Error occurred sending to camera %d: errno %d", camera, errno);
+            continue;
+        }
+        sent++;
     }
-
-    if (sock != -1)
-    {
-        ESP_LOGI("UDP", "Shutting down socket");
-        shutdown(sock, 0);
-        close(sock);
-    }
-    vTaskDelete(NULL);
+    return sent;
 }
 
-void button_task(void* arg) {
-    int last_state = 0;
-    while (1) {
-        int state = gpio_get_level(BUTTON_GPIO);
-        if (state != last_state) {
-            last_state = state;
-            if (state == 1) { // Assuming the button is active-high
-                ESP_LOGI("Button", "Button pressed!");
-                // camera_start_recording();
-            }
-        }
-        vTaskDelay(10 / portTICK_PERIOD_MS); // Debouncing delay
+// Runs on the input task straight after the edge, no queue hop to a sender
+static void button_changed(const button_event_t *event, void *ctx) {
+    if (!event->pressed) {
+        return;
+    }
+    int sent = shutter_fan_out();
+    int64_t latency_us = esp_timer_get_time() - event->edge_us;
+    if (latency_us > worst_press_us) {
+        worst_press_us = latency_us;
     }
+    // Logged after the sends, and without formatting, so it barely adds to
+    // the latency it reports
+    BINLOGI("Button", "Shutter sent to %d cameras %lu us after the press, worst %lu us",
+            sent, (unsigned long)latency_us, (unsigned long)worst_press_us);
 }
 
 void app_main(void)
@@ -276,6 +256,10 @@ void app_main(void)
       ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    ESP_ERROR_CHECK(persist_init());
+    binlog_init();
+    // Debounces the button
+    timer_service_init();
 
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
@@ -284,18 +268,11 @@ void app_main(void)
 
     wifi_init_softap();
 
-    // CameraInfo retrieved_array[MAX_CAMERAS];
-    // retrieve_camera_info_array_from_nvs(retrieved_array, MAX_CAMERAS);
-    // ESP_LOGI("NVS", "Saved camera is "MACSTR" and IP is what",
-    //         MAC2STR(retrieved_array[0].mac));
-
     button_init();
 
-    xTaskCreate(button_task, "button_task", 2048, NULL, 10, NULL);
-
-    button_event_queue = xQueueCreate(10, sizeof(uint32_t));
-    gpio_install_isr_service(0);
-    gpio_isr_handler_add(BUTTON_GPIO, button_isr_handler, (void*) BUTTON_GPIO);
+    ESP_ERROR_CHECK(shutter_init());
+    ESP_ERROR_CHECK(button_input_init());
+    ESP_ERROR_CHECK(button_input_add(BUTTON_GPIO, false, BUTTON_DEBOUNCE_MS, button_changed, NULL));
 
 // Set up UDP connection to the camera
     const char *ip = "10.71.79.2"; // Replace with your camera's IP address
@@ -303,9 +280,6 @@ void app_main(void)
 
     camera_setup_udp(ip,port);
 
-    // // Start UDP client task
-    // xTaskCreate(udp_client_task, "udp_client", 4096, NULL, 5, NULL);
-
 }
 
 